@@ -25,6 +25,7 @@ typedef enum {
     XPROF_StringClean,
     XPROF_StringInitBuf,
     XPROF_StringReset,
+    XPROF_StringUnshare,
     XPROF_aclCheckFast,
     XPROF_aclMatchAclList,
     XPROF_calloc,
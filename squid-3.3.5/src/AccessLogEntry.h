@@ -38,6 +38,7 @@
 #include "icp_opcode.h"
 #include "ip/Address.h"
 #include "HttpRequestMethod.h"
+#include "PhaseTimes.h"
 #if ICAP_CLIENT
 #include "adaptation/icap/Elements.h"
 #endif
@@ -212,6 +213,23 @@ public:
     } adapt;
 #endif
 
+#if USE_SQUID_ESI
+    /** \brief This subclass holds ESI processing details of the response.
+     * \todo Inner class declarations should be moved outside.
+     */
+    class EsiDetails
+    {
+
+    public:
+        EsiDetails(): processingTime(-1), includes(0), peakIncludes(0), waitedIncludes(0) {}
+
+        int processingTime; ///< msec from template reply to processed page, or -1
+        int includes; ///< esi:include fetches started
+        int peakIncludes; ///< the most esi:include fetches at the same time
+        int waitedIncludes; ///< includes delayed by esi_max_parallel_includes
+    } esi;
+#endif
+
     // Why is this a sub-class and not a set of real "private:" fields?
     // It looks like its duplicating HTTPRequestMethod anyway!
     // TODO: shuffle this to the relevant protocol section OR replace with request->method
@@ -224,6 +242,7 @@ public:
         const char *method_str;
     } _private;
     HierarchyLogEntry hier;
+    PhaseTimes phases; ///< time spent in each processing phase
     HttpReply *reply;
     HttpRequest *request; //< virgin HTTP request
     HttpRequest *adapted_request; //< HTTP request after adaptation and redirection
@@ -10,6 +10,10 @@
 
 #if USE_DELAY_POOLS
 class CommQuotaQueue;
+namespace Ipc
+{
+class TokenBucket;
+}
 #endif
 
 class ClientInfo
@@ -47,6 +51,8 @@ public:
     int rationedCount; ///< number of clients that will receive rationedQuota
     bool selectWaiting; ///< is between commSetSelect and commHandleWrite
     bool eventWaiting; ///< waiting for commHandleWriteHelper event to fire
+    uint64_t sharedQuotaKey; ///< identifies our bucket among SMP workers
+    Ipc::TokenBucket *sharedQuota; ///< bucket shared by SMP workers or nil
 
     // all those functions access Comm fd_table and are defined in comm.cc
     bool hasQueue() const;  ///< whether any clients are waiting for write quota
@@ -58,6 +64,8 @@ public:
     void kickQuotaQueue(); ///< schedule commHandleWriteHelper call
     int quotaForDequed(); ///< allocate quota for a just dequeued client
     void refillBucket(); ///< adds bytes to bucket based on rate and time
+    void drainSharedBucket(const int bytes); ///< removes written bytes from the shared bucket, if any
+    Ipc::TokenBucket *sharedBucket(); ///< the bucket shared by SMP workers or nil
 
     void quotaDumpQueue(); ///< dumps quota queue for debugging
 
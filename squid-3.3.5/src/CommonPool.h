@@ -53,7 +53,8 @@ class CommonPool
 public:
     void *operator new(size_t);
     void operator delete (void *);
-    static CommonPool *Factory (unsigned char _class, CompositePoolNode::Pointer&);
+    /// creates a pool of the given class; pool is the zero-based pool number
+    static CommonPool *Factory (unsigned char _class, CompositePoolNode::Pointer&, unsigned short pool);
     char const* theClassTypeLabel() const {return typeLabel.termedBuf();}
 
 protected:
@@ -38,10 +38,25 @@
 
 #if USE_DELAY_POOLS
 #include "DelayBucket.h"
+#include "DelayPools.h"
 #include "DelaySpec.h"
+#include "ipc/TokenBuckets.h"
 #include "SquidConfig.h"
+#include "SquidTime.h"
 #include "Store.h"
 
+#if HAVE_LIMITS_H
+#include <limits.h>
+#endif
+
+int
+DelayBucket::level() const
+{
+    if (Ipc::TokenBucket *bucket = sharedBucket())
+        return bucket->tokens();
+    return level_;
+}
+
 void
 DelayBucket::stats(StoreEntry *entry)const
 {
@@ -51,9 +66,18 @@ DelayBucket::stats(StoreEntry *entry)const
 void
 DelayBucket::update(DelaySpec const &rate, int incr)
 {
-    if (rate.restore_bps != -1 &&
-            (level() += rate.restore_bps * incr) > rate.max_bytes)
-        level() = rate.max_bytes;
+    if (rate.restore_bps == -1)
+        return;
+
+    if (Ipc::TokenBucket *bucket = sharedBucket()) {
+        // kids refill at different times; the bucket adds what has accrued
+        const int limit = static_cast<int>(min(rate.max_bytes, static_cast<int64_t>(INT_MAX)));
+        bucket->refill(static_cast<int64_t>(current_dtime * 1000), rate.restore_bps, limit);
+        return;
+    }
+
+    if ((level_ += rate.restore_bps * incr) > rate.max_bytes)
+        level_ = rate.max_bytes;
 }
 
 int
@@ -66,14 +90,31 @@ DelayBucket::bytesWanted(int minimum, int maximum) const
 void
 DelayBucket::bytesIn(int qty)
 {
-    level() -= qty;
+    if (Ipc::TokenBucket *bucket = sharedBucket())
+        bucket->consume(qty);
+    else
+        level_ -= qty;
 }
 
 void
 DelayBucket::init(DelaySpec const &rate)
 {
-    level() = (int) (((double)rate.max_bytes *
-                      Config.Delay.initial) / 100);
+    level_ = (int) (((double)rate.max_bytes *
+                     Config.Delay.initial) / 100);
+}
+
+/// the shared bucket for our key, if we can share one
+Ipc::TokenBucket *
+DelayBucket::sharedBucket() const
+{
+    if (!sharingKey)
+        return NULL;
+
+    // an idle bucket may have been given to another key; find or claim anew
+    if (!shared || shared->key.get() != sharingKey)
+        shared = DelayPools::SharedBucket(sharingKey, level_);
+
+    return shared;
 }
 
 #endif /* USE_DELAY_POOLS */
@@ -35,6 +35,11 @@
 class DelaySpec;
 class StoreEntry;
 
+namespace Ipc
+{
+class TokenBucket;
+}
+
 /* don't use remote storage for these */
 
 /// \ingroup DelayPoolsAPI
@@ -42,9 +47,9 @@ class DelayBucket
 {
 
 public:
-    int const& level() const {return level_;}
+    DelayBucket(): level_(0), sharingKey(0), shared(NULL) {}
 
-    int & level() {return level_;}
+    int level() const;
 
     void stats(StoreEntry *)const;
     void update (DelaySpec const &, int incr);
@@ -52,8 +57,16 @@ public:
     void bytesIn(int qty);
     void init (DelaySpec const &);
 
+    /// keep the level in memory shared by SMP kids, if possible;
+    /// kids using the same key share the same bucket
+    void share(const uint64_t key) { sharingKey = key; }
+
 private:
-    int level_;
+    Ipc::TokenBucket *sharedBucket() const;
+
+    int level_; ///< the level when we are not sharing the bucket
+    uint64_t sharingKey; ///< identifies the shared bucket or zero
+    mutable Ipc::TokenBucket *shared; ///< cached sharedBucket() result
 };
 
 #endif /* SQUID_DELAYBUCKET_H */
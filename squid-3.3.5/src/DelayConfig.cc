@@ -69,14 +69,14 @@ DelayConfig::parsePoolClass()
     unsigned short delay_class_;
     ConfigParser::ParseUShort(&delay_class_);
 
-    if (delay_class_ < 1 || delay_class_ > 5) {
-        debugs(3, DBG_CRITICAL, "parse_delay_pool_class: Ignoring pool " << pool << " class " << delay_class_ << " not in 1 .. 5");
+    if (delay_class_ < 1 || delay_class_ > 6) {
+        debugs(3, DBG_CRITICAL, "parse_delay_pool_class: Ignoring pool " << pool << " class " << delay_class_ << " not in 1 .. 6");
         return;
     }
 
     --pool;
 
-    DelayPools::delay_data[pool].createPool(delay_class_);
+    DelayPools::delay_data[pool].createPool(delay_class_, pool);
 }
 
 void
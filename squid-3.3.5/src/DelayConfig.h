@@ -49,6 +49,7 @@ public:
     void parsePoolRates();
     void parsePoolAccess(ConfigParser &parser);
     unsigned short initial;
+    int sharedBuckets; ///< delay_pool_shared_buckets
 
 };
 
@@ -45,7 +45,7 @@
 
 DelayPool::DelayPool() : pool (NULL), access (NULL)
 {
-    pool = CommonPool::Factory(0, theComposite_);
+    pool = CommonPool::Factory(0, theComposite_, 0);
 }
 
 DelayPool::~DelayPool()
@@ -86,12 +86,12 @@ DelayPool::dump(StoreEntry *entry, unsigned int i) const
 }
 
 void
-DelayPool::createPool(u_char delay_class)
+DelayPool::createPool(u_char delay_class, unsigned short poolNumberMinusOne)
 {
     if (pool)
         freeData();
 
-    pool = CommonPool::Factory(delay_class, theComposite_);
+    pool = CommonPool::Factory(delay_class, theComposite_, poolNumberMinusOne);
 }
 
 void
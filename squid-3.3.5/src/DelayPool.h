@@ -54,7 +54,7 @@ public:
     DelayPool();
     ~DelayPool();
     void freeData();
-    void createPool(u_char delay_class);
+    void createPool(u_char delay_class, unsigned short poolNumberMinusOne);
     void parse();
     void dump (StoreEntry *, unsigned int poolNumberMinusOne) const;
     CommonPool *pool;
@@ -52,6 +52,11 @@ class DelayPool;
 class Updateable;
 class StoreEntry;
 
+namespace Ipc
+{
+class TokenBucket;
+}
+
 /* for Vector<> */
 #include "Array.h"
 
@@ -68,6 +73,13 @@ public:
     static unsigned char *DelayClasses();
     static void registerForUpdates(Updateable *);
     static void deregisterForUpdates (Updateable *);
+
+    /// keys of shared buckets belonging to the given node of the given pool
+    static uint64_t SharedKeys(unsigned short pool, unsigned char node);
+
+    /// a bucket shared by SMP kids, claimed with initialLevel if needed,
+    /// or nil when the kids do not share delay buckets or ran out of them
+    static Ipc::TokenBucket *SharedBucket(const uint64_t key, const int initialLevel);
     static long MemoryUsed;
     static DelayPool *delay_data;
 
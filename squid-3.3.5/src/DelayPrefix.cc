@@ -0,0 +1,332 @@
+/*
+ * DEBUG: section 77    Delay Pools
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+
+#if USE_DELAY_POOLS
+#include "cache_cf.h"
+#include "DelayPools.h"
+#include "DelayPrefix.h"
+#include "NullDelayId.h"
+#include "Parsing.h"
+#include "SquidTime.h"
+#include "Store.h"
+
+/// hash_table size; the table chains, so this only affects lookup speed
+static const int TheIndexBuckets = 1021;
+
+/// how long a full bucket may stay unused before it is forgotten
+static const time_t IdleTimeout = 60;
+
+/// fills buf with the prefix/length text used as the bucket key
+static void
+PrefixKey(const Ip::Address &prefix, const int length, char *buf, const size_t bufSize)
+{
+    char ip[MAX_IPSTRLEN];
+    snprintf(buf, bufSize, "%s/%d", prefix.NtoA(ip, sizeof(ip)), length);
+}
+
+/// the low 32 bits of the shared bucket key for a prefix/length text;
+/// kids hash the same prefix to the same key, so they share its bucket
+static uint64_t
+PrefixSharingKey(const char *text)
+{
+    // 32-bit FNV-1a
+    uint32_t h = 2166136261U;
+    for (const unsigned char *p = reinterpret_cast<const unsigned char *>(text); *p; ++p) {
+        h ^= *p;
+        h *= 16777619U;
+    }
+    return h;
+}
+
+/// parses the value of an ipv4-prefix= or ipv6-prefix= option
+static int
+ParsePrefixLength(const char *option, const char *value, const int maximum)
+{
+    const int length = xatoi(value);
+    if (length < 0 || length > maximum) {
+        debugs(3, DBG_CRITICAL, "ERROR: delay_parameters " << option <<
+               " must be between 0 and " << maximum);
+        self_destruct();
+    }
+    return length;
+}
+
+void *
+DelayPrefix::operator new(size_t size)
+{
+    DelayPools::MemoryUsed += sizeof (DelayPrefix);
+    return ::operator new (size);
+}
+
+void
+DelayPrefix::operator delete (void *address)
+{
+    DelayPools::MemoryUsed -= sizeof (DelayPrefix);
+    ::operator delete (address);
+}
+
+DelayPrefix::DelayPrefix(const uint64_t keys): ipv4PrefixLength(32), ipv6PrefixLength(64),
+        buckets(hash_create((HASHCMP *) strcmp, TheIndexBuckets, hash_string)),
+        sharedKeys(keys)
+{
+    DelayPools::registerForUpdates (this);
+}
+
+DelayPrefix::~DelayPrefix()
+{
+    DelayPools::deregisterForUpdates (this);
+
+    for (unsigned int i = 0; i < buckets->size; ++i) {
+        hash_link *link = hash_get_bucket(buckets, i);
+        while (link) {
+            DelayPrefixBucket *bucket = static_cast<DelayPrefixBucket *>(link);
+            link = link->next;
+            forget(bucket);
+        }
+    }
+
+    hashFreeMemory(buckets);
+}
+
+void
+DelayPrefix::stats(StoreEntry * sentry)
+{
+    spec.stats (sentry, "Per Prefix");
+
+    if (spec.restore_bps == -1)
+        return;
+
+    storeAppendPrintf(sentry, "\t\tPrefix lengths: IPv4 /%d, IPv6 /%d\n",
+                      ipv4PrefixLength, ipv6PrefixLength);
+    storeAppendPrintf(sentry, "\t\tCurrent:");
+
+    if (!buckets->count) {
+        storeAppendPrintf (sentry, " Not used yet.\n\n");
+        return;
+    }
+
+    hash_first(buckets);
+    while (hash_link *link = hash_next(buckets))
+        static_cast<DelayPrefixBucket *>(link)->stats(sentry);
+
+    storeAppendPrintf(sentry, "\n\n");
+}
+
+void
+DelayPrefix::dump(StoreEntry *entry) const
+{
+    spec.dump(entry);
+
+    if (ipv4PrefixLength != 32)
+        storeAppendPrintf(entry, " ipv4-prefix=%d", ipv4PrefixLength);
+
+    if (ipv6PrefixLength != 64)
+        storeAppendPrintf(entry, " ipv6-prefix=%d", ipv6PrefixLength);
+}
+
+void
+DelayPrefix::update(int incr)
+{
+    if (spec.restore_bps == -1)
+        return;
+
+    // the cost is proportional to the number of recently active prefixes
+    // because idle ones are forgotten here
+    for (unsigned int i = 0; i < buckets->size; ++i) {
+        hash_link *link = hash_get_bucket(buckets, i);
+        while (link) {
+            DelayPrefixBucket *bucket = static_cast<DelayPrefixBucket *>(link);
+            link = link->next;
+            bucket->theBucket.update(spec, incr);
+
+            if (expired(*bucket))
+                forget(bucket);
+        }
+    }
+
+    kickReads();
+}
+
+/// whether the bucket can be forgotten without loosening the limit: a
+/// recreated bucket starts at the initial level, which is never above max
+bool
+DelayPrefix::expired(const DelayPrefixBucket &bucket) const
+{
+    return bucket.RefCountCount() == 1 && // only the index uses it
+           bucket.lastUsed + IdleTimeout <= squid_curtime &&
+           bucket.theBucket.level() >= spec.max_bytes;
+}
+
+/// removes the bucket from the index, destroying it if nobody else uses it
+void
+DelayPrefix::forget(DelayPrefixBucket *bucket)
+{
+    hash_remove_link(buckets, bucket);
+    if (!bucket->RefCountDereference())
+        delete bucket;
+}
+
+void
+DelayPrefix::parse()
+{
+    spec.parse();
+
+    while (char *token = strtok(NULL, w_space)) {
+        if (strncmp(token, "ipv4-prefix=", 12) == 0)
+            ipv4PrefixLength = ParsePrefixLength("ipv4-prefix", token + 12, 32);
+        else if (strncmp(token, "ipv6-prefix=", 12) == 0)
+            ipv6PrefixLength = ParsePrefixLength("ipv6-prefix", token + 12, 128);
+        else {
+            debugs(3, DBG_CRITICAL, "ERROR: unknown delay_parameters option: " << token);
+            self_destruct();
+        }
+    }
+}
+
+DelayIdComposite::Pointer
+DelayPrefix::id(CompositePoolNode::CompositeSelectionDetails &details)
+{
+    if (spec.restore_bps == -1)
+        return new NullDelayId;
+
+    if (details.src_addr.IsAnyAddr() || details.src_addr.IsNoAddr())
+        return new NullDelayId;
+
+    return new Id(this, findBucket(details.src_addr));
+}
+
+/// returns the bucket for the client prefix, creating one if needed
+DelayPrefixBucket::Pointer
+DelayPrefix::findBucket(const Ip::Address &client)
+{
+    const bool ipv4 = client.IsIPv4();
+    const int length = ipv4 ? ipv4PrefixLength : ipv6PrefixLength;
+    Ip::Address prefix = client;
+    prefix.ApplyMask(length, ipv4 ? AF_INET : AF_INET6);
+
+    char key[MAX_IPSTRLEN + 4];
+    PrefixKey(prefix, length, key, sizeof(key));
+
+    if (hash_link *link = hash_lookup(buckets, key)) {
+        DelayPrefixBucket *bucket = static_cast<DelayPrefixBucket *>(link);
+        bucket->lastUsed = squid_curtime;
+        return bucket;
+    }
+
+    DelayPrefixBucket *bucket = new DelayPrefixBucket(prefix, length);
+    bucket->theBucket.init(spec);
+    // a forgotten and recreated bucket finds the same shared level again
+    bucket->theBucket.share(sharedKeys | PrefixSharingKey(key));
+    bucket->RefCountReference(); // for the index
+    hash_join(buckets, bucket);
+    debugs(77, 3, HERE << "new bucket for " << key << "; " << buckets->count << " total");
+    return bucket;
+}
+
+void *
+DelayPrefix::Id::operator new(size_t size)
+{
+    DelayPools::MemoryUsed += sizeof (Id);
+    return ::operator new (size);
+}
+
+void
+DelayPrefix::Id::operator delete (void *address)
+{
+    DelayPools::MemoryUsed -= sizeof (Id);
+    ::operator delete (address);
+}
+
+DelayPrefix::Id::Id(DelayPrefix::Pointer aDelayPrefix, DelayPrefixBucket::Pointer aBucket):
+        thePrefix(aDelayPrefix), theBucket(aBucket)
+{}
+
+DelayPrefix::Id::~Id()
+{
+    debugs(77, 3, "DelayPrefix::Id::~Id");
+}
+
+int
+DelayPrefix::Id::bytesWanted (int min, int max) const
+{
+    return theBucket->theBucket.bytesWanted(min,max);
+}
+
+void
+DelayPrefix::Id::bytesIn(int qty)
+{
+    theBucket->theBucket.bytesIn(qty);
+    theBucket->lastUsed = squid_curtime;
+}
+
+void
+DelayPrefix::Id::delayRead(DeferredRead const &aRead)
+{
+    thePrefix->delayRead(aRead);
+}
+
+void *
+DelayPrefixBucket::operator new(size_t size)
+{
+    DelayPools::MemoryUsed += sizeof (DelayPrefixBucket);
+    return ::operator new (size);
+}
+
+void
+DelayPrefixBucket::operator delete (void *address)
+{
+    DelayPools::MemoryUsed -= sizeof (DelayPrefixBucket);
+    ::operator delete (address);
+}
+
+DelayPrefixBucket::DelayPrefixBucket(const Ip::Address &aPrefix, const int aPrefixLength):
+        prefix(aPrefix), lastUsed(squid_curtime)
+{
+    PrefixKey(prefix, aPrefixLength, keyText, sizeof(keyText));
+    key = keyText;
+    next = NULL;
+}
+
+DelayPrefixBucket::~DelayPrefixBucket()
+{
+    debugs(77, 3, "DelayPrefixBucket::~DelayPrefixBucket " << keyText);
+}
+
+void
+DelayPrefixBucket::stats(StoreEntry *entry) const
+{
+    storeAppendPrintf(entry, " %s:", keyText);
+    theBucket.stats(entry);
+}
+
+#endif /* USE_DELAY_POOLS */
@@ -0,0 +1,119 @@
+/*
+ * DEBUG: section 77    Delay Pools
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+#ifndef DELAYPREFIX_H
+#define DELAYPREFIX_H
+
+#if USE_DELAY_POOLS
+
+#include "CompositePoolNode.h"
+#include "DelayBucket.h"
+#include "DelayIdComposite.h"
+#include "DelaySpec.h"
+#include "hash.h"
+#include "ip/Address.h"
+
+/// \ingroup DelayPoolsAPI
+/// a bucket shared by all clients with the same address prefix
+class DelayPrefixBucket : public hash_link, public RefCountable
+{
+
+public:
+    typedef RefCount<DelayPrefixBucket> Pointer;
+    void *operator new(size_t);
+    void operator delete (void *);
+
+    DelayPrefixBucket(const Ip::Address &aPrefix, const int aPrefixLength);
+    ~DelayPrefixBucket();
+    void stats(StoreEntry *)const;
+
+    DelayBucket theBucket;
+    Ip::Address prefix; ///< client address with host bits cleared
+    time_t lastUsed; ///< when the bucket was last selected or drained
+
+private:
+    char keyText[MAX_IPSTRLEN + 4]; ///< prefix/length, used as the hash key
+};
+
+/// \ingroup DelayPoolsAPI
+/// Individual buckets keyed by client address prefix (class 6).
+/// Unlike the IPv4-only class 2-4 maps, works with IPv6 clients and keeps
+/// buckets only for recently active prefixes.
+class DelayPrefix : public CompositePoolNode
+{
+
+public:
+    typedef RefCount<DelayPrefix> Pointer;
+    void *operator new(size_t);
+    void operator delete (void *);
+    explicit DelayPrefix(const uint64_t sharedKeys);
+    virtual ~DelayPrefix();
+    virtual void stats(StoreEntry * sentry);
+    virtual void dump(StoreEntry *entry) const;
+    virtual void update(int incr);
+    virtual void parse();
+
+    virtual DelayIdComposite::Pointer id(CompositeSelectionDetails &);
+
+private:
+
+    /// \ingroup DelayPoolsInternal
+    class Id:public DelayIdComposite
+    {
+
+    public:
+        void *operator new(size_t);
+        void operator delete (void *);
+        Id (RefCount<DelayPrefix>, DelayPrefixBucket::Pointer);
+        ~Id();
+        virtual int bytesWanted (int min, int max) const;
+        virtual void bytesIn(int qty);
+        virtual void delayRead(DeferredRead const &);
+
+    private:
+        RefCount<DelayPrefix> thePrefix;
+        DelayPrefixBucket::Pointer theBucket;
+    };
+
+    friend class Id;
+
+    DelayPrefixBucket::Pointer findBucket(const Ip::Address &client);
+    bool expired(const DelayPrefixBucket &bucket) const;
+    void forget(DelayPrefixBucket *bucket);
+
+    DelaySpec spec;
+    int ipv4PrefixLength; ///< ipv4-prefix= option
+    int ipv6PrefixLength; ///< ipv6-prefix= option
+    hash_table *buckets; ///< DelayPrefixBucket index, one reference each
+    const uint64_t sharedKeys; ///< base key of our shared buckets
+};
+
+#endif /* USE_DELAY_POOLS */
+#endif /* DELAYPREFIX_H */
@@ -70,7 +70,10 @@ DiskdFile::DiskdFile(char const *aPath, DiskdIOStrategy *anIO) :
         errorOccured(false),
         IO(anIO),
         mode(0),
-        inProgressIOs(0)
+        inProgressIOs(0),
+        pendingSent(0),
+        awayPiece(NULL),
+        pieceScheduled(false)
 {
     assert (aPath);
     debugs(79, 3, "DiskdFile::DiskdFile: " << aPath);
@@ -82,6 +85,7 @@ DiskdFile::DiskdFile(char const *aPath, DiskdIOStrategy *anIO) :
 DiskdFile::~DiskdFile()
 {
     assert (inProgressIOs == 0);
+    dropPendingWrites();
     safe_free (path_);
 }
 
@@ -312,6 +316,90 @@ void
 DiskdFile::write(WriteRequest *aRequest)
 {
     debugs(79, 3, "DiskdFile::write: this " << (void *)this << ", buf " << (void *)aRequest->buf << ", off " << aRequest->offset << ", len " << aRequest->len);
+
+    // a shared memory buffer holds SHMBUF_BLKSZ bytes, but memory cache
+    // nodes may be larger; such writes (and any writes after them) are
+    // queued and sent piece by piece
+    if (aRequest->len > SHMBUF_BLKSZ || !pendingWrites.empty()) {
+        pendingWrites.push_back(aRequest);
+        if (!awayPiece && !pieceScheduled)
+            writeNextPiece();
+        return;
+    }
+
+    writeNow(aRequest);
+}
+
+/// sends the next piece of the first pending write, if the diskd queue
+/// admits more requests; otherwise, retries a little later
+void
+DiskdFile::writeNextPiece()
+{
+    assert(!awayPiece);
+    assert(!pendingWrites.empty());
+
+    if (errorOccured) {
+        dropPendingWrites();
+        return;
+    }
+
+    // the same admission check that newFile() applies to new files
+    if (IO->shedLoad()) {
+        debugs(79, 3, "DiskdFile::writeNextPiece: " << this << " waiting for queue space");
+        pieceScheduled = true;
+        eventAdd("DiskdFile::WriteNextPiece", &DiskdFile::WriteNextPiece, this, 0.001, 0, true);
+        return;
+    }
+
+    const WriteRequest::Pointer whole = pendingWrites.front();
+    const size_t len = min(whole->len - pendingSent, static_cast<size_t>(SHMBUF_BLKSZ));
+    const off_t offset = whole->offset < 0 ? whole->offset : whole->offset + pendingSent;
+    WriteRequest *piece = new WriteRequest(whole->buf + pendingSent, offset, len, NULL);
+    pendingSent += len;
+
+    const bool lastPiece = pendingSent == whole->len;
+    if (lastPiece) {
+        pendingWrites.pop_front();
+        pendingSent = 0;
+    }
+
+    awayPiece = piece;
+    writeNow(piece);
+
+    // writeNow() copied the piece to shared memory; free_func expects the
+    // start of the whole buffer (memNodeWriteComplete() locates its node)
+    if (lastPiece && whole->free_func)
+        whole->free_func(const_cast<char *>(whole->buf));
+}
+
+void
+DiskdFile::WriteNextPiece(void *data)
+{
+    DiskdFile *file = static_cast<DiskdFile *>(data);
+    file->pieceScheduled = false;
+    if (!file->awayPiece && !file->pendingWrites.empty())
+        file->writeNextPiece();
+}
+
+/// forgets writes that will not be sent because of an earlier error
+void
+DiskdFile::dropPendingWrites()
+{
+    while (!pendingWrites.empty()) {
+        const WriteRequest::Pointer whole = pendingWrites.front();
+        pendingWrites.pop_front();
+        if (whole->free_func)
+            whole->free_func(const_cast<char *>(whole->buf));
+    }
+    pendingSent = 0;
+}
+
+/// sends a write of at most SHMBUF_BLKSZ bytes to diskd
+void
+DiskdFile::writeNow(WriteRequest *aRequest)
+{
+    assert(aRequest->len <= SHMBUF_BLKSZ);
+
     ssize_t shm_offset;
     char *sbuf = (char *)IO->shm.get(&shm_offset);
     memcpy(sbuf, aRequest->buf, aRequest->len);
@@ -334,6 +422,9 @@ DiskdFile::write(WriteRequest *aRequest)
         errorOccured = true;
         debugs(79, DBG_IMPORTANT, "storeDiskdSend WRITE: " << xstrerror());
         //        IO->shm.put (shm_offset);
+        if (aRequest == awayPiece)
+            awayPiece = NULL;
+        dropPendingWrites();
         notifyClient();
         ioRequestor = NULL;
         return;
@@ -412,14 +503,23 @@ DiskdFile::writeDone(diomsg *M)
     if (writeRequest != NULL)
         writeRequest->RefCountDereference();
 
+    const bool wasPiece = writeRequest.getRaw() && writeRequest.getRaw() == awayPiece;
+    if (wasPiece)
+        awayPiece = NULL;
+
     if (M->status < 0) {
         errorOccured = true;
         ++diskd_stats.write.fail;
         ioCompleted();
+        dropPendingWrites();
         ioRequestor->writeCompleted (DISK_ERROR,0, writeRequest);
         return;
     }
 
+    // keep ioInProgress() true while the requestor is notified below
+    if (wasPiece && !pendingWrites.empty() && !pieceScheduled)
+        writeNextPiece();
+
     ++diskd_stats.write.success;
     ioCompleted();
     ioRequestor->writeCompleted (DISK_OK,M->status, writeRequest);
@@ -428,5 +528,5 @@ DiskdFile::writeDone(diomsg *M)
 bool
 DiskdFile::ioInProgress()const
 {
-    return inProgressIOs != 0;
+    return inProgressIOs != 0 || !pendingWrites.empty();
 }
@@ -36,6 +36,10 @@
 
 #include "cbdata.h"
 #include "DiskIO/DiskFile.h"
+#include "DiskIO/WriteRequest.h"
+#include "event.h"
+
+#include <deque>
 
 class DiskdIOStrategy;
 
@@ -77,6 +81,10 @@ private:
     void readDone (diomsg *);
     void writeDone (diomsg *);
     void closeDone (diomsg *);
+    void writeNow(WriteRequest *);
+    void writeNextPiece();
+    void dropPendingWrites();
+    static EVH WriteNextPiece;
     int mode;
     void notifyClient();
     bool canNotifyClient() const;
@@ -84,6 +92,14 @@ private:
     void ioCompleted();
     size_t inProgressIOs;
 
+    /// Writes waiting to be sent in SHMBUF_BLKSZ pieces, one piece at a
+    /// time, so that a large write holds at most one shared memory buffer.
+    /// Later writes wait behind them to keep the file offsets in order.
+    std::deque<WriteRequest::Pointer> pendingWrites;
+    size_t pendingSent; ///< bytes of pendingWrites.front() already sent
+    WriteRequest *awayPiece; ///< the piece being written or nil
+    bool pieceScheduled; ///< whether WriteNextPiece() is scheduled
+
     CBDATA_CLASS(DiskdFile);
 };
 
@@ -437,6 +437,7 @@ IpcIoFile::handleResponse(IpcIoMsg &ipcIo)
 
     Must(requestId);
     if (IpcIoPendingRequest *const pending = dequeueRequest(requestId)) {
+        statCounter.disk.svcTime.count(ipcIo.start, current_time);
         pending->completeIo(&ipcIo);
         delete pending; // XXX: leaking if throwing
     } else {
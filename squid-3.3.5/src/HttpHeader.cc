@@ -1623,13 +1623,21 @@ HttpHeaderEntry::parse(const char *field_start, const char *field_end)
 
     debugs(55, 9, "parsed HttpHeaderEntry: '" << name << ": " << value << "'");
 
-    return new HttpHeaderEntry(id, name.termedBuf(), value.termedBuf());
+    // share the parsed buffers instead of copying them into the new entry
+    HttpHeaderEntry *e = new HttpHeaderEntry(id, NULL, NULL);
+    e->name = name;
+    e->value = value;
+    return e;
 }
 
 HttpHeaderEntry *
 HttpHeaderEntry::clone() const
 {
-    return new HttpHeaderEntry(id, name.termedBuf(), value.termedBuf());
+    // the clone shares our name and value buffers until either is modified
+    HttpHeaderEntry *e = new HttpHeaderEntry(id, NULL, NULL);
+    e->name = name;
+    e->value = value;
+    return e;
 }
 
 void
@@ -108,6 +108,7 @@ HttpRequest::init()
     body_pipe = NULL;
     // hier
     dnsWait = -1;
+    phases = PhaseTimes();
     errType = ERR_NONE;
     errDetail = ERR_DETAIL_NONE;
     peer_login = NULL;		// not allocated/deallocated by this class
@@ -190,7 +191,8 @@ HttpRequest::reset()
 HttpRequest *
 HttpRequest::clone() const
 {
-    HttpRequest *copy = new HttpRequest(method, protocol, urlpath.termedBuf());
+    HttpRequest *copy = new HttpRequest(method, protocol, NULL);
+    copy->urlpath = urlpath; // shares the buffer until either copy changes
     // TODO: move common cloning clone to Msg::copyTo() or copy ctor
     copy->header.append(&header);
     copy->hdrCacheInit();
@@ -204,7 +206,7 @@ HttpRequest::clone() const
     copy->host_addr = host_addr;
 
     copy->port = port;
-    // urlPath handled in ctor
+    // urlPath handled above
     copy->canonical = canonical ? xstrdup(canonical) : NULL;
 
     // range handled in hdrCacheInit()
@@ -248,6 +250,7 @@ HttpRequest::inheritProperties(const HttpMsg *aMsg)
     my_addr = aReq->my_addr;
 
     dnsWait = aReq->dnsWait;
+    phases = aReq->phases;
 
 #if USE_ADAPTATION
     adaptHistory_ = aReq->adaptHistory();
@@ -625,6 +628,7 @@ HttpRequest::recordLookup(const DnsLookupDetails &dns)
             dnsWait += dns.wait;
         else
             dnsWait = dns.wait;
+        phases.add(PhaseTimes::phDns, static_cast<int64_t>(dns.wait) * 1000);
     }
 }
 
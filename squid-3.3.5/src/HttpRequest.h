@@ -37,6 +37,7 @@
 #include "HierarchyLogEntry.h"
 #include "HttpMsg.h"
 #include "HttpRequestMethod.h"
+#include "PhaseTimes.h"
 #include "RequestFlags.h"
 
 #if USE_AUTH
@@ -182,6 +183,8 @@ public:
 
     int dnsWait; ///< sum of DNS lookup delays in milliseconds, for %dt
 
+    PhaseTimes phases; ///< time spent in each processing phase, for phase:: codes
+
     err_type errType;
     int errDetail; ///< errType-specific detail about the transaction error
 
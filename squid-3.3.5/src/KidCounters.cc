@@ -0,0 +1,357 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#include "squid.h"
+#include "base/RunnersRegistry.h"
+#include "Debug.h"
+#include "event.h"
+#include "globals.h"
+#include "ipc/mem/Segment.h"
+#include "KidCounters.h"
+#include "mgr/Registration.h"
+#include "SquidTime.h"
+#include "StatCounters.h"
+#include "Store.h"
+#include "tools.h"
+
+#if HAVE_SYS_RESOURCE_H
+#include <sys/resource.h>
+#endif
+
+/// shared memory segment path to use for kid counters
+static const char *const SegmentLabel = "kid_counters";
+
+/// Shared::layout value; increment when changing the segment layout
+static const int32_t LayoutVersion = 3;
+
+/// how often kids update their slots (seconds)
+static const double PublishInterval = 1.0;
+
+/// the exported counters, in the order used by KidCounters::Fill()
+static const char *const CounterNames[] = {
+    "client_http.accepts",
+    "client_http.requests",
+    "client_http.hits",
+    "client_http.mem_hits",
+    "client_http.disk_hits",
+    "client_http.errors",
+    "client_http.kbytes_in",
+    "client_http.kbytes_out",
+    "client_http.hit_kbytes_out",
+    "server.all.requests",
+    "server.all.errors",
+    "server.all.kbytes_in",
+    "server.all.kbytes_out",
+    "server.http.requests",
+    "server.http.errors",
+    "server.http.kbytes_in",
+    "server.http.kbytes_out",
+    "server.ftp.requests",
+    "server.ftp.errors",
+    "server.ftp.kbytes_in",
+    "server.ftp.kbytes_out",
+    "server.other.requests",
+    "server.other.errors",
+    "server.other.kbytes_in",
+    "server.other.kbytes_out",
+    "icp.pkts_sent",
+    "icp.pkts_recv",
+    "icp.queries_sent",
+    "icp.replies_sent",
+    "icp.queries_recv",
+    "icp.replies_recv",
+    "icp.query_timeouts",
+    "htcp.pkts_sent",
+    "htcp.pkts_recv",
+    "unlink.requests",
+    "page_faults",
+    "select_loops",
+    "select_fds",
+    "syscalls.selects",
+    "syscalls.disk.opens",
+    "syscalls.disk.closes",
+    "syscalls.disk.reads",
+    "syscalls.disk.writes",
+    "syscalls.sock.accepts",
+    "syscalls.sock.sockets",
+    "syscalls.sock.connects",
+    "syscalls.sock.closes",
+    "syscalls.sock.reads",
+    "syscalls.sock.writes",
+    "acceptor.events",
+    "acceptor.full_batches",
+    "acceptor.deferrals",
+    "swap.outs",
+    "swap.ins",
+    "swap.files_cleaned",
+    "aborted_requests",
+    "cpu_time_msec"
+};
+
+static const int CounterCount = sizeof(CounterNames) / sizeof(*CounterNames);
+
+/// attached segment or nil if counters are not shared
+static Ipc::Mem::Pointer<KidCounters::Shared> TheShared;
+
+/// whether the kid_counters segment should be used
+static bool
+ShareCounters()
+{
+    return UsingSmp() && Ipc::Atomic::Enabled() && Ipc::Mem::Segment::Enabled();
+}
+
+bool
+KidCounters::Slot::read(Slot &copy) const
+{
+    // give up after a few attempts; the slot owner updates once a second
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        const uint32_t before = version.get();
+        if (before & 1)
+            continue; // the owner is updating the slot
+
+        copy.pid = pid;
+        copy.updated = updated;
+        memcpy(copy.values, values, sizeof(values));
+
+        if (version.get() == before)
+            return true;
+    }
+    return false;
+}
+
+/// copies our own counters into the given slot values
+void
+KidCounters::Fill(Slot &slot)
+{
+    const StatCounters &c = statCounter;
+    int64_t *v = slot.values;
+    int i = 0;
+    v[i++] = c.client_http.accepts;
+    v[i++] = c.client_http.requests;
+    v[i++] = c.client_http.hits;
+    v[i++] = c.client_http.mem_hits;
+    v[i++] = c.client_http.disk_hits;
+    v[i++] = c.client_http.errors;
+    v[i++] = c.client_http.kbytes_in.kb;
+    v[i++] = c.client_http.kbytes_out.kb;
+    v[i++] = c.client_http.hit_kbytes_out.kb;
+    v[i++] = c.server.all.requests;
+    v[i++] = c.server.all.errors;
+    v[i++] = c.server.all.kbytes_in.kb;
+    v[i++] = c.server.all.kbytes_out.kb;
+    v[i++] = c.server.http.requests;
+    v[i++] = c.server.http.errors;
+    v[i++] = c.server.http.kbytes_in.kb;
+    v[i++] = c.server.http.kbytes_out.kb;
+    v[i++] = c.server.ftp.requests;
+    v[i++] = c.server.ftp.errors;
+    v[i++] = c.server.ftp.kbytes_in.kb;
+    v[i++] = c.server.ftp.kbytes_out.kb;
+    v[i++] = c.server.other.requests;
+    v[i++] = c.server.other.errors;
+    v[i++] = c.server.other.kbytes_in.kb;
+    v[i++] = c.server.other.kbytes_out.kb;
+    v[i++] = c.icp.pkts_sent;
+    v[i++] = c.icp.pkts_recv;
+    v[i++] = c.icp.queries_sent;
+    v[i++] = c.icp.replies_sent;
+    v[i++] = c.icp.queries_recv;
+    v[i++] = c.icp.replies_recv;
+    v[i++] = c.icp.query_timeouts;
+    v[i++] = c.htcp.pkts_sent;
+    v[i++] = c.htcp.pkts_recv;
+    v[i++] = c.unlink.requests;
+
+    // statCounter gets these once a minute; we want fresh values
+    struct rusage rusage;
+    squid_getrusage(&rusage);
+    v[i++] = rusage_pagefaults(&rusage);
+
+    v[i++] = c.select_loops;
+    v[i++] = c.select_fds;
+    v[i++] = c.syscalls.selects;
+    v[i++] = c.syscalls.disk.opens;
+    v[i++] = c.syscalls.disk.closes;
+    v[i++] = c.syscalls.disk.reads;
+    v[i++] = c.syscalls.disk.writes;
+    v[i++] = c.syscalls.sock.accepts;
+    v[i++] = c.syscalls.sock.sockets;
+    v[i++] = c.syscalls.sock.connects;
+    v[i++] = c.syscalls.sock.closes;
+    v[i++] = c.syscalls.sock.reads;
+    v[i++] = c.syscalls.sock.writes;
+    v[i++] = c.acceptor.events;
+    v[i++] = c.acceptor.full_batches;
+    v[i++] = c.acceptor.deferrals;
+    v[i++] = c.swap.outs;
+    v[i++] = c.swap.ins;
+    v[i++] = c.swap.files_cleaned;
+    v[i++] = c.aborted_requests;
+    v[i++] = static_cast<int64_t>(rusage_cputime(&rusage) * 1000);
+    assert(i == CounterCount);
+
+    slot.pid = getpid();
+    slot.updated = static_cast<int64_t>(current_dtime * 1000);
+}
+
+/// periodically copies our counters into our slot
+void
+KidCounters::Publish(void *)
+{
+    const int idx = KidIdentifier - 1;
+    if (TheShared != NULL && 0 <= idx && idx < TheShared->limit) {
+        Slot &slot = TheShared->slots[idx];
+        ++slot.version; // odd: tell readers that values are changing
+        Fill(slot);
+        ++slot.version;
+    }
+
+    eventAdd("KidCounters::Publish", &KidCounters::Publish, NULL, PublishInterval, 0);
+}
+
+/// dumps counters of all kids in a "kidN.name = value" format,
+/// followed by "total.name = value" sums
+void
+KidCounters::Stat(StoreEntry *e)
+{
+    int64_t totals[CounterLimit];
+    memset(totals, 0, sizeof(totals));
+    int reported = 0;
+
+    const int slotCount = TheShared != NULL ? TheShared->limit : 1;
+    for (int idx = 0; idx < slotCount; ++idx) {
+        Slot slot;
+        if (TheShared == NULL) {
+            Fill(slot); // not sharing: report our own counters
+        } else if (!TheShared->slots[idx].read(slot)) {
+            storeAppendPrintf(e, "kid%d.busy = 1\n", idx + 1);
+            continue;
+        }
+
+        if (!slot.pid)
+            continue; // the kid has not reported (e.g., a Coordinator slot)
+
+        const int kid = TheShared != NULL ? idx + 1 : KidIdentifier;
+        storeAppendPrintf(e, "kid%d.pid = %d\n", kid, slot.pid);
+        storeAppendPrintf(e, "kid%d.sample_time_msec = %" PRId64 "\n", kid, slot.updated);
+        for (int i = 0; i < CounterCount; ++i) {
+            storeAppendPrintf(e, "kid%d.%s = %" PRId64 "\n", kid, CounterNames[i], slot.values[i]);
+            totals[i] += slot.values[i];
+        }
+        ++reported;
+    }
+
+    storeAppendPrintf(e, "total.kids = %d\n", reported);
+    for (int i = 0; i < CounterCount; ++i)
+        storeAppendPrintf(e, "total.%s = %" PRId64 "\n", CounterNames[i], totals[i]);
+}
+
+KidCounters::Owner *
+KidCounters::Init()
+{
+    Owner *const owner = shm_new(Shared)(SegmentLabel, NumberOfKids());
+    debugs(18, 5, HERE << "created " << SegmentLabel << " with " <<
+           NumberOfKids() << " slots");
+    return owner;
+}
+
+void
+KidCounters::Open()
+{
+    Must(TheShared == NULL);
+    TheShared = shm_old(Shared)(SegmentLabel);
+    Must(TheShared->layout == LayoutVersion);
+
+    // the Coordinator handles no traffic and has nothing to publish
+    if (!IamCoordinatorProcess())
+        Publish(NULL);
+}
+
+void
+KidCounters::Close()
+{
+    TheShared = Ipc::Mem::Pointer<Shared>();
+}
+
+void
+KidCounters::RegisterWithCacheManager()
+{
+    Mgr::RegisterLocalAction("kid_counters",
+                             "Per-kid Traffic and Resource Counters",
+                             &KidCounters::Stat, 0);
+}
+
+KidCounters::Shared::Shared(const int aLimit): layout(LayoutVersion),
+        limit(aLimit), counters(CounterCount), slots(aLimit)
+{
+    assert(CounterCount <= CounterLimit);
+    memset(names, 0, sizeof(names));
+    for (int i = 0; i < CounterCount; ++i) {
+        assert(strlen(CounterNames[i]) < static_cast<size_t>(CounterNameSize));
+        strcpy(names[i], CounterNames[i]);
+    }
+}
+
+size_t
+KidCounters::Shared::sharedMemorySize() const
+{
+    return SharedMemorySize(limit);
+}
+
+size_t
+KidCounters::Shared::SharedMemorySize(const int limit)
+{
+    return sizeof(Shared) + limit * sizeof(Slot);
+}
+
+/// initializes shared memory segment used by KidCounters
+class KidCountersRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    KidCountersRr(): owner(NULL) {}
+    virtual void run(const RunnerRegistry &);
+    virtual ~KidCountersRr();
+
+protected:
+    virtual void create(const RunnerRegistry &);
+    virtual void open(const RunnerRegistry &);
+
+private:
+    KidCounters::Owner *owner;
+};
+
+RunnerRegistrationEntry(rrAfterConfig, KidCountersRr);
+
+void
+KidCountersRr::run(const RunnerRegistry &r)
+{
+    // the action works without shared memory, reporting this process only
+    KidCounters::RegisterWithCacheManager();
+    Ipc::Mem::RegisteredRunner::run(r);
+}
+
+void
+KidCountersRr::create(const RunnerRegistry &)
+{
+    if (!ShareCounters())
+        return;
+
+    Must(!owner);
+    owner = KidCounters::Init();
+}
+
+void
+KidCountersRr::open(const RunnerRegistry &)
+{
+    if (ShareCounters())
+        KidCounters::Open();
+}
+
+KidCountersRr::~KidCountersRr()
+{
+    KidCounters::Close();
+    delete owner;
+}
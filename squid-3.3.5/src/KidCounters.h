@@ -0,0 +1,87 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#ifndef SQUID_KID_COUNTERS_H
+#define SQUID_KID_COUNTERS_H
+
+#include "ipc/AtomicWord.h"
+#include "ipc/mem/FlexibleArray.h"
+#include "ipc/mem/Pointer.h"
+
+class StoreEntry;
+
+/**
+ * Traffic and resource counters of every kid, kept in a shared memory
+ * segment so that any kid (or an external monitoring tool that maps the
+ * segment read-only) can report all of them without messaging the workers.
+ * Each kid copies its statCounter totals into its own slot once a second.
+ *
+ * The segment (squid-kid_counters.shm on most platforms) starts with the
+ * Shared header: three int32_t fields (layout, slots, counters) followed by
+ * CounterLimit NUL-terminated counter names, CounterNameSize bytes each.
+ * The Slot array follows, 8-byte aligned; kid N uses slot N-1. All integers
+ * use the host byte order. A slot version is odd while its kid updates the
+ * slot; readers should retry if the version is odd or changes while they
+ * copy the values.
+ */
+class KidCounters
+{
+public:
+    /// the maximum number of counters a slot can hold
+    static const int CounterLimit = 64;
+    /// the maximum counter name size, including the terminating NUL
+    static const int CounterNameSize = 32;
+
+    /// one kid's counters
+    class Slot
+    {
+    public:
+        Slot(): version(0), pid(0), updated(0) { memset(values, 0, sizeof(values)); }
+
+        /// copies the slot into the caller's storage unless it keeps changing
+        bool read(Slot &copy) const;
+
+        Ipc::Atomic::WordT<uint32_t> version; ///< odd while being updated
+        int32_t pid; ///< kid process ID or zero if the kid has not reported yet
+        int64_t updated; ///< last update time in milliseconds since the epoch
+        int64_t values[CounterLimit]; ///< counter values, in Shared::names order
+    };
+
+    /// data shared across all kids
+    class Shared
+    {
+    public:
+        explicit Shared(const int aLimit);
+        size_t sharedMemorySize() const;
+        static size_t SharedMemorySize(const int limit);
+
+        const int32_t layout; ///< changes when the segment layout changes
+        const int32_t limit; ///< number of slots
+        int32_t counters; ///< number of used values in each slot
+        char names[CounterLimit][CounterNameSize]; ///< counter names
+        Ipc::Mem::FlexibleArray<Slot> slots; ///< slots storage
+    };
+
+    typedef Ipc::Mem::Owner<Shared> Owner;
+
+    /// initialize shared memory
+    static Owner *Init();
+
+    /// attach to the shared memory and, in workers, start publishing
+    static void Open();
+
+    /// detach from the shared memory
+    static void Close();
+
+    /// registers the kid_counters cache manager action
+    static void RegisterWithCacheManager();
+
+private:
+    static void Publish(void *);
+    static void Fill(Slot &slot);
+    static void Stat(StoreEntry *e);
+};
+
+#endif /* SQUID_KID_COUNTERS_H */
@@ -0,0 +1,165 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#include "squid.h"
+#include "base/RunnersRegistry.h"
+#include "base/TextException.h"
+#include "Debug.h"
+#include "globals.h"
+#include "ipc/mem/Segment.h"
+#include "KidLatencies.h"
+#include "tools.h"
+
+/// shared memory segment path to use for kid histograms
+static const char *const SegmentLabel = "kid_latencies";
+
+/// attached segment or nil if histograms are not shared
+static Ipc::Mem::Pointer<KidLatencies::Shared> TheShared;
+
+/// whether the kid_latencies segment should be used
+static bool
+ShareLatencies()
+{
+    return UsingSmp() && Ipc::Atomic::Enabled() && Ipc::Mem::Segment::Enabled();
+}
+
+bool
+KidLatencies::Slot::read(Windows &copy) const
+{
+    // give up after a few attempts; the slot owner updates once a minute
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        const uint32_t before = version.get();
+        if (before & 1)
+            continue; // the owner is updating the slot
+
+        memcpy(copy, windows, sizeof(windows));
+
+        if (version.get() == before)
+            return true;
+    }
+    return false;
+}
+
+bool
+KidLatencies::Enabled()
+{
+    return TheShared != NULL;
+}
+
+void
+KidLatencies::Publish(const Windows &windows)
+{
+    const int idx = KidIdentifier - 1;
+    if (TheShared == NULL || idx < 0 || idx >= TheShared->limit)
+        return;
+
+    Slot &slot = TheShared->slots[idx];
+    ++slot.version; // odd: tell readers that histograms are changing
+    memcpy(slot.windows, windows, sizeof(windows));
+    ++slot.version;
+}
+
+void
+KidLatencies::Merge(Windows &windows)
+{
+    Must(TheShared != NULL);
+
+    for (int w = 0; w < wndEnd; ++w) {
+        for (int k = 0; k < PCTILE_END; ++k)
+            windows[w][k].clear();
+    }
+
+    static Windows copy; // too big for the stack
+    for (int idx = 0; idx < TheShared->limit; ++idx) {
+        if (!TheShared->slots[idx].read(copy)) {
+            debugs(18, 3, HERE << "skipping busy kid" << (idx + 1) << " slot");
+            continue;
+        }
+
+        for (int w = 0; w < wndEnd; ++w) {
+            for (int k = 0; k < PCTILE_END; ++k)
+                windows[w][k] += copy[w][k];
+        }
+    }
+}
+
+KidLatencies::Owner *
+KidLatencies::Init()
+{
+    Owner *const owner = shm_new(Shared)(SegmentLabel, NumberOfKids());
+    debugs(18, 5, HERE << "created " << SegmentLabel << " with " <<
+           NumberOfKids() << " slots");
+    return owner;
+}
+
+void
+KidLatencies::Open()
+{
+    Must(TheShared == NULL);
+    TheShared = shm_old(Shared)(SegmentLabel);
+}
+
+void
+KidLatencies::Close()
+{
+    TheShared = Ipc::Mem::Pointer<Shared>();
+}
+
+KidLatencies::Shared::Shared(const int aLimit): limit(aLimit), slots(aLimit)
+{
+}
+
+size_t
+KidLatencies::Shared::sharedMemorySize() const
+{
+    return SharedMemorySize(limit);
+}
+
+size_t
+KidLatencies::Shared::SharedMemorySize(const int limit)
+{
+    return sizeof(Shared) + limit * sizeof(Slot);
+}
+
+/// initializes shared memory segment used by KidLatencies
+class KidLatenciesRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    KidLatenciesRr(): owner(NULL) {}
+    virtual ~KidLatenciesRr();
+
+protected:
+    virtual void create(const RunnerRegistry &);
+    virtual void open(const RunnerRegistry &);
+
+private:
+    KidLatencies::Owner *owner;
+};
+
+RunnerRegistrationEntry(rrAfterConfig, KidLatenciesRr);
+
+void
+KidLatenciesRr::create(const RunnerRegistry &)
+{
+    if (!ShareLatencies())
+        return;
+
+    Must(!owner);
+    owner = KidLatencies::Init();
+}
+
+void
+KidLatenciesRr::open(const RunnerRegistry &)
+{
+    if (ShareLatencies())
+        KidLatencies::Open();
+}
+
+KidLatenciesRr::~KidLatenciesRr()
+{
+    KidLatencies::Close();
+    delete owner;
+}
@@ -0,0 +1,77 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#ifndef SQUID_KID_LATENCIES_H
+#define SQUID_KID_LATENCIES_H
+
+#include "enums.h"
+#include "ipc/AtomicWord.h"
+#include "ipc/mem/FlexibleArray.h"
+#include "ipc/mem/Pointer.h"
+#include "LatencyHistogram.h"
+
+/**
+ * Recent service time histograms of every kid, kept in shared memory so
+ * that any kid can report service time percentiles of all kids combined,
+ * without asking other kids for their (unmergeable) percentiles. Each kid
+ * replaces its slot with fresh 5- and 60-minute histograms once a minute,
+ * when it takes its statCounter snapshot.
+ */
+class KidLatencies
+{
+public:
+    /// reporting windows
+    enum { wnd5min, wnd60min, wndEnd };
+
+    /// service time histograms for each window and PCTILE_ kind
+    typedef LatencyHistogram Windows[wndEnd][PCTILE_END];
+
+    /// one kid's histograms
+    class Slot
+    {
+    public:
+        Slot(): version(0) {}
+
+        /// copies windows into the caller's storage unless they keep changing
+        bool read(Windows &copy) const;
+
+        Ipc::Atomic::WordT<uint32_t> version; ///< odd while being updated
+        Windows windows; ///< the last published histograms
+    };
+
+    /// data shared across all kids
+    class Shared
+    {
+    public:
+        explicit Shared(const int aLimit);
+        size_t sharedMemorySize() const;
+        static size_t SharedMemorySize(const int limit);
+
+        const int limit; ///< number of slots
+        Ipc::Mem::FlexibleArray<Slot> slots; ///< slots storage
+    };
+
+    typedef Ipc::Mem::Owner<Shared> Owner;
+
+    /// initialize shared memory
+    static Owner *Init();
+
+    /// attach to the shared memory
+    static void Open();
+
+    /// detach from the shared memory
+    static void Close();
+
+    /// whether histograms are shared among kids
+    static bool Enabled();
+
+    /// replaces our slot contents with the given histograms
+    static void Publish(const Windows &windows);
+
+    /// fills windows with histograms of all kids combined
+    static void Merge(Windows &windows);
+};
+
+#endif /* SQUID_KID_LATENCIES_H */
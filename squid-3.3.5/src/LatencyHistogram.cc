@@ -0,0 +1,95 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#include "squid.h"
+#include "LatencyHistogram.h"
+
+#if HAVE_MATH_H
+#include <math.h>
+#endif
+
+LatencyHistogram &
+LatencyHistogram::operator +=(const LatencyHistogram &other)
+{
+    for (int i = 0; i < BinCount; ++i)
+        bins[i] += other.bins[i];
+    return *this;
+}
+
+LatencyHistogram &
+LatencyHistogram::operator -=(const LatencyHistogram &earlier)
+{
+    for (int i = 0; i < BinCount; ++i)
+        bins[i] -= earlier.bins[i]; // wraps correctly for unsigned counters
+    return *this;
+}
+
+uint64_t
+LatencyHistogram::total() const
+{
+    uint64_t sum = 0;
+    for (int i = 0; i < BinCount; ++i)
+        sum += bins[i];
+    return sum;
+}
+
+uint64_t
+LatencyHistogram::BinMin(const int bin)
+{
+    assert(0 <= bin && bin < BinCount);
+    if (bin < SubCount)
+        return bin;
+    const int group = bin / SubCount;
+    const uint64_t sub = bin % SubCount;
+    return (SubCount + sub) << (group - 1);
+}
+
+uint64_t
+LatencyHistogram::BinWidth(const int bin)
+{
+    assert(0 <= bin && bin < BinCount);
+    if (bin < SubCount)
+        return 1;
+    return static_cast<uint64_t>(1) << (bin / SubCount - 1);
+}
+
+/// the percentile of values recorded after the earlier snapshot (if any);
+/// returns the middle of the bin holding the value at that percentile
+double
+LatencyHistogram::pctileAfter(const LatencyHistogram *earlier, const double pctile) const
+{
+    uint64_t count = 0;
+    for (int i = 0; i < BinCount; ++i)
+        count += static_cast<Counter>(bins[i] - (earlier ? earlier->bins[i] : 0));
+
+    if (!count)
+        return 0.0;
+
+    uint64_t rank = static_cast<uint64_t>(ceil(pctile * count));
+    if (rank < 1)
+        rank = 1;
+    else if (rank > count)
+        rank = count;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < BinCount; ++i) {
+        seen += static_cast<Counter>(bins[i] - (earlier ? earlier->bins[i] : 0));
+        if (seen >= rank)
+            return BinMin(i) + (BinWidth(i) - 1) / 2.0;
+    }
+
+    assert(false); // not reached: the last bin makes seen equal count
+    return 0.0;
+}
+
+void
+LatencyHistogram::dump(StoreEntry *sentry, LatencyBinDumper *bd) const
+{
+    assert(bd);
+    for (int i = 0; i < BinCount; ++i) {
+        if (bins[i])
+            bd(sentry, i, BinMin(i), BinWidth(i), bins[i]);
+    }
+}
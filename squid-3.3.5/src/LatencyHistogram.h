@@ -0,0 +1,115 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ */
+
+#ifndef SQUID_LATENCY_HISTOGRAM_H
+#define SQUID_LATENCY_HISTOGRAM_H
+
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+class StoreEntry;
+
+/// function signature for LatencyHistogram dumping functions, compatible
+/// with StatHistBinDumper
+typedef void LatencyBinDumper(StoreEntry *, int idx, double val, double size, int count);
+
+/**
+ * A fixed-size log-linear ("HDR-style") histogram of non-negative integer
+ * values, usually service times in microseconds. Each power-of-two range
+ * is split into SubCount equal bins, so a recorded value is known with
+ * 1/SubCount (about 3%) relative precision, regardless of its magnitude.
+ * Values below SubCount are recorded exactly. Values of 2^MaxBits or more
+ * (about 19 hours in microseconds) share the last bin.
+ *
+ * Finding a bin takes a few integer shifts and comparisons. Histograms
+ * have no pointers and can be copied, merged, and subtracted bin-by-bin,
+ * which makes them suitable for interval snapshots and shared memory.
+ * Bin counters are 32-bit and may wrap; differences between snapshots
+ * remain correct as long as a single bin gets fewer than 2^32 new values.
+ */
+class LatencyHistogram
+{
+public:
+    typedef uint32_t Counter;
+
+    static const int SubBits = 5; ///< log2 of the number of bins per power of two
+    static const int SubCount = 1 << SubBits; ///< bins per power of two
+    static const int MaxBits = 36; ///< values must be below 2^MaxBits
+    static const int BinCount = (MaxBits - SubBits + 1) * SubCount;
+
+    LatencyHistogram() { clear(); }
+
+    /// forgets all recorded values
+    void clear() { memset(bins, 0, sizeof(bins)); }
+
+    /// records a value
+    void count(const uint64_t value) { ++bins[FindBin(value)]; }
+
+    /// records the time between start and finish, in microseconds
+    void count(const struct timeval &start, const struct timeval &finish) { count(Usec(start, finish)); }
+
+    /// merges values recorded by another histogram into ours
+    LatencyHistogram &operator +=(const LatencyHistogram &other);
+
+    /// removes values recorded by an earlier snapshot of this histogram
+    LatencyHistogram &operator -=(const LatencyHistogram &earlier);
+
+    /// the number of recorded values
+    uint64_t total() const;
+
+    /// the value at the given percentile (0.0 - 1.0) or zero if empty
+    double percentile(const double pctile) const { return pctileAfter(NULL, pctile); }
+
+    /// the percentile (0.0 - 1.0) of values recorded since the earlier snapshot
+    double deltaPctile(const LatencyHistogram &earlier, const double pctile) const { return pctileAfter(&earlier, pctile); }
+
+    /// calls bd for every bin with recorded values
+    void dump(StoreEntry *sentry, LatencyBinDumper *bd) const;
+
+    /// the bin recording the given value
+    static int FindBin(const uint64_t value) {
+        if (value < static_cast<uint64_t>(SubCount))
+            return static_cast<int>(value);
+        if (value >> MaxBits)
+            return BinCount - 1;
+        const int power = HighestBit(value);
+        const int group = power - SubBits + 1;
+        const int sub = static_cast<int>(value >> (power - SubBits)) - SubCount;
+        return group * SubCount + sub;
+    }
+
+    /// the smallest value recorded by the given bin
+    static uint64_t BinMin(const int bin);
+
+    /// the number of different values recorded by the given bin
+    static uint64_t BinWidth(const int bin);
+
+    /// microseconds from start to finish or zero if finish precedes start
+    static uint64_t Usec(const struct timeval &start, const struct timeval &finish) {
+        const int64_t usec = static_cast<int64_t>(finish.tv_sec - start.tv_sec) * 1000000 +
+                             (finish.tv_usec - start.tv_usec);
+        return usec > 0 ? static_cast<uint64_t>(usec) : 0;
+    }
+
+private:
+    /// position of the most significant set bit in a positive value
+    static int HighestBit(uint64_t value) {
+        int bit = 0;
+        for (int shift = 32; shift > 0; shift >>= 1) {
+            if (value >> shift) {
+                value >>= shift;
+                bit += shift;
+            }
+        }
+        return bit;
+    }
+
+    double pctileAfter(const LatencyHistogram *earlier, const double pctile) const;
+
+    Counter bins[BinCount];
+};
+
+#endif /* SQUID_LATENCY_HISTOGRAM_H */
@@ -0,0 +1,97 @@
+/*
+ * DEBUG: section 13    High Level Memory Pool Management
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+#ifndef SQUID_MEMARENA_H
+#define SQUID_MEMARENA_H
+
+#if HAVE_IOSFWD
+#include <iosfwd>
+#endif
+
+/**
+ * Allocates memory for data that never outlives the arena owner, such as
+ * the URLs of a client transaction. Allocated memory is never freed
+ * individually; all of it is released when the arena is reset or destroyed.
+ *
+ * Small amounts are carved out of a buffer inside the arena itself,
+ * requiring no allocations at all. More space comes from blocks of the
+ * "MemArena block" pool. Requests exceeding the block size are satisfied
+ * with xmalloc() and released with the arena as well.
+ *
+ * Objects that may outlive the arena owner, such as refcounted or
+ * cbdata-protected objects, must continue to use their MemPools.
+ */
+class MemArena
+{
+public:
+    MemArena();
+    ~MemArena();
+
+    /// returns size bytes of uninitialized memory, aligned for basic types
+    void *alloc(size_t size);
+    /// returns an arena copy of the given c-string
+    char *dup(const char *s);
+    /// like xstrndup(): copies at most n-1 characters and terminates the copy
+    char *ndup(const char *s, size_t n);
+    /// releases all allocated memory, making the arena empty again
+    void reset();
+
+    /// reports arena usage statistics for the "mem" cache manager page
+    static void Stats(std::ostream &);
+
+    /// size of the buffer embedded in every arena
+    static const size_t InlineSize = 512;
+    /// size of the pooled blocks used after the embedded buffer is exhausted
+    static const size_t BlockSize = 4096;
+
+private:
+    MemArena(const MemArena &); // not implemented
+    MemArena &operator =(const MemArena &); // not implemented
+
+    /// an allocated block, followed by its payload
+    class Block
+    {
+    public:
+        Block *next; ///< the previously allocated block or nil
+        bool pooled; ///< whether the block came from the block pool
+    };
+
+    Block *blocks_; ///< all allocated blocks
+    char *free_; ///< unused space in the current buffer
+    size_t avail_; ///< size of the unused space in the current buffer
+
+    /// the embedded buffer; the union aligns it
+    union {
+        double alignment_;
+        char buf_[InlineSize];
+    } inline_;
+};
+
+#endif /* SQUID_MEMARENA_H */
@@ -0,0 +1,100 @@
+/*
+ * DEBUG: section 73    HTTP Request
+ *
+ */
+
+#ifndef SQUID_PHASE_TIMES_H
+#define SQUID_PHASE_TIMES_H
+
+#if HAVE_TIME_H
+#include <time.h>
+#endif
+/* NP: sys/time.h is provided by libcompat */
+
+/**
+ * Time a master transaction spent in each of its processing phases.
+ * Phase boundaries are stamped with a monotonic clock that is read at
+ * the boundary itself, so short synchronous phases are measured too and
+ * system clock adjustments do not distort the results.
+ *
+ * A phase may be entered several times (e.g., when retrying a connection);
+ * the times are summed. Calling start() for a phase in progress has no
+ * effect. Times are kept in microseconds.
+ */
+class PhaseTimes
+{
+public:
+    typedef enum {
+        phAcl, ///< http_access, adapted_http_access, and cache checks
+        phAdaptation, ///< request and response adaptation
+        phStore, ///< waiting for the first bytes of a cache hit
+        phPeerSelect, ///< peer selection, including its DNS lookups
+        phDns, ///< DNS lookups
+        phConnect, ///< opening server connections
+        phServer, ///< sending the request and waiting for response headers
+        phEnd
+    } Phase;
+
+    PhaseTimes() {
+        for (int p = 0; p < phEnd; ++p) {
+            started[p] = 0;
+            spent[p] = -1;
+        }
+    }
+
+    /// marks the beginning of a phase unless it is already in progress
+    void start(const Phase p) {
+        if (!started[p])
+            started[p] = Now();
+    }
+
+    /// marks the end of a phase, if it is in progress
+    void stop(const Phase p) {
+        if (started[p]) {
+            add(p, Now() - started[p]);
+            started[p] = 0;
+        }
+    }
+
+    /// accounts for time spent in a phase measured elsewhere
+    void add(const Phase p, const int64_t usec) {
+        const int64_t sum = (spent[p] > 0 ? spent[p] : 0) + (usec > 0 ? usec : 0);
+        spent[p] = sum < 0x7FFFFFFF ? sum : 0x7FFFFFFF;
+    }
+
+    /// whether the transaction went through the phase
+    bool happened(const Phase p) const { return spent[p] >= 0; }
+
+    /// microseconds spent in the phase or -1 if it never ended
+    int64_t usec(const Phase p) const { return spent[p]; }
+
+    /// the phase name used in logformat codes and reports
+    static const char *Name(const Phase p) {
+        static const char *names[phEnd] = {
+            "acl", "adapt", "store", "peer", "dns", "connect", "server"
+        };
+        return names[p];
+    }
+
+    /// current monotonic clock reading, in microseconds; never zero
+    static int64_t Now() {
+#if defined(CLOCK_MONOTONIC)
+        struct timespec ts;
+        if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+            return static_cast<int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000 + 1;
+#endif
+        struct timeval tv;
+#if GETTIMEOFDAY_NO_TZP
+        gettimeofday(&tv);
+#else
+        gettimeofday(&tv, NULL);
+#endif
+        return static_cast<int64_t>(tv.tv_sec) * 1000000 + tv.tv_usec;
+    }
+
+private:
+    int64_t started[phEnd]; ///< Now() when the phase in progress began or 0
+    int32_t spent[phEnd]; ///< microseconds spent in each phase or -1
+};
+
+#endif /* SQUID_PHASE_TIMES_H */
@@ -191,6 +191,8 @@ ServerStateData::serverComplete()
     HttpRequest *r = originalRequest();
     r->hier.total_response_time = r->hier.first_conn_start.tv_sec ?
                                   tvSubMsec(r->hier.first_conn_start, current_time) : -1;
+    if (r->hier.first_conn_start.tv_sec)
+        statCounter.server.svcTime.count(r->hier.first_conn_start, current_time);
 
     if (requestBodySource != NULL)
         stopConsumingFrom(requestBodySource);
@@ -551,6 +553,7 @@ ServerStateData::startAdaptation(const Adaptation::ServiceGroupPointer &group, H
             virginBodyDestination->setBodySize(size);
     }
 
+    cause->phases.start(PhaseTimes::phAdaptation);
     adaptedHeadSource = initiateAdaptation(
                             new Adaptation::Iterator(vrep, cause, group));
     startedAdaptation = initiated(adaptedHeadSource);
@@ -655,6 +658,7 @@ void
 ServerStateData::noteAdaptationAnswer(const Adaptation::Answer &answer)
 {
     clearAdaptation(adaptedHeadSource); // we do not expect more messages
+    originalRequest()->phases.stop(PhaseTimes::phAdaptation);
 
     switch (answer.kind) {
     case Adaptation::Answer::akForward:
@@ -118,6 +118,7 @@ public:
         time_msec_t idns_retransmit;
         time_msec_t idns_query;
 #endif
+        time_msec_t happy_eyeballs; ///< spare connection delay
 
     } Timeout;
     size_t maxRequestHeaderSize;
@@ -320,6 +321,7 @@ public:
         int ignore_unknown_nameservers;
         int client_pconns;
         int server_pconns;
+        int server_pconn_sharing;
         int error_pconns;
 #if USE_CACHE_DIGESTS
 
@@ -458,6 +460,12 @@ public:
     } comm_incoming;
     int max_open_disk_fds;
     int uri_whitespace;
+
+    struct {
+        int order; ///< PCONN_REUSE_LIFO or PCONN_REUSE_FIFO
+        time_t maxIdle; ///< do not reuse connections idle longer than this
+    } serverPconnReuse;
+
     AclSizeLimit *rangeOffsetLimit;
 #if MULTICAST_MISS_STREAM
 
@@ -493,6 +501,8 @@ public:
     struct {
         int unclean_shutdown;
         char *ssl_engine;
+        int64_t sessionCacheSize; ///< shared TLS session cache size
+        time_t sessionTtl; ///< TLS session lifetime
     } SSL;
 #endif
 
@@ -528,6 +538,7 @@ public:
 #endif
 
     char *accept_filter;
+    int accept_batch;
     int umask;
     int max_filedescriptors;
     int workers;
@@ -77,6 +77,27 @@ private:
 class StoreEntry;
 #endif
 
+/// String buffer sharing statistics
+class StringStats
+{
+public:
+    StringStats();
+
+    /// dumps class-wide statistics
+    std::ostream& dump(std::ostream& os) const;
+
+public:
+    uint64_t allocated; ///< buffers allocated
+    uint64_t shared;   ///< String copies that share the original buffer
+    uint64_t unshared; ///< shared buffers copied before modification
+};
+
+/**
+ * A copy-on-write string. Copies and assignments share the buffer of the
+ * original instead of duplicating it. The first modification of a shared
+ * buffer gives the modified String its own copy. The buffer reference count
+ * is kept in the same string pool allocation, right before the characters.
+ */
 class String
 {
 
@@ -150,6 +171,9 @@ public:
 
     _SQUID_INLINE_ void cut(size_type newLength);
 
+    /// obtain a const view of class-wide statistics
+    static const StringStats& GetStats();
+
 #if DEBUGSTRINGS
     void stat(StoreEntry *) const;
 #endif
@@ -158,15 +182,20 @@ private:
     void allocAndFill(const char *str, int len);
     void allocBuffer(size_type sz);
     void setBuffer(char *buf, size_type sz);
+    void share(String const &old);
+    void unshare();
+    uint32_t &refs() const;
 
     _SQUID_INLINE_ bool nilCmp(bool, bool, int &) const;
 
     /* never reference these directly! */
-    size_type size_; /* buffer size; 64K limit */
+    size_type size_; /* buffer size, including the reference count; 64K limit */
 
     size_type len_;  /* current length  */
 
-    char *buf_;
+    char *buf_; /* characters after the reference count, or nil */
+
+    static StringStats Stats; ///< class-wide statistics
 
     _SQUID_INLINE_ void set(char const *loc, char const ch);
     _SQUID_INLINE_ void cutPointer(char const *loc);
@@ -32,6 +32,8 @@
 #ifndef STATCOUNTERS_H_
 #define STATCOUNTERS_H_
 
+#include "LatencyHistogram.h"
+#include "PhaseTimes.h"
 #include "StatHist.h"
 
 #if USE_CACHE_DIGESTS
@@ -57,6 +59,7 @@ class StatCounters
 public:
     struct {
         int clients;
+        int accepts; ///< accepted client connections
         int requests;
         int hits;
         int mem_hits;
@@ -65,11 +68,11 @@ public:
         kb_t kbytes_in;
         kb_t kbytes_out;
         kb_t hit_kbytes_out;
-        StatHist missSvcTime;
-        StatHist nearMissSvcTime;
-        StatHist nearHitSvcTime;
-        StatHist hitSvcTime;
-        StatHist allSvcTime;
+        LatencyHistogram missSvcTime;
+        LatencyHistogram nearMissSvcTime;
+        LatencyHistogram nearHitSvcTime;
+        LatencyHistogram hitSvcTime;
+        LatencyHistogram allSvcTime;
     } client_http;
 
     struct {
@@ -80,6 +83,7 @@ public:
             kb_t kbytes_in;
             kb_t kbytes_out;
         } all , http, ftp, other;
+        LatencyHistogram svcTime; ///< time from the first connection attempt to response end
     } server;
 
     struct {
@@ -99,8 +103,8 @@ public:
         kb_t kbytes_recv;
         kb_t q_kbytes_recv;
         kb_t r_kbytes_recv;
-        StatHist querySvcTime;
-        StatHist replySvcTime;
+        LatencyHistogram querySvcTime;
+        LatencyHistogram replySvcTime;
         int query_timeouts;
         int times_used;
     } icp;
@@ -115,9 +119,26 @@ public:
     } unlink;
 
     struct {
-        StatHist svcTime;
+        LatencyHistogram svcTime;
     } dns;
 
+    struct {
+        LatencyHistogram svcTime; ///< ICAP transaction duration
+    } icap;
+
+    struct {
+        LatencyHistogram svcTime; ///< shared disk I/O request response time
+    } disk;
+
+    /// Comm::TcpAcceptor activity
+    struct {
+        int events; ///< listening socket readiness events handled
+        int full_batches; ///< events that reached the accept_batch limit
+        int deferrals; ///< accepts postponed for the lack of descriptors
+        LatencyHistogram delay; ///< time from listener readiness to accept()
+        LatencyHistogram backlog; ///< connections queued at each event
+    } acceptor;
+
     struct {
         int times_used;
         kb_t kbytes_sent;
@@ -179,6 +200,12 @@ public:
         int ins;
     } swap;
 
+    /// transaction phase totals, indexed by PhaseTimes::Phase
+    struct {
+        uint64_t count[PhaseTimes::phEnd]; ///< transactions that completed the phase
+        uint64_t usec[PhaseTimes::phEnd]; ///< time those transactions spent in it
+    } phases;
+
 private:
 };
 
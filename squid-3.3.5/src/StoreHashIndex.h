@@ -113,6 +113,7 @@ public:
 
 private:
     void copyBucket();
+    static void CopyEntry(hash_link *link, void *data);
     void (*callback)(void *cbdata);
     void *cbdata;
     bool _done;
@@ -0,0 +1,298 @@
+/*
+ * DEBUG: section 20    Storage Manager Key Table
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "fatal.h"
+#include "StoreKeyTable.h"
+
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+
+/// marks old table slots that lost their link while the table was growing
+static hash_link TombstoneLink;
+static hash_link *const Tombstone = &TombstoneLink;
+
+/// the maximum number of used slots per slot, as a fraction of 1024
+static const uint32_t MaxLoad = 768;
+
+/// how many old table slots each modification migrates while growing;
+/// must exceed capacity/(capacity*MaxLoad/1024) to finish before the next
+/// growth, but is kept small to bound the per-call cost
+static const uint32_t MigrationStep = 16;
+
+void
+StoreKeyTable::Slots::allocate(int newBits)
+{
+    assert(!links);
+    bits = newBits;
+    fingerprints = static_cast<uint32_t *>(xcalloc(capacity(), sizeof(*fingerprints)));
+    links = static_cast<hash_link **>(xcalloc(capacity(), sizeof(*links)));
+    used = 0;
+}
+
+void
+StoreKeyTable::Slots::release()
+{
+    safe_free(fingerprints);
+    safe_free(links);
+    bits = 0;
+    used = 0;
+}
+
+StoreKeyTable::StoreKeyTable(uint32_t walkBucketCount):
+        migrated(0), count(0), walkBits(0)
+{
+    assert(walkBucketCount > 0);
+    while ((1U << walkBits) < walkBucketCount)
+        ++walkBits;
+    assert((1U << walkBits) == walkBucketCount); // a power of two
+    assert(walkBits < 32);
+
+    // each walk bucket gets at least one slot; see walkBucket()
+    current.allocate(walkBits);
+}
+
+StoreKeyTable::~StoreKeyTable()
+{
+    current.release();
+    old.release();
+}
+
+uint32_t
+StoreKeyTable::Fingerprint(const void *key)
+{
+    // MD5 cache keys are uniformly distributed already
+    uint32_t fingerprint;
+    memcpy(&fingerprint, key, sizeof(fingerprint));
+    return fingerprint;
+}
+
+/// searches the given slots for key, skipping migrated old slots
+bool
+StoreKeyTable::findIn(const Slots &slots, uint32_t skipBelow, const void *key, uint32_t fingerprint, uint32_t &pos) const
+{
+    if (!slots.links)
+        return false;
+
+    pos = slots.home(fingerprint);
+    for (uint32_t probes = 0; probes < slots.capacity(); ++probes) {
+        if (pos >= slots.capacity())
+            pos = 0;
+        if (pos < skipBelow) // all these are tombstones
+            pos = skipBelow;
+
+        const hash_link *link = slots.links[pos];
+        if (!link)
+            return false;
+        if (link != Tombstone && slots.fingerprints[pos] == fingerprint &&
+                memcmp(link->key, key, SQUID_MD5_DIGEST_LENGTH) == 0)
+            return true;
+        ++pos;
+    }
+    return false;
+}
+
+hash_link *
+StoreKeyTable::find(const void *key) const
+{
+    const uint32_t fingerprint = Fingerprint(key);
+    uint32_t pos = 0;
+    if (findIn(current, 0, key, fingerprint, pos))
+        return current.links[pos];
+    if (findIn(old, migrated, key, fingerprint, pos))
+        return old.links[pos];
+    return NULL;
+}
+
+/// puts link into the first free slot at or after its home position
+void
+StoreKeyTable::place(Slots &slots, hash_link *link, uint32_t fingerprint)
+{
+    uint32_t pos = slots.home(fingerprint);
+    while (slots.links[pos])
+        pos = (pos + 1) & slots.mask();
+    slots.fingerprints[pos] = fingerprint;
+    slots.links[pos] = link;
+    ++slots.used;
+}
+
+void
+StoreKeyTable::insert(hash_link *link)
+{
+    assert(link);
+    if ((count + 1) * 1024 > static_cast<uint64_t>(current.capacity()) * MaxLoad)
+        startGrowing();
+
+    place(current, link, Fingerprint(link->key));
+    ++count;
+    migrate(MigrationStep);
+}
+
+/// removes the link at pos, shifting the following probe chain back
+void
+StoreKeyTable::eraseAt(Slots &slots, uint32_t pos)
+{
+    uint32_t hole = pos;
+    uint32_t next = (hole + 1) & slots.mask();
+    while (slots.links[next]) {
+        const uint32_t home = slots.home(slots.fingerprints[next]);
+        // move the next link into the hole unless its home is in (hole, next]
+        if (((next - home) & slots.mask()) >= ((next - hole) & slots.mask())) {
+            slots.fingerprints[hole] = slots.fingerprints[next];
+            slots.links[hole] = slots.links[next];
+            hole = next;
+        }
+        next = (next + 1) & slots.mask();
+    }
+    slots.links[hole] = NULL;
+    --slots.used;
+}
+
+void
+StoreKeyTable::remove(hash_link *link)
+{
+    assert(link);
+    const uint32_t fingerprint = Fingerprint(link->key);
+    uint32_t pos = 0;
+    if (findIn(current, 0, link->key, fingerprint, pos)) {
+        assert(current.links[pos] == link);
+        eraseAt(current, pos);
+    } else if (findIn(old, migrated, link->key, fingerprint, pos)) {
+        assert(old.links[pos] == link);
+        // shifting old links could move them below the migration cursor
+        old.links[pos] = Tombstone;
+    } else {
+        fatal("StoreKeyTable::remove: could not find entry");
+    }
+    --count;
+    migrate(MigrationStep);
+}
+
+/// starts moving links into a twice larger table
+void
+StoreKeyTable::startGrowing()
+{
+    migrate(old.capacity()); // finish the previous growth, if any
+    assert(!old.links);
+
+    old = current;
+    current = Slots();
+    current.allocate(old.bits + 1);
+    migrated = 0;
+    debugs(20, 3, HERE << "growing to " << current.capacity() << " slots for " << count << " entries");
+}
+
+/// moves up to slotCount old table slots into the current table
+void
+StoreKeyTable::migrate(uint32_t slotCount)
+{
+    if (!old.links)
+        return;
+
+    while (slotCount > 0 && migrated < old.capacity()) {
+        hash_link *link = old.links[migrated];
+        if (link && link != Tombstone)
+            place(current, link, old.fingerprints[migrated]);
+        // keep probe chains intact for links that were not migrated yet
+        old.links[migrated] = Tombstone;
+        ++migrated;
+        --slotCount;
+    }
+
+    if (migrated >= old.capacity()) {
+        old.release();
+        migrated = 0;
+    }
+}
+
+/// calls visitor for the given slots links that belong to the walk bucket
+void
+StoreKeyTable::walkIn(const Slots &slots, uint32_t bucket, Visitor *visitor, void *data) const
+{
+    if (!slots.links)
+        return;
+
+    // Links with home positions inside the bucket range may be placed after
+    // that range, but never after the first empty slot following it. The
+    // range may also contain links from the preceding walk buckets.
+    const int shift = slots.bits - walkBits;
+    const uint32_t start = bucket << shift;
+    const uint32_t rangeSize = 1U << shift;
+    for (uint32_t i = 0; i < slots.capacity(); ++i) {
+        const uint32_t pos = (start + i) & slots.mask();
+        const hash_link *link = slots.links[pos];
+        if (!link) {
+            if (i >= rangeSize)
+                break;
+            continue;
+        }
+        if (link != Tombstone && (slots.fingerprints[pos] >> (32 - walkBits)) == bucket)
+            visitor(slots.links[pos], data);
+    }
+}
+
+void
+StoreKeyTable::walkBucket(uint32_t bucket, Visitor *visitor, void *data) const
+{
+    assert(bucket < walkBuckets());
+    walkIn(current, bucket, visitor, data);
+    walkIn(old, bucket, visitor, data);
+}
+
+void
+StoreKeyTable::freeItems(HASHFREE *freer)
+{
+    // collect first because freer modifies the table
+    hash_link **list = static_cast<hash_link **>(xcalloc(count + 1, sizeof(hash_link *)));
+    size_t collected = 0;
+    const Slots *tables[] = { &current, &old };
+    for (int t = 0; t < 2; ++t) {
+        const Slots &slots = *tables[t];
+        for (uint32_t pos = 0; pos < slots.capacity(); ++pos) {
+            hash_link *link = slots.links[pos];
+            if (link && link != Tombstone && collected < count)
+                list[collected++] = link;
+        }
+    }
+
+    for (size_t i = 0; i < collected; ++i)
+        freer(list[i]);
+    xfree(list);
+}
+
+size_t
+StoreKeyTable::memoryUsed() const
+{
+    const size_t slotSize = sizeof(uint32_t) + sizeof(hash_link *);
+    return (current.capacity() + old.capacity()) * slotSize;
+}
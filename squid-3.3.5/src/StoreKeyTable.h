@@ -0,0 +1,127 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_STOREKEYTABLE_H
+#define SQUID_STOREKEYTABLE_H
+
+#include "hash.h"
+#include "md5.h"
+
+/**
+ \ingroup StorageManager
+ *
+ * An open-addressing hash table of hash_links (i.e., StoreEntries) keyed by
+ * MD5 cache keys. This is the store_table implementation.
+ *
+ * Each slot keeps a 32-bit key fingerprint in an array separate from the
+ * link pointers, so most lookups compare fingerprints in one or two cache
+ * lines and dereference a link only on a likely match. Collisions are
+ * resolved using linear probing; removals use backward-shift deletion.
+ *
+ * The table grows incrementally: when it gets too full, a twice larger table
+ * is allocated, and every subsequent modification migrates a few slots from
+ * the old table until it is empty. Lookups check both tables meanwhile.
+ *
+ * For StoreSearch walks, keys are also grouped into a fixed number of
+ * "walk buckets" by their fingerprint prefix. Since slot positions are also
+ * based on fingerprint prefixes, every walk bucket occupies a contiguous
+ * slot range, regardless of the table size, and can be copied cheaply.
+ */
+class StoreKeyTable
+{
+public:
+    /// visits one link; see walkBucket()
+    typedef void Visitor(hash_link *link, void *data);
+
+    /// \param walkBuckets the number of walk buckets; a power of two
+    explicit StoreKeyTable(uint32_t walkBuckets);
+    ~StoreKeyTable();
+
+    /// the link with the given key or nil
+    hash_link *find(const void *key) const;
+
+    /// adds a link with a new key (already stored in the link)
+    void insert(hash_link *link);
+
+    /// removes a previously inserted link
+    void remove(hash_link *link);
+
+    /// the number of links in the table
+    size_t size() const { return count; }
+
+    /// the number of walk buckets
+    uint32_t walkBuckets() const { return 1U << walkBits; }
+
+    /// calls visitor for each link in the given walk bucket
+    void walkBucket(uint32_t bucket, Visitor *visitor, void *data) const;
+
+    /// passes each link to freer, which is expected to remove() the link
+    void freeItems(HASHFREE *freer);
+
+    /// the memory used by the slots of both tables
+    size_t memoryUsed() const;
+
+private:
+    /// a power-of-two array of slots with fingerprints and links
+    class Slots
+    {
+    public:
+        Slots(): fingerprints(NULL), links(NULL), bits(0), used(0) {}
+
+        void allocate(int bits);
+        void release();
+
+        uint32_t capacity() const { return bits ? (1U << bits) : 0; }
+        uint32_t mask() const { return capacity() - 1; }
+        uint32_t home(uint32_t fingerprint) const { return bits ? fingerprint >> (32 - bits) : 0; }
+
+        uint32_t *fingerprints; ///< key fingerprints of used slots
+        hash_link **links; ///< nil for empty slots
+        int bits; ///< log2(capacity)
+        uint32_t used; ///< the number of used slots, including tombstones
+    };
+
+    static uint32_t Fingerprint(const void *key);
+
+    bool findIn(const Slots &slots, uint32_t skipBelow, const void *key, uint32_t fingerprint, uint32_t &pos) const;
+    void place(Slots &slots, hash_link *link, uint32_t fingerprint);
+    void eraseAt(Slots &slots, uint32_t pos);
+    void walkIn(const Slots &slots, uint32_t bucket, Visitor *visitor, void *data) const;
+    void startGrowing();
+    void migrate(uint32_t slotCount);
+
+    Slots current; ///< where new links go
+    Slots old; ///< links waiting to be migrated to current (while growing)
+    uint32_t migrated; ///< the number of old slots already migrated
+
+    size_t count; ///< the number of links in both tables
+    int walkBits; ///< log2(walkBuckets())
+};
+
+#endif /* SQUID_STOREKEYTABLE_H */
@@ -41,6 +41,35 @@
 #if HAVE_LIMITS_H
 #include <limits.h>
 #endif
+#if HAVE_IOSTREAM
+#include <iostream>
+#endif
+
+StringStats String::Stats;
+
+/* StringStats */
+
+StringStats::StringStats(): allocated(0), shared(0), unshared(0)
+{}
+
+std::ostream&
+StringStats::dump(std::ostream &os) const
+{
+    os <<
+    "String buffers allocated: " << allocated <<
+    "\nString copies sharing a buffer: " << shared <<
+    "\nString buffers copied on write: " << unshared <<
+    "\nString buffer allocations avoided: " << (shared - unshared) << std::endl;
+    return os;
+}
+
+/* String */
+
+const StringStats&
+String::GetStats()
+{
+    return Stats;
+}
 
 int
 String::psize() const
@@ -49,6 +78,9 @@ String::psize() const
     return size();
 }
 
+/// bytes taken by the reference count in front of the String characters
+static const String::size_type RefsSize = sizeof(uint32_t);
+
 // low-level buffer allocation,
 // does not free old buffer and does not adjust or look at len_
 void
@@ -56,8 +88,11 @@ String::allocBuffer(String::size_type sz)
 {
     PROF_start(StringInitBuf);
     assert (undefined());
-    char *newBuffer = (char*)memAllocString(sz, &sz);
+    // the reference count shares the allocation with the characters
+    char *newBuffer = (char*)memAllocString(RefsSize + sz, &sz);
     setBuffer(newBuffer, sz);
+    refs() = 1;
+    ++Stats.allocated;
     PROF_stop(StringInitBuf);
 }
 
@@ -67,11 +102,53 @@ void
 String::setBuffer(char *aBuf, String::size_type aSize)
 {
     assert(undefined());
-    assert(aSize < 65536);
-    buf_ = aBuf;
+    assert(aSize < 65536 + RefsSize);
+    buf_ = aBuf + RefsSize;
     size_ = aSize;
 }
 
+/// the number of Strings using the buffer
+uint32_t &
+String::refs() const
+{
+    assert(defined());
+    return *reinterpret_cast<uint32_t *>(buf_ - RefsSize);
+}
+
+// low-level buffer sharing,
+// does not free old buffer
+void
+String::share(String const &old)
+{
+    assert(undefined());
+    if (old.defined()) {
+        buf_ = old.buf_;
+        size_ = old.size_;
+        len_ = old.len_;
+        ++refs();
+        ++Stats.shared;
+    }
+}
+
+/// gives this String its own copy of a buffer shared with other Strings;
+/// must be called before modifying the buffer
+void
+String::unshare()
+{
+    if (undefined() || refs() <= 1)
+        return;
+
+    PROF_start(StringUnshare);
+    const char *old = buf_;
+    --refs(); // other Strings still use the old buffer
+    buf_ = NULL;
+    size_ = 0;
+    allocBuffer(len_ + 1);
+    memcpy(buf_, old, len_ + 1);
+    ++Stats.unshared;
+    PROF_stop(StringUnshare);
+}
+
 String::String(char const *aString) : size_(0), len_(0), buf_(NULL)
 {
     if (aString)
@@ -92,9 +169,10 @@ String::operator =(char const *aString)
 String &
 String::operator =(String const &old)
 {
-    clean(); // TODO: optimize to avoid cleaning the buffer we can use
-    if (old.size() > 0)
-        allocAndFill(old.rawBuf(), old.size());
+    if (buf_ != old.buf_) {
+        clean();
+        share(old);
+    }
     return *this;
 }
 
@@ -140,8 +218,7 @@ String::allocAndFill(const char *str, int len)
 
 String::String(String const &old) : size_(0), len_(0), buf_(NULL)
 {
-    if (old.size() > 0)
-        allocAndFill(old.rawBuf(), old.size());
+    share(old);
 #if DEBUGSTRINGS
 
     StringRegistry::Instance().add(this);
@@ -155,13 +232,13 @@ String::clean()
     assert(this);
 
     /* TODO if mempools has already closed this will FAIL!! */
-    if (defined())
-        memFreeString(size_, buf_);
-
-    len_ = 0;
+    if (defined() && --refs() == 0)
+        memFreeString(size_, buf_ - RefsSize);
 
     size_ = 0;
 
+    len_ = 0;
+
     buf_ = NULL;
     PROF_stop(StringClean);
 }
@@ -192,9 +269,10 @@ String::append( char const *str, int len)
     assert(str && len >= 0);
 
     PROF_start(StringAppend);
-    if (len_ + len < size_) {
-        strncat(buf_, str, len);
+    if (defined() && refs() == 1 && len_ + len < size_ - RefsSize) {
+        memcpy(buf_ + len_, str, len);
         len_ += len;
+        buf_[len_] = '\0';
     } else {
         // Create a temporary string and absorb it later.
         String snew;
@@ -234,14 +312,18 @@ String::append(char const chr)
 void
 String::append(String const &old)
 {
-    append(old.rawBuf(), old.len_);
+    if (undefined())
+        share(old);
+    else
+        append(old.rawBuf(), old.len_);
 }
 
 void
 String::absorb(String &old)
 {
     clean();
-    setBuffer(old.buf_, old.size_);
+    buf_ = old.buf_;
+    size_ = old.size_;
     len_ = old.len_;
     old.size_ = 0;
     old.buf_ = NULL;
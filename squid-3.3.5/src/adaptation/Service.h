@@ -35,6 +35,9 @@ public:
 
     bool wants(const ServiceFilter &filter) const;
 
+    /// the number of transactions using or waiting for the service
+    virtual int load() const { return 0; }
+
     // the methods below can only be called on an up() service
     virtual bool wantsUrl(const String &urlPath) const = 0;
 
@@ -12,7 +12,7 @@
 
 Adaptation::ServiceConfig::ServiceConfig():
         port(-1), method(methodNone), point(pointNone),
-        bypass(false), maxConn(-1), onOverload(srvWait),
+        bypass(false), maxConn(-1), minIdleConn(0), onOverload(srvWait),
         routing(false), ipv6(false)
 {}
 
@@ -120,6 +120,8 @@ Adaptation::ServiceConfig::parse()
                 debugs(3, DBG_PARSE_NOTE(DBG_IMPORTANT), "WARNING: IPv6 is disabled. ICAP service option ignored.");
         } else if (strcmp(name, "max-conn") == 0)
             grokked = grokLong(maxConn, name, value);
+        else if (strcmp(name, "min-idle-conn") == 0)
+            grokked = grokLong(minIdleConn, name, value);
         else if (strcmp(name, "on-overload") == 0) {
             grokked = grokOnOverload(onOverload, value);
             onOverloadSet = true;
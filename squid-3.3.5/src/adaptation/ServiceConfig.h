@@ -35,6 +35,7 @@ public:
 
     // options
     long maxConn; ///< maximum number of concurrent service transactions
+    long minIdleConn; ///< idle connections to keep open in advance
     SrvBehaviour onOverload; ///< how to handle Max-Connections feature
     bool routing; ///< whether this service may determine the next service(s)
     bool ipv6;    ///< whether this service uses IPv6 transport (default IPv4)
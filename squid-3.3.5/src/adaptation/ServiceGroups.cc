@@ -5,6 +5,7 @@
 #include "adaptation/Service.h"
 #include "adaptation/ServiceFilter.h"
 #include "adaptation/ServiceGroups.h"
+#include "cache_cf.h"
 #include "ConfigParser.h"
 #include "Debug.h"
 #include "StrList.h"
@@ -12,7 +13,7 @@
 
 Adaptation::ServiceGroup::ServiceGroup(const String &aKind, bool allSame):
         kind(aKind), method(methodNone), point(pointNone),
-        allServicesSame(allSame)
+        allServicesSame(allSame), balanced(false)
 {
 }
 
@@ -27,11 +28,30 @@ Adaptation::ServiceGroup::parse()
 
     wordlist *names = NULL;
     ConfigParser::ParseWordList(&names);
-    for (wordlist *i = names; i; i = i->next)
-        services.push_back(i->key);
+    for (wordlist *i = names; i; i = i->next) {
+        if (allServicesSame && strncmp(i->key, "balance=", 8) == 0)
+            parseBalance(i->key + 8);
+        else
+            services.push_back(i->key);
+    }
     wordlistDestroy(&names);
 }
 
+/// interprets the balance=method option of adaptation_service_set
+void
+Adaptation::ServiceGroup::parseBalance(const char *value)
+{
+    if (strcmp(value, "least-load") == 0)
+        balanced = true;
+    else if (strcmp(value, "failover") == 0)
+        balanced = false;
+    else {
+        debugs(3, DBG_CRITICAL, "ERROR: unknown balance method '" << value <<
+               "' in " << kind << ' ' << id);
+        self_destruct();
+    }
+}
+
 // Note: configuration code aside, this method is called by DynamicServiceChain
 void
 Adaptation::ServiceGroup::finalize()
@@ -116,9 +136,36 @@ Adaptation::ServiceGroup::finalizeMsg(const char *msg, const String &culprit,
            id << "'");
 }
 
-Adaptation::ServicePointer Adaptation::ServiceGroup::at(const Pos pos) const
+Adaptation::ServicePointer Adaptation::ServiceGroup::at(const Pos pos, const Pos offset) const
 {
-    return FindService(services[pos]);
+    return FindService(services[(offset + pos) % services.size()]);
+}
+
+/// zero or, for balanced sets, the position of the least loaded usable service
+Adaptation::ServiceGroup::Pos
+Adaptation::ServiceGroup::startOffset(const ServiceFilter &filter) const
+{
+    if (!balanced)
+        return 0;
+
+    Pos best = 0;
+    int bestLoad = -1;
+    for (Pos pos = 0; has(pos); ++pos) {
+        ServicePointer service = at(pos);
+        if (!service || !service->up() || !service->wants(filter))
+            continue;
+
+        // ties go to the earlier service, like without balancing
+        const int load = service->load();
+        if (bestLoad < 0 || load < bestLoad) {
+            best = pos;
+            bestLoad = load;
+        }
+    }
+
+    debugs(93,7, HERE << id << " starts with service at " << best <<
+           " with load " << bestLoad);
+    return best;
 }
 
 /// \todo: optimize to cut search short instead of looking for the best svc
@@ -130,7 +177,7 @@ Adaptation::ServiceGroup::wants(const ServiceFilter &filter) const
 }
 
 bool
-Adaptation::ServiceGroup::findService(const ServiceFilter &filter, Pos &pos) const
+Adaptation::ServiceGroup::findService(const ServiceFilter &filter, Pos &pos, const Pos offset) const
 {
     if (method != filter.method || point != filter.point) {
         debugs(93,5,HERE << id << " serves another location");
@@ -142,7 +189,7 @@ Adaptation::ServiceGroup::findService(const ServiceFilter &filter, Pos &pos) con
     Pos essPos = 0;
     for (; has(pos); ++pos) {
         debugs(93,9,HERE << id << " checks service at " << pos);
-        ServicePointer service = at(pos);
+        ServicePointer service = at(pos, offset);
 
         if (!service)
             continue; // the service was lost due to reconfiguration
@@ -183,9 +230,9 @@ Adaptation::ServiceGroup::findService(const ServiceFilter &filter, Pos &pos) con
 }
 
 bool
-Adaptation::ServiceGroup::findReplacement(const ServiceFilter &filter, Pos &pos) const
+Adaptation::ServiceGroup::findReplacement(const ServiceFilter &filter, Pos &pos, const Pos offset) const
 {
-    return allServicesSame && findService(filter, pos);
+    return allServicesSame && findService(filter, pos, offset);
 }
 
 bool
@@ -264,16 +311,19 @@ Adaptation::DynamicServiceChain::Split(const ServiceFilter &filter,
 
 /* ServicePlan */
 
-Adaptation::ServicePlan::ServicePlan(): pos(0), atEof(true)
+Adaptation::ServicePlan::ServicePlan(): pos(0), offset(0), atEof(true)
 {
 }
 
 Adaptation::ServicePlan::ServicePlan(const ServiceGroupPointer &g,
                                      const ServiceFilter &filter):
-        group(g), pos(0), atEof(!g || !g->has(pos))
+        group(g), pos(0), offset(0), atEof(!g || !g->has(pos))
 {
+    if (!atEof)
+        offset = group->startOffset(filter);
+
     // this will find the first service because starting pos is zero
-    if (!atEof && !group->findService(filter, pos))
+    if (!atEof && !group->findService(filter, pos, offset))
         atEof = true;
 }
 
@@ -281,13 +331,13 @@ Adaptation::ServicePointer
 Adaptation::ServicePlan::current() const
 {
     // may return NULL even if not atEof
-    return atEof ? Adaptation::ServicePointer() : group->at(pos);
+    return atEof ? Adaptation::ServicePointer() : group->at(pos, offset);
 }
 
 Adaptation::ServicePointer
 Adaptation::ServicePlan::replacement(const ServiceFilter &filter)
 {
-    if (!atEof && !group->findReplacement(filter, ++pos))
+    if (!atEof && !group->findReplacement(filter, ++pos, offset))
         atEof = true;
     return current();
 }
@@ -306,7 +356,11 @@ Adaptation::ServicePlan::print(std::ostream &os) const
     if (!group)
         return os << "[nil]";
 
-    return os << group->id << '[' << pos << ".." << group->services.size() <<
+    if (offset)
+        os << group->id << '+' << offset;
+    else
+        os << group->id;
+    return os << '[' << pos << ".." << group->services.size() <<
            (atEof ? ".]" : "]");
 }
 
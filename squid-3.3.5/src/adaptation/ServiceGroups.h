@@ -41,14 +41,18 @@ protected:
     /// these methods control group iteration; used by ServicePlan
 
     /// find next to try after failure, starting with pos
-    bool findReplacement(const ServiceFilter &filter, Pos &pos) const;
+    bool findReplacement(const ServiceFilter &filter, Pos &pos, const Pos offset) const;
     /// find next to link after success, starting with pos
     bool findLink(const ServiceFilter &filter, Pos &pos) const;
+    /// where a new plan should start iterating (see ServicePlan::offset)
+    Pos startOffset(const ServiceFilter &filter) const;
 
 private:
-    ServicePointer at(const Pos pos) const;
-    bool findService(const ServiceFilter &filter, Pos &pos) const;
+    /// the service at pos when iteration starts with the service at offset
+    ServicePointer at(const Pos pos, const Pos offset = 0) const;
+    bool findService(const ServiceFilter &filter, Pos &pos, const Pos offset = 0) const;
 
+    void parseBalance(const char *value);
     void checkUniqueness(const Pos checkedPos) const;
     void finalizeMsg(const char *msg, const String &culprit, bool error) const;
 
@@ -62,6 +66,7 @@ public:
     VectPoint point; /// based on the first added service
 
     const bool allServicesSame; // whether we can freely substitute services
+    bool balanced; ///< whether to start with the least loaded service
 };
 
 // a group of equivalent services; one service per set is usually used
@@ -132,6 +137,7 @@ public:
 private:
     ServiceGroupPointer group; ///< the group we are iterating
     Pos pos; ///< current service position within the group
+    Pos offset; ///< the group position of the first service tried
     bool atEof; ///< cached information for better performance
 };
 
@@ -47,7 +47,7 @@ Adaptation::Icap::Config::Config() :
         preview_enable(0), preview_size(0), allow206_enable(0),
         connect_timeout_raw(0), io_timeout_raw(0), reuse_connections(0),
         client_username_header(NULL), client_username_encode(0), repeat(NULL),
-        repeat_limit(0)
+        repeat_limit(0), result_cache_size(0), result_cache_max_body(0)
 {
 }
 
@@ -63,6 +63,8 @@ public:
     int client_username_encode;
     acl_access *repeat; ///< icap_retry ACL in squid.conf
     int repeat_limit; ///< icap_retry_limit in squid.conf
+    int64_t result_cache_size; ///< icap_result_cache_size in squid.conf
+    int64_t result_cache_max_body; ///< icap_result_cache_max_body in squid.conf
 
     Config();
     ~Config();
@@ -24,6 +24,7 @@
 #include "HttpMsg.h"
 #include "HttpReply.h"
 #include "HttpRequest.h"
+#include "md5.h"
 #include "SquidTime.h"
 #include "URL.h"
 
@@ -38,6 +39,9 @@ CBDATA_NAMESPACED_CLASS_INIT(Adaptation::Icap, ModXactLauncher);
 
 static const size_t TheBackupLimit = BodyPipe::MaxCapacity;
 
+/// smaller virgin body chunks are copied rather than written in place
+static const size_t TheInPlaceWriteMin = 4*1024;
+
 Adaptation::Icap::ModXact::State::State()
 {
     memset(this, 0, sizeof(*this));
@@ -48,13 +52,19 @@ Adaptation::Icap::ModXact::ModXact(HttpMsg *virginHeader,
         AsyncJob("Adaptation::Icap::ModXact"),
         Adaptation::Icap::Xaction("Adaptation::Icap::ModXact", aService),
         virginConsumed(0),
+        writingVirginInPlace(false),
         bodyParser(NULL),
         canStartBypass(false), // too early
         protectGroupBypass(true),
         replyHttpHeaderSize(-1),
         replyHttpBodySize(-1),
-        adaptHistoryId(-1)
+        adaptHistoryId(-1),
+        resultKeyed(false),
+        cachedBodyReplayed(0)
 {
+    connectStart.tv_sec = 0;
+    connectStart.tv_usec = 0;
+
     assert(virginHeader);
 
     virgin.setHeader(virginHeader); // sets virgin.body_pipe if needed
@@ -88,6 +98,10 @@ void Adaptation::Icap::ModXact::start()
 
     canStartBypass = service().cfg().bypass;
 
+    resultKeyed = ResultCache::Enabled() && makeResultKey();
+    if (resultKeyed && service().up() && replayCachedResult())
+        return;
+
     // it is an ICAP violation to send request to a service w/o known OPTIONS
     // and the service may is too busy for us: honor Max-Connections and such
     if (service().up() && service().availableForNew())
@@ -170,6 +184,10 @@ void Adaptation::Icap::ModXact::startWriting()
 {
     state.writing = State::writingConnect;
 
+    // time spent waiting for service OPTIONS or a free connection slot
+    connectStart = current_time;
+    service().noteQueueDelay(tvSubDsec(icap_tr_start, connectStart) * 1000.0);
+
     decideOnPreview(); // must be decided before we decideOnRetries
     decideOnRetries();
 
@@ -181,6 +199,8 @@ void Adaptation::Icap::ModXact::handleCommConnected()
 {
     Must(state.writing == State::writingConnect);
 
+    service().noteConnectDelay(tvSubDsec(connectStart, current_time) * 1000.0);
+
     startReading(); // wait for early errors from the ICAP server
 
     MemBuf requestBuf;
@@ -323,16 +343,34 @@ void Adaptation::Icap::ModXact::writeSomeBody(const char *label, size_t size)
     const size_t writableSize = virginContentSize(virginBodyWriting);
     const size_t chunkSize = min(writableSize, size);
 
+    // large chunks are written straight from the virgin body buffer, with
+    // writeBuf holding just the chunk framing around them
+    const bool inPlace = chunkSize >= TheInPlaceWriteMin;
+    const char *chunkData = NULL;
+    mb_size_t chunkHeadSize = 0;
+
     if (chunkSize) {
         debugs(93, 7, HERE << "will write " << chunkSize <<
-               "-byte chunk of " << label);
+               "-byte chunk of " << label << (inPlace ? " in place" : ""));
+
+        if (inPlace) {
+            // grow the buffer to its limit now so that appends by the
+            // producer cannot move the bytes we are going to write
+            BodyPipeCheckout bpc(*virgin.body_pipe);
+            bpc.buf.space(bpc.buf.potentialSpaceSize() + 1);
+            bpc.checkIn();
+            chunkData = virginContentData(virginBodyWriting);
+        }
 
         openChunk(writeBuf, chunkSize, false);
-        writeBuf.append(virginContentData(virginBodyWriting), chunkSize);
+        chunkHeadSize = writeBuf.contentSize();
+        if (!inPlace)
+            writeBuf.append(virginContentData(virginBodyWriting), chunkSize);
         closeChunk(writeBuf);
 
         virginBodyWriting.progress(chunkSize);
-        virginConsume();
+        if (!inPlace)
+            virginConsume(); // in-place bytes are consumed once written
     } else {
         debugs(93, 7, HERE << "has no writable " << label << " content");
     }
@@ -352,13 +390,37 @@ void Adaptation::Icap::ModXact::writeSomeBody(const char *label, size_t size)
     debugs(93, 7, HERE << "will write " << writeBuf.contentSize()
            << " raw bytes of " << label);
 
-    if (writeBuf.hasContent()) {
+    if (inPlace) {
+        writeBodyInPlace(writeBuf, chunkHeadSize, chunkData, chunkSize);
+        writeBuf.clean();
+    } else if (writeBuf.hasContent()) {
         scheduleWrite(writeBuf); // comm will free the chunk
     } else {
         writeBuf.clean();
     }
 }
 
+/// Writes the chunk data without copying it out of the virgin body buffer.
+/// The framing is everything writeSomeBody() formatted around the data.
+void Adaptation::Icap::ModXact::writeBodyInPlace(const MemBuf &framing, mb_size_t headSize, const char *data, size_t size)
+{
+    inPlaceFraming.reset();
+    inPlaceFraming.append(framing.content(), framing.contentSize());
+
+    char *framingBuf = inPlaceFraming.content();
+    struct iovec iov[3];
+    iov[0].iov_base = framingBuf;
+    iov[0].iov_len = headSize;
+    iov[1].iov_base = const_cast<char *>(data);
+    iov[1].iov_len = size;
+    iov[2].iov_base = framingBuf + headSize;
+    iov[2].iov_len = inPlaceFraming.contentSize() - headSize;
+
+    // virginConsume() and checkConsuming() wait for noteCommWrote()
+    writingVirginInPlace = true;
+    scheduleWrite(iov, 3);
+}
+
 void Adaptation::Icap::ModXact::addLastRequestChunk(MemBuf &buf)
 {
     const bool ieof = state.writing == State::writingPreview && preview.ieof();
@@ -422,6 +484,9 @@ void Adaptation::Icap::ModXact::virginConsume()
     if (!virgin.body_pipe)
         return; // nothing to consume
 
+    if (virginBodyPinned())
+        return; // Comm is still writing from the buffer
+
     if (isRetriable)
         return; // do not consume if we may have to retry later
 
@@ -470,6 +535,12 @@ void Adaptation::Icap::ModXact::virginConsume()
 
 void Adaptation::Icap::ModXact::handleCommWroteBody()
 {
+    if (writingVirginInPlace) {
+        writingVirginInPlace = false;
+        virginConsume(); // the bytes we wrote in place are no longer needed
+        checkConsuming();
+    }
+
     writeMore();
 }
 
@@ -497,6 +568,10 @@ void Adaptation::Icap::ModXact::stopWriting(bool nicely)
         // Somebody should add comm_remove_write_handler() to comm API.
         reuseConnection = false;
         ignoreLastWrite = true;
+
+        // we are about to release virgin body bytes Comm may be writing
+        if (virginBodyPinned())
+            closeConnection();
     }
 
     debugs(93, 7, HERE << "will no longer write" << status());
@@ -598,6 +673,190 @@ void Adaptation::Icap::ModXact::echoMore()
     }
 }
 
+/// Computes resultKey from the service identity and the virgin message
+/// parts that the service sees. Returns false if our outcome must not be
+/// cached because it may depend on things the key does not cover.
+bool Adaptation::Icap::ModXact::makeResultKey()
+{
+    const Adaptation::ServiceConfig &s = service().cfg();
+
+    // the outcome may affect other transactions or the adaptation plan
+    if (s.routing || Adaptation::Config::masterx_shared_name)
+        return false;
+
+    // The key covers the virgin body bytes, so the whole body must already
+    // be buffered when we start. Otherwise, do not cache: the message's own
+    // validators cannot vouch for the body the service would see.
+    if (virginBody.expected()) {
+        const BodyPipe &pipe = *virgin.body_pipe;
+        if (!pipe.bodySizeKnown() || pipe.consumedSize() != 0 ||
+                static_cast<uint64_t>(pipe.buf().contentSize()) != pipe.bodySize())
+            return false;
+    }
+
+    MemBuf buf;
+    buf.init();
+    buf.Printf("%s " SQUIDSTRINGPH "\r\n", s.methodStr(), SQUIDSTRINGPRINT(s.uri));
+
+    const HttpRequest *request = &virginRequest();
+    if (ICAP::methodReqmod == s.method) {
+        packHead(buf, virgin.header);
+    } else {
+        const HttpReply *reply = dynamic_cast<const HttpReply*>(virgin.header);
+        Must(reply);
+        buf.Printf("%s %s\r\n%d\r\n", request->method.image(),
+                   request->canonical ? request->canonical : "",
+                   reply->sline.status);
+
+        // skip headers that change with every response of the same resource
+        HttpHeaderPos pos = HttpHeaderInitPos;
+        while (const HttpHeaderEntry *e = reply->header.getEntry(&pos)) {
+            if (e->id == HDR_DATE || e->id == HDR_AGE || e->id == HDR_EXPIRES ||
+                    e->id == HDR_VIA || e->id == HDR_X_CACHE ||
+                    e->id == HDR_X_CACHE_LOOKUP)
+                continue;
+            buf.Printf(SQUIDSTRINGPH ": " SQUIDSTRINGPH "\r\n",
+                       SQUIDSTRINGPRINT(e->name), SQUIDSTRINGPRINT(e->value));
+        }
+        buf.Printf("%" PRId64 "\r\n", virginBody.expected() ? virgin.body_pipe->bodySize() : -1);
+    }
+
+    // the same meta information makeRequestHeaders() sends
+    if (TheConfig.send_client_ip) {
+        char ntoabuf[MAX_IPSTRLEN];
+#if FOLLOW_X_FORWARDED_FOR
+        const Ip::Address &client_addr = TheConfig.use_indirect_client ?
+                                         request->indirect_client_addr : request->client_addr;
+#else
+        const Ip::Address &client_addr = request->client_addr;
+#endif
+        buf.Printf("%s\r\n", client_addr.NtoA(ntoabuf, MAX_IPSTRLEN));
+    }
+
+    if (TheConfig.send_username)
+        makeUsernameHeader(request, buf);
+
+    typedef Adaptation::Config::MetaHeaders::iterator ACAMLI;
+    for (ACAMLI i = Adaptation::Config::metaHeaders.begin(); i != Adaptation::Config::metaHeaders.end(); ++i) {
+        HttpRequest *r = virgin.cause ?
+                         virgin.cause : dynamic_cast<HttpRequest*>(virgin.header);
+        Must(r);
+        HttpReply *reply = dynamic_cast<HttpReply*>(virgin.header);
+        if (const char *value = (*i)->match(r, reply))
+            buf.Printf("%s: %s\r\n", (*i)->name.termedBuf(), value);
+    }
+
+    SquidMD5_CTX md5;
+    SquidMD5Init(&md5);
+    SquidMD5Update(&md5, buf.content(), buf.contentSize());
+    if (virginBody.expected()) {
+        const MemBuf &body = virgin.body_pipe->buf();
+        SquidMD5Update(&md5, body.content(), body.contentSize());
+    }
+    SquidMD5Final(resultKey, &md5);
+    buf.clean();
+    return true;
+}
+
+/// answers with a cached outcome, if any, without contacting the service
+bool Adaptation::Icap::ModXact::replayCachedResult()
+{
+    cachedResult = ResultCache::Instance().find(resultKey, service().istag());
+    if (cachedResult == NULL)
+        return false;
+
+    debugs(93, 5, HERE << "replaying cached " <<
+           (cachedResult->echo ? "echo" : "adapted") << " result" << status());
+
+    resultKeyed = false; // we already have it
+    disableRetries();
+    stopWriting(true);
+    stopParsing();
+
+    if (cachedResult->echo) {
+        cachedResult = NULL;
+        prepEchoing();
+        startSending();
+        return true;
+    }
+
+    // "clone" the cached adapted header by parsing it, like prepEchoing()
+    Must(!adapted.header);
+    {
+        HttpMsg::Pointer newHead;
+        if (cachedResult->reply) {
+            newHead = new HttpReply;
+        } else {
+            HttpRequest::Pointer newR(new HttpRequest);
+            newHead = newR;
+        }
+        newHead->inheritProperties(virgin.header);
+        adapted.setHeader(newHead);
+    }
+
+    MemBuf httpBuf;
+    httpBuf.init();
+    httpBuf.append(cachedResult->head.content(), cachedResult->head.contentSize());
+    http_status error = HTTP_STATUS_NONE;
+    Must(adapted.header->parse(&httpBuf, true, &error));
+    if (HttpRequest *r = dynamic_cast<HttpRequest*>(adapted.header))
+        urlCanonical(r); // parse does not set HttpRequest::canonical
+    httpBuf.clean();
+
+    const bool satisfied = cachedResult->reply && ICAP::methodReqmod == service().cfg().method;
+    setOutcome(satisfied ? xoSatisfied : xoModified);
+    state.sending = State::sendingAdapted;
+    checkConsuming();
+
+    if (cachedResult->hasBody) {
+        makeAdaptedBodyPipe("cached adapted body");
+        adapted.body_pipe->setBodySize(cachedResult->bodySize());
+    } else {
+        cachedResult = NULL;
+        stopSending(true);
+    }
+
+    startSending();
+
+    if (cachedResult != NULL)
+        replayMore();
+    return true;
+}
+
+/// sends more of the cached adapted body
+void Adaptation::Icap::ModXact::replayMore()
+{
+    Must(cachedResult != NULL);
+    Must(adapted.body_pipe != NULL);
+
+    const size_t size = cachedResult->bodySize() - cachedBodyReplayed;
+    if (size > 0) {
+        const char *data = cachedResult->body.content() + cachedBodyReplayed;
+        cachedBodyReplayed += adapted.body_pipe->putMoreData(data, size);
+    }
+
+    if (cachedBodyReplayed == cachedResult->bodySize()) {
+        debugs(93, 5, HERE << "replayed " << cachedBodyReplayed << " body bytes");
+        cachedResult = NULL;
+        stopSending(true);
+    }
+}
+
+/// caches the recorded outcome, if any, after we parsed all of it
+void Adaptation::Icap::ModXact::rememberResult()
+{
+    if (newResult == NULL)
+        return;
+
+    // the options (and, hence, the ISTag) may have expired meanwhile
+    if (service().up()) {
+        newResult->istag = service().istag();
+        newResult->expires = squid_curtime + service().optionsTtl();
+        ResultCache::Instance().remember(newResult);
+    }
+    newResult = NULL;
+}
+
 bool Adaptation::Icap::ModXact::doneSending() const
 {
     return state.sending == State::sendingDone;
@@ -633,7 +892,7 @@ void Adaptation::Icap::ModXact::stopSending(bool nicely)
 void Adaptation::Icap::ModXact::checkConsuming()
 {
     // quit if we already stopped or are still using the pipe
-    if (!virgin.body_pipe || !state.doneConsumingVirgin())
+    if (!virgin.body_pipe || !state.doneConsumingVirgin() || virginBodyPinned())
         return;
 
     debugs(93, 7, HERE << "will stop consuming" << status());
@@ -898,6 +1157,12 @@ void Adaptation::Icap::ModXact::handle204NoContent()
 {
     stopParsing();
     prepEchoing();
+
+    if (resultKeyed) {
+        newResult = new ResultCache::Result(resultKey);
+        newResult->echo = true;
+        rememberResult();
+    }
 }
 
 void Adaptation::Icap::ModXact::handle206PartialContent()
@@ -911,6 +1176,7 @@ void Adaptation::Icap::ModXact::handle206PartialContent()
         Must(state.allowedPostview206);
         debugs(93, 7, HERE << "206 outside preview");
     }
+    resultKeyed = false; // the outcome depends on the virgin body
     state.parsing = State::psHttpHeader;
     state.sending = State::sendingAdapted;
     state.readyForUob = true;
@@ -1060,6 +1326,12 @@ void Adaptation::Icap::ModXact::parseHttpHead()
         // Maybe adapted.header==NULL if HttpReply and have Http 0.9 ....
         if (adapted.header)
             adapted.header->inheritProperties(virgin.header);
+
+        if (resultKeyed && adapted.header) {
+            newResult = new ResultCache::Result(resultKey);
+            newResult->reply = dynamic_cast<HttpReply*>(adapted.header) != NULL;
+            packHead(newResult->head, adapted.header);
+        }
     }
 
     decideOnParsingBody();
@@ -1099,10 +1371,13 @@ void Adaptation::Icap::ModXact::decideOnParsingBody()
         bodyParser = new ChunkedCodingParser;
         makeAdaptedBodyPipe("adapted response from the ICAP server");
         Must(state.sending == State::sendingAdapted);
+        if (newResult != NULL)
+            newResult->hasBody = true;
     } else {
         debugs(93, 5, HERE << "not expecting a body");
         stopParsing();
         stopSending(true);
+        rememberResult();
     }
 }
 
@@ -1115,7 +1390,20 @@ void Adaptation::Icap::ModXact::parseBody()
 
     // the parser will throw on errors
     BodyPipeCheckout bpc(*adapted.body_pipe);
+    const mb_size_t oldContentSize = bpc.buf.contentSize();
     const bool parsed = bodyParser->parse(&readBuf, &bpc.buf);
+
+    if (newResult != NULL) {
+        // copy what we have just parsed unless the body becomes too big
+        const mb_size_t newContentSize = bpc.buf.contentSize() - oldContentSize;
+        if (static_cast<int64_t>(newResult->bodySize() + newContentSize) > TheConfig.result_cache_max_body) {
+            debugs(93, 5, HERE << "adapted body is too big to cache");
+            newResult = NULL;
+        } else if (newContentSize > 0) {
+            newResult->body.append(bpc.buf.content() + oldContentSize, newContentSize);
+        }
+    }
+
     bpc.checkIn();
 
     debugs(93, 5, HERE << "have " << readBuf.contentSize() << " body bytes after " <<
@@ -1139,6 +1427,7 @@ void Adaptation::Icap::ModXact::parseBody()
 
         stopParsing();
         stopSending(true); // the parser succeeds only if all parsed data fits
+        rememberResult();
         return;
     }
 
@@ -1212,6 +1501,8 @@ void Adaptation::Icap::ModXact::noteMoreBodySpaceAvailable(BodyPipe::Pointer)
 {
     if (state.sending == State::sendingVirgin)
         echoMore();
+    else if (state.sending == State::sendingAdapted && cachedResult != NULL)
+        replayMore();
     else if (state.sending == State::sendingAdapted)
         parseMore();
     else
@@ -33,6 +33,7 @@
 #define SQUID_ICAPMODXACT_H
 
 #include "BodyPipe.h"
+#include "adaptation/icap/ResultCache.h"
 #include "adaptation/icap/Xaction.h"
 #include "adaptation/icap/InOut.h"
 #include "adaptation/icap/Launcher.h"
@@ -186,6 +187,7 @@ private:
     void writePreviewBody();
     void writePrimeBody();
     void writeSomeBody(const char *label, size_t size);
+    void writeBodyInPlace(const MemBuf &framing, mb_size_t headSize, const char *data, size_t size);
     void decideWritingAfterPreview(const char *previewKind);
 
     void startReading();
@@ -204,6 +206,8 @@ private:
     void openChunk(MemBuf &buf, size_t chunkSize, bool ieof);
     void closeChunk(MemBuf &buf);
     void virginConsume();
+    /// whether Comm may still be writing straight from the virgin body buffer
+    bool virginBodyPinned() const { return writingVirginInPlace && writer != NULL; }
     void finishNullOrEmptyBodyPreview(MemBuf &buf);
 
     void decideOnPreview();
@@ -244,6 +248,11 @@ private:
     void prepPartialBodyEchoing(uint64_t pos);
     void echoMore();
 
+    bool makeResultKey();
+    bool replayCachedResult();
+    void replayMore();
+    void rememberResult();
+
     virtual bool doneAll() const;
     virtual void swanSong();
 
@@ -270,6 +279,8 @@ private:
     VirginBodyAct virginBodySending;  // virgin body sending state
     uint64_t virginConsumed;        // virgin data consumed so far
     Preview preview; // use for creating (writing) the preview
+    MemBuf inPlaceFraming; ///< chunk framing of the in-place body write
+    bool writingVirginInPlace; ///< the last body write referenced virgin.body_pipe
 
     ChunkedCodingParser *bodyParser; // ICAP response body parser
 
@@ -289,6 +300,14 @@ private:
 
     int adaptHistoryId; ///< adaptation history slot reservation
 
+    timeval connectStart; ///< when we started to look for a connection
+
+    cache_key resultKey[SQUID_MD5_DIGEST_LENGTH]; ///< ResultCache key
+    bool resultKeyed; ///< resultKey is set and our outcome may be cached
+    ResultCache::Result::Pointer newResult; ///< outcome being recorded
+    ResultCache::Result::Pointer cachedResult; ///< outcome being replayed
+    size_t cachedBodyReplayed; ///< cachedResult body bytes already sent
+
     class State
     {
 
@@ -0,0 +1,176 @@
+/*
+ * DEBUG: section 93    ICAP (RFC 3507) Client
+ */
+
+#include "squid.h"
+#include "adaptation/icap/Config.h"
+#include "adaptation/icap/ResultCache.h"
+#include "Debug.h"
+#include "mgr/Registration.h"
+#include "SquidTime.h"
+#include "Store.h"
+#include "store_key_md5.h"
+
+/// hash_table size; the table chains, so this only affects lookup speed
+static const int TheIndexBuckets = 7951;
+
+static void
+ResultCacheStat(StoreEntry *e)
+{
+    Adaptation::Icap::ResultCache::Instance().stat(e);
+}
+
+Adaptation::Icap::ResultCache::Result::Result(const cache_key *aKey):
+        expires(0),
+        echo(false),
+        reply(false),
+        hasBody(false)
+{
+    memcpy(keyData, aKey, sizeof(keyData));
+    key = keyData;
+    next = NULL;
+    head.init();
+    body.init();
+}
+
+Adaptation::Icap::ResultCache::Result::~Result()
+{
+    head.clean();
+    body.clean();
+}
+
+size_t
+Adaptation::Icap::ResultCache::Result::memoryUsed() const
+{
+    return sizeof(*this) + istag.size() + head.contentSize() + body.contentSize();
+}
+
+Adaptation::Icap::ResultCache &
+Adaptation::Icap::ResultCache::Instance()
+{
+    static ResultCache *TheInstance = NULL;
+    if (!TheInstance)
+        TheInstance = new ResultCache;
+    return *TheInstance;
+}
+
+bool
+Adaptation::Icap::ResultCache::Enabled()
+{
+    return TheConfig.result_cache_size > 0;
+}
+
+Adaptation::Icap::ResultCache::ResultCache():
+        index(hash_create(storeKeyHashCmp, TheIndexBuckets, storeKeyHashHash)),
+        memUsed(0), count(0),
+        lookups(0), hits(0), stored(0), evicted(0)
+{
+}
+
+void
+Adaptation::Icap::ResultCache::RegisterWithCacheManager()
+{
+    Mgr::RegisterAction("icap_result_cache",
+                        "ICAP Result Cache Statistics",
+                        ResultCacheStat, 0, 1);
+}
+
+Adaptation::Icap::ResultCache::Result::Pointer
+Adaptation::Icap::ResultCache::find(const cache_key *key, const String &istag)
+{
+    ++lookups;
+
+    Result *result = static_cast<Result *>(hash_lookup(index, key));
+    if (!result) {
+        debugs(93, 7, HERE << "miss " << storeKeyText(key));
+        return NULL;
+    }
+
+    if (result->expires < squid_curtime || result->istag != istag) {
+        debugs(93, 5, HERE << "stale " << storeKeyText(key) << " ISTag " <<
+               result->istag << " now " << istag);
+        forget(result);
+        return NULL;
+    }
+
+    ++hits;
+    debugs(93, 5, HERE << "hit " << storeKeyText(key));
+
+    // a hit makes the result the most recently used one
+    dlinkDelete(&result->lru, &lruList);
+    dlinkAddTail(result, &result->lru, &lruList);
+    return result;
+}
+
+void
+Adaptation::Icap::ResultCache::remember(Result::Pointer result)
+{
+    Must(result != NULL);
+
+    const size_t limit = static_cast<size_t>(TheConfig.result_cache_size);
+    if (result->memoryUsed() > limit / 8) {
+        debugs(93, 5, HERE << "too big to cache: " << result->memoryUsed());
+        return;
+    }
+
+    if (Result *old = static_cast<Result *>(hash_lookup(index, result->key)))
+        forget(old);
+
+    trim(limit - result->memoryUsed());
+
+    // the index and the LRU list hold one reference between them
+    Result *r = result.getRaw();
+    r->RefCountReference();
+    hash_join(index, r);
+    dlinkAddTail(r, &r->lru, &lruList);
+    memUsed += r->memoryUsed();
+    ++count;
+    ++stored;
+
+    debugs(93, 5, HERE << "stored " << (r->echo ? "204" : "adapted") <<
+           " result " << storeKeyText(r->keyData) << " for " <<
+           (r->expires - squid_curtime) << "s; " << count << " results, " <<
+           memUsed << " bytes");
+}
+
+void
+Adaptation::Icap::ResultCache::configure()
+{
+    trim(Enabled() ? static_cast<size_t>(TheConfig.result_cache_size) : 0);
+}
+
+void
+Adaptation::Icap::ResultCache::forget(Result *result)
+{
+    hash_remove_link(index, result);
+    dlinkDelete(&result->lru, &lruList);
+    memUsed -= result->memoryUsed();
+    --count;
+    if (!result->RefCountDereference())
+        delete result;
+}
+
+/// evicts least recently used results until at most limit bytes are used
+void
+Adaptation::Icap::ResultCache::trim(size_t limit)
+{
+    while (memUsed > limit && lruList.head) {
+        forget(static_cast<Result *>(lruList.head->data));
+        ++evicted;
+    }
+}
+
+void
+Adaptation::Icap::ResultCache::stat(StoreEntry *e) const
+{
+    storeAppendPrintf(e, "ICAP Result Cache:\n");
+    storeAppendPrintf(e, "\tCache size limit: %" PRId64 " KB\n",
+                      TheConfig.result_cache_size >> 10);
+    storeAppendPrintf(e, "\tMemory used: %" PRIuSIZE " KB\n", memUsed >> 10);
+    storeAppendPrintf(e, "\tCached results: %d\n", count);
+    storeAppendPrintf(e, "\tLookups: %" PRIu64 "\n", lookups);
+    storeAppendPrintf(e, "\tHits: %" PRIu64 " (%.1f%%)\n", hits,
+                      lookups ? 100.0 * hits / lookups : 0.0);
+    storeAppendPrintf(e, "\tStored: %" PRIu64 "\n", stored);
+    storeAppendPrintf(e, "\tEvicted: %" PRIu64 "\n", evicted);
+}
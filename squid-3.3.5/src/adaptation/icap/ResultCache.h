@@ -0,0 +1,103 @@
+#ifndef SQUID_ICAPRESULTCACHE_H
+#define SQUID_ICAPRESULTCACHE_H
+
+#include "dlink.h"
+#include "hash.h"
+#include "md5.h"
+#include "MemBuf.h"
+#include "RefCount.h"
+#include "SquidString.h"
+#include "typedefs.h"
+
+class StoreEntry;
+
+namespace Adaptation
+{
+namespace Icap
+{
+
+/**
+ * Remembers ICAP REQMOD/RESPMOD outcomes so that identical virgin messages
+ * can be answered without contacting the service again. Results are keyed
+ * by a digest of the service identity and the virgin message (see
+ * ModXact::makeResultKey()) and stay valid while the service keeps the
+ * ISTag they were produced under, for at most one OPTIONS TTL.
+ *
+ * The cache is limited by icap_result_cache_size and evicts the least
+ * recently used results first.
+ */
+class ResultCache
+{
+public:
+    /// a cached ICAP outcome: either "use the virgin message" or an adapted one
+    class Result: public hash_link, public RefCountable
+    {
+    public:
+        typedef RefCount<Result> Pointer;
+
+        explicit Result(const cache_key *aKey);
+        virtual ~Result();
+
+        /// size of the adapted body or zero
+        size_t bodySize() const { return body.contentSize(); }
+
+        /// memory accounted to this result
+        size_t memoryUsed() const;
+
+        cache_key keyData[SQUID_MD5_DIGEST_LENGTH];
+        String istag; ///< service ISTag the result was produced under
+        time_t expires; ///< when the result stops being valid
+        bool echo; ///< the service did not modify the message (204)
+        bool reply; ///< the adapted header is an HTTP response header
+        bool hasBody; ///< the adapted message has a body, possibly empty
+        MemBuf head; ///< packed adapted HTTP header unless echo
+        MemBuf body; ///< adapted HTTP body unless echo
+        dlink_node lru; ///< position in the LRU list
+
+    private:
+        Result(const Result &); // not implemented
+        Result &operator =(const Result &); // not implemented
+    };
+
+    static ResultCache &Instance();
+
+    /// adds icap_result_cache to the cache manager menu; call once
+    static void RegisterWithCacheManager();
+
+    /// whether results should be looked up and remembered
+    static bool Enabled();
+
+    /// a valid result for the key produced under the given ISTag, if any
+    Result::Pointer find(const cache_key *key, const String &istag);
+
+    /// stores (or replaces) the result, evicting older ones as needed
+    void remember(Result::Pointer result);
+
+    /// applies icap_result_cache_size after (re)configuration
+    void configure();
+
+    /// cache manager statistics
+    void stat(StoreEntry *e) const;
+
+private:
+    ResultCache();
+
+    void forget(Result *result);
+    void trim(size_t limit);
+
+    hash_table *index;
+    dlink_list lruList; ///< head is the least recently used result
+    size_t memUsed; ///< bytes used by all cached results
+    int count;
+
+    /* statistics */
+    uint64_t lookups;
+    uint64_t hits;
+    uint64_t stored;
+    uint64_t evicted;
+};
+
+} // namespace Icap
+} // namespace Adaptation
+
+#endif /* SQUID_ICAPRESULTCACHE_H */
@@ -8,20 +8,52 @@
 #include "adaptation/icap/ModXact.h"
 #include "adaptation/icap/Options.h"
 #include "adaptation/icap/OptXact.h"
+#include "adaptation/icap/ResultCache.h"
 #include "adaptation/icap/ServiceRep.h"
 #include "base/TextException.h"
 #include "comm/Connection.h"
+#include "comm/ConnOpener.h"
 #include "ConfigParser.h"
 #include "Debug.h"
 #include "fde.h"
+#include "forward.h"
 #include "globals.h"
 #include "HttpReply.h"
 #include "ip/tools.h"
+#include "mgr/Registration.h"
 #include "SquidConfig.h"
 #include "SquidTime.h"
 
 CBDATA_NAMESPACED_CLASS_INIT(Adaptation::Icap, ServiceRep);
 
+/// how often to check that min-idle-conn connections are ready, in seconds
+static const double TheIdleConnMaintenanceGap = 1.0;
+
+static void
+ServiceRep_noteIdleConnLookup(const ipcache_addrs *ia, const DnsLookupDetails &, void *data)
+{
+    Adaptation::Icap::ServiceRep *service = static_cast<Adaptation::Icap::ServiceRep*>(data);
+    Must(service);
+    service->noteIdleConnLookup(ia);
+}
+
+/// cache manager action reporting all current ICAP services
+static void
+ServiceRepsStat(StoreEntry *e)
+{
+    typedef Adaptation::Services::iterator SCI;
+    for (SCI i = Adaptation::AllServices().begin(); i != Adaptation::AllServices().end(); ++i) {
+        if (const Adaptation::Icap::ServiceRep *service = dynamic_cast<const Adaptation::Icap::ServiceRep *>(i->getRaw()))
+            service->stat(e);
+    }
+}
+
+void Adaptation::Icap::ServiceRep::RegisterWithCacheManager()
+{
+    Mgr::RegisterAction("icap_services", "ICAP Service Connections and Delays",
+                        ServiceRepsStat, 0, 1);
+}
+
 Adaptation::Icap::ServiceRep::ServiceRep(const ServiceConfigPointer &svcCfg):
         AsyncJob("Adaptation::Icap::ServiceRep"), Adaptation::Service(svcCfg),
         theOptions(NULL), theOptionsFetcher(0), theLastUpdate(0),
@@ -29,6 +61,9 @@ Adaptation::Icap::ServiceRep::ServiceRep(const ServiceConfigPointer &svcCfg):
         theAllWaiters(0),
         connOverloadReported(false),
         theIdleConns(NULL),
+        theOpeningConns(0),
+        idleConnLookup(false),
+        maintenanceScheduled(false),
         isSuspended(0), notifying(false),
         updateScheduled(false),
         wasAnnouncedUp(true), // do not announce an "up" service at startup
@@ -36,6 +71,8 @@ Adaptation::Icap::ServiceRep::ServiceRep(const ServiceConfigPointer &svcCfg):
 {
     setMaxConnections();
     theIdleConns = new IdleConnList("ICAP Service", NULL);
+    theQueueDelays.logInit(300, 0.0, 60000.0 * 10.0);
+    theConnectDelays.logInit(300, 0.0, 60000.0 * 10.0);
 }
 
 Adaptation::Icap::ServiceRep::~ServiceRep()
@@ -64,6 +101,12 @@ Adaptation::Icap::ServiceRep::finalize()
 
     theSessionFailures.configure(TheConfig.oldest_service_failure > 0 ?
                                  TheConfig.oldest_service_failure : -1);
+
+    // apply icap_result_cache_size changes
+    ResultCache::Instance().configure();
+
+    if (cfg().minIdleConn > 0)
+        scheduleIdleConnMaintenance();
 }
 
 void Adaptation::Icap::ServiceRep::noteFailure()
@@ -108,12 +151,15 @@ Adaptation::Icap::ServiceRep::getConnection(bool retriableXact, bool &reused)
      */
     if (retriableXact)
         connection = theIdleConns->pop();
-    else
+    else if (theIdleConns->count() > cfg().minIdleConn) // keep warmed-up ones
         theIdleConns->closeN(1);
 
     reused = Comm::IsConnOpen(connection);
     ++theBusyConns;
     debugs(93,3, HERE << "got connection: " << connection);
+
+    // replace the pooled connection we may have just taken
+    maintainIdleConns();
     return connection;
 }
 
@@ -251,6 +297,109 @@ void Adaptation::Icap::ServiceRep::busyCheckpoint()
     }
 }
 
+int Adaptation::Icap::ServiceRep::idleConnsNeeded() const
+{
+    if (cfg().minIdleConn <= 0 || !TheConfig.reuse_connections ||
+            detached() || !up())
+        return 0;
+
+    const int pending = theIdleConns->count() + theOpeningConns;
+    int needed = cfg().minIdleConn - pending;
+
+    // warm-up connections must not create Max-Connections debt
+    if (theMaxConnections >= 0)
+        needed = min(needed, theMaxConnections - theBusyConns - pending);
+
+    return max(needed, 0);
+}
+
+void Adaptation::Icap::ServiceRep::maintainIdleConns()
+{
+    if (idleConnLookup || !idleConnsNeeded())
+        return;
+
+    debugs(93,5, HERE << "needs " << idleConnsNeeded() << " more idle connections " << status());
+    idleConnLookup = true; // before the lookup because it may call back immediately
+    ipcache_nbgethostbyname(cfg().host.termedBuf(), ServiceRep_noteIdleConnLookup, this);
+}
+
+void Adaptation::Icap::ServiceRep::noteIdleConnLookup(const ipcache_addrs *ia)
+{
+    Must(idleConnLookup);
+    idleConnLookup = false;
+
+    if (!ia) {
+        debugs(93, 3, HERE << "cannot warm up connections to unknown host " << cfg().host);
+        return;
+    }
+
+    assert(ia->cur < ia->count);
+    for (int needed = idleConnsNeeded(); needed > 0; --needed) {
+        Comm::ConnectionPointer conn = new Comm::Connection;
+        conn->remote = ia->in_addrs[ia->cur];
+        conn->remote.SetPort(cfg().port);
+        getOutgoingAddress(NULL, conn);
+
+        typedef CommCbMemFunT<Adaptation::Icap::ServiceRep, CommConnectCbParams> Dialer;
+        AsyncCall::Pointer callback = JobCallback(93, 5, Dialer, this, Adaptation::Icap::ServiceRep::noteIdleConnOpened);
+        Comm::ConnOpener *cs = new Comm::ConnOpener(conn, callback, TheConfig.connect_timeout(cfg().bypass));
+        cs->setHost(cfg().host.termedBuf());
+        AsyncJob::Start(cs);
+        ++theOpeningConns;
+    }
+}
+
+void Adaptation::Icap::ServiceRep::noteIdleConnOpened(const CommConnectCbParams &io)
+{
+    Must(theOpeningConns > 0);
+    --theOpeningConns;
+
+    if (io.flag != COMM_OK) {
+        debugs(93, 3, HERE << "failed to warm up a connection to " << cfg().uri << status());
+        return;
+    }
+
+    // the service may have changed while we were connecting
+    if (!idleConnsNeeded()) {
+        debugs(93, 5, HERE << "closing unneeded warm-up connection " << io.conn);
+        io.conn->close();
+        return;
+    }
+
+    debugs(93, 5, HERE << "pooling warm-up connection " << io.conn);
+    theIdleConns->push(io.conn);
+}
+
+static
+void ServiceRep_noteTimeToMaintainIdleConns(void *data)
+{
+    Adaptation::Icap::ServiceRep *service = static_cast<Adaptation::Icap::ServiceRep*>(data);
+    Must(service);
+    service->noteTimeToMaintainIdleConns();
+}
+
+void Adaptation::Icap::ServiceRep::scheduleIdleConnMaintenance()
+{
+    if (maintenanceScheduled)
+        return;
+
+    eventAdd("Adaptation::Icap::ServiceRep::noteTimeToMaintainIdleConns",
+             &ServiceRep_noteTimeToMaintainIdleConns, this,
+             TheIdleConnMaintenanceGap, 0, true);
+    maintenanceScheduled = true;
+}
+
+void Adaptation::Icap::ServiceRep::noteTimeToMaintainIdleConns()
+{
+    maintenanceScheduled = false;
+    if (detached())
+        return; // a reconfigured service maintains its own pool
+
+    // idle connections expire or get closed by the server between transactions
+    maintainIdleConns();
+    scheduleIdleConnMaintenance();
+}
+
 void Adaptation::Icap::ServiceRep::suspend(const char *reason)
 {
     if (isSuspended) {
@@ -331,6 +480,18 @@ bool Adaptation::Icap::ServiceRep::allows206() const
     return false;
 }
 
+const String &Adaptation::Icap::ServiceRep::istag() const
+{
+    Must(hasOptions());
+    return theOptions->istag;
+}
+
+int Adaptation::Icap::ServiceRep::optionsTtl() const
+{
+    Must(hasOptions());
+    return theOptions->ttl();
+}
+
 static
 void ServiceRep_noteTimeToUpdate(void *data)
 {
@@ -575,6 +736,8 @@ void Adaptation::Icap::ServiceRep::handleNewOptions(Adaptation::Icap::Options *n
         theIdleConns->closeN(n);
     }
 
+    maintainIdleConns();
+
     scheduleNotification();
 }
 
@@ -699,6 +862,38 @@ const char *Adaptation::Icap::ServiceRep::status() const
     return buf.content();
 }
 
+/// the given percentile of all the delays counted in a histogram
+static double
+delayPercentile(const StatHist &delays, const double pctile)
+{
+    StatHist none; // deltaPctile() needs a baseline with the same layout
+    none.logInit(300, 0.0, 60000.0 * 10.0);
+    return none.deltaPctile(delays, pctile);
+}
+
+void Adaptation::Icap::ServiceRep::stat(StoreEntry *e) const
+{
+    storeAppendPrintf(e, "ICAP service %s %s\n", cfg().uri.termedBuf(), status());
+    storeAppendPrintf(e, "\tConnections: %d busy, %d idle, %d opening\n",
+                      theBusyConns, theIdleConns->count(), theOpeningConns);
+    storeAppendPrintf(e, "\tTransactions waiting: %d\n", theAllWaiters);
+    storeAppendPrintf(e, "\tMax-Connections: %d, min-idle-conn: %ld\n",
+                      theMaxConnections, cfg().minIdleConn);
+    storeAppendPrintf(e, "\tQueue delay (msec): median %.3f, 90%% %.3f, 99%% %.3f\n",
+                      delayPercentile(theQueueDelays, 0.5),
+                      delayPercentile(theQueueDelays, 0.9),
+                      delayPercentile(theQueueDelays, 0.99));
+    storeAppendPrintf(e, "\tConnect delay (msec): median %.3f, 90%% %.3f, 99%% %.3f\n",
+                      delayPercentile(theConnectDelays, 0.5),
+                      delayPercentile(theConnectDelays, 0.9),
+                      delayPercentile(theConnectDelays, 0.99));
+    storeAppendPrintf(e, "\tQueue delay histogram:\n");
+    theQueueDelays.dump(e, NULL);
+    storeAppendPrintf(e, "\tConnect delay histogram:\n");
+    theConnectDelays.dump(e, NULL);
+    storeAppendPrintf(e, "\n");
+}
+
 void Adaptation::Icap::ServiceRep::detach()
 {
     debugs(93,3, HERE << "detaching ICAP service: " << cfg().uri <<
@@ -40,7 +40,10 @@
 #include "adaptation/icap/Elements.h"
 #include "base/AsyncJobCalls.h"
 #include "comm.h"
+#include "CommCalls.h"
+#include "ipcache.h"
 #include "pconn.h"
+#include "StatHist.h"
 #include <deque>
 
 namespace Adaptation
@@ -92,6 +95,9 @@ public:
 
     virtual void finalize();
 
+    /// adds icap_services to the cache manager menu; call once
+    static void RegisterWithCacheManager();
+
     virtual bool probed() const; // see comments above
     virtual bool up() const; // see comments above
     bool availableForNew() const; ///< a new transaction may start communicating with the service
@@ -107,6 +113,8 @@ public:
     bool wantsPreview(const String &urlPath, size_t &wantedSize) const;
     bool allows204() const;
     bool allows206() const;
+    const String &istag() const; ///< ISTag of the current OPTIONS response
+    int optionsTtl() const; ///< Options-TTL of the current OPTIONS response
     Comm::ConnectionPointer getConnection(bool isRetriable, bool &isReused);
     void putConnection(const Comm::ConnectionPointer &conn, bool isReusable, bool sendReset, const char *comment);
     void noteConnectionUse(const Comm::ConnectionPointer &conn);
@@ -118,6 +126,15 @@ public:
     void noteGoneWaiter(); ///< An xaction is not waiting any more for service to be available
     bool existWaiters() const {return (theAllWaiters > 0);} ///< if there are xactions waiting for the service to be available
 
+    virtual int load() const { return theBusyConns + theAllWaiters; }
+
+    /// records how long a transaction waited for the service before connecting
+    void noteQueueDelay(const double msec) { theQueueDelays.count(msec); }
+    /// records how long a transaction waited for a new or pooled connection
+    void noteConnectDelay(const double msec) { theConnectDelays.count(msec); }
+    /// cache manager report on the service connections and delays
+    void stat(StoreEntry *e) const;
+
     //AsyncJob virtual methods
     virtual bool doneAll() const { return Adaptation::Initiator::doneAll() && false;}
     virtual void callException(const std::exception &e);
@@ -128,6 +145,9 @@ public:
 public: // treat these as private, they are for callbacks only
     void noteTimeToUpdate();
     void noteTimeToNotify();
+    void noteTimeToMaintainIdleConns();
+    void noteIdleConnLookup(const ipcache_addrs *ia);
+    void noteIdleConnOpened(const CommConnectCbParams &io);
 
     // receive either an ICAP OPTIONS response header or an abort message
     virtual void noteAdaptationAnswer(const Answer &answer);
@@ -159,6 +179,12 @@ private:
     // TODO: use a better type like the FadingCounter for connOverloadReported
     mutable bool connOverloadReported; ///< whether we reported exceeding theMaxConnections
     IdleConnList *theIdleConns; ///< idle persistent connection pool
+    int theOpeningConns; ///< connections being opened for theIdleConns
+    bool idleConnLookup; ///< waiting for DNS before opening idle connections
+    bool maintenanceScheduled; ///< periodic idle connection upkeep is scheduled
+
+    StatHist theQueueDelays; ///< msec from transaction start to connecting
+    StatHist theConnectDelays; ///< msec from connecting to connected
 
     FadingCounter theSessionFailures;
     const char *isSuspended; // also stores suspension reason for debugging
@@ -201,6 +227,12 @@ private:
      */
     void busyCheckpoint();
 
+    /// how many more connections to open in advance to honor min-idle-conn
+    int idleConnsNeeded() const;
+    /// starts opening connections for the idle pool if it is too short
+    void maintainIdleConns();
+    void scheduleIdleConnMaintenance();
+
     const char *status() const;
 
     mutable bool wasAnnouncedUp; // prevent sequential same-state announcements
@@ -26,6 +26,7 @@
 #include "pconn.h"
 #include "SquidConfig.h"
 #include "SquidTime.h"
+#include "StatCounters.h"
 
 //CBDATA_NAMESPACED_CLASS_INIT(Adaptation::Icap, Xaction);
 
@@ -277,6 +278,19 @@ void Adaptation::Icap::Xaction::scheduleWrite(MemBuf &buf)
     updateTimeout();
 }
 
+/// writes caller-owned buffers; they must stay intact until noteCommWrote()
+void Adaptation::Icap::Xaction::scheduleWrite(const struct iovec *iov, int iovcnt)
+{
+    Must(haveConnection());
+
+    typedef CommCbMemFunT<Adaptation::Icap::Xaction, CommIoCbParams> Dialer;
+    writer = JobCallback(93, 3,
+                         Dialer, this, Adaptation::Icap::Xaction::noteCommWrote);
+
+    Comm::Write(connection, iov, iovcnt, writer);
+    updateTimeout();
+}
+
 void Adaptation::Icap::Xaction::noteCommWrote(const CommIoCbParams &io)
 {
     Must(writer != NULL);
@@ -528,6 +542,8 @@ void Adaptation::Icap::Xaction::swanSong()
 
     tellQueryAborted();
 
+    statCounter.icap.svcTime.count(icap_tr_start, current_time);
+
     maybeLog();
 
     Adaptation::Initiate::swanSong();
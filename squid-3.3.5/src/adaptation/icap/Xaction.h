@@ -109,6 +109,7 @@ protected:
 
     void scheduleRead();
     void scheduleWrite(MemBuf &buf);
+    void scheduleWrite(const struct iovec *iov, int iovcnt);
     void updateTimeout();
 
     void cancelRead();
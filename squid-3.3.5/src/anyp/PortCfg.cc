@@ -66,6 +66,7 @@ AnyP::PortCfg::clone() const
     b->vport = vport;
     b->connection_auth_disabled = connection_auth_disabled;
     b->disable_pmtu_discovery = disable_pmtu_discovery;
+    b->reuse_port = reuse_port;
 
     memcpy( &(b->tcp_keepalive), &(tcp_keepalive), sizeof(tcp_keepalive));
 
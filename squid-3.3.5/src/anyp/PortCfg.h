@@ -41,6 +41,7 @@ public:
     int vport;                 /* virtual port support, -1 for dynamic, >0 static*/
     bool connection_auth_disabled;     /* Don't support connection oriented auth */
     int disable_pmtu_discovery;
+    int reuse_port; ///< one of the REUSEPORT_* values
 
     struct {
         unsigned int enabled;
@@ -98,6 +98,7 @@
 #include "auth/Scheme.h"
 #endif
 #if USE_SQUID_ESI
+#include "esi/IncludeQueue.h"
 #include "esi/Parser.h"
 #endif
 #if SQUID_SNMP
@@ -3290,6 +3291,32 @@ dump_uri_whitespace(StoreEntry * entry, const char *name, int var)
     storeAppendPrintf(entry, "%s %s\n", name, s);
 }
 
+#define free_pconn_reuse_order free_int
+
+static void
+parse_pconn_reuse_order(int *var)
+{
+    char *token = strtok(NULL, w_space);
+
+    if (token == NULL)
+        self_destruct();
+
+    if (!strcasecmp(token, "lifo"))
+        *var = PCONN_REUSE_LIFO;
+    else if (!strcasecmp(token, "fifo"))
+        *var = PCONN_REUSE_FIFO;
+    else {
+        debugs(0, DBG_PARSE_NOTE(2), "ERROR: Invalid option '" << token << "': 'server_pconn_reuse_order' accepts 'lifo' and 'fifo'.");
+        self_destruct();
+    }
+}
+
+static void
+dump_pconn_reuse_order(StoreEntry * entry, const char *name, int var)
+{
+    storeAppendPrintf(entry, "%s %s\n", name, var == PCONN_REUSE_FIFO ? "fifo" : "lifo");
+}
+
 static void
 free_removalpolicy(RemovalPolicySettings ** settings)
 {
@@ -3675,6 +3702,19 @@ parse_port_option(AnyP::PortCfg * s, char *token)
             s->disable_pmtu_discovery = DISABLE_PMTU_ALWAYS;
         else
             self_destruct();
+    } else if (strcmp(token, "reuseport") == 0 || strncmp(token, "reuseport=", 10) == 0) {
+#if defined(SO_REUSEPORT)
+        if (token[9] == '\0' || !strcasecmp(token + 10, "on"))
+            s->reuse_port = REUSEPORT_ON;
+        else if (!strcasecmp(token + 10, "cpu"))
+            s->reuse_port = REUSEPORT_CPU;
+        else if (!strcasecmp(token + 10, "off"))
+            s->reuse_port = REUSEPORT_OFF;
+        else
+            self_destruct();
+#else
+        debugs(3, DBG_CRITICAL, "WARNING: http(s)_port: " << token << " is not supported on this platform. Ignored.");
+#endif
     } else if (strcmp(token, "ipv4") == 0) {
         if ( !s->s.SetIPv4() ) {
             debugs(3, DBG_CRITICAL, "FATAL: http(s)_port: IPv6 addresses cannot be used as IPv4-Only. " << s->s );
@@ -3891,6 +3931,11 @@ dump_generic_port(StoreEntry * e, const char *n, const AnyP::PortCfg * s)
         storeAppendPrintf(e, " disable-pmtu-discovery=%s", pmtu);
     }
 
+    if (s->reuse_port == REUSEPORT_ON)
+        storeAppendPrintf(e, " reuseport");
+    else if (s->reuse_port == REUSEPORT_CPU)
+        storeAppendPrintf(e, " reuseport=cpu");
+
     if (s->s.IsAnyAddr() && !s->s.IsIPv6())
         storeAppendPrintf(e, " ipv4");
 
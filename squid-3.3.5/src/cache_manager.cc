@@ -425,7 +425,8 @@ CacheManager::Start(const Comm::ConnectionPointer &client, HttpRequest * request
         return;
     }
 
-    if (UsingSmp() && IamWorkerProcess()) {
+    // local actions read shared memory and need no Coordinator help
+    if (UsingSmp() && IamWorkerProcess() && !cmd->profile->isLocal) {
         // is client the right connection to pass here?
         AsyncJob::Start(new Mgr::Forwarder(client, cmd->params, request, entry));
         return;
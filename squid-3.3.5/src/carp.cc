@@ -211,14 +211,14 @@ carpSelectParent(HttpRequest * request)
             if (tp->options.carp_key.path) {
                 String::size_type pos;
                 if ((pos=request->urlpath.find('?'))!=String::npos)
-                    key.append(request->urlpath.substr(0,pos));
+                    key.append(request->urlpath.rawBuf(), pos);
                 else
                     key.append(request->urlpath);
             }
             if (tp->options.carp_key.params) {
                 String::size_type pos;
                 if ((pos=request->urlpath.find('?'))!=String::npos)
-                    key.append(request->urlpath.substr(pos,request->urlpath.size()));
+                    key.append(request->urlpath.rawBuf() + pos, request->urlpath.size() - pos);
             }
         }
         // if the url-based key is empty, e.g. because the user is
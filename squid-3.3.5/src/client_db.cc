@@ -95,6 +95,8 @@ clientdbAdd(const Ip::Address &addr)
     c->rationedCount = 0;
     c->selectWaiting = false;
     c->eventWaiting = false;
+    c->sharedQuotaKey = 0;
+    c->sharedQuota = NULL;
 
     /* get current time */
     getCurrentTime();
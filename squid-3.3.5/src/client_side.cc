@@ -137,6 +137,7 @@
 #include "ClientInfo.h"
 #endif
 #if USE_SSL
+#include "ssl/CertSigner.h"
 #include "ssl/ProxyCerts.h"
 #include "ssl/context_storage.h"
 #include "ssl/helper.h"
@@ -190,6 +191,31 @@ private:
 
 static void clientListenerConnectionOpened(AnyP::PortCfg *s, const Ipc::FdNoteId portTypeNote, const Subscription::Pointer &sub);
 
+#if USE_SSL
+/// dials ConnStateData::sslCertGenerated call
+class CertGeneratedDialer: public JobDialer<ConnStateData>, public Ssl::CertSignerCb
+{
+public:
+    typedef void (ConnStateData::*Method)(Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey);
+    CertGeneratedDialer(const CbcPointer<ConnStateData> &aJob, Method aMethod):
+            JobDialer<ConnStateData>(aJob), method(aMethod) {}
+
+    virtual void print(std::ostream &os) const { os << '(' << cert << ')'; }
+
+protected:
+    virtual void doDial() {
+        Ssl::X509_Pointer aCert(cert);
+        Ssl::EVP_PKEY_Pointer aPkey(pkey);
+        cert = NULL;
+        pkey = NULL;
+        ((&(*job))->*method)(aCert, aPkey);
+    }
+
+private:
+    Method method;
+};
+#endif
+
 /* our socket-related context */
 
 CBDATA_CLASS_INIT(ClientSocketContext);
@@ -231,7 +257,7 @@ static void clientSetKeepaliveFlag(ClientHttpRequest *);
 static int clientIsContentLengthValid(HttpRequest * r);
 static int clientIsRequestBodyTooLargeForPolicy(int64_t bodyLength);
 
-static void clientUpdateStatHistCounters(log_type logType, int svc_time);
+static void clientUpdateStatHistCounters(log_type logType, uint64_t svc_time);
 static void clientUpdateStatCounters(log_type logType);
 static void clientUpdateHierCounters(HierarchyLogEntry *);
 static bool clientPingHasFinished(ping_data const *aPing);
@@ -458,7 +484,7 @@ clientUpdateStatCounters(log_type logType)
 }
 
 void
-clientUpdateStatHistCounters(log_type logType, int svc_time)
+clientUpdateStatHistCounters(log_type logType, uint64_t svc_time)
 {
     statCounter.client_http.allSvcTime.count(svc_time);
     /**
@@ -533,7 +559,7 @@ clientUpdateHierCounters(HierarchyLogEntry * someEntry)
         i = &someEntry->ping;
 
         if (clientPingHasFinished(i))
-            statCounter.icp.querySvcTime.count(tvSubUsec(i->start, i->stop));
+            statCounter.icp.querySvcTime.count(i->start, i->stop);
 
         if (i->timeout)
             ++ statCounter.icp.query_timeouts;
@@ -561,9 +587,17 @@ ClientHttpRequest::updateCounters()
         ++ statCounter.client_http.errors;
 
     clientUpdateStatHistCounters(logType,
-                                 tvSubMsec(start_time, current_time));
+                                 LatencyHistogram::Usec(start_time, current_time));
 
     clientUpdateHierCounters(&request->hier);
+
+    for (int p = 0; p < PhaseTimes::phEnd; ++p) {
+        const PhaseTimes::Phase phase = static_cast<PhaseTimes::Phase>(p);
+        if (request->phases.happened(phase)) {
+            ++statCounter.phases.count[p];
+            statCounter.phases.usec[p] += request->phases.usec(phase);
+        }
+    }
 }
 
 void
@@ -614,6 +648,7 @@ prepareLogWithRequestDetails(HttpRequest * request, AccessLogEntry::Pointer &aLo
     aLogEntry->http.method = request->method;
     aLogEntry->http.version = request->http_ver;
     aLogEntry->hier = request->hier;
+    aLogEntry->phases = request->phases;
     if (request->content_length > 0) // negative when no body or unknown length
         aLogEntry->cache.requestSize += request->content_length;
     aLogEntry->cache.extuser = request->extacl_user.termedBuf();
@@ -623,6 +658,7 @@ prepareLogWithRequestDetails(HttpRequest * request, AccessLogEntry::Pointer &aLo
     // TODO: avoid losses by keeping these stats in a shared history object?
     if (aLogEntry->request) {
         aLogEntry->request->dnsWait = request->dnsWait;
+        aLogEntry->request->phases = request->phases;
         aLogEntry->request->errType = request->errType;
         aLogEntry->request->errDetail = request->errDetail;
     }
@@ -708,9 +744,10 @@ ClientHttpRequest::logRequest()
 void
 ClientHttpRequest::freeResources()
 {
-    safe_free(uri);
-    safe_free(log_uri);
-    safe_free(redirect.location);
+    // the strings are in our arena
+    uri = NULL;
+    log_uri = NULL;
+    redirect.location = NULL;
     range_iter.boundary.clean();
     HTTPMSGUNLOCK(request);
 
@@ -1900,7 +1937,7 @@ parseHttpRequestAbort(ConnStateData * csd, const char *uri)
     StoreIOBuffer tempBuffer;
     http = new ClientHttpRequest(csd);
     http->req_sz = csd->in.notYetUsed;
-    http->uri = xstrdup(uri);
+    http->uri = http->arena.dup(uri);
     setLogUri (http, uri);
     context = ClientSocketContextNew(csd->clientConnection, http);
     tempBuffer.data = context->reqbuf;
@@ -1953,11 +1990,10 @@ findTrailingHTTPVersion(const char *uriAndHTTPVersion, const char *end)
 void
 setLogUri(ClientHttpRequest * http, char const *uri, bool cleanUrl)
 {
-    safe_free(http->log_uri);
-
+    // the old log_uri, if any, stays in the arena until the transaction ends
     if (!cleanUrl)
         // The uri is already clean just dump it.
-        http->log_uri = xstrndup(uri, MAX_URL);
+        http->log_uri = http->arena.ndup(uri, MAX_URL);
     else {
         int flags = 0;
         switch (Config.uri_whitespace) {
@@ -1966,13 +2002,13 @@ setLogUri(ClientHttpRequest * http, char const *uri, bool cleanUrl)
 
         case URI_WHITESPACE_ENCODE:
             flags |= RFC1738_ESCAPE_UNESCAPED;
-            http->log_uri = xstrndup(rfc1738_do_escape(uri, flags), MAX_URL);
+            http->log_uri = http->arena.ndup(rfc1738_do_escape(uri, flags), MAX_URL);
             break;
 
         case URI_WHITESPACE_CHOP: {
             flags |= RFC1738_ESCAPE_NOSPACE;
             flags |= RFC1738_ESCAPE_UNESCAPED;
-            http->log_uri = xstrndup(rfc1738_do_escape(uri, flags), MAX_URL);
+            http->log_uri = http->arena.ndup(rfc1738_do_escape(uri, flags), MAX_URL);
             int pos = strcspn(http->log_uri, w_space);
             http->log_uri[pos] = '\0';
         }
@@ -1993,7 +2029,7 @@ setLogUri(ClientHttpRequest * http, char const *uri, bool cleanUrl)
                 ++t;
             }
             *q = '\0';
-            http->log_uri = xstrndup(rfc1738_escape_unescaped(tmp_uri), MAX_URL);
+            http->log_uri = http->arena.ndup(rfc1738_escape_unescaped(tmp_uri), MAX_URL);
             xfree(tmp_uri);
         }
         break;
@@ -2060,7 +2096,7 @@ prepareAcceleratedURL(ConnStateData * conn, ClientHttpRequest *http, char *url,
         } // else nothing to alter port-wise.
         int url_sz = strlen(url) + 32 + Config.appendDomainLen +
                      strlen(host);
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         const char *protocol = switchedToHttps ?
                                "https" : conn->port->protocol;
         snprintf(http->uri, url_sz, "%s://%s%s", protocol, host, url);
@@ -2069,7 +2105,7 @@ prepareAcceleratedURL(ConnStateData * conn, ClientHttpRequest *http, char *url,
         debugs(33, 5, "ACCEL DEFAULTSITE REWRITE: defaultsite=" << conn->port->defaultsite << " + vport=" << vport);
         int url_sz = strlen(url) + 32 + Config.appendDomainLen +
                      strlen(conn->port->defaultsite);
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         char vportStr[32];
         vportStr[0] = '\0';
         if (vport > 0) {
@@ -2082,7 +2118,7 @@ prepareAcceleratedURL(ConnStateData * conn, ClientHttpRequest *http, char *url,
         debugs(33, 5, "ACCEL VPORT REWRITE: http_port IP + vport=" << vport);
         /* Put the local socket IP address as the hostname, with whatever vport we found  */
         int url_sz = strlen(url) + 32 + Config.appendDomainLen;
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         http->getConn()->clientConnection->local.ToHostname(ipbuf,MAX_IPSTRLEN);
         snprintf(http->uri, url_sz, "%s://%s:%d%s",
                  http->getConn()->port->protocol,
@@ -2105,13 +2141,13 @@ prepareTransparentURL(ConnStateData * conn, ClientHttpRequest *http, char *url,
     if ((host = mime_get_header(req_hdr, "Host")) != NULL) {
         int url_sz = strlen(url) + 32 + Config.appendDomainLen +
                      strlen(host);
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         snprintf(http->uri, url_sz, "%s://%s%s", conn->port->protocol, host, url);
         debugs(33, 5, "TRANSPARENT HOST REWRITE: '" << http->uri <<"'");
     } else {
         /* Put the local socket IP address as the hostname.  */
         int url_sz = strlen(url) + 32 + Config.appendDomainLen;
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         http->getConn()->clientConnection->local.ToHostname(ipbuf,MAX_IPSTRLEN);
         snprintf(http->uri, url_sz, "%s://%s:%d%s",
                  http->getConn()->port->protocol,
@@ -2292,7 +2328,7 @@ parseHttpRequest(ConnStateData *csd, HttpParser *hp, HttpRequestMethod * method_
     } else if (internalCheck(url)) {
         /* internal URL mode */
         /* prepend our name & port */
-        http->uri = xstrdup(internalLocalUri(NULL, url));
+        http->uri = http->arena.dup(internalLocalUri(NULL, url));
         // We just re-wrote the URL. Must replace the Host: header.
         //  But have not parsed there yet!! flag for local-only handling.
         http->flags.internal = 1;
@@ -2306,7 +2342,7 @@ parseHttpRequest(ConnStateData *csd, HttpParser *hp, HttpRequestMethod * method_
         /* No special rewrites have been applied above, use the
          * requested url. may be rewritten later, so make extra room */
         int url_sz = strlen(url) + Config.appendDomainLen + 5;
-        http->uri = (char *)xcalloc(url_sz, 1);
+        http->uri = static_cast<char *>(http->arena.alloc(url_sz));
         strcpy(http->uri, url);
     }
 
@@ -3347,6 +3383,7 @@ httpAccept(const CommAcceptCbParams &params)
     }
 
     ++ incoming_sockets_accepted;
+    ++statCounter.client_http.accepts;
 
     // Socket is ready, setup the connection manager to start using it
     ConnStateData *connState = connStateCreate(params.conn, s);
@@ -3377,7 +3414,9 @@ httpAccept(const CommAcceptCbParams &params)
 
             /* pools require explicit 'allow' to assign a client into them */
             if (pools[pool].access) {
-                ch.accessList = pools[pool].access;
+                // the checklist destructor unlocks the list
+                cbdataReferenceDone(ch.accessList);
+                ch.accessList = cbdataReference(pools[pool].access);
                 allow_t answer = ch.fastCheck();
                 if (answer == ACCESS_ALLOWED) {
 
@@ -3647,6 +3686,7 @@ httpsAccept(const CommAcceptCbParams &params)
     }
 
     ++incoming_sockets_accepted;
+    ++statCounter.client_http.accepts;
 
     // Socket is ready, setup the connection manager to start using it
     ConnStateData *connState = connStateCreate(params.conn, s);
@@ -3709,6 +3749,19 @@ ConnStateData::sslCrtdHandleReply(const char * reply)
     getSslContextDone(NULL);
 }
 
+void
+ConnStateData::sslCertGenerated(Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey)
+{
+    if (cert.get() && pkey.get()) {
+        debugs(33, 5, HERE << "Certificate for " << sslConnectHostOrIp << " was successfully generated by a signer thread");
+        SSL_CTX *ctx = Ssl::generateSslContextUsingPkeyAndCert(cert, pkey, *port);
+        getSslContextDone(ctx, true);
+        return;
+    }
+    debugs(33, 5, HERE << "Certificate for " << sslConnectHostOrIp << " cannot be generated by a signer thread");
+    getSslContextDone(NULL);
+}
+
 void ConnStateData::buildSslCertGenerationParams(Ssl::CertificateProperties &certProperties)
 {
     certProperties.commonName =  sslCommonName.defined() ? sslCommonName.termedBuf() : sslConnectHostOrIp.termedBuf();
@@ -3825,6 +3878,13 @@ ConnStateData::getSslContextStart()
             debugs(33, 5, HERE << "SSL certificate for " << sslBumpCertKey << " haven't found in cache");
         }
 
+        if (Ssl::CertSignerEnabled()) {
+            debugs(33, 5, HERE << "Generating SSL certificate for " << certProperties.commonName << " using signer threads.");
+            AsyncCall::Pointer call = JobCallback(33, 5, CertGeneratedDialer, this, ConnStateData::sslCertGenerated);
+            Ssl::GenerateCertificate(certProperties, call);
+            return;
+        }
+
 #if USE_SSL_CRTD
         try {
             debugs(33, 5, HERE << "Generating SSL certificate for " << certProperties.commonName << " using ssl_crtd.");
@@ -3995,6 +4055,20 @@ AddOpenedHttpSocket(const Comm::ConnectionPointer &conn)
     return found;
 }
 
+/// COMM_REUSEPORT* flags for the port listening socket
+static int
+ListenerReuseFlags(const AnyP::PortCfg *s)
+{
+    switch (s->reuse_port) {
+    case REUSEPORT_ON:
+        return COMM_REUSEPORT;
+    case REUSEPORT_CPU:
+        return COMM_REUSEPORT | COMM_REUSEPORT_CPU;
+    default:
+        return 0;
+    }
+}
+
 static void
 clientHttpConnectionsOpen(void)
 {
@@ -4027,7 +4101,8 @@ clientHttpConnectionsOpen(void)
         //  then pass back when active so we can start a TcpAcceptor subscription.
         s->listenConn = new Comm::Connection;
         s->listenConn->local = s->s;
-        s->listenConn->flags = COMM_NONBLOCKING | (s->spoof_client_ip ? COMM_TRANSPARENT : 0) | (s->intercepted ? COMM_INTERCEPTION : 0);
+        s->listenConn->flags = COMM_NONBLOCKING | (s->spoof_client_ip ? COMM_TRANSPARENT : 0) | (s->intercepted ? COMM_INTERCEPTION : 0) |
+                               ListenerReuseFlags(s);
 
         // setup the subscriptions such that new connections accepted by listenConn are handled by HTTP
         typedef CommCbFunPtrCallT<CommAcceptCbPtrFun> AcceptCall;
@@ -4083,7 +4158,7 @@ clientHttpsConnectionsOpen(void)
         s->listenConn = new Comm::Connection;
         s->listenConn->local = s->s;
         s->listenConn->flags = COMM_NONBLOCKING | (s->spoof_client_ip ? COMM_TRANSPARENT : 0) |
-                               (s->intercepted ? COMM_INTERCEPTION : 0);
+                               (s->intercepted ? COMM_INTERCEPTION : 0) | ListenerReuseFlags(s);
 
         // setup the subscriptions such that new connections accepted by listenConn are handled by HTTPS
         typedef CommCbFunPtrCallT<CommAcceptCbPtrFun> AcceptCall;
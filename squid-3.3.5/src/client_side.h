@@ -346,6 +346,8 @@ public:
     static void sslCrtdHandleReplyWrapper(void *data, char *reply);
     /// Proccess response from ssl_crtd.
     void sslCrtdHandleReply(const char * reply);
+    /// Process a certificate generated by an in-process signer thread.
+    void sslCertGenerated(Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey);
 
     void switchToHttps(HttpRequest *request, Ssl::BumpMode bumpServerMode);
     bool switchedToHttps() const { return switchedToHttps_; }
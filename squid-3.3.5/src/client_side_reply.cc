@@ -463,6 +463,7 @@ clientReplyContext::cacheHit(StoreIOBuffer result)
     StoreEntry *e = http->storeEntry();
 
     HttpRequest *r = http->request;
+    r->phases.stop(PhaseTimes::phStore);
 
     debugs(88, 3, "clientCacheHit: " << http->uri << ", " << result.length << " bytes");
 
@@ -1770,6 +1771,7 @@ clientReplyContext::doGetMoreData()
         localTempBuffer.offset = reqofs;
         localTempBuffer.length = getNextNode()->readBuffer.length;
         localTempBuffer.data = getNextNode()->readBuffer.data;
+        http->request->phases.start(PhaseTimes::phStore);
         storeClientCopy(sc, http->storeEntry(), localTempBuffer, CacheHit, this);
     } else {
         /* MISS CASE, http->logType is already set! */
@@ -2075,19 +2077,22 @@ clientReplyContext::sendMoreData (StoreIOBuffer result)
 
     ConnStateData * conn = http->getConn();
 
-    // too late, our conn is closing
-    // TODO: should we also quit?
-    if (conn == NULL) {
-        debugs(33,3, "not sending more data to a closed connection" );
-        return;
-    }
-    if (!conn->isOpen()) {
-        debugs(33,3, "not sending more data to closing connection " << conn->clientConnection);
-        return;
-    }
-    if (conn->pinning.zeroReply) {
-        debugs(33,3, "not sending more data after a pinned zero reply " << conn->clientConnection);
-        return;
+    // internal requests such as ESI includes never had a client connection
+    if (http->clientConnection != NULL) {
+        // too late, our conn is closing
+        // TODO: should we also quit?
+        if (conn == NULL) {
+            debugs(33,3, "not sending more data to a closed connection" );
+            return;
+        }
+        if (!conn->isOpen()) {
+            debugs(33,3, "not sending more data to closing connection " << conn->clientConnection);
+            return;
+        }
+        if (conn->pinning.zeroReply) {
+            debugs(33,3, "not sending more data after a pinned zero reply " << conn->clientConnection);
+            return;
+        }
     }
 
     char *buf = next()->readBuffer.data;
@@ -2098,7 +2103,7 @@ clientReplyContext::sendMoreData (StoreIOBuffer result)
         memcpy(buf, result.data, result.length);
     }
 
-    if (reqofs==0 && !logTypeIsATcpHit(http->logType) && Comm::IsConnOpen(conn->clientConnection)) {
+    if (reqofs==0 && !logTypeIsATcpHit(http->logType) && conn && Comm::IsConnOpen(conn->clientConnection)) {
         if (Ip::Qos::TheConfig.isHitTosActive()) {
             Ip::Qos::doTosLocalMiss(conn->clientConnection, http->request->hier.code);
         }
@@ -2126,7 +2131,7 @@ clientReplyContext::sendMoreData (StoreIOBuffer result)
            reqofs << " bytes (" << result.length <<
            " new bytes)");
     debugs(88, 5, "clientReplyContext::sendMoreData:"
-           << conn->clientConnection <<
+           << http->clientConnection <<
            " '" << entry->url() << "'" <<
            " out.offset=" << http->out.offset);
 
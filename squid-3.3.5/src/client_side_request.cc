@@ -189,9 +189,11 @@ ClientHttpRequest::ClientHttpRequest(ConnStateData * aConn) :
     start_time = current_time;
     setConn(aConn);
     al = new AccessLogEntry;
-    al->tcpClient = clientConnection = aConn->clientConnection;
+    // internal requests such as ESI includes have no client connection
+    if (aConn)
+        al->tcpClient = clientConnection = aConn->clientConnection;
 #if USE_SSL
-    if (aConn->clientConnection != NULL && aConn->clientConnection->isOpen()) {
+    if (aConn && aConn->clientConnection != NULL && aConn->clientConnection->isOpen()) {
         if (SSL *ssl = fd_table[aConn->clientConnection->fd].ssl)
             al->cache.sslClientCert.reset(SSL_get_peer_certificate(ssl));
     }
@@ -364,7 +366,7 @@ clientBeginRequest(const HttpRequestMethod& method, char const *url, CSCB * stre
     http->flags.accel = 1;
     /* allow size for url rewriting */
     url_sz = strlen(url) + Config.appendDomainLen + 5;
-    http->uri = (char *)xcalloc(url_sz, 1);
+    http->uri = static_cast<char *>(http->arena.alloc(url_sz));
     strcpy(http->uri, url);
 
     if ((request = HttpRequest::CreateFromUrlAndMethod(http->uri, method)) == NULL) {
@@ -380,7 +382,7 @@ clientBeginRequest(const HttpRequestMethod& method, char const *url, CSCB * stre
     if (header)
         request->header.update(header, NULL);
 
-    http->log_uri = xstrdup(urlCanonicalClean(request));
+    http->log_uri = http->arena.dup(urlCanonicalClean(request));
 
     /* http struct now ready */
 
@@ -709,6 +711,8 @@ ClientRequestContext::hostHeaderVerify()
 void
 ClientRequestContext::clientAccessCheck()
 {
+    http->request->phases.start(PhaseTimes::phAcl);
+
 #if FOLLOW_X_FORWARDED_FOR
     if (!http->request->flags.doneFollowXff() &&
             Config.accessList.followXFF &&
@@ -745,6 +749,8 @@ ClientRequestContext::clientAccessCheck()
 void
 ClientRequestContext::clientAccessCheck2()
 {
+    http->request->phases.start(PhaseTimes::phAcl);
+
     if (Config.accessList.adapted_http) {
         acl_checklist = clientAclChecklistCreate(Config.accessList.adapted_http, http);
         acl_checklist->nonBlockingCheck(clientAccessCheckDoneWrapper, this);
@@ -769,6 +775,7 @@ void
 ClientRequestContext::clientAccessCheckDone(const allow_t &answer)
 {
     acl_checklist = NULL;
+    http->request->phases.stop(PhaseTimes::phAcl);
     err_type page_id;
     http_status status;
     debugs(85, 2, "The request " <<
@@ -851,9 +858,7 @@ ClientRequestContext::clientAccessCheckDone(const allow_t &answer)
     }
 
     /* ACCESS_ALLOWED continues here ... */
-    safe_free(http->uri);
-
-    http->uri = xstrdup(urlCanonical(http->request));
+    http->uri = http->arena.dup(urlCanonical(http->request));
 
     http->doCallouts();
 }
@@ -1211,7 +1216,7 @@ ClientRequestContext::clientRedirectDone(char *result)
 
             if ((t = strchr(result, ':')) != NULL) {
                 http->redirect.status = status;
-                http->redirect.location = xstrdup(t + 1);
+                http->redirect.location = http->arena.dup(t + 1);
                 // TODO: validate the URL produced here is RFC 2616 compliant absolute URI
             } else {
                 debugs(85, DBG_CRITICAL, "ERROR: URL-rewrite produces invalid " << status << " redirect Location: " << result);
@@ -1234,8 +1239,7 @@ ClientRequestContext::clientRedirectDone(char *result)
                 }
 
                 // update the current working ClientHttpRequest fields
-                safe_free(http->uri);
-                http->uri = xstrdup(urlCanonical(new_request));
+                http->uri = http->arena.dup(urlCanonical(new_request));
                 HTTPMSGUNLOCK(old_request);
                 http->request = HTTPMSGLOCK(new_request);
             } else {
@@ -1262,6 +1266,8 @@ ClientRequestContext::clientRedirectDone(char *result)
 void
 ClientRequestContext::checkNoCache()
 {
+    http->request->phases.start(PhaseTimes::phAcl);
+
     if (Config.accessList.noCache) {
         acl_checklist = clientAclChecklistCreate(Config.accessList.noCache, http);
         acl_checklist->nonBlockingCheck(checkNoCacheDoneWrapper, this);
@@ -1286,6 +1292,7 @@ void
 ClientRequestContext::checkNoCacheDone(const allow_t &answer)
 {
     acl_checklist = NULL;
+    http->request->phases.stop(PhaseTimes::phAcl);
     http->request->flags.cachable = (answer == ACCESS_ALLOWED);
     http->doCallouts();
 }
@@ -1717,6 +1724,7 @@ ClientHttpRequest::startAdaptation(const Adaptation::ServiceGroupPointer &g)
     debugs(85, 3, HERE << "adaptation needed for " << this);
     assert(!virginHeadSource);
     assert(!adaptedBodySource);
+    request->phases.start(PhaseTimes::phAdaptation);
     virginHeadSource = initiateAdaptation(
                            new Adaptation::Iterator(request, NULL, g));
 
@@ -1731,6 +1739,7 @@ ClientHttpRequest::noteAdaptationAnswer(const Adaptation::Answer &answer)
     assert(cbdataReferenceValid(this));		// indicates bug
     clearAdaptation(virginHeadSource);
     assert(!adaptedBodySource);
+    request->phases.stop(PhaseTimes::phAdaptation);
 
     switch (answer.kind) {
     case Adaptation::Answer::akForward:
@@ -1756,13 +1765,14 @@ ClientHttpRequest::handleAdaptedHeader(HttpMsg *msg)
         /*
          * Replace the old request with the new request.
          */
+        // new_req inherited our phase times before the adaptation phase ended
+        new_req->phases = request->phases;
         HTTPMSGUNLOCK(request);
         request = HTTPMSGLOCK(new_req);
         /*
          * Store the new URI for logging
          */
-        xfree(uri);
-        uri = xstrdup(urlCanonical(request));
+        uri = arena.dup(urlCanonical(request));
         setLogUri(this, urlCanonicalClean(request));
         assert(request->method.id());
     } else if (HttpReply *new_rep = dynamic_cast<HttpReply*>(msg)) {
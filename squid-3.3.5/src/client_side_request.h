@@ -37,6 +37,7 @@
 #include "dlink.h"
 #include "base/AsyncJob.h"
 #include "HttpHeaderRange.h"
+#include "MemArena.h"
 
 #if USE_ADAPTATION
 #include "adaptation/forward.h"
@@ -96,8 +97,8 @@ public:
     Comm::ConnectionPointer clientConnection;
 
     HttpRequest *request;		/* Parsed URL ... */
-    char *uri;
-    char *log_uri;
+    char *uri; ///< allocated in arena
+    char *log_uri; ///< allocated in arena
 
     struct {
         int64_t offset;
@@ -123,7 +124,7 @@ public:
 
     struct {
         http_status status;
-        char *location;
+        char *location; ///< allocated in arena
     } redirect;
 
     dlink_node active;
@@ -133,6 +134,10 @@ public:
     ClientRequestContext *calloutContext;
     void doCallouts();
 
+    /// Memory for strings that die with this transaction. Objects that
+    /// others may hold on to, like the request, must not be allocated here.
+    MemArena arena;
+
 #if USE_ADAPTATION
     // AsyncJob virtual methods
     virtual bool doneAll() const {
@@ -66,6 +66,10 @@
 #include "StoreIOBuffer.h"
 #include "tools.h"
 
+#if USE_DELAY_POOLS
+#include "DelayPools.h"
+#include "ipc/TokenBuckets.h"
+#endif
 #if USE_SSL
 #include "ssl/support.h"
 #endif
@@ -79,6 +83,9 @@
 #if HAVE_SYS_UN_H
 #include <sys/un.h>
 #endif
+#if HAVE_LIMITS_H
+#include <limits.h>
+#endif
 #if HAVE_MATH_H
 #include <math.h>
 #endif
@@ -110,6 +117,7 @@ static void commPlanHalfClosedCheck();
 
 static comm_err_t commBind(int s, struct addrinfo &);
 static void commSetReuseAddr(int);
+static void commSetReusePort(int);
 static void commSetNoLinger(int);
 #ifdef TCP_NODELAY
 static void commSetTcpNoDelay(int);
@@ -673,6 +681,10 @@ comm_apply_flags(int new_socket,
     if ((flags & COMM_REUSEADDR))
         commSetReuseAddr(new_socket);
 
+    /* MUST be done before binding to join the group of sockets sharing addr */
+    if ((flags & COMM_REUSEPORT))
+        commSetReusePort(new_socket);
+
     if (addr.GetPort() > (unsigned short) 0) {
 #if _SQUID_MSWIN_
         if (sock_type != SOCK_DGRAM)
@@ -1318,6 +1330,23 @@ commSetReuseAddr(int fd)
         debugs(50, DBG_IMPORTANT, "commSetReuseAddr: FD " << fd << ": " << xstrerror());
 }
 
+/**
+ * Allow other kids to bind their own listening sockets to our address so
+ * that the kernel distributes new connections among the kids.
+ */
+static void
+commSetReusePort(int fd)
+{
+#if defined(SO_REUSEPORT)
+    int on = 1;
+
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (char *) &on, sizeof(on)) < 0)
+        debugs(50, DBG_IMPORTANT, "commSetReusePort: FD " << fd << ": " << xstrerror());
+#else
+    debugs(50, DBG_CRITICAL, "WARNING: commSetReusePort: SO_REUSEPORT is not supported on this platform");
+#endif
+}
+
 static void
 commSetTcpRcvbuf(int fd, int size)
 {
@@ -1627,10 +1656,37 @@ ClientInfo::quotaForDequed()
     return rationedQuota;
 }
 
+/// identifies the client bucket shared by SMP workers
+static uint64_t
+SharedBucketKey(const Ip::Address &addr)
+{
+    struct in6_addr ip;
+    addr.GetInAddr(ip);
+
+    // FNV-1a folds the address into the low 56 bits; the top byte keeps
+    // client_delay_pools keys apart from delay_pools ones
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < sizeof(ip.s6_addr); ++i) {
+        hash ^= ip.s6_addr[i];
+        hash *= 1099511628211ULL;
+    }
+    return (static_cast<uint64_t>(2) << 56) | (hash >> 8);
+}
+
 ///< adds bytes to the quota bucket based on the rate and passed time
 void
 ClientInfo::refillBucket()
 {
+    if (Ipc::TokenBucket *bucket = sharedBucket()) {
+        // other workers refill and drain the same bucket; mirror its level
+        const int limit = bucketSizeLimit < INT_MAX ? static_cast<int>(bucketSizeLimit) : INT_MAX;
+        bucket->refill(static_cast<int64_t>(current_dtime * 1000), writeSpeedLimit, limit);
+        bucketSize = max(0, bucket->tokens());
+        debugs(77,5, HERE << "clt" << (const char*)hash.key << ": shared " <<
+               bucket->tokens());
+        return;
+    }
+
     // all these times are in seconds, with double precision
     const double currTime = current_dtime;
     const double timePassed = currTime - prevTime;
@@ -1687,9 +1743,30 @@ ClientInfo::setWriteLimiter(const int aWriteSpeedLimit, const double anInitialBu
 
         bucketSize = anInitialBurst;
         prevTime = current_dtime;
+        sharedQuotaKey = SharedBucketKey(addr);
     }
 }
 
+Ipc::TokenBucket *
+ClientInfo::sharedBucket()
+{
+    if (!sharedQuotaKey)
+        return NULL;
+
+    // an idle bucket may have been given to another client; find or claim anew
+    if (!sharedQuota || sharedQuota->key.get() != sharedQuotaKey)
+        sharedQuota = DelayPools::SharedBucket(sharedQuotaKey, static_cast<int>(bucketSize));
+
+    return sharedQuota;
+}
+
+void
+ClientInfo::drainSharedBucket(const int bytes)
+{
+    if (Ipc::TokenBucket *bucket = sharedBucket())
+        bucket->consume(bytes);
+}
+
 CommQuotaQueue::CommQuotaQueue(ClientInfo *info): clientInfo(info),
         ins(0), outs(0)
 {
@@ -72,6 +72,8 @@ namespace Comm
 #define COMM_DOBIND             0x08  // requires a bind()
 #define COMM_TRANSPARENT        0x10  // arrived via TPROXY
 #define COMM_INTERCEPTION       0x20  // arrived via NAT
+#define COMM_REUSEPORT          0x40  // listener may share its address with other kids
+#define COMM_REUSEPORT_CPU      0x80  // steer COMM_REUSEPORT connections by CPU
 
 /**
  * Store data about the physical and logical attributes of a connection.
@@ -55,6 +55,18 @@ Comm::IoCallback::setCallback(Comm::iocb_type t, AsyncCall::Pointer &cb, char *b
     freefunc = f;
     size = sz;
     offset = 0;
+    iovCount = 0;
+}
+
+void
+Comm::IoCallback::setIoVecs(const struct iovec *vecs, int count)
+{
+    assert(type == IOCB_WRITE);
+    assert(!buf && !freefunc);
+    assert(0 < count && count <= MaxWriteIoVecs);
+
+    memcpy(iov, vecs, count * sizeof(*vecs));
+    iovCount = count;
 }
 
 void
@@ -94,6 +106,7 @@ Comm::IoCallback::reset()
         buf = NULL;
         freefunc = NULL;
     }
+    iovCount = 0;
     xerrno = 0;
 
 #if USE_DELAY_POOLS
@@ -6,9 +6,16 @@
 #include "comm_err_t.h"
 #include "typedefs.h"
 
+#if HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 namespace Comm
 {
 
+/// the most buffers a single gathered write may reference
+static const int MaxWriteIoVecs = 4;
+
 /// Type of IO callbacks the Comm layer deals with.
 typedef enum {
     IOCB_NONE,
@@ -27,6 +34,8 @@ public:
     FREE *freefunc;
     int size;
     int offset;
+    struct iovec iov[MaxWriteIoVecs]; ///< gathered write buffers used instead of buf
+    int iovCount; ///< number of iov entries in use; zero unless gathering
     comm_err_t errcode;
     int xerrno;
 #if USE_DELAY_POOLS
@@ -36,6 +45,9 @@ public:
     bool active() const { return callback != NULL; }
     void setCallback(iocb_type type, AsyncCall::Pointer &cb, char *buf, FREE *func, int sz);
 
+    /// use the given caller-owned buffers instead of buf for this write
+    void setIoVecs(const struct iovec *vecs, int count);
+
     /// called when fd needs to write but may need to wait in line for its quota
     void selectOrQueueWrite();
 
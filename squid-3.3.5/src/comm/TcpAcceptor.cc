@@ -57,6 +57,10 @@
 // required for accept_filter to build.
 #include <netinet/tcp.h>
 #endif
+#if _SQUID_LINUX_
+// required for reuseport=cpu to build.
+#include <linux/filter.h>
+#endif
 
 CBDATA_NAMESPACED_CLASS_INIT(Comm, TcpAcceptor);
 
@@ -66,7 +70,10 @@ Comm::TcpAcceptor::TcpAcceptor(const Comm::ConnectionPointer &newConn, const cha
         isLimited(0),
         theCallSub(aSub),
         conn(newConn)
-{}
+{
+    readyTime.tv_sec = 0;
+    readyTime.tv_usec = 0;
+}
 
 void
 Comm::TcpAcceptor::subscribe(const Subscription::Pointer &aSub)
@@ -177,6 +184,28 @@ Comm::TcpAcceptor::setListen()
             debugs(5, DBG_CRITICAL, "WARNING: TCP_DEFER_ACCEPT '" << Config.accept_filter << "': '" << xstrerror());
 #else
         debugs(5, DBG_CRITICAL, "WARNING: accept_filter not supported on your OS");
+#endif
+    }
+
+    // only a listening socket has joined its SO_REUSEPORT group; attaching
+    // earlier would give the socket a group of its own
+    if (conn->flags & COMM_REUSEPORT_CPU) {
+#if _SQUID_LINUX_ && defined(SO_ATTACH_REUSEPORT_CBPF)
+        // A = current CPU; A = A % workers; return A (a group socket index)
+        // The index follows the order in which sockets joined the group, so
+        // a restarted worker may take over the CPUs of another one.
+        struct sock_filter code[] = {
+            { BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU) },
+            { BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(max(Config.workers, 1)) },
+            { BPF_RET | BPF_A, 0, 0, 0 }
+        };
+        struct sock_fprog prog;
+        prog.len = sizeof(code) / sizeof(*code);
+        prog.filter = code;
+        if (setsockopt(conn->fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0)
+            debugs(5, DBG_CRITICAL, "WARNING: SO_ATTACH_REUSEPORT_CBPF on " << conn << ": " << xstrerror());
+#else
+        debugs(5, DBG_CRITICAL, "WARNING: reuseport=cpu not supported on your OS");
 #endif
     }
 }
@@ -189,6 +218,11 @@ Comm::TcpAcceptor::setListen()
  * available to do the clone safely will push the listening FD into a list
  * of deferred operations. The list gets kicked and the dupe/accept() actually
  * done later when enough sockets become available.
+ *
+ * Up to accept_batch queued connections are accepted per call so that
+ * a busy listener does not wait for another select loop iteration for each
+ * of them. The subscriber calls for the whole batch are scheduled before
+ * any of them runs.
  */
 void
 Comm::TcpAcceptor::doAccept(int fd, void *data)
@@ -199,11 +233,30 @@ Comm::TcpAcceptor::doAccept(int fd, void *data)
         Must(isOpen(fd));
         TcpAcceptor *afd = static_cast<TcpAcceptor*>(data);
 
-        if (!okToAccept()) {
-            AcceptLimiter::Instance().defer(afd);
-        } else {
-            afd->acceptNext();
+        ++statCounter.acceptor.events;
+        if (!afd->isLimited) // deferred accepts keep their original wait start
+            afd->readyTime = current_time;
+
+        const int limit = max(Config.accept_batch, 1);
+        int accepted = 0;
+        bool drained = false;
+        while (accepted < limit) {
+            if (!okToAccept()) {
+                ++statCounter.acceptor.deferrals;
+                AcceptLimiter::Instance().defer(afd);
+                break;
+            }
+            if (!afd->acceptOne()) {
+                drained = true; // or the listener failed
+                break;
+            }
+            ++accepted;
         }
+
+        if (accepted >= limit)
+            ++statCounter.acceptor.full_batches;
+        // zero means another process took the connection we were woken for
+        statCounter.acceptor.backlog.count(accepted + (drained ? 0 : afd->queueLength()));
         SetSelect(fd, COMM_SELECT_READ, Comm::TcpAcceptor::doAccept, afd, 0);
 
     } catch (const std::exception &e) {
@@ -229,7 +282,7 @@ Comm::TcpAcceptor::okToAccept()
     return false;
 }
 
-void
+bool
 Comm::TcpAcceptor::acceptOne()
 {
     /*
@@ -249,20 +302,38 @@ Comm::TcpAcceptor::acceptOne()
             /* register interest again */
             debugs(5, 5, HERE << "try later: " << conn << " handler Subscription: " << theCallSub);
             SetSelect(conn->fd, COMM_SELECT_READ, doAccept, this, 0);
-            return;
+            return false;
         }
 
         // A non-recoverable error; notify the caller */
         debugs(5, 5, HERE << "non-recoverable error:" << status() << " handler Subscription: " << theCallSub);
         notify(flag, newConnDetails);
         mustStop("Listener socket closed");
-        return;
+        return false;
     }
 
+    getCurrentTime();
+    statCounter.acceptor.delay.count(readyTime, current_time);
+
     debugs(5, 5, HERE << "Listener: " << conn <<
            " accepted new connection " << newConnDetails <<
            " handler Subscription: " << theCallSub);
     notify(flag, newConnDetails);
+    return true;
+}
+
+int
+Comm::TcpAcceptor::queueLength() const
+{
+#if _SQUID_LINUX_ && defined(TCP_INFO)
+    // for listening sockets, Linux reports the accept queue length here
+    struct tcp_info info;
+    socklen_t len = sizeof(info);
+    if (getsockopt(conn->fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0)
+        return info.tcpi_unacked;
+    debugs(5, 3, HERE << conn << ": " << xstrerror());
+#endif
+    return 0;
 }
 
 void
@@ -326,7 +397,20 @@ Comm::TcpAcceptor::oldAccept(Comm::ConnectionPointer &details)
     details->local.InitAddrInfo(gai);
 
     errcode = 0; // reset local errno copy.
-    if ((sock = accept(conn->fd, gai->ai_addr, &gai->ai_addrlen)) < 0) {
+#if _SQUID_LINUX_ && defined(SOCK_NONBLOCK) && defined(SOCK_CLOEXEC)
+    // saves two fcntl() calls per connection; old kernels lack accept4()
+    static bool noAccept4 = false;
+    sock = noAccept4 ? -1 : accept4(conn->fd, gai->ai_addr, &gai->ai_addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sock < 0 && (noAccept4 || errno == ENOSYS)) {
+        noAccept4 = true;
+        sock = accept(conn->fd, gai->ai_addr, &gai->ai_addrlen);
+    }
+    const bool flagsSet = !noAccept4;
+#else
+    sock = accept(conn->fd, gai->ai_addr, &gai->ai_addrlen);
+    const bool flagsSet = false;
+#endif
+    if (sock < 0) {
         errcode = errno; // store last accept errno locally.
 
         details->local.FreeAddrInfo(gai);
@@ -379,8 +463,13 @@ Comm::TcpAcceptor::oldAccept(Comm::ConnectionPointer &details)
     F->sock_family = details->local.IsIPv6()?AF_INET6:AF_INET;
 
     // set socket flags
-    commSetCloseOnExec(sock);
-    commSetNonBlocking(sock);
+    if (flagsSet) {
+        F->flags.close_on_exec = 1;
+        F->flags.nonblocking = 1;
+    } else {
+        commSetCloseOnExec(sock);
+        commSetNonBlocking(sock);
+    }
 
     /* IFF the socket is (tproxy) transparent, pass the flag down to allow spoofing */
     F->flags.transparent = fd_table[conn->fd].flags.transparent; // XXX: can we remove this line yet?
@@ -80,7 +80,14 @@ private:
     /// Method callback for whenever an FD is ready to accept a client connection.
     static void doAccept(int fd, void *data);
 
-    void acceptOne();
+    /// the number of connections waiting to be accepted, if known, or zero
+    int queueLength() const;
+
+    /// when the listener became ready for the connections we are accepting
+    struct timeval readyTime;
+
+    /// accepts one connection; returns whether another accept may succeed
+    bool acceptOne();
     comm_err_t oldAccept(Comm::ConnectionPointer &details);
     void setListen();
 
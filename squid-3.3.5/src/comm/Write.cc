@@ -23,6 +23,30 @@ Comm::Write(const Comm::ConnectionPointer &conn, MemBuf *mb, AsyncCall::Pointer
     Comm::Write(conn, mb->buf, mb->size, callback, mb->freeFunc());
 }
 
+void
+Comm::Write(const Comm::ConnectionPointer &conn, const struct iovec *iov, int iovcnt, AsyncCall::Pointer &callback)
+{
+    int size = 0;
+    for (int i = 0; i < iovcnt; ++i)
+        size += iov[i].iov_len;
+
+    debugs(5, 5, HERE << conn << ": sz " << size << " in " << iovcnt <<
+           " buffers: asynCall " << callback);
+
+    /* Make sure we are open, not closing, and not writing */
+    assert(fd_table[conn->fd].flags.open);
+    assert(!fd_table[conn->fd].closing());
+    Comm::IoCallback *ccb = COMMIO_FD_WRITECB(conn->fd);
+    assert(!ccb->active());
+
+    fd_table[conn->fd].writeStart = squid_curtime;
+    ccb->conn = conn;
+    /* Queue the write */
+    ccb->setCallback(IOCB_WRITE, callback, NULL, NULL, size);
+    ccb->setIoVecs(iov, iovcnt);
+    ccb->selectOrQueueWrite();
+}
+
 void
 Comm::Write(const Comm::ConnectionPointer &conn, const char *buf, int size, AsyncCall::Pointer &callback, FREE * free_func)
 {
@@ -41,6 +65,39 @@ Comm::Write(const Comm::ConnectionPointer &conn, const char *buf, int size, Asyn
     ccb->selectOrQueueWrite();
 }
 
+/// writes up to nleft bytes of the gathered buffers, starting at state.offset
+static int
+WriteIoVecs(int fd, const Comm::IoCallback &state, int nleft)
+{
+    struct iovec iov[Comm::MaxWriteIoVecs];
+    int count = 0;
+    int skip = state.offset;
+    for (int i = 0; i < state.iovCount && nleft > 0; ++i) {
+        const int len = static_cast<int>(state.iov[i].iov_len);
+        if (skip >= len) {
+            skip -= len;
+            continue;
+        }
+        iov[count].iov_base = static_cast<char *>(state.iov[i].iov_base) + skip;
+        iov[count].iov_len = min(len - skip, nleft);
+        nleft -= iov[count].iov_len;
+        skip = 0;
+        ++count;
+    }
+
+    if (!count)
+        return 0;
+
+#if HAVE_SYS_UIO_H
+    // writev(2) would bypass special write methods such as SSL_write()
+    if (fd_table[fd].write_method == &default_write_method)
+        return writev(fd, iov, count);
+#endif
+
+    // write one buffer at a time; HandleWrite calls us again for the rest
+    return FD_WRITE_METHOD(fd, static_cast<const char *>(iov[0].iov_base), iov[0].iov_len);
+}
+
 /** Write to FD.
  * This function is used by the lowest level of IO loop which only has access to FD numbers.
  * We have to use the comm iocb_table to map FD numbers to waiting data and Comm::Connections.
@@ -96,7 +153,10 @@ Comm::HandleWrite(int fd, void *data)
 #endif /* USE_DELAY_POOLS */
 
     /* actually WRITE data */
-    len = FD_WRITE_METHOD(fd, state->buf + state->offset, nleft);
+    if (state->iovCount)
+        len = WriteIoVecs(fd, *state, nleft);
+    else
+        len = FD_WRITE_METHOD(fd, state->buf + state->offset, nleft);
     debugs(5, 5, HERE << "write() returns " << len);
 
 #if USE_DELAY_POOLS
@@ -104,6 +164,7 @@ Comm::HandleWrite(int fd, void *data)
         if (len > 0) {
             /* we wrote data - drain them from bucket */
             clientInfo->bucketSize -= len;
+            clientInfo->drainSharedBucket(len);
             if (clientInfo->bucketSize < 0.0) {
                 debugs(5, DBG_IMPORTANT, HERE << "drained too much"); // should not happen
                 clientInfo->bucketSize = 0;
@@ -23,6 +23,15 @@ void Write(const Comm::ConnectionPointer &conn, const char *buf, int size, Async
  */
 void Write(const Comm::ConnectionPointer &conn, MemBuf *mb, AsyncCall::Pointer &callback);
 
+/**
+ * Queue a gathered write of up to MaxWriteIoVecs buffers. callback is
+ * scheduled when the write completes, on error, or on file descriptor close.
+ *
+ * The buffers are not copied or freed. The caller must keep them unchanged
+ * until the callback is scheduled.
+ */
+void Write(const Comm::ConnectionPointer &conn, const struct iovec *iov, int iovcnt, AsyncCall::Pointer &callback);
+
 /// Cancel the write pending on FD. No action if none pending.
 void WriteCancel(const Comm::ConnectionPointer &conn, const char *reason);
 
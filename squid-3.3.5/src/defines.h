@@ -221,6 +221,9 @@
 #define URI_WHITESPACE_CHOP 3
 #define URI_WHITESPACE_DENY 4
 
+#define PCONN_REUSE_LIFO 0
+#define PCONN_REUSE_FIFO 1
+
 #ifndef O_TEXT
 #define O_TEXT 0
 #endif
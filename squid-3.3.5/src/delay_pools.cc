@@ -43,6 +43,7 @@
 
 #if USE_DELAY_POOLS
 #include "Array.h"
+#include "base/RunnersRegistry.h"
 #include "client_side_request.h"
 #include "comm/Connection.h"
 #include "CommonPool.h"
@@ -52,19 +53,24 @@
 #include "DelayId.h"
 #include "DelayPool.h"
 #include "DelayPools.h"
+#include "DelayPrefix.h"
 #include "DelaySpec.h"
 #include "DelayTagged.h"
 #include "DelayUser.h"
 #include "DelayVector.h"
 #include "event.h"
 #include "ip/Address.h"
+#include "ipc/mem/Segment.h"
+#include "ipc/TokenBuckets.h"
 #include "MemObject.h"
 #include "mgr/Registration.h"
 #include "NullDelayId.h"
+#include "SquidConfig.h"
 #include "SquidString.h"
 #include "SquidTime.h"
 #include "StoreClient.h"
 #include "Store.h"
+#include "tools.h"
 
 /// \ingroup DelayPoolsInternal
 long DelayPools::MemoryUsed = 0;
@@ -77,7 +83,7 @@ public:
     typedef RefCount<Aggregate> Pointer;
     void *operator new(size_t);
     void operator delete (void *);
-    Aggregate();
+    explicit Aggregate(const uint64_t sharedKeys);
     ~Aggregate();
     virtual DelaySpec *rate() {return &spec;}
 
@@ -148,7 +154,7 @@ public:
 
     virtual DelayIdComposite::Pointer id(CompositeSelectionDetails &);
     VectorMap<unsigned char, DelayBucket> buckets;
-    VectorPool();
+    explicit VectorPool(const uint64_t sharedKeys);
     ~VectorPool();
 
 protected:
@@ -162,6 +168,7 @@ protected:
     virtual unsigned int makeKey(Ip::Address &src_addr) const = 0;
 
     DelaySpec spec;
+    const uint64_t sharedKeys; ///< base key of our shared buckets
 
     /// \ingroup DelayPoolsInternal
     class Id:public DelayIdComposite
@@ -185,6 +192,7 @@ class IndividualPool : public VectorPool
 {
 
 public:
+    explicit IndividualPool(const uint64_t sharedKeys): VectorPool(sharedKeys) {}
     void *operator new(size_t);
     void operator delete(void *);
 
@@ -198,6 +206,7 @@ class ClassCNetPool : public VectorPool
 {
 
 public:
+    explicit ClassCNetPool(const uint64_t sharedKeys): VectorPool(sharedKeys) {}
     void *operator new(size_t);
     void operator delete (void *);
 
@@ -236,7 +245,7 @@ public:
     virtual void stats(StoreEntry * sentry);
 
     virtual DelayIdComposite::Pointer id(CompositeSelectionDetails &);
-    ClassCHostPool();
+    explicit ClassCHostPool(const uint64_t sharedKeys);
     ~ClassCHostPool();
 
 protected:
@@ -252,6 +261,7 @@ protected:
     unsigned char makeHostKey(Ip::Address &src_addr) const;
 
     DelaySpec spec;
+    const uint64_t sharedKeys; ///< base key of our shared buckets
     VectorMap<unsigned char, ClassCBucket> buckets;
 
     class Id;
@@ -297,7 +307,7 @@ CommonPool::operator delete(void *address)
 }
 
 CommonPool *
-CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeCopy)
+CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeCopy, unsigned short pool)
 {
     CommonPool *result = new CommonPool;
 
@@ -307,7 +317,7 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         break;
 
     case 1:
-        compositeCopy = new Aggregate;
+        compositeCopy = new Aggregate(DelayPools::SharedKeys(pool, 0));
         result->typeLabel = "1";
         break;
 
@@ -316,8 +326,8 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         {
             DelayVector::Pointer temp = new DelayVector;
             compositeCopy = temp.getRaw();
-            temp->push_back (new Aggregate);
-            temp->push_back(new IndividualPool);
+            temp->push_back (new Aggregate(DelayPools::SharedKeys(pool, 0)));
+            temp->push_back(new IndividualPool(DelayPools::SharedKeys(pool, 1)));
         }
         break;
 
@@ -326,9 +336,9 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         {
             DelayVector::Pointer temp = new DelayVector;
             compositeCopy = temp.getRaw();
-            temp->push_back (new Aggregate);
-            temp->push_back (new ClassCNetPool);
-            temp->push_back (new ClassCHostPool);
+            temp->push_back (new Aggregate(DelayPools::SharedKeys(pool, 0)));
+            temp->push_back (new ClassCNetPool(DelayPools::SharedKeys(pool, 1)));
+            temp->push_back (new ClassCHostPool(DelayPools::SharedKeys(pool, 2)));
         }
         break;
 
@@ -337,9 +347,9 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         {
             DelayVector::Pointer temp = new DelayVector;
             compositeCopy = temp.getRaw();
-            temp->push_back (new Aggregate);
-            temp->push_back (new ClassCNetPool);
-            temp->push_back (new ClassCHostPool);
+            temp->push_back (new Aggregate(DelayPools::SharedKeys(pool, 0)));
+            temp->push_back (new ClassCNetPool(DelayPools::SharedKeys(pool, 1)));
+            temp->push_back (new ClassCHostPool(DelayPools::SharedKeys(pool, 2)));
 #if USE_AUTH
             temp->push_back (new DelayUser);
 #endif
@@ -351,6 +361,16 @@ CommonPool::Factory(unsigned char _class, CompositePoolNode::Pointer& compositeC
         compositeCopy = new DelayTagged;
         break;
 
+    case 6:
+        result->typeLabel = "6";
+        {
+            DelayVector::Pointer temp = new DelayVector;
+            compositeCopy = temp.getRaw();
+            temp->push_back (new Aggregate(DelayPools::SharedKeys(pool, 0)));
+            temp->push_back (new DelayPrefix(DelayPools::SharedKeys(pool, 1)));
+        }
+        break;
+
     default:
         fatal ("unknown delay pool class");
         return NULL;
@@ -454,9 +474,10 @@ Aggregate::operator delete (void *address)
     ::operator delete (address);
 }
 
-Aggregate::Aggregate()
+Aggregate::Aggregate(const uint64_t sharedKeys)
 {
     theBucket.init (*rate());
+    theBucket.share(sharedKeys);
     DelayPools::registerForUpdates (this);
 }
 
@@ -542,6 +563,95 @@ DelayPool *DelayPools::delay_data = NULL;
 time_t DelayPools::LastUpdate = 0;
 unsigned short DelayPools::pools_ (0);
 
+/// buckets shared by SMP kids, if they share delay buckets
+static Ipc::TokenBuckets *SharedBuckets = NULL;
+
+/// shared memory segment path for SharedBuckets
+static const char *const SharedBucketsLabel = "delay_buckets";
+
+/// whether SMP kids should keep delay buckets in shared memory
+static bool
+ShareBuckets()
+{
+    return UsingSmp() && Config.Delay.sharedBuckets > 0 &&
+           Ipc::Atomic::Enabled() && Ipc::Mem::Segment::Enabled();
+}
+
+/// initializes shared memory segments used by delay pools
+class DelayBucketsRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    DelayBucketsRr(): owner(NULL) {}
+    virtual ~DelayBucketsRr();
+
+protected:
+    virtual void create(const RunnerRegistry &);
+    virtual void open(const RunnerRegistry &);
+
+private:
+    Ipc::TokenBuckets::Owner *owner;
+};
+
+RunnerRegistrationEntry(rrAfterConfig, DelayBucketsRr);
+
+void
+DelayBucketsRr::create(const RunnerRegistry &)
+{
+    if (!ShareBuckets())
+        return;
+
+    Must(!owner);
+    owner = Ipc::TokenBuckets::Init(SharedBucketsLabel, Config.Delay.sharedBuckets);
+}
+
+void
+DelayBucketsRr::open(const RunnerRegistry &)
+{
+    if (!ShareBuckets())
+        return;
+
+    Must(!SharedBuckets);
+    SharedBuckets = new Ipc::TokenBuckets(SharedBucketsLabel);
+}
+
+DelayBucketsRr::~DelayBucketsRr()
+{
+    delete SharedBuckets;
+    SharedBuckets = NULL;
+    delete owner;
+}
+
+uint64_t
+DelayPools::SharedKeys(unsigned short pool, unsigned char node)
+{
+    // the top byte distinguishes delay_pools from client_delay_pools keys;
+    // the low 32 bits are left for the node to identify its buckets
+    return (static_cast<uint64_t>(1) << 56) |
+           (static_cast<uint64_t>(pool) << 40) |
+           (static_cast<uint64_t>(node) << 32);
+}
+
+Ipc::TokenBucket *
+DelayPools::SharedBucket(const uint64_t key, const int initialLevel)
+{
+    if (!SharedBuckets)
+        return NULL;
+
+    Ipc::TokenBucket *bucket = SharedBuckets->bucket(key, initialLevel,
+                               static_cast<int64_t>(current_dtime * 1000));
+    if (!bucket) {
+        static time_t lastWarning = 0;
+        if (lastWarning + 3600 < squid_curtime) {
+            debugs(77, DBG_IMPORTANT, "WARNING: out of shared delay buckets; " <<
+                   "some delay pool limits are enforced per worker. Consider " <<
+                   "increasing delay_pool_shared_buckets.");
+            lastWarning = squid_curtime;
+        }
+    }
+    return bucket;
+}
+
 void
 DelayPools::RegisterWithCacheManager(void)
 {
@@ -649,6 +759,11 @@ DelayPools::Stats(StoreEntry * sentry)
     }
 
     storeAppendPrintf(sentry, "Memory Used: %d bytes\n", (int) DelayPools::MemoryUsed);
+
+    if (SharedBuckets) {
+        storeAppendPrintf(sentry, "Shared buckets: %d of %d used\n",
+                          SharedBuckets->entryCount(), SharedBuckets->entryLimit());
+    }
 }
 
 void
@@ -719,7 +834,7 @@ IndividualPool::operator delete (void *address)
     ::operator delete (address);
 }
 
-VectorPool::VectorPool()
+VectorPool::VectorPool(const uint64_t keys): sharedKeys(keys)
 {
     DelayPools::registerForUpdates (this);
 }
@@ -821,6 +936,7 @@ VectorPool::id(CompositeSelectionDetails &details)
     unsigned char const resultIndex = buckets.insert(key);
 
     buckets.values[resultIndex].init(*rate());
+    buckets.values[resultIndex].share(sharedKeys | key);
 
     return new Id(this, resultIndex);
 }
@@ -892,7 +1008,7 @@ ClassCNetPool::makeKey(Ip::Address &src_addr) const
     return ( (ntohl(net.s_addr) >> 8) & 0xff);
 }
 
-ClassCHostPool::ClassCHostPool()
+ClassCHostPool::ClassCHostPool(const uint64_t keys): sharedKeys(keys)
 {
     DelayPools::registerForUpdates (this);
 }
@@ -1001,6 +1117,7 @@ ClassCHostPool::id(CompositeSelectionDetails &details)
         netIndex = buckets.insert (key);
 
     hostIndex = buckets.values[netIndex].hostPosition (*rate(), host);
+    buckets.values[netIndex].individuals.values[hostIndex].share(sharedKeys | (key << 8) | host);
 
     return new Id (this, netIndex, hostIndex);
 }
@@ -251,7 +251,12 @@ enum {
     PCTILE_MISS,
     PCTILE_NM,
     PCTILE_NH,
-    PCTILE_ICP_REPLY
+    PCTILE_ICP_REPLY,
+    PCTILE_SERVER,
+    PCTILE_ICAP,
+    PCTILE_DISK,
+    PCTILE_ACCEPT,
+    PCTILE_END
 };
 
 enum {
@@ -323,6 +328,13 @@ enum {
     DISABLE_PMTU_TRANSPARENT
 };
 
+/// how SMP kids listen on an http(s)_port
+enum {
+    REUSEPORT_OFF, ///< Coordinator shares one listening socket with all kids
+    REUSEPORT_ON, ///< each kid listens on its own SO_REUSEPORT socket
+    REUSEPORT_CPU ///< REUSEPORT_ON plus steering connections by CPU
+};
+
 #if USE_HTCP
 /*
  * TODO: This should be in htcp.h
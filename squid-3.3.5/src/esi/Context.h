@@ -65,6 +65,8 @@ public:
             reading_(true),
             processing(false) {
         memset(&flags, 0, sizeof(flags));
+        started.tv_sec = 0;
+        started.tv_usec = 0;
     }
 
     ~ESIContext();
@@ -161,9 +163,12 @@ public:
 
     bool cachedASTInUse;
 
+    struct timeval started; /* when the template reply reached us */
+
 private:
     void fail ();
     void freeResources();
+    void updateLogEntry();
     void fixupOutboundTail();
     void trimBlanks();
     size_t send ();
@@ -61,6 +61,7 @@
 #include "MemBuf.h"
 #include "profiler/Profiler.h"
 #include "SquidConfig.h"
+#include "SquidTime.h"
 
 /* quick reference on behaviour here.
  * The ESI specification 1.0 requires the ESI processor to be able to
@@ -660,7 +661,7 @@ ESIContext::send ()
     debugs(86, 5, "ESIContext::send: this=" << this << " Client no longer wants data ");
     /* Deal with re-entrancy */
     HttpReply *temprep = rep;
-    rep = NULL; /* freed downstream */
+    rep = NULL; /* unlocked below, once downstream has it */
 
     if (temprep && varState)
         varState->buildVary (temprep);
@@ -673,6 +674,9 @@ ESIContext::send ()
         clientStreamCallback (thisNode, http, temprep, tempBuffer);
     }
 
+    /* downstream nodes lock the reply for as long as they need it */
+    HTTPMSGUNLOCK(temprep);
+
     if (len == 0)
         len = 1; /* tell the caller we sent something (because we sent headers */
 
@@ -885,7 +889,8 @@ ESIContextNew (HttpReply *rep, clientStreamNode *thisNode, ClientHttpRequest *ht
 {
     assert (rep);
     ESIContext *rv = new ESIContext;
-    rv->rep = rep;
+    /* locked until sent downstream or freed on abort */
+    rv->rep = HTTPMSGLOCK(rep);
     rv->cbdataLocker = rv;
 
     if (esiAlwaysPassthrough(rep->sline.status)) {
@@ -903,6 +908,7 @@ ESIContextNew (HttpReply *rep, clientStreamNode *thisNode, ClientHttpRequest *ht
         rv->http = http;
         rv->flags.clientwantsdata = 1;
         rv->varState = new ESIVarState (&http->request->header, http->uri);
+        rv->started = current_time;
         debugs(86, 5, "ESIContextNew: Client wants data (always created during reply cycle");
     }
 
@@ -1408,6 +1414,7 @@ ESIContext::process ()
             /* we've finished all processing. Render and send. */
             debugs(86, 5, "esiProcess, processing complete");
             flags.finished = 1;
+            updateLogEntry();
         }
 
         PROF_stop(esiProcessing);
@@ -1446,6 +1453,11 @@ ESIContext::freeResources ()
     ESISegmentFreeList (buffered);
     ESISegmentFreeList (outbound);
     ESISegmentFreeList (outboundtail);
+
+    /* queued includes keep our varState allocated */
+    if (varState)
+        varState->includes.clear();
+
     delete varState;
     varState=NULL;
     /* don't touch incoming, it's a pointer into buffered anyway */
@@ -1453,6 +1465,23 @@ ESIContext::freeResources ()
 
 ErrorState *clientBuildError (err_type, http_status, char const *, Ip::Address &, HttpRequest *);
 
+/* record the page processing time and include fetches for access.log */
+void
+ESIContext::updateLogEntry()
+{
+    if (!http || http->al == NULL || !varState)
+        return;
+
+    AccessLogEntry::EsiDetails &esi = http->al->esi;
+    esi.processingTime = tvSubMsec(started, current_time);
+    esi.includes = varState->includes.started;
+    esi.peakIncludes = varState->includes.peak;
+    esi.waitedIncludes = varState->includes.waited;
+    debugs(86, 5, "ESIContext::updateLogEntry: " << esi.processingTime << "ms, " <<
+           esi.includes << " includes, " << esi.peakIncludes << " at once, " <<
+           esi.waitedIncludes << " waited");
+}
+
 /* This can ONLY be used before we have sent *any* data to the client */
 void
 ESIContext::fail ()
@@ -1460,6 +1489,7 @@ ESIContext::fail ()
     debugs(86, 5, "ESIContext::fail: this=" << this);
     /* check preconditions */
     assert (pos == 0);
+    updateLogEntry();
     /* cleanup current state */
     freeResources ();
     /* Stop altering thisNode request */
@@ -1472,7 +1502,7 @@ ESIContext::fail ()
     ErrorState * err = clientBuildError(errorpage, errorstatus, NULL, http->getConn()->clientConnection->remote, http->request);
     err->err_msg = errormessage;
     errormessage = NULL;
-    rep = err->BuildHttpReply();
+    rep = HTTPMSGLOCK(err->BuildHttpReply());
     assert (rep->body.hasContent());
     size_t errorprogress = rep->body.contentSize();
     /* Tell esiSend where to start sending from */
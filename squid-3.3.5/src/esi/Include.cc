@@ -305,7 +305,8 @@ ESIInclude::ESIInclude(ESIInclude const &old) :
         alturl(NULL),
         parent(NULL),
         started(false),
-        sent(false)
+        sent(false),
+        fetching(false)
 {
     memset(&flags, 0, sizeof(flags));
     flags.onerrorcontinue = old.flags.onerrorcontinue;
@@ -356,7 +357,8 @@ ESIInclude::ESIInclude(esiTreeParentPtr aParent, int attrcount, char const **att
         alturl(NULL),
         parent(aParent),
         started(false),
-        sent(false)
+        sent(false),
+        fetching(false)
 {
     assert (aContext);
     memset(&flags, 0, sizeof(flags));
@@ -410,8 +412,8 @@ ESIInclude::start()
     started = true;
 
     if (src.getRaw()) {
-        Start (src, srcurl, varState);
-        Start (alt, alturl, varState);
+        /* fetched now or when the page has a free fetch slot */
+        varState->includes.schedule(this);
     } else {
         alt = NULL;
 
@@ -421,6 +423,24 @@ ESIInclude::start()
     }
 }
 
+bool
+ESIInclude::fetchable() const
+{
+    /* a queued include may be discarded by its esi:try or esi:choose */
+    return parent.getRaw() != NULL && dataNeeded();
+}
+
+void
+ESIInclude::fetch()
+{
+    /* prevent freeing ourselves if the fetch completes immediately */
+    ESIIncludePtr foo(this);
+
+    fetching = true;
+    Start (src, srcurl, varState);
+    Start (alt, alturl, varState);
+}
+
 void
 ESIInclude::render(ESISegment::Pointer output)
 {
@@ -553,6 +573,14 @@ ESIInclude::subRequestDone (ESIStreamContext::Pointer stream, bool success)
     }
 
     if (flags.finished || flags.failed) {
+        /* let the next waiting include of the page fetch */
+        if (fetching) {
+            fetching = false;
+
+            if (cbdataReferenceValid(varState))
+                varState->includes.release();
+        }
+
         /* Kick ESI Processor */
         debugs (86, 5, "ESIInclude " << this <<
                 " SubRequest " << stream.getRaw() <<
@@ -90,12 +90,17 @@ public:
     void includeFail(ESIStreamContext::Pointer);
     void finish();
 
+    /* used by ESIIncludeQueue */
+    bool fetchable() const;
+    void fetch();
+
 private:
     void Start (ESIStreamContext::Pointer, char const *, ESIVarState *);
     esiTreeParentPtr parent;
     void start();
     bool started;
     bool sent;
+    bool fetching; /* holds an ESIIncludeQueue slot */
     ESIInclude(ESIInclude const &);
     bool dataNeeded() const;
     void prepareRequestHeaders(HttpHeader &tempheaders, ESIVarState *vars);
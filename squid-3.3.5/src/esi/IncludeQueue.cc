@@ -0,0 +1,109 @@
+/*
+ * DEBUG: section 86    ESI processing
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+
+/* MS Visual Studio Projects are monolithic, so we need the following
+ * #if to exclude the ESI code from compile process when not needed.
+ */
+#if (USE_SQUID_ESI == 1)
+
+#include "client_side_request.h"
+#include "Debug.h"
+#include "esi/Include.h"
+#include "esi/IncludeQueue.h"
+
+int ESIIncludeQueue::MaxParallel = 0;
+
+ESIIncludeQueue::ESIIncludeQueue() :
+        started(0),
+        peak(0),
+        waited(0),
+        fetching(0)
+{}
+
+ESIIncludeQueue::~ESIIncludeQueue()
+{
+    clear();
+}
+
+void
+ESIIncludeQueue::schedule(const RefCount<ESIInclude> &include)
+{
+    if (full() || !waiting.empty()) {
+        debugs(86, 5, "ESIIncludeQueue::schedule: include " << include.getRaw() <<
+               " waits; " << fetching << " fetching, " << waiting.size() << " waiting");
+        waiting.push_back(include);
+        ++waited;
+        return;
+    }
+
+    launch(include);
+}
+
+void
+ESIIncludeQueue::release()
+{
+    assert (fetching > 0);
+    --fetching;
+
+    while (!full() && !waiting.empty()) {
+        RefCount<ESIInclude> include = waiting.front();
+        waiting.pop_front();
+        launch(include);
+    }
+}
+
+void
+ESIIncludeQueue::clear()
+{
+    waiting.clear();
+}
+
+void
+ESIIncludeQueue::launch(const RefCount<ESIInclude> &include)
+{
+    if (!include->fetchable()) {
+        debugs(86, 5, "ESIIncludeQueue::launch: include " << include.getRaw() << " is no longer needed");
+        return;
+    }
+
+    /* count the slot first: the fetch may complete and release() it at once */
+    ++fetching;
+    ++started;
+
+    if (fetching > peak)
+        peak = fetching;
+
+    include->fetch();
+}
+
+#endif /* USE_SQUID_ESI == 1 */
@@ -0,0 +1,79 @@
+/*
+ * DEBUG: section 86    ESI processing
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_ESIINCLUDEQUEUE_H
+#define SQUID_ESIINCLUDEQUEUE_H
+
+#include "RefCount.h"
+
+#include <deque>
+
+class ESIInclude;
+
+/**
+ * Limits how many esi:include elements of one ESI page fetch their content
+ * at the same time. Every include in a processed template, freshly parsed
+ * or from the cached element tree, asks to be fetched in document order;
+ * fetches beyond esi_max_parallel_includes wait here until an earlier
+ * include completes. Completed includes may finish in any order: their
+ * sequence keeps the content until everything before it is rendered.
+ */
+class ESIIncludeQueue
+{
+
+public:
+    ESIIncludeQueue();
+    ~ESIIncludeQueue();
+
+    /// fetches the include now or once an earlier include completes
+    void schedule(const RefCount<ESIInclude> &include);
+
+    /// an include has stopped fetching; starts the next waiting one
+    void release();
+
+    /// forgets waiting includes; they reference the page being freed
+    void clear();
+
+    static int MaxParallel; ///< esi_max_parallel_includes, zero for no limit
+
+    int started; ///< includes that started fetching
+    int peak; ///< the most includes fetching at the same time
+    int waited; ///< includes that had to wait for a fetch slot
+
+private:
+    bool full() const { return MaxParallel > 0 && fetching >= MaxParallel; }
+    void launch(const RefCount<ESIInclude> &include);
+
+    int fetching; ///< includes fetching now
+    std::deque<RefCount<ESIInclude> > waiting; ///< in document order
+};
+
+#endif /* SQUID_ESIINCLUDEQUEUE_H */
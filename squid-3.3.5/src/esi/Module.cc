@@ -2,11 +2,13 @@
 #include "esi/Module.h"
 #include "esi/CustomParser.h"
 #include "esi/Libxml2Parser.h"
+#include "esi/StreamParser.h"
 /* include for esi/ExpatParser.h must follow esi/Libxml2Parser.h */
 /* do not remove this comment, as it acts as barrier for the autmatic sorting */
 #include "esi/ExpatParser.h"
 
 static ESIParser::Register *prCustom = 0;
+static ESIParser::Register *prStream = 0;
 #if HAVE_LIBXML2
 static ESIParser::Register *prLibxml = 0;
 #endif
@@ -19,6 +21,7 @@ void Esi::Init()
     assert(!prCustom); // we should be called once
 
     prCustom = new ESIParser::Register("custom", &ESICustomParser::NewParser);
+    prStream = new ESIParser::Register("stream", &ESIStreamParser::NewParser);
 
 #if HAVE_LIBXML2
     prLibxml = new ESIParser::Register("libxml2", &ESILibxml2Parser::NewParser);
@@ -43,6 +46,9 @@ void Esi::Clean()
     prLibxml = NULL;
 #endif
 
+    delete prStream;
+    prStream = NULL;
+
     delete prCustom;
     prCustom = NULL;
 }
@@ -0,0 +1,418 @@
+
+/*
+ * DEBUG: section 86    ESI processing
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Array.h"
+#include "Debug.h"
+#include "esi/StreamParser.h"
+#include "fatal.h"
+
+EsiParserDefinition(ESIStreamParser);
+
+/* the longest ESI tag or comment kept while waiting for its end */
+static const mb_size_t MaxPendingMarkup = 1024 * 1024;
+
+ESIStreamParser::ESIStreamParser(ESIParserClient *aClient) :
+        theClient(aClient),
+        pendingScanned(0),
+        openESITags(0)
+{}
+
+ESIStreamParser::~ESIStreamParser()
+{
+    theClient = NULL;
+
+    if (!pending.isNull())
+        pending.clean();
+}
+
+/* a terminated copy of the unterminated input; free with xfree() */
+static char *
+TerminatedCopy(char const *start, size_t len)
+{
+    char *copy = static_cast<char *>(xmalloc(len + 1));
+    memcpy(copy, start, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+/* matches s against the markup start, which may be cut short by the buffer end */
+static bool
+MarkupStarts(char const *s, size_t len, char const *markup, size_t markupLen, bool &partial)
+{
+    const size_t n = min(len, markupLen);
+
+    if (strncasecmp(s, markup, n) != 0)
+        return false;
+
+    if (n < markupLen) {
+        partial = true;
+        return false;
+    }
+
+    return true;
+}
+
+/* s points at a '<' */
+ESIStreamParser::Markup
+ESIStreamParser::Classify(char const *s, size_t len)
+{
+    bool partial = false;
+
+    if (MarkupStarts(s, len, "<esi:", 5, partial))
+        return mkTag;
+
+    if (MarkupStarts(s, len, "</esi:", 6, partial))
+        return mkEndTag;
+
+    if (MarkupStarts(s, len, "<!--", 4, partial))
+        return mkComment;
+
+    return partial ? mkPartial : mkNone;
+}
+
+/* the "-->" at or after s, or NULL */
+char const *
+ESIStreamParser::FindCommentEnd(char const *s, char const *end)
+{
+    while (end - s >= 3) {
+        s = static_cast<char const *>(memchr(s, '-', end - s - 2));
+
+        if (!s)
+            return NULL;
+
+        if (s[1] == '-' && s[2] == '>')
+            return s;
+
+        ++s;
+    }
+
+    return NULL;
+}
+
+bool
+ESIStreamParser::parse(char const *dataToParse, size_t const lengthOfData, bool const endOfStream)
+{
+    size_t consumed = 0;
+
+    if (pending.isNull() || !pending.contentSize()) {
+        if (!scan(dataToParse, lengthOfData, endOfStream, consumed))
+            return false;
+
+        if (consumed < lengthOfData && !keep(dataToParse + consumed, lengthOfData - consumed))
+            return false;
+    } else {
+        debugs(86, 9, "ESIStreamParser::parse: completing " << pending.contentSize() << " pending bytes");
+
+        if (!keep(dataToParse, lengthOfData))
+            return false;
+
+        if (!scan(pending.content(), pending.contentSize(), endOfStream, consumed))
+            return false;
+
+        pending.consume(consumed);
+    }
+
+    if (!endOfStream)
+        return true;
+
+    debugs(86, 5, "ESIStreamParser::parse: Finished parsing, will return " << !openESITags);
+
+    if (openESITags)
+        error = "ESI Tags still open";
+
+    return !openESITags;
+}
+
+/* appends unparsed input to the split markup kept in pending */
+bool
+ESIStreamParser::keep(char const *data, size_t len)
+{
+    if (pending.isNull())
+        pending.init(2 * 1024, MaxPendingMarkup);
+
+    if (len > static_cast<size_t>(pending.potentialSpaceSize())) {
+        debugs(86, 3, "ESIStreamParser::keep: markup exceeds " << MaxPendingMarkup << " bytes");
+        error = "ESI tag or comment too long";
+        return false;
+    }
+
+    pending.append(data, len);
+    return true;
+}
+
+/*
+ * Hands everything up to the next ESI tag or comment to the client as one
+ * literal. Markup that does not end in this buffer is left unconsumed.
+ * When buf is the pending markup, the search for its end resumes where the
+ * previous scan stopped.
+ */
+bool
+ESIStreamParser::scan(char const *buf, size_t size, bool const endOfStream, size_t &consumed)
+{
+    char const *const end = buf + size;
+    char const *literalStart = buf;
+    char const *pos = buf;
+    /* where the end of markup starting at buf may be */
+    char const *const resume = buf == pending.content() ? buf + pendingScanned : buf;
+    pendingScanned = 0;
+
+    while (pos < end) {
+        char const *tag = static_cast<char const *>(memchr(pos, '<', end - pos));
+
+        if (!tag)
+            break;
+
+        const Markup markup = Classify(tag, end - tag);
+
+        if (markup == mkNone) {
+            pos = tag + 1;
+            continue;
+        }
+
+        char const *tagEnd = NULL;
+        char const *from = tag == buf ? resume : tag;
+
+        if (markup == mkComment)
+            tagEnd = FindCommentEnd(max(from, tag + 4), end);
+        else if (markup != mkPartial)
+            tagEnd = static_cast<char const *>(memchr(from, '>', end - from));
+
+        if (!tagEnd) {
+            if (!endOfStream) {
+                /* wait for the rest of the markup; a "-->" may straddle
+                 * the buffer end, so the next search backs up two bytes */
+                literal(literalStart, tag);
+                consumed = tag - buf;
+
+                if (markup != mkPartial && end - tag > 2)
+                    pendingScanned = end - tag - 2;
+
+                return true;
+            }
+
+            if (markup == mkPartial) {
+                /* a literal '<' near the end of the document */
+                pos = tag + 1;
+                continue;
+            }
+
+            error = markup == mkComment ? "missing end of comment" :
+                    "Could not find end ('>') of tag";
+            return false;
+        }
+
+        literal(literalStart, tag);
+
+        switch (markup) {
+
+        case mkTag:
+            if (!startTag(tag, tagEnd))
+                return false;
+
+            pos = tagEnd + 1;
+            break;
+
+        case mkEndTag:
+            if (!endTag(tag, tagEnd))
+                return false;
+
+            pos = tagEnd + 1;
+            break;
+
+        case mkComment:
+            comment(tag + 4, tagEnd);
+            pos = tagEnd + 3;
+            break;
+
+        default:
+            fatal ("unknown ESI markup type found");
+        }
+
+        literalStart = pos;
+    }
+
+    literal(literalStart, end);
+    consumed = size;
+    return true;
+}
+
+void
+ESIStreamParser::literal(char const *start, char const *end)
+{
+    if (end > start)
+        theClient->parserDefault(start, end - start);
+}
+
+/* tag points at "<esi:" and tagEnd at the closing '>' */
+bool
+ESIStreamParser::startTag(char const *tag, char const *tagEnd)
+{
+    /* the client wants terminated names and values; parse a copy */
+    const size_t len = tagEnd - tag;
+    char *copy = TerminatedCopy(tag, len);
+
+    const bool selfClosing = len > 0 && copy[len - 1] == '/';
+    char *copyEnd = copy + len;
+
+    if (selfClosing)
+        *--copyEnd = '\0';
+
+    char *endofName = copy + strcspn(copy, w_space);
+
+    if (endofName > copyEnd)
+        endofName = copyEnd;
+
+    char *attribute = endofName;
+
+    if (attribute < copyEnd)
+        ++attribute;
+
+    *endofName = '\0';
+
+    Vector<char *>attributes;
+
+    while (attribute < copyEnd) {
+        /* leading spaces */
+
+        while (attribute < copyEnd && (xisspace(*attribute) || (*attribute == '/')))
+            ++attribute;
+
+        if (! (attribute < copyEnd))
+            break;
+
+        /* attribute name */
+        attributes.push_back(attribute);
+
+        char *nextSpace = strpbrk(attribute, w_space);
+
+        char *equals = strchr(attribute, '=');
+
+        if (!equals) {
+            error = "Missing attribute value.";
+            xfree(copy);
+            return false;
+        }
+
+        if (nextSpace && nextSpace < equals)
+            *nextSpace = '\0';
+        else
+            *equals = '\0';
+
+        ++equals;
+
+        while (equals < copyEnd && xisspace(*equals))
+            ++equals;
+
+        char sep = *equals;
+
+        if (sep != '\'' && sep != '"') {
+            error = "Unknown identifier (";
+            error.append (sep);
+            error.append (")");
+            xfree(copy);
+            return false;
+        }
+
+        char *value = equals + 1;
+        char *end = strchr(value, sep);
+
+        if (!end) {
+            error = "Missing attribute ending separator (";
+            error.append(sep);
+            error.append(")");
+            xfree(copy);
+            return false;
+        }
+
+        attributes.push_back(value);
+        *end = '\0';
+        attribute = end + 1;
+    }
+
+    theClient->start (copy + 1, (const char **)attributes.items, attributes.size() >> 1);
+
+    if (selfClosing)
+        theClient->end (copy + 1);
+    else
+        ++openESITags;
+
+    xfree(copy);
+    return true;
+}
+
+/* tag points at "</esi:" and tagEnd at the closing '>' */
+bool
+ESIStreamParser::endTag(char const *tag, char const *tagEnd)
+{
+    if (!openESITags) {
+        error = "Unexpected end tag";
+        return false;
+    }
+
+    char const *nameEnd = tag + 2;
+
+    while (nameEnd < tagEnd && !xisspace(*nameEnd))
+        ++nameEnd;
+
+    char *name = TerminatedCopy(tag + 2, nameEnd - tag - 2);
+    theClient->end (name);
+    xfree(name);
+
+    --openESITags;
+    return true;
+}
+
+/* start follows "<!--" and end points at "-->" */
+void
+ESIStreamParser::comment(char const *start, char const *end)
+{
+    char *text = TerminatedCopy(start, end - start);
+    theClient->parserComment (text);
+    xfree(text);
+}
+
+long int
+ESIStreamParser::lineNumber() const
+{
+    /* We don't track lines in the body */
+    return 0;
+}
+
+char const *
+ESIStreamParser::errorString() const
+{
+    if (error.size())
+        return error.termedBuf();
+    else
+        return "Parsing error strings not implemented";
+}
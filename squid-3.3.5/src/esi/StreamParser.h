@@ -0,0 +1,91 @@
+/*
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+#ifndef SQUID_ESISTREAMPARSER_H
+#define SQUID_ESISTREAMPARSER_H
+
+/* inherits from */
+#include "esi/Parser.h"
+
+#include "MemBuf.h"
+/* for String variables */
+#include "SquidString.h"
+
+/**
+ \ingroup ESIAPI
+ *
+ * Accepts the same markup as ESICustomParser, but parses each buffer as it
+ * arrives instead of collecting the whole document first. Literal runs are
+ * located with memchr(3), which the C library vectorizes, and handed to the
+ * client straight from the input buffer. Only an ESI tag or comment split
+ * across buffers is kept until the rest of it arrives, and parsing fails
+ * if it grows beyond MaxPendingMarkup bytes.
+ */
+class ESIStreamParser : public ESIParser
+{
+
+public:
+    ESIStreamParser(ESIParserClient *);
+    ~ESIStreamParser();
+    /* true on success */
+    bool parse(char const *dataToParse, size_t const lengthOfData, bool const endOfStream);
+    long int lineNumber() const;
+    char const * errorString() const;
+
+    EsiParserDeclaration;
+
+private:
+    enum Markup {
+        mkNone,     /* not ESI markup */
+        mkPartial,  /* too short to tell yet */
+        mkTag,
+        mkEndTag,
+        mkComment
+    };
+
+    static Markup Classify(char const *s, size_t len);
+    static char const *FindCommentEnd(char const *s, char const *end);
+
+    bool scan(char const *buf, size_t size, bool const endOfStream, size_t &consumed);
+    bool keep(char const *data, size_t len);
+    void literal(char const *start, char const *end);
+    bool startTag(char const *tag, char const *tagEnd);
+    bool endTag(char const *tag, char const *tagEnd);
+    void comment(char const *start, char const *end);
+
+    ESIParserClient *theClient;
+    String error;
+    /* unparsed tail of the previous buffer: the start of split markup */
+    MemBuf pending;
+    /* how much of pending is known not to hold the end of its markup */
+    size_t pendingScanned;
+    size_t openESITags;
+};
+
+#endif /* SQUID_ESISTREAMPARSER_H */
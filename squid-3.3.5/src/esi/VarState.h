@@ -32,6 +32,7 @@
 #ifndef SQUID_ESIVARSTATE_H
 #define SQUID_ESIVARSTATE_H
 
+#include "esi/IncludeQueue.h"
 #include "esi/Segment.h"
 #include "Trie.h"
 #include "Array.h"
@@ -81,6 +82,8 @@ public:
     ESISegment::Pointer &getOutput();
     HttpHeader &header();
 
+    ESIIncludeQueue includes; /* esi:include fetches of this page */
+
 private:
     ESISegment::Pointer input;
     ESISegment::Pointer output;
@@ -48,7 +48,6 @@
 #endif
 
 int default_read_method(int, char *, int);
-int default_write_method(int, const char *, int);
 #if _SQUID_MSWIN_
 int socket_read_method(int, char *, int);
 int socket_write_method(int, const char *, int);
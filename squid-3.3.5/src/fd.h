@@ -40,5 +40,6 @@ void fd_bytes(int fd, int len, unsigned int type);
 void fdDumpOpen(void);
 int fdUsageHigh(void);
 void fdAdjustReserved(void);
+int default_write_method(int, const char *, int);
 
 #endif /* SQUID_FD_H_ */
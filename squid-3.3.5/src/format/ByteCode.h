@@ -143,6 +143,15 @@ typedef enum {
     LFT_TOTAL_SERVER_SIDE_RESPONSE_TIME,
     LFT_DNS_WAIT_TIME,
 
+    /* transaction phase times, in PhaseTimes::Phase order */
+    LFT_PHASE_ACL,
+    LFT_PHASE_ADAPTATION,
+    LFT_PHASE_STORE,
+    LFT_PHASE_PEER_SELECT,
+    LFT_PHASE_DNS,
+    LFT_PHASE_CONNECT,
+    LFT_PHASE_SERVER,
+
     /* Squid internal processing details */
     LFT_SQUID_STATUS,
     LFT_SQUID_ERROR,
@@ -190,6 +199,13 @@ typedef enum {
     LFT_ICAP_STATUS_CODE,
 #endif
 
+#if USE_SQUID_ESI
+    LFT_ESI_TOTAL_TIME,
+    LFT_ESI_INCLUDES,
+    LFT_ESI_PEAK_INCLUDES,
+    LFT_ESI_WAITED_INCLUDES,
+#endif
+
 #if USE_SSL
     LFT_SSL_BUMP_MODE,
     LFT_SSL_USER_CERT_SUBJECT,
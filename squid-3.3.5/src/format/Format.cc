@@ -497,6 +497,22 @@ Format::Format::assemble(MemBuf &mb, const AccessLogEntry::Pointer &al, int logS
             }
             break;
 
+        case LFT_PHASE_ACL:
+        case LFT_PHASE_ADAPTATION:
+        case LFT_PHASE_STORE:
+        case LFT_PHASE_PEER_SELECT:
+        case LFT_PHASE_DNS:
+        case LFT_PHASE_CONNECT:
+        case LFT_PHASE_SERVER: {
+            const PhaseTimes::Phase phase =
+                static_cast<PhaseTimes::Phase>(fmt->type - LFT_PHASE_ACL);
+            if (al->phases.happened(phase)) {
+                outoff = al->phases.usec(phase);
+                dooff = 1;
+            }
+        }
+        break;
+
         case LFT_REQUEST_HEADER:
 
             if (al->request)
@@ -708,6 +724,37 @@ Format::Format::assemble(MemBuf &mb, const AccessLogEntry::Pointer &al, int logS
             doint = 1;
             break;
 #endif
+
+#if USE_SQUID_ESI
+        case LFT_ESI_TOTAL_TIME:
+            if (al->esi.processingTime >= 0) {
+                outint = al->esi.processingTime;
+                doint = 1;
+            }
+            break;
+
+        case LFT_ESI_INCLUDES:
+            if (al->esi.processingTime >= 0) {
+                outint = al->esi.includes;
+                doint = 1;
+            }
+            break;
+
+        case LFT_ESI_PEAK_INCLUDES:
+            if (al->esi.processingTime >= 0) {
+                outint = al->esi.peakIncludes;
+                doint = 1;
+            }
+            break;
+
+        case LFT_ESI_WAITED_INCLUDES:
+            if (al->esi.processingTime >= 0) {
+                outint = al->esi.waitedIncludes;
+                doint = 1;
+            }
+            break;
+#endif
+
         case LFT_REQUEST_HEADER_ELEM:
             if (al->request)
                 sb = al->request->header.getByNameListMember(fmt->data.header.header, fmt->data.header.element, fmt->data.header.separator);
@@ -188,6 +188,29 @@ static TokenTableEntry TokenTableIcap[] = {
 };
 #endif
 
+#if USE_SQUID_ESI
+/// ESI (esi::) tokens
+static TokenTableEntry TokenTableEsi[] = {
+    {"tt", LFT_ESI_TOTAL_TIME},
+    {"inc_peak", LFT_ESI_PEAK_INCLUDES},
+    {"inc_wait", LFT_ESI_WAITED_INCLUDES},
+    {"inc", LFT_ESI_INCLUDES},
+    {NULL, LFT_NONE}           /* this must be last */
+};
+#endif
+
+/// transaction phase time (phase::) tokens
+static TokenTableEntry TokenTablePhase[] = {
+    {"acl", LFT_PHASE_ACL},
+    {"adapt", LFT_PHASE_ADAPTATION},
+    {"store", LFT_PHASE_STORE},
+    {"peer", LFT_PHASE_PEER_SELECT},
+    {"dns", LFT_PHASE_DNS},
+    {"connect", LFT_PHASE_CONNECT},
+    {"server", LFT_PHASE_SERVER},
+    {NULL, LFT_NONE}           /* this must be last */
+};
+
 #if USE_SSL
 // SSL (ssl::) tokens
 static TokenTableEntry TokenTableSsl[] = {
@@ -212,6 +235,10 @@ Format::Token::Init()
 #if ICAP_CLIENT
     TheConfig.registerTokens(String("icap"),::Format::TokenTableIcap);
 #endif
+#if USE_SQUID_ESI
+    TheConfig.registerTokens(String("esi"),::Format::TokenTableEsi);
+#endif
+    TheConfig.registerTokens(String("phase"),::Format::TokenTablePhase);
 #if USE_SSL
     TheConfig.registerTokens(String("ssl"),::Format::TokenTableSsl);
 #endif
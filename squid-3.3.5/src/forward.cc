@@ -75,6 +75,7 @@
 #include "ssl/support.h"
 #include "ssl/ErrorDetail.h"
 #include "ssl/ServerBump.h"
+#include "ssl/SessionCache.h"
 #endif
 #if HAVE_ERRNO_H
 #include <errno.h>
@@ -92,6 +93,17 @@ static OBJH fwdStats;
 #define MAX_FWD_STATS_IDX 9
 static int FwdReplyCodes[MAX_FWD_STATS_IDX + 1][HTTP_INVALID_HEADER + 1];
 
+/// Happy Eyeballs connection racing statistics
+static struct {
+    int started; ///< spare connections opened
+    int wonByIpv4; ///< races won by an IPv4 spare
+    int wonByIpv6; ///< races won by an IPv6 spare
+    int lost; ///< spares abandoned because the primary connected first
+    int failed; ///< spares that failed to connect
+    double savedMsec; ///< lower bound of the time saved by spare wins
+    double savedMsecMax; ///< the time saved if all losers would time out
+} RaceStats;
+
 static PconnPool *fwdPconnPool = new PconnPool("server-side");
 CBDATA_CLASS_INIT(FwdState);
 
@@ -109,6 +121,7 @@ FwdState::abort(void* d)
     } else {
         debugs(17, 7, HERE << "store entry aborted; no connection to close");
     }
+    fwd->cancelSpare("store entry aborted");
     fwd->serverDestinations.clean();
     fwd->self = NULL;
 }
@@ -123,6 +136,7 @@ FwdState::FwdState(const Comm::ConnectionPointer &client, StoreEntry * e, HttpRe
     clientConn = client;
     request = HTTPMSGLOCK(r);
     pconnRace = raceImpossible;
+    race.waiting = false;
     start_t = squid_curtime;
     serverDestinations.reserve(Config.forward_max_tries);
     e->lock();
@@ -262,6 +276,8 @@ FwdState::~FwdState()
 
     entry = NULL;
 
+    cancelSpare("FwdState destructed");
+
     if (calls.connector != NULL) {
         calls.connector->cancel("FwdState destructed");
         calls.connector = NULL;
@@ -769,6 +785,12 @@ FwdState::negotiateSSL(int fd)
         serverConnection()->getPeer()->sslSession = SSL_get1_session(ssl);
     }
 
+    // Do not share sessions with certificate errors: resuming them would
+    // bypass sslproxy_cert_error checks.
+    if (!serverConnection()->getPeer() && !SSL_session_reused(ssl) &&
+            !SSL_get_ex_data(ssl, ssl_ex_index_ssl_errors))
+        Ssl::SessionCache::PutOriginSession(request->GetHost(), request->port, SSL_get_session(ssl));
+
     dispatch();
 }
 
@@ -832,6 +854,11 @@ FwdState::initiateSSL()
         // to the origin server and we know the server host name.
         if (!hostnameIsIp)
             Ssl::setClientSNI(ssl, hostname);
+
+        if (SSL_SESSION *session = Ssl::SessionCache::GetOriginSession(hostname, request->port)) {
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+        }
     }
 
     // Create the ACL check list now, while we have access to more info.
@@ -861,6 +888,14 @@ FwdState::initiateSSL()
 void
 FwdState::connectDone(const Comm::ConnectionPointer &conn, comm_err_t status, int xerrno)
 {
+    if (race.spare != NULL && conn == race.spare) {
+        spareConnectDone(conn, status);
+        return;
+    }
+
+    calls.connector = NULL;
+    race.opener.clear();
+
     if (status != COMM_OK) {
         ErrorState *const anErr = makeConnectingError(ERR_CONNECT_FAIL);
         anErr->xerrno = xerrno;
@@ -873,10 +908,24 @@ FwdState::connectDone(const Comm::ConnectionPointer &conn, comm_err_t status, in
 
             conn->close();
         }
+
+        // keep waiting for the spare instead of starting a new connection
+        if (calls.spareConnector != NULL) {
+            promoteSpare();
+            return;
+        }
+
+        request->phases.stop(PhaseTimes::phConnect);
+        cancelSpare("primary connection failed");
         retryOrBail();
         return;
     }
 
+    request->phases.stop(PhaseTimes::phConnect);
+    if (calls.spareConnector != NULL)
+        ++RaceStats.lost;
+    cancelSpare("primary connection won");
+
     serverConn = conn;
     flags.connected_okay = true;
 
@@ -1062,12 +1111,206 @@ FwdState::connectStart()
 #endif
 
     calls.connector = commCbCall(17,3, "fwdConnectDoneWrapper", CommConnectCbPtrFun(fwdConnectDoneWrapper, this));
+    request->phases.start(PhaseTimes::phConnect);
     Comm::ConnOpener *cs = new Comm::ConnOpener(serverDestinations[0], calls.connector, ctimeout);
     if (host)
         cs->setHost(host);
+    race.opener = cs;
+    AsyncJob::Start(cs);
+
+    scheduleSpare(ctimeout);
+}
+
+/// The index of the first destination worth racing against the current one
+/// or -1. Like RFC 6555, we race addresses of the same host that belong to
+/// different families, so that a broken IPv6 (or IPv4) path does not cost
+/// us a full connect timeout.
+int
+FwdState::findSpareDestination() const
+{
+    const Comm::ConnectionPointer &primary = serverDestinations[0];
+    if (primary->peerType == PINNED)
+        return -1;
+
+    for (size_t i = 1; i < serverDestinations.size(); ++i) {
+        const Comm::ConnectionPointer &dest = serverDestinations[i];
+        if (dest->getPeer() != primary->getPeer() || dest->peerType != primary->peerType)
+            break; // the remaining destinations are other hosts
+        if (dest->remote.IsIPv4() != primary->remote.IsIPv4())
+            return i;
+    }
+    return -1;
+}
+
+/// plans to race serverDestinations[0] if racing is enabled and possible
+void
+FwdState::scheduleSpare(int ctimeout)
+{
+    if (!Config.Timeout.happy_eyeballs)
+        return; // disabled
+
+    const int idx = findSpareDestination();
+    if (idx < 0)
+        return;
+
+    race.spare = serverDestinations[idx];
+    race.ctimeout = ctimeout;
+    race.start = current_time;
+    race.waiting = true;
+    debugs(17, 4, HERE << "will race " << serverDestinations[0] << " with " << race.spare);
+    eventAdd("FwdState::StartSpareWrapper", &FwdState::StartSpareWrapper, this,
+             Config.Timeout.happy_eyeballs / 1000.0, 0);
+}
+
+void
+FwdState::StartSpareWrapper(void *data)
+{
+    FwdState *fwd = static_cast<FwdState*>(data);
+    fwd->race.waiting = false;
+    fwd->startSpare();
+}
+
+/// starts connecting to the spare destination while the primary is still trying
+void
+FwdState::startSpare()
+{
+    if (race.spare == NULL || calls.connector == NULL)
+        return; // the primary has finished meanwhile
+
+    ++RaceStats.started;
+    debugs(17, 3, HERE << serverDestinations[0] << " is slow; racing " << race.spare);
+
+    race.spare->local.SetPort(0);
+    if (Ip::Qos::TheConfig.isAclTosActive())
+        race.spare->tos = GetTosToServer(request);
+#if SO_MARK && USE_LIBCAP
+    race.spare->nfmark = GetNfmarkToServer(request);
+#else
+    race.spare->nfmark = 0;
+#endif
+
+    race.spareStart = current_time;
+    calls.spareConnector = commCbCall(17,3, "fwdConnectDoneWrapper", CommConnectCbPtrFun(fwdConnectDoneWrapper, this));
+    Comm::ConnOpener *cs = new Comm::ConnOpener(race.spare, calls.spareConnector, race.ctimeout);
+    if (!race.spare->getPeer())
+        cs->setHost(request->GetHost());
+    race.spareOpener = cs;
     AsyncJob::Start(cs);
 }
 
+/// handles the spare ConnOpener answer while the primary is still trying
+void
+FwdState::spareConnectDone(const Comm::ConnectionPointer &conn, comm_err_t status)
+{
+    calls.spareConnector = NULL;
+    race.spareOpener.clear();
+    race.spare = NULL;
+
+    if (status != COMM_OK) {
+        ++RaceStats.failed;
+        debugs(17, 3, HERE << "spare " << conn << " failed; still waiting for " << serverDestinations[0]);
+        if (conn->getPeer())
+            peerConnectFailed(conn->getPeer());
+        conn->close();
+        serverDestinations.prune(conn); // do not try it again
+        return;
+    }
+
+    // the spare won; the connection we were waiting for becomes a fallback
+    const Comm::ConnectionPointer loser = serverDestinations[0];
+    abortConnecting(calls.connector, race.opener, loser, "spare connection won");
+
+    for (size_t i = 1; i < serverDestinations.size(); ++i) {
+        if (serverDestinations[i] == conn) {
+            serverDestinations[i] = loser;
+            serverDestinations[0] = conn;
+            break;
+        }
+    }
+    request->hier.note(conn, request->GetHost());
+
+    // Without racing, we would still be waiting for the loser and then
+    // spend as long on the spare. If the loser would time out, we would
+    // wait for the rest of its connect timeout as well.
+    const int saved = tvSubMsec(race.spareStart, current_time);
+    const int waitedForLoser = tvSubMsec(race.start, current_time);
+    const int savedMax = saved + max(race.ctimeout * 1000 - waitedForLoser, 0);
+    RaceStats.savedMsec += saved;
+    RaceStats.savedMsecMax += savedMax;
+    if (conn->remote.IsIPv4())
+        ++RaceStats.wonByIpv4;
+    else
+        ++RaceStats.wonByIpv6;
+    debugs(17, 2, "Happy Eyeballs: " << (conn->remote.IsIPv4() ? "IPv4" : "IPv6") <<
+           " spare " << conn << " beat " << loser->remote << " after " <<
+           waitedForLoser << " ms, saving " << saved << " to " << savedMax <<
+           " ms: " << entry->url());
+
+    connectDone(conn, COMM_OK, 0);
+}
+
+/// makes the spare connection attempt the primary one after the primary failed
+void
+FwdState::promoteSpare()
+{
+    debugs(17, 3, HERE << serverDestinations[0] << " failed; waiting for spare " << race.spare);
+
+    const Comm::ConnectionPointer failed = serverDestinations[0];
+    for (size_t i = 1; i < serverDestinations.size(); ++i) {
+        if (serverDestinations[i] == race.spare) {
+            serverDestinations[i] = failed;
+            serverDestinations[0] = race.spare;
+            break;
+        }
+    }
+    serverDestinations.prune(failed); // keeps the order of the others
+
+    // as if startConnectionOrFail() picked the spare
+    delete err;
+    err = NULL;
+    request->hier.note(serverDestinations[0], request->GetHost());
+    request->clearError();
+
+    calls.connector = calls.spareConnector;
+    calls.spareConnector = NULL;
+    race.opener = race.spareOpener;
+    race.spareOpener.clear();
+    race.spare = NULL;
+}
+
+/// stops racing: forgets the planned spare or closes the spare being opened
+void
+FwdState::cancelSpare(const char *reason)
+{
+    if (race.waiting) {
+        eventDelete(&FwdState::StartSpareWrapper, this);
+        race.waiting = false;
+    }
+
+    if (calls.spareConnector != NULL)
+        abortConnecting(calls.spareConnector, race.spareOpener, race.spare, reason);
+
+    race.spare = NULL;
+}
+
+/// cancels our ConnOpener callback and makes the opener close its socket
+void
+FwdState::abortConnecting(AsyncCall::Pointer &call, CbcPointer<Comm::ConnOpener> &job, const Comm::ConnectionPointer &dest, const char *reason)
+{
+    debugs(17, 4, HERE << dest << ": " << reason);
+
+    call->cancel(reason);
+    call = NULL;
+
+    if (job.valid())
+        CallJobHere(17, 4, job, Comm::ConnOpener, noteAbort);
+    job.clear();
+
+    // the opener may have connected before we canceled its answer
+    if (Comm::IsConnOpen(dest))
+        dest->close();
+}
+
 void
 FwdState::dispatch()
 {
@@ -1271,6 +1514,17 @@ fwdStats(StoreEntry * s)
 
         storeAppendPrintf(s, "\n");
     }
+
+    storeAppendPrintf(s, "\nHappy Eyeballs connection racing:\n");
+    storeAppendPrintf(s, "\tspare connections opened: %d\n", RaceStats.started);
+    storeAppendPrintf(s, "\twon by IPv4 spares: %d\n", RaceStats.wonByIpv4);
+    storeAppendPrintf(s, "\twon by IPv6 spares: %d\n", RaceStats.wonByIpv6);
+    storeAppendPrintf(s, "\twon by the primary: %d\n", RaceStats.lost);
+    storeAppendPrintf(s, "\tspares failed: %d\n", RaceStats.failed);
+    storeAppendPrintf(s, "\ttime saved by spare wins, at least: %.3f sec\n",
+                      RaceStats.savedMsec / 1000.0);
+    storeAppendPrintf(s, "\ttime saved by spare wins, if losers would time out: %.3f sec\n",
+                      RaceStats.savedMsecMax / 1000.0);
 }
 
 /**** STATIC MEMBER FUNCTIONS *************************************************/
@@ -1321,6 +1575,7 @@ void
 FwdState::initModule()
 {
     RegisterWithCacheManager();
+    fwdPconnPool->shareIdleConnections();
 }
 
 void
@@ -2,6 +2,7 @@
 #define SQUID_FORWARD_H
 
 #include "Array.h"
+#include "base/CbcPointer.h"
 #include "comm.h"
 #include "comm/Connection.h"
 #include "err_type.h"
@@ -17,6 +18,11 @@ typedef RefCount<AccessLogEntry> AccessLogEntryPointer;
 class ErrorState;
 class HttpRequest;
 
+namespace Comm
+{
+class ConnOpener;
+}
+
 /**
  * Returns the TOS value that we should be setting on the connection
  * to the server, based on the ACL.
@@ -86,6 +92,16 @@ private:
     ErrorState *makeConnectingError(const err_type type) const;
     static void RegisterWithCacheManager(void);
 
+    /* Happy Eyeballs (RFC 6555) connection racing */
+    int findSpareDestination() const;
+    void scheduleSpare(int ctimeout);
+    static void StartSpareWrapper(void *data);
+    void startSpare();
+    void spareConnectDone(const Comm::ConnectionPointer &conn, comm_err_t status);
+    void promoteSpare();
+    void cancelSpare(const char *reason);
+    void abortConnecting(AsyncCall::Pointer &call, CbcPointer<Comm::ConnOpener> &job, const Comm::ConnectionPointer &dest, const char *reason);
+
 public:
     StoreEntry *entry;
     HttpRequest *request;
@@ -103,8 +119,20 @@ private:
     // AsyncCalls which we set and may need cancelling.
     struct {
         AsyncCall::Pointer connector;  ///< a call linking us to the ConnOpener producing serverConn.
+        AsyncCall::Pointer spareConnector; ///< a call linking us to the ConnOpener racing the above.
     } calls;
 
+    /// connection racing state; the spare is one of serverDestinations
+    struct {
+        CbcPointer<Comm::ConnOpener> opener; ///< opens serverDestinations[0]
+        CbcPointer<Comm::ConnOpener> spareOpener; ///< opens the spare
+        Comm::ConnectionPointer spare; ///< destination raced against serverDestinations[0]
+        bool waiting; ///< whether StartSpareWrapper() is scheduled
+        int ctimeout; ///< connect timeout for both connections
+        struct timeval start; ///< when the serverDestinations[0] opener was started
+        struct timeval spareStart; ///< when the spare opener was started
+    } race;
+
     struct {
         unsigned int connected_okay:1; ///< TCP link ever opened properly. This affects retry of POST,PUT,CONNECT,etc
         unsigned int dont_retry:1;
@@ -506,7 +506,8 @@ fqdncacheHandleReply(void *data, const rfc1035_rr * answers, int na, const char
     static_cast<generic_cbdata *>(data)->unwrap(&f);
     ++FqdncacheStats.replies;
     const int age = f->age();
-    statCounter.dns.svcTime.count(age);
+    if (f->request_time.tv_sec)
+        statCounter.dns.svcTime.count(f->request_time, current_time);
 #if USE_DNSHELPER
 
     fqdncacheParse(f, reply);
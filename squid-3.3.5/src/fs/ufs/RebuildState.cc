@@ -40,8 +40,11 @@
 #include "store_rebuild.h"
 #include "StoreSwapLogData.h"
 #include "tools.h"
+#include "UFSSwapLogIndex.h"
 #include "UFSSwapLogParser.h"
 
+#include <algorithm>
+
 #if HAVE_MATH_H
 #include <math.h>
 #endif
@@ -55,7 +58,8 @@
 CBDATA_NAMESPACED_CLASS_INIT(Fs::Ufs,RebuildState);
 
 Fs::Ufs::RebuildState::RebuildState(RefCount<UFSSwapDir> aSwapDir) :
-        sd (aSwapDir), LogParser(NULL), e(NULL), fromLog(true), _done (false)
+        sd (aSwapDir), LogParser(NULL), LogIndex(NULL), n_indexed(0),
+        e(NULL), fromLog(true), _done (false)
 {
     /*
      * If the swap.state file exists in the cache_dir, then
@@ -79,6 +83,15 @@ Fs::Ufs::RebuildState::RebuildState(RefCount<UFSSwapDir> aSwapDir) :
     } else {
         fromLog = true;
         flags.clean = (unsigned int) clean;
+
+        // prefer scanning mapped records in bulk to reading them one by one
+        if (LogParser->Mappable()) {
+            LogIndex = new Fs::Ufs::UFSSwapLogIndex;
+            if (!LogIndex->map(LogParser->log)) {
+                delete LogIndex;
+                LogIndex = NULL;
+            }
+        }
     }
 
     if (!clean)
@@ -92,6 +105,9 @@ Fs::Ufs::RebuildState::~RebuildState()
 {
     sd->closeTmpSwapLog();
 
+    if (LogIndex)
+        delete LogIndex;
+
     if (LogParser)
         delete LogParser;
 }
@@ -124,16 +140,19 @@ Fs::Ufs::RebuildState::rebuildStep()
     const timeval loopStart = current_time;
 
     const int totalEntries = LogParser ? LogParser->SwapLogEntries() : -1;
+    const int passes = LogIndex ? 2 : 1; // indexing (if any) and loading
 
     while (!isDone()) {
-        if (fromLog)
+        if (LogIndex && n_indexed < LogIndex->entries())
+            indexSwapLog();
+        else if (fromLog)
             rebuildFromSwapLog();
         else
             rebuildFromDirectory();
 
         // TODO: teach storeRebuildProgress to handle totalEntries <= 0
         if (totalEntries > 0 && (n_read % 4000 == 0))
-            storeRebuildProgress(sd->index, totalEntries, n_read);
+            storeRebuildProgress(sd->index, passes * totalEntries, n_indexed + n_read);
 
         if (opt_foreground_rebuild)
             continue; // skip "few entries at a time" check below
@@ -220,7 +239,8 @@ Fs::Ufs::RebuildState::rebuildFromDirectory()
                                     tmpe.refcount,  /* refcount */
                                     tmpe.flags,     /* flags */
                                     (int) flags.clean));
-    storeDirSwapLog(currentEntry(), SWAP_LOG_ADD);
+    if (currentEntry()) // compact index entries are logged by addDiskRestore()
+        storeDirSwapLog(currentEntry(), SWAP_LOG_ADD);
 }
 
 StoreEntry *
@@ -235,14 +255,89 @@ Fs::Ufs::RebuildState::currentEntry(StoreEntry *newValue)
     e = newValue;
 }
 
+/// find the latest record for each key in a batch of mapped swap log entries
+void
+Fs::Ufs::RebuildState::indexSwapLog()
+{
+    // a batch is large enough to amortize rebuildStep() overheads but is
+    // still processed well within its time limit
+    const int end = min(n_indexed + 4096, LogIndex->entries());
+
+    for (; n_indexed < end; ++n_indexed) {
+        if (indexable(LogIndex->record(n_indexed)) && !LogIndex->note(n_indexed))
+            debugs(47, 3, HERE << "ignoring entry " << n_indexed << " using a swap file of another key");
+    }
+
+    if (n_indexed == LogIndex->entries())
+        debugs(47, DBG_IMPORTANT, "Done indexing " << sd->path << " swaplog (" << n_indexed << " entries)");
+}
+
+/// whether LogIndex may select the record as the one to load for its key;
+/// rebuildFromSwapLog() ignores the other records before their keys matter
+bool
+Fs::Ufs::RebuildState::indexable(const StoreSwapLogData &swapData) const
+{
+    if (!swapData.sane())
+        return false;
+
+    if (swapData.op == SWAP_LOG_DEL)
+        return true;
+
+    return swapData.op == SWAP_LOG_ADD &&
+           sd->validFileno(swapData.swap_filen & 0x00FFFFFF, 0) &&
+           !EBIT_TEST(swapData.flags, KEY_PRIVATE);
+}
+
+/// unlinks swap files of skipped ADD records unless a loaded entry uses them;
+/// the record-by-record rebuild releases such files when it replaces entries
+void
+Fs::Ufs::RebuildState::releaseSupersededFiles()
+{
+    std::sort(supersededFiles.begin(), supersededFiles.end());
+    supersededFiles.erase(std::unique(supersededFiles.begin(), supersededFiles.end()),
+                          supersededFiles.end());
+
+    int released = 0;
+    typedef std::vector<sfileno>::const_iterator FI;
+    for (FI i = supersededFiles.begin(); i != supersededFiles.end(); ++i) {
+        if (!sd->mapBitTest(*i)) {
+            sd->unlinkFile(*i);
+            ++released;
+        }
+    }
+
+    debugs(47, 2, HERE << "released " << released << " of " <<
+           supersededFiles.size() << " superseded swap files in " << sd->path);
+    std::vector<sfileno>().swap(supersededFiles);
+}
+
+/// get the next swap log entry from LogIndex, if any, or LogParser
+bool
+Fs::Ufs::RebuildState::readSwapLogRecord(StoreSwapLogData &swapData)
+{
+    if (!LogIndex)
+        return LogParser->ReadRecord(swapData);
+
+    if (n_read >= LogIndex->entries())
+        return false;
+
+    swapData = LogIndex->record(n_read);
+    return true;
+}
+
 /// process one swap log entry
 void
 Fs::Ufs::RebuildState::rebuildFromSwapLog()
 {
     StoreSwapLogData swapData;
 
-    if (LogParser->ReadRecord(swapData) != 1) {
+    if (!readSwapLogRecord(swapData)) {
         debugs(47, DBG_IMPORTANT, "Done reading " << sd->path << " swaplog (" << n_read << " entries)");
+        if (LogIndex) {
+            delete LogIndex;
+            LogIndex = NULL;
+            releaseSupersededFiles();
+        }
         LogParser->Close();
         delete LogParser;
         LogParser = NULL;
@@ -272,6 +367,14 @@ Fs::Ufs::RebuildState::rebuildFromSwapLog()
            std::hex << std::uppercase << std::setw(8) <<
            swapData.swap_filen);
 
+    if (LogIndex && indexable(swapData) && !LogIndex->latest(n_read - 1)) {
+        /* another entry for the same key supersedes this one */
+        ++counts.dupcount;
+        if (swapData.op == SWAP_LOG_ADD)
+            supersededFiles.push_back(swapData.swap_filen);
+        return;
+    }
+
     if (swapData.op == SWAP_LOG_ADD) {
         (void) 0;
     } else if (swapData.op == SWAP_LOG_DEL) {
@@ -404,7 +507,8 @@ Fs::Ufs::RebuildState::rebuildFromSwapLog()
                                     swapData.flags,
                                     (int) flags.clean));
 
-    storeDirSwapLog(currentEntry(), SWAP_LOG_ADD);
+    if (currentEntry()) // compact index entries are logged by addDiskRestore()
+        storeDirSwapLog(currentEntry(), SWAP_LOG_ADD);
 }
 
 /// undo the effects of adding an entry in rebuildFromSwapLog()
@@ -32,10 +32,14 @@
 
 #include "RefCount.h"
 #include "UFSSwapDir.h"
+#include "UFSSwapLogIndex.h"
 #include "UFSSwapLogParser.h"
 #include "store_rebuild.h"
 
+#include <vector>
+
 class StoreEntry;
+class StoreSwapLogData;
 
 namespace Fs
 {
@@ -59,6 +63,8 @@ public:
     int n_read;
     /*    FILE *log;*/
     Fs::Ufs::UFSSwapLogParser *LogParser;
+    Fs::Ufs::UFSSwapLogIndex *LogIndex; ///< bulk access to LogParser records, if possible
+    int n_indexed; ///< the number of LogIndex records processed by indexSwapLog()
     int curlvl1;
     int curlvl2;
 
@@ -82,6 +88,10 @@ private:
     CBDATA_CLASS2(RebuildState);
     void rebuildFromDirectory();
     void rebuildFromSwapLog();
+    void indexSwapLog();
+    bool indexable(const StoreSwapLogData &swapData) const;
+    void releaseSupersededFiles();
+    bool readSwapLogRecord(StoreSwapLogData &swapData);
     void rebuildStep();
     void undoAdd();
     int getNextFile(sfileno *, int *size);
@@ -90,6 +100,8 @@ private:
     StoreEntry *e;
     bool fromLog;
     bool _done;
+    /// swap files of ADD records skipped because LogIndex had a better record
+    std::vector<sfileno> supersededFiles;
     /// \bug (callback) should be hidden behind a proper human readable name
     void (callback)(void *cbdata);
     void *cbdata;
@@ -0,0 +1,192 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "UFSCompactIndex.h"
+
+/// whether a time value survives narrowing to 32 bits
+static bool
+FitsInt32(const time_t value)
+{
+    return static_cast<time_t>(static_cast<int32_t>(value)) == value;
+}
+
+Fs::Ufs::UFSCompactIndex::UFSCompactIndex():
+        tail(0), head(0), entries(0), keys(*this)
+{
+}
+
+Fs::Ufs::UFSCompactIndex::~UFSCompactIndex()
+{
+    for (size_t i = 0; i < chunks.size(); ++i)
+        xfree(chunks[i]);
+}
+
+Fs::Ufs::UFSCompactIndex::Entry &
+Fs::Ufs::UFSCompactIndex::entryAt(const uint32_t n) const
+{
+    Entry *chunk = chunks[n >> ChunkBits];
+    assert(chunk);
+    return chunk[n & (ChunkSize - 1)];
+}
+
+const cache_key *
+Fs::Ufs::UFSCompactIndex::keyOf(const uint32_t n) const
+{
+    return entryAt(n).key;
+}
+
+bool
+Fs::Ufs::UFSCompactIndex::add(const cache_key *key, sfileno filen, uint64_t swap_file_sz,
+                              time_t expires, time_t timestamp, time_t lastref, time_t lastmod,
+                              uint32_t refcount, uint16_t flags)
+{
+    if (filen < 0 || refcount > 0xFFFF)
+        return false;
+
+    if (!FitsInt32(expires) || !FitsInt32(timestamp) ||
+            !FitsInt32(lastref) || !FitsInt32(lastmod))
+        return false;
+
+    // keep record numbers (plus one) and slot counts within 32 bits
+    if (tail >= 0x7FFFFFFF || entries >= 0x3FFFFFFF)
+        return false;
+
+    keys.reserve(entries + 1);
+
+    uint32_t &slot = keys.slot(keys.find(key));
+    if (slot)
+        return false; // the caller should have promoted the old entry
+
+    const uint32_t c = tail >> ChunkBits;
+    if (c == chunks.size()) {
+        chunks.push_back(NULL);
+        chunkUse.push_back(0);
+    }
+    if (!chunks[c]) {
+        chunks[c] = static_cast<Entry *>(xmalloc(ChunkSize * sizeof(Entry)));
+        for (uint32_t i = 0; i < ChunkSize; ++i)
+            chunks[c][i].swap_filen = -1;
+    }
+
+    Entry &entry = entryAt(tail);
+    memcpy(entry.key, key, SQUID_MD5_DIGEST_LENGTH);
+    entry.swap_file_sz = swap_file_sz;
+    entry.timestamp = static_cast<int32_t>(timestamp);
+    entry.lastref = static_cast<int32_t>(lastref);
+    entry.expires = static_cast<int32_t>(expires);
+    entry.lastmod = static_cast<int32_t>(lastmod);
+    entry.swap_filen = filen;
+    entry.refcount = static_cast<uint16_t>(refcount);
+    entry.flags = flags;
+
+    slot = tail + 1;
+    ++tail;
+    ++entries;
+    ++chunkUse[c];
+    return true;
+}
+
+const Fs::Ufs::UFSCompactIndex::Entry *
+Fs::Ufs::UFSCompactIndex::find(const cache_key *key) const
+{
+    if (!entries)
+        return NULL;
+
+    const uint32_t used = keys.slot(keys.find(key));
+    return used ? &entryAt(used - 1) : NULL;
+}
+
+void
+Fs::Ufs::UFSCompactIndex::remove(const Entry &entry)
+{
+    const uint32_t pos = keys.find(entry.key);
+    assert(keys.slot(pos));
+    const uint32_t n = keys.slot(pos) - 1;
+    assert(&entryAt(n) == &entry);
+
+    keys.erase(pos);
+
+    entryAt(n).swap_filen = -1;
+    --entries;
+
+    const uint32_t c = n >> ChunkBits;
+    if (--chunkUse[c] == 0) {
+        safe_free(chunks[c]);
+        debugs(47, 5, HERE << "freed chunk " << c);
+    }
+}
+
+const Fs::Ufs::UFSCompactIndex::Entry *
+Fs::Ufs::UFSCompactIndex::oldest()
+{
+    const Entry *entry = next(head);
+    if (entry)
+        --head; // next() moved head past the returned entry
+    return entry;
+}
+
+const Fs::Ufs::UFSCompactIndex::Entry *
+Fs::Ufs::UFSCompactIndex::next(uint32_t &pos) const
+{
+    if (pos < head)
+        pos = head;
+
+    while (pos < tail) {
+        const uint32_t c = pos >> ChunkBits;
+        if (!chunks[c]) {
+            pos = (c + 1) << ChunkBits;
+            continue;
+        }
+
+        const Entry &entry = entryAt(pos);
+        ++pos;
+        if (entry.swap_filen >= 0)
+            return &entry;
+    }
+
+    pos = tail;
+    return NULL;
+}
+
+size_t
+Fs::Ufs::UFSCompactIndex::memoryUsed() const
+{
+    size_t used = keys.memoryUsed() +
+                  chunks.capacity() * sizeof(Entry *) +
+                  chunkUse.capacity() * sizeof(uint32_t);
+
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i])
+            used += ChunkSize * sizeof(Entry);
+    }
+
+    return used;
+}
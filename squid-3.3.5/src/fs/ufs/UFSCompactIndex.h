@@ -0,0 +1,126 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_FS_UFS_UFSCOMPACTINDEX_H
+#define SQUID_FS_UFS_UFSCOMPACTINDEX_H
+
+#include "md5.h"
+#include "typedefs.h"
+#include "UFSKeyTable.h"
+
+#include <vector>
+
+namespace Fs
+{
+namespace Ufs
+{
+
+/**
+ \ingroup UFS
+ *
+ * A compact index of cache_dir entries that were loaded during the cache
+ * index rebuild but were not requested since. Such "cold" entries are kept
+ * as fixed-size records in a slab array instead of full StoreEntry objects
+ * in store_table (with their hash links, separately allocated keys, and
+ * replacement policy nodes). An entry is promoted to a StoreEntry when it
+ * is looked up.
+ *
+ * Records are added during the rebuild and when maintain() returns entries
+ * that the replacement policy did not purge. The oldest() record is the one
+ * maintain() offers to the policy next. A slab chunk is freed when all of
+ * its records are gone.
+ */
+class UFSCompactIndex : private UFSKeyTable::Records
+{
+public:
+    /// packed metadata of an indexed entry
+    class Entry
+    {
+    public:
+        cache_key key[SQUID_MD5_DIGEST_LENGTH];
+        uint64_t swap_file_sz;
+        int32_t timestamp; ///< StoreEntry::timestamp narrowed to 32 bits
+        int32_t lastref; ///< StoreEntry::lastref narrowed to 32 bits
+        int32_t expires; ///< StoreEntry::expires narrowed to 32 bits
+        int32_t lastmod; ///< StoreEntry::lastmod narrowed to 32 bits
+        sfileno swap_filen; ///< negative for unused records
+        uint16_t refcount;
+        uint16_t flags;
+    };
+
+    UFSCompactIndex();
+    ~UFSCompactIndex();
+
+    /// indexes a new entry; fails if some values do not fit an Entry
+    bool add(const cache_key *key, sfileno filen, uint64_t swap_file_sz,
+             time_t expires, time_t timestamp, time_t lastref, time_t lastmod,
+             uint32_t refcount, uint16_t flags);
+
+    /// the entry with the given key or nil
+    const Entry *find(const cache_key *key) const;
+
+    /// removes a previously found entry from the index
+    void remove(const Entry &entry);
+
+    /// the least recently added entry or nil
+    const Entry *oldest();
+
+    /// the first entry at or after the given position or nil;
+    /// updates the position to point after the returned entry
+    const Entry *next(uint32_t &pos) const;
+
+    /// the number of indexed entries
+    uint32_t count() const { return entries; }
+
+    /// the total memory used by the index, including its hash table
+    size_t memoryUsed() const;
+
+private:
+    static const uint32_t ChunkBits = 16;
+    static const uint32_t ChunkSize = 1 << ChunkBits; ///< records per chunk
+
+    /* UFSKeyTable::Records API */
+    virtual const cache_key *keyOf(uint32_t n) const;
+
+    Entry &entryAt(uint32_t n) const;
+
+    std::vector<Entry *> chunks; ///< slab chunks; nil if freed
+    std::vector<uint32_t> chunkUse; ///< the number of indexed entries in each chunk
+
+    uint32_t tail; ///< the number of records ever added
+    uint32_t head; ///< no entries before this record number
+    uint32_t entries; ///< the number of indexed entries
+
+    UFSKeyTable keys; ///< finds record numbers by entry key
+};
+
+} // namespace Ufs
+} // namespace Fs
+
+#endif /* SQUID_FS_UFS_UFSCOMPACTINDEX_H */
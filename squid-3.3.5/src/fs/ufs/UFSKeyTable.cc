@@ -0,0 +1,128 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "md5.h"
+#include "UFSKeyTable.h"
+
+Fs::Ufs::UFSKeyTable::UFSKeyTable(const Records &aRecords):
+        records(aRecords), slots(NULL), capacity_(0)
+{
+}
+
+Fs::Ufs::UFSKeyTable::~UFSKeyTable()
+{
+    clear();
+}
+
+/// the preferred slot position for the key
+uint32_t
+Fs::Ufs::UFSKeyTable::home(const cache_key *key) const
+{
+    // MD5 keys are uniformly distributed; any four bytes make a good hash
+    uint32_t hash;
+    memcpy(&hash, key, sizeof(hash));
+    return hash & (capacity_ - 1);
+}
+
+void
+Fs::Ufs::UFSKeyTable::reserve(const uint32_t count)
+{
+    uint32_t wanted = capacity_ ? capacity_ : 1024;
+    while (static_cast<uint64_t>(count) * 4 > static_cast<uint64_t>(wanted) * 3) {
+        wanted <<= 1;
+        assert(wanted); // callers keep count within 30 bits
+    }
+
+    if (wanted == capacity_)
+        return;
+
+    const uint32_t oldCapacity = capacity_;
+    uint32_t *oldSlots = slots;
+
+    capacity_ = wanted;
+    slots = static_cast<uint32_t *>(xcalloc(capacity_, sizeof(*slots)));
+
+    const uint32_t mask = capacity_ - 1;
+    for (uint32_t i = 0; i < oldCapacity; ++i) {
+        if (const uint32_t used = oldSlots[i]) {
+            uint32_t pos = home(records.keyOf(used - 1));
+            while (slots[pos])
+                pos = (pos + 1) & mask;
+            slots[pos] = used;
+        }
+    }
+
+    xfree(oldSlots);
+    debugs(47, 3, HERE << "resized from " << oldCapacity << " to " << capacity_ << " slots");
+}
+
+void
+Fs::Ufs::UFSKeyTable::clear()
+{
+    safe_free(slots);
+    capacity_ = 0;
+}
+
+uint32_t
+Fs::Ufs::UFSKeyTable::find(const cache_key *key) const
+{
+    assert(capacity_);
+    const uint32_t mask = capacity_ - 1;
+    uint32_t pos = home(key);
+    while (const uint32_t used = slots[pos]) {
+        if (memcmp(records.keyOf(used - 1), key, SQUID_MD5_DIGEST_LENGTH) == 0)
+            break;
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+void
+Fs::Ufs::UFSKeyTable::erase(uint32_t pos)
+{
+    assert(slots[pos]);
+
+    // backward-shift deletion keeps probe sequences intact without tombstones
+    const uint32_t mask = capacity_ - 1;
+    slots[pos] = 0;
+    for (uint32_t next = (pos + 1) & mask; slots[next]; next = (next + 1) & mask) {
+        const uint32_t preferred = home(records.keyOf(slots[next] - 1));
+        // move the record unless its home is cyclically within (pos, next]
+        const bool stays = pos <= next ?
+                           (pos < preferred && preferred <= next) :
+                           (pos < preferred || preferred <= next);
+        if (!stays) {
+            slots[pos] = slots[next];
+            slots[next] = 0;
+            pos = next;
+        }
+    }
+}
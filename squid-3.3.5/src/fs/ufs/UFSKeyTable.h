@@ -0,0 +1,99 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_FS_UFS_UFSKEYTABLE_H
+#define SQUID_FS_UFS_UFSKEYTABLE_H
+
+#include "typedefs.h"
+
+namespace Fs
+{
+namespace Ufs
+{
+
+/**
+ \ingroup UFS
+ *
+ * An open addressing hash table with linear probing that maps MD5 cache keys
+ * to record numbers. The table stores 32-bit record numbers only; the owner
+ * keeps the records and tells the table which key each record has. This
+ * keeps the table memory at four bytes per slot.
+ */
+class UFSKeyTable
+{
+public:
+    /// the owner of the records referred to by the table
+    class Records
+    {
+    public:
+        virtual ~Records() {}
+
+        /// the key of the n-th record
+        virtual const cache_key *keyOf(uint32_t n) const = 0;
+    };
+
+    explicit UFSKeyTable(const Records &aRecords);
+    ~UFSKeyTable();
+
+    /// grows the table, if needed, to index the given number of records
+    /// while keeping its load factor at or under 75%
+    void reserve(uint32_t count);
+
+    /// frees all slots
+    void clear();
+
+    /// the position of the slot for the key: either empty or used by a
+    /// record with that key; the table must have some slots
+    uint32_t find(const cache_key *key) const;
+
+    /// record number plus one for a used slot; zero for an empty one
+    uint32_t &slot(const uint32_t pos) { return slots[pos]; }
+    uint32_t slot(const uint32_t pos) const { return slots[pos]; }
+
+    /// empties a used slot, keeping probe sequences of other keys intact
+    void erase(uint32_t pos);
+
+    /// the number of slots; zero or a power of two
+    uint32_t capacity() const { return capacity_; }
+
+    /// the total memory used by the slots
+    size_t memoryUsed() const { return capacity_ * sizeof(*slots); }
+
+private:
+    uint32_t home(const cache_key *key) const;
+
+    const Records &records; ///< provides record keys
+    uint32_t *slots; ///< record number plus one for each used slot; zero if empty
+    uint32_t capacity_; ///< the number of slots; zero or a power of two
+};
+
+} // namespace Ufs
+} // namespace Fs
+
+#endif /* SQUID_FS_UFS_UFSKEYTABLE_H */
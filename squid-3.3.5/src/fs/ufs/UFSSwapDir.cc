@@ -44,6 +44,7 @@
 #include "SquidMath.h"
 #include "DiskIO/DiskIOStrategy.h"
 #include "store_key_md5.h"
+#include "StoreKeyTable.h"
 #include "StoreSearchUFS.h"
 #include "StoreSwapLogData.h"
 #include "SquidConfig.h"
@@ -76,6 +77,8 @@ public:
     /** "write" an entry to the clean log file.
      */
     virtual void write(StoreEntry const &);
+    /// "write" all compact index entries to the clean log file
+    void write(const Fs::Ufs::UFSCompactIndex &index);
     char *cur;
     char *newLog;
     char *cln;
@@ -84,8 +87,39 @@ public:
     int fd;
     RemovalPolicyWalker *walker;
     SwapDir *sd;
+
+private:
+    bool writeRecord(StoreSwapLogData &s);
 };
 
+/// fills a swap log record with compact index entry metadata
+static void
+PackCompactEntry(const Fs::Ufs::UFSCompactIndex::Entry &entry, int op, StoreSwapLogData &s)
+{
+    s.op = (char) op;
+    s.swap_filen = entry.swap_filen;
+    s.timestamp = entry.timestamp;
+    s.lastref = entry.lastref;
+    s.expires = entry.expires;
+    s.lastmod = entry.lastmod;
+    s.swap_file_sz = entry.swap_file_sz;
+    s.refcount = entry.refcount;
+    s.flags = entry.flags;
+    memcpy(s.key, entry.key, SQUID_MD5_DIGEST_LENGTH);
+}
+
+/// StoreEntry flags as restoreEntry() would reset them, for compact entries
+static uint16_t
+CompactFlags(const uint16_t flags)
+{
+    uint16_t compactFlags = flags;
+    EBIT_SET(compactFlags, ENTRY_CACHABLE);
+    EBIT_CLR(compactFlags, RELEASE_REQUEST);
+    EBIT_CLR(compactFlags, KEY_PRIVATE);
+    EBIT_CLR(compactFlags, ENTRY_VALIDATED);
+    return compactFlags;
+}
+
 UFSCleanLog::UFSCleanLog(SwapDir *aSwapDir) :
         cur(NULL), newLog(NULL), cln(NULL), outbuf(NULL),
         outbuf_offset(0), fd(-1),walker(NULL), sd(aSwapDir)
@@ -106,7 +140,6 @@ void
 UFSCleanLog::write(StoreEntry const &e)
 {
     StoreSwapLogData s;
-    static size_t ss = sizeof(StoreSwapLogData);
     s.op = (char) SWAP_LOG_ADD;
     s.swap_filen = e.swap_filen;
     s.timestamp = e.timestamp;
@@ -117,6 +150,34 @@ UFSCleanLog::write(StoreEntry const &e)
     s.refcount = e.refcount;
     s.flags = e.flags;
     memcpy(&s.key, e.key, SQUID_MD5_DIGEST_LENGTH);
+
+    if (!writeRecord(s)) {
+        /* XXX This error handling should probably move up to the caller */
+        sd->cleanLog = NULL;
+        delete this;
+    }
+}
+
+/// compact index entries are not known to the replacement policy walker;
+/// on errors, closes fd but leaves the cleanup to writeCleanDone()
+void
+UFSCleanLog::write(const Fs::Ufs::UFSCompactIndex &index)
+{
+    uint32_t pos = 0;
+    while (const Fs::Ufs::UFSCompactIndex::Entry *cold = index.next(pos)) {
+        StoreSwapLogData s;
+        PackCompactEntry(*cold, SWAP_LOG_ADD, s);
+        if (!writeRecord(s))
+            return;
+    }
+}
+
+/// buffers a record, writing the buffer when it is full
+/// \returns false if the buffer could not be written and fd was closed
+bool
+UFSCleanLog::writeRecord(StoreSwapLogData &s)
+{
+    static size_t ss = sizeof(StoreSwapLogData);
     s.finalize();
     memcpy(outbuf + outbuf_offset, &s, ss);
     outbuf_offset += ss;
@@ -124,19 +185,18 @@ UFSCleanLog::write(StoreEntry const &e)
 
     if (outbuf_offset + ss >= CLEAN_BUF_SZ) {
         if (FD_WRITE_METHOD(fd, outbuf, outbuf_offset) < 0) {
-            /* XXX This error handling should probably move up to the caller */
             debugs(50, DBG_CRITICAL, HERE << newLog << ": write: " << xstrerror());
             debugs(50, DBG_CRITICAL, HERE << "Current swap logfile not replaced.");
             file_close(fd);
             fd = -1;
             unlink(newLog);
-            sd->cleanLog = NULL;
-            delete this;
-            return;
+            return false;
         }
 
         outbuf_offset = 0;
     }
+
+    return true;
 }
 
 bool
@@ -269,6 +329,38 @@ Fs::Ufs::UFSSwapDir::optionIODump(StoreEntry * e) const
     storeAppendPrintf(e, " IOEngine=%s", ioType);
 }
 
+bool
+Fs::Ufs::UFSSwapDir::optionCompactIndexParse(char const *option, const char *value, int isaReconfig)
+{
+    if (strcmp(option, "compact-index") != 0)
+        return false;
+
+    const bool enable = value ? xatoi(value) != 0 : true;
+
+    if (isaReconfig) {
+        // the index layout is chosen when the index is rebuilt
+        if (enable != (compactIndex != NULL))
+            debugs(3, DBG_IMPORTANT, "WARNING: cache_dir " << path << " compact-index change requires a restart");
+        return true;
+    }
+
+    if (enable && !compactIndex)
+        compactIndex = new UFSCompactIndex;
+    else if (!enable && compactIndex) {
+        delete compactIndex;
+        compactIndex = NULL;
+    }
+
+    return true;
+}
+
+void
+Fs::Ufs::UFSSwapDir::optionCompactIndexDump(StoreEntry * e) const
+{
+    if (compactIndex)
+        storeAppendPrintf(e, " compact-index");
+}
+
 ConfigOption *
 Fs::Ufs::UFSSwapDir::getOptionTree() const
 {
@@ -281,6 +373,8 @@ Fs::Ufs::UFSSwapDir::getOptionTree() const
 
     currentIOOptions->options.push_back(new ConfigOptionAdapter<UFSSwapDir>(*const_cast<UFSSwapDir *>(this), &UFSSwapDir::optionIOParse, &UFSSwapDir::optionIODump));
 
+    currentIOOptions->options.push_back(new ConfigOptionAdapter<UFSSwapDir>(*const_cast<UFSSwapDir *>(this), &UFSSwapDir::optionCompactIndexParse, &UFSSwapDir::optionCompactIndexDump));
+
     if (ConfigOption *ioOptions = IO->io->getOptionTree())
         currentIOOptions->options.push_back(ioOptions);
 
@@ -327,7 +421,7 @@ Fs::Ufs::UFSSwapDir::create()
     createSwapSubDirs();
 }
 
-Fs::Ufs::UFSSwapDir::UFSSwapDir(char const *aType, const char *anIOType) : SwapDir(aType), IO(NULL), map(new FileMap()), suggest(0), swaplog_fd (-1), currentIOOptions(new ConfigOptionVector()), ioType(xstrdup(anIOType)), cur_size(0), n_disk_objects(0)
+Fs::Ufs::UFSSwapDir::UFSSwapDir(char const *aType, const char *anIOType) : SwapDir(aType), IO(NULL), map(new FileMap()), suggest(0), swaplog_fd (-1), currentIOOptions(new ConfigOptionVector()), ioType(xstrdup(anIOType)), cur_size(0), n_disk_objects(0), compactIndex(NULL)
 {
     /* modulename is only set to disk modules that are built, by configure,
      * so the Find call should never return NULL here.
@@ -349,6 +443,8 @@ Fs::Ufs::UFSSwapDir::~UFSSwapDir()
 
     IO = NULL;
 
+    delete compactIndex;
+
     safe_free(ioType);
 }
 
@@ -399,6 +495,26 @@ Fs::Ufs::UFSSwapDir::statfs(StoreEntry & sentry) const
     storeAppendPrintf(&sentry, "Filemap bits in use: %d of %d (%d%%)\n",
                       map->numFilesInMap(), map->capacity(),
                       Math::intPercent(map->numFilesInMap(), map->capacity()));
+
+    // full entries also have a key copy and a replacement policy node
+    const uint64_t compactCount = compactIndex ? compactIndex->count() : 0;
+    const uint64_t fullCount = n_disk_objects > compactCount ? n_disk_objects - compactCount : 0;
+    const size_t fullBytes = sizeof(StoreEntry) + SQUID_MD5_DIGEST_LENGTH;
+    storeAppendPrintf(&sentry, "Full index entries: %" PRIu64 " (at least %d bytes each)\n",
+                      fullCount, static_cast<int>(fullBytes));
+    if (compactIndex) {
+        storeAppendPrintf(&sentry, "Compact index entries: %" PRIu64 " (%d bytes each)\n",
+                          compactCount, static_cast<int>(sizeof(UFSCompactIndex::Entry)));
+        storeAppendPrintf(&sentry, "Compact index memory: %.2f KB\n",
+                          compactIndex->memoryUsed() / 1024.0);
+    }
+    if (n_disk_objects > 0) {
+        const double indexBytes = static_cast<double>(fullCount) * fullBytes +
+                                  (compactIndex ? compactIndex->memoryUsed() : 0);
+        storeAppendPrintf(&sentry, "Index bytes per object: %.1f\n",
+                          indexBytes / n_disk_objects);
+    }
+
     x = storeDirGetUFSStats(path, &totl_kb, &free_kb, &totl_in, &free_in);
 
     if (0 == x) {
@@ -455,6 +571,20 @@ Fs::Ufs::UFSSwapDir::maintain()
 
     debugs(47, 3, HERE << "f=" << f << ", max_scan=" << max_scan << ", max_remove=" << max_remove  );
 
+    // Let the replacement policy choose among compact index entries too:
+    // offer it the least recently added ones, as many as we may remove.
+    std::vector<UFSCompactIndex::Entry> offered;
+    if (compactIndex && currentSize() >= minSize()) {
+        offered.reserve(max_remove);
+        for (int promoted = 0; promoted < max_remove; ++promoted) {
+            const UFSCompactIndex::Entry *cold = compactIndex->oldest();
+            if (!cold)
+                break;
+            offered.push_back(*cold);
+            promoteCompact(*cold, true);
+        }
+    }
+
     walker = repl->PurgeInit(repl, max_scan);
 
     while (1) {
@@ -475,6 +605,19 @@ Fs::Ufs::UFSSwapDir::maintain()
     }
 
     walker->Done(walker);
+
+    // return the offered entries that the policy kept to the compact index
+    int demoted = 0;
+    for (size_t i = 0; i < offered.size(); ++i) {
+        StoreEntry *kept = static_cast<StoreEntry *>(store_table->find(offered[i].key));
+        if (kept && kept->swap_dirn == index && kept->swap_filen == offered[i].swap_filen &&
+                demoteCompact(*kept))
+            ++demoted;
+    }
+    if (!offered.empty())
+        debugs(47, 3, HERE << path << " offered " << offered.size() <<
+               " compact entries, kept " << demoted);
+
     debugs(47, (removed ? 2 : 3), HERE << path <<
            " removed " << removed << "/" << max_remove << " f=" <<
            std::setprecision(4) << f << " max_scan=" << max_scan);
@@ -754,12 +897,43 @@ Fs::Ufs::UFSSwapDir::addDiskRestore(const cache_key * key,
                                     uint16_t newFlags,
                                     int clean)
 {
-    StoreEntry *e = NULL;
     debugs(47, 5, HERE << storeKeyText(key)  <<
            ", fileno="<< std::setfill('0') << std::hex << std::uppercase << std::setw(8) << file_number);
     /* if you call this you'd better be sure file_number is not
      * already in use! */
-    e = new StoreEntry();
+    mapBitSet(file_number);
+    cur_size += fs.blksize * sizeInBlocks(swap_file_sz);
+    ++n_disk_objects;
+
+    // special entries are locked and must stay in store_table
+    if (compactIndex && !EBIT_TEST(newFlags, ENTRY_SPECIAL)) {
+        if (compactIndex->add(key, file_number, swap_file_sz, expires, timestamp,
+                              lastref, lastmod, refcount, CompactFlags(newFlags))) {
+            logCompactEntry(*compactIndex->find(key), SWAP_LOG_ADD);
+            return NULL;
+        }
+    }
+
+    StoreEntry *e = restoreEntry(key, file_number, swap_file_sz, expires, timestamp,
+                                 lastref, lastmod, refcount, newFlags);
+    replacementAdd(e);
+    return e;
+}
+
+/// creates a StoreEntry for an already accounted for cache_dir object;
+/// the caller adds it to the replacement policy
+StoreEntry *
+Fs::Ufs::UFSSwapDir::restoreEntry(const cache_key * key,
+                                  sfileno file_number,
+                                  uint64_t swap_file_sz,
+                                  time_t expires,
+                                  time_t timestamp,
+                                  time_t lastref,
+                                  time_t lastmod,
+                                  uint32_t refcount,
+                                  uint16_t newFlags)
+{
+    StoreEntry *e = new StoreEntry();
     e->store_status = STORE_OK;
     e->setMemStatus(NOT_IN_MEMORY);
     e->swap_status = SWAPOUT_DONE;
@@ -778,14 +952,58 @@ Fs::Ufs::UFSSwapDir::addDiskRestore(const cache_key * key,
     EBIT_CLR(e->flags, KEY_PRIVATE);
     e->ping_status = PING_NONE;
     EBIT_CLR(e->flags, ENTRY_VALIDATED);
-    mapBitSet(e->swap_filen);
-    cur_size += fs.blksize * sizeInBlocks(e->swap_file_sz);
-    ++n_disk_objects;
     e->hashInsert(key); /* do it after we clear KEY_PRIVATE */
-    replacementAdd (e);
     return e;
 }
 
+/// moves a compact index entry to store_table and the replacement policy;
+/// a purge candidate goes where the policy looks for victims first
+StoreEntry *
+Fs::Ufs::UFSSwapDir::promoteCompact(const UFSCompactIndex::Entry &cold, const bool purgeCandidate)
+{
+    // copy everything we need before the record is gone
+    const UFSCompactIndex::Entry entry = cold;
+    compactIndex->remove(cold);
+
+    StoreEntry *e = restoreEntry(entry.key, entry.swap_filen, entry.swap_file_sz,
+                                 entry.expires, entry.timestamp, entry.lastref,
+                                 entry.lastmod, entry.refcount, entry.flags);
+    if (purgeCandidate) {
+        debugs(47, 4, HERE << "added cold node " << e << " to dir " << index);
+        repl->AddCold(repl, e, &e->repl);
+    } else
+        replacementAdd(e);
+
+    // storeCleanup() validates only entries promoted while it runs
+    if (!StoreController::store_dirs_rebuilding)
+        EBIT_SET(e->flags, ENTRY_VALIDATED);
+
+    debugs(47, 3, HERE << "promoted " << *e);
+    return e;
+}
+
+/// moves an idle StoreEntry back to the compact index
+/// \returns false if the entry must stay in store_table
+bool
+Fs::Ufs::UFSSwapDir::demoteCompact(StoreEntry &e)
+{
+    if (e.locked() || e.mem_obj || e.swap_status != SWAPOUT_DONE ||
+            EBIT_TEST(e.flags, RELEASE_REQUEST) || EBIT_TEST(e.flags, ENTRY_SPECIAL))
+        return false;
+
+    if (!compactIndex->add(static_cast<const cache_key *>(e.key), e.swap_filen, e.swap_file_sz, e.expires, e.timestamp,
+                           e.lastref, e.lastmod, e.refcount, CompactFlags(e.flags)))
+        return false;
+
+    debugs(47, 3, HERE << "demoting " << e);
+    replacementRemove(&e);
+    // the swap file and its swap.state record now belong to the compact entry
+    e.swap_filen = -1;
+    e.swap_dirn = -1;
+    destroyStoreEntry(static_cast<hash_link *>(&e));
+    return true;
+}
+
 void
 Fs::Ufs::UFSSwapDir::undoAddDiskRestore(StoreEntry *e)
 {
@@ -971,7 +1189,10 @@ Fs::Ufs::UFSSwapDir::writeCleanDone()
 
     state->walker->Done(state->walker);
 
-    if (FD_WRITE_METHOD(state->fd, state->outbuf, state->outbuf_offset) < 0) {
+    if (compactIndex)
+        state->write(*compactIndex);
+
+    if (state->fd >= 0 && FD_WRITE_METHOD(state->fd, state->outbuf, state->outbuf_offset) < 0) {
         debugs(50, DBG_CRITICAL, HERE << state->newLog << ": write: " << xstrerror());
         debugs(50, DBG_CRITICAL, HERE << "Current swap logfile not replaced.");
         file_close(state->fd);
@@ -1250,6 +1471,25 @@ Fs::Ufs::UFSSwapDir::search(String const url, HttpRequest *request)
     return new Fs::Ufs::StoreSearchUFS (this);
 }
 
+StoreEntry *
+Fs::Ufs::UFSSwapDir::get(const cache_key *key)
+{
+    if (!compactIndex)
+        return NULL;
+
+    const UFSCompactIndex::Entry *cold = compactIndex->find(key);
+    if (!cold)
+        return NULL;
+
+    return promoteCompact(*cold);
+}
+
+void
+Fs::Ufs::UFSSwapDir::get(String const key, STOREGETCLIENT aCallback, void *aCallbackData)
+{
+    SwapDir::get(key, aCallback, aCallbackData);
+}
+
 void
 Fs::Ufs::UFSSwapDir::logEntry(const StoreEntry & e, int op) const
 {
@@ -1264,6 +1504,21 @@ Fs::Ufs::UFSSwapDir::logEntry(const StoreEntry & e, int op) const
     s->refcount = e.refcount;
     s->flags = e.flags;
     memcpy(s->key, e.key, SQUID_MD5_DIGEST_LENGTH);
+    logRecord(s);
+}
+
+void
+Fs::Ufs::UFSSwapDir::logCompactEntry(const UFSCompactIndex::Entry &entry, int op) const
+{
+    StoreSwapLogData *s = new StoreSwapLogData;
+    PackCompactEntry(entry, op, *s);
+    logRecord(s);
+}
+
+/// finalizes and writes a swap log record, taking ownership of it
+void
+Fs::Ufs::UFSSwapDir::logRecord(StoreSwapLogData *s) const
+{
     s->finalize();
     file_write(swaplog_fd,
                -1,
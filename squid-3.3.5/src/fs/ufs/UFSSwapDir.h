@@ -35,9 +35,11 @@
 #include "StoreSearch.h"
 #include "SwapDir.h"
 #include "swap_log_op.h"
+#include "UFSCompactIndex.h"
 #include "UFSStrategy.h"
 
 class HttpRequest;
+class StoreSwapLogData;
 class ConfigOptionVector;
 class FileMap;
 class DiskIOModule;
@@ -68,6 +70,12 @@ public:
     virtual void dump(StoreEntry &) const;
     ~UFSSwapDir();
     virtual StoreSearch *search(String const url, HttpRequest *);
+    /** promote a compact index entry, if any, to a StoreEntry
+     *
+     * Other entries are in the global store_table already.
+     */
+    virtual StoreEntry *get(const cache_key *key);
+    virtual void get(String const, STOREGETCLIENT, void * cbdata);
     /** double-check swap during rebuild (-S command-line option)
      *
      * called by storeCleanup if needed
@@ -125,7 +133,10 @@ public:
     void mapBitSet(sfileno filn);
     /** Add a new object to the cache with empty memory copy and pointer to disk
      *
-     * This method is used to rebuild a store from disk
+     * This method is used to rebuild a store from disk. If the compact-index
+     * option is on, the object may be added to the compact index instead.
+     * In that case, the swap log ADD record is written here and nil is
+     * returned because there is no StoreEntry for the caller to log.
      */
     StoreEntry *addDiskRestore(const cache_key * key,
                                sfileno file_number,
@@ -152,6 +163,9 @@ public:
     void replacementAdd(StoreEntry *e);
     void replacementRemove(StoreEntry *e);
 
+    /// the number of entries in the compact index
+    uint32_t compactCount() const { return compactIndex ? compactIndex->count() : 0; }
+
 protected:
     FileMap *map;
     int suggest;
@@ -180,10 +194,26 @@ private:
     void changeIO(DiskIOModule *);
     bool optionIOParse(char const *option, const char *value, int reconfiguring);
     void optionIODump(StoreEntry * e) const;
+    bool optionCompactIndexParse(char const *option, const char *value, int reconfiguring);
+    void optionCompactIndexDump(StoreEntry * e) const;
+    StoreEntry *restoreEntry(const cache_key * key,
+                             sfileno file_number,
+                             uint64_t swap_file_sz,
+                             time_t expires,
+                             time_t timestamp,
+                             time_t lastref,
+                             time_t lastmod,
+                             uint32_t refcount,
+                             uint16_t flags);
+    StoreEntry *promoteCompact(const UFSCompactIndex::Entry &cold, bool purgeCandidate = false);
+    bool demoteCompact(StoreEntry &e);
+    void logCompactEntry(const UFSCompactIndex::Entry &entry, int op) const;
+    void logRecord(StoreSwapLogData *s) const;
     mutable ConfigOptionVector *currentIOOptions;
     char const *ioType;
     uint64_t cur_size; ///< currently used space in the storage area
     uint64_t n_disk_objects; ///< total number of objects stored
+    UFSCompactIndex *compactIndex; ///< cold entries without StoreEntry or nil
 };
 
 } //namespace Ufs
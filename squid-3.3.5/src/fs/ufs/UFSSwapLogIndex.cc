@@ -0,0 +1,202 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "StoreSwapLogData.h"
+#include "swap_log_op.h"
+#include "UFSSwapLogIndex.h"
+
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+Fs::Ufs::UFSSwapLogIndex::UFSSwapLogIndex():
+        mapping(NULL), mappingSize(0), records(NULL), count(0),
+        keys(*this), fileSlots(NULL), fileCapacity(0)
+{
+}
+
+Fs::Ufs::UFSSwapLogIndex::~UFSSwapLogIndex()
+{
+    unmap();
+}
+
+bool
+Fs::Ufs::UFSSwapLogIndex::map(FILE *fp)
+{
+    assert(fp);
+    assert(!mapping);
+
+#if HAVE_SYS_MMAN_H
+    const int fd = fileno(fp);
+    const long start = ftell(fp);
+    struct stat sb;
+    if (start < 0 || fstat(fd, &sb) != 0) {
+        debugs(47, DBG_IMPORTANT, "WARNING: cannot size swap log FD " << fd << ": " << xstrerror());
+        return false;
+    }
+
+    if (sb.st_size <= start)
+        return false;
+
+    const off_t recordCount = (sb.st_size - start) / sizeof(StoreSwapLogData);
+    // keep record numbers (plus one) and the slot count within 32 bits
+    if (recordCount <= 0 || recordCount > 0x3FFFFFFF)
+        return false;
+
+    mappingSize = start + recordCount * sizeof(StoreSwapLogData);
+    mapping = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        debugs(47, DBG_IMPORTANT, "WARNING: cannot mmap " << mappingSize <<
+               " swap log bytes from FD " << fd << ": " << xstrerror());
+        mapping = NULL;
+        mappingSize = 0;
+        return false;
+    }
+
+#if defined(MADV_SEQUENTIAL)
+    // both passes read the records in order
+    (void)madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+#endif
+
+    records = reinterpret_cast<const StoreSwapLogData *>(static_cast<const char *>(mapping) + start);
+    count = static_cast<int>(recordCount);
+
+    // keep the load factors under 75% even if all keys are unique
+    keys.reserve(count);
+    fileCapacity = keys.capacity();
+    fileSlots = static_cast<uint32_t *>(xcalloc(fileCapacity, sizeof(*fileSlots)));
+
+    debugs(47, 2, HERE << "mapped " << count << " swap log records from FD " << fd <<
+           " using " << keys.capacity() << " index slots");
+    return true;
+#else
+    return false;
+#endif
+}
+
+void
+Fs::Ufs::UFSSwapLogIndex::unmap()
+{
+#if HAVE_SYS_MMAN_H
+    if (mapping)
+        munmap(mapping, mappingSize);
+#endif
+    mapping = NULL;
+    mappingSize = 0;
+    records = NULL;
+    count = 0;
+
+    keys.clear();
+    safe_free(fileSlots);
+    fileCapacity = 0;
+}
+
+const StoreSwapLogData &
+Fs::Ufs::UFSSwapLogIndex::record(const int n) const
+{
+    assert(0 <= n && n < count);
+    return records[n];
+}
+
+const cache_key *
+Fs::Ufs::UFSSwapLogIndex::keyOf(const uint32_t n) const
+{
+    return record(n).key;
+}
+
+/// the position of the slot for the record swap file number: either empty
+/// or used by an ADD record with that file number
+uint32_t
+Fs::Ufs::UFSSwapLogIndex::findFile(const StoreSwapLogData &rec) const
+{
+    const sfileno filen = rec.swap_filen & 0x00FFFFFF;
+    const uint32_t mask = fileCapacity - 1;
+    uint32_t pos = (static_cast<uint32_t>(filen) * 2654435761U) & mask;
+    while (const uint32_t used = fileSlots[pos]) {
+        if ((records[used - 1].swap_filen & 0x00FFFFFF) == filen)
+            break;
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+bool
+Fs::Ufs::UFSSwapLogIndex::note(const int n)
+{
+    const StoreSwapLogData &rec = record(n);
+    uint32_t &slot = keys.slot(keys.find(rec.key));
+
+    if (rec.op == SWAP_LOG_ADD) {
+        // rebuildFromSwapLog() ignores an ADD if its swap file is used by
+        // a loaded entry of another key; the loaded entries are the latest
+        // ADDs of their keys
+        const uint32_t owner = fileSlots[findFile(rec)];
+        if (owner && owner != slot) {
+            const StoreSwapLogData &claim = record(owner - 1);
+            if (keys.slot(keys.find(claim.key)) == owner &&
+                    memcmp(claim.key, rec.key, SQUID_MD5_DIGEST_LENGTH) != 0)
+                return false;
+        }
+    }
+
+    bool supersedes = !slot;
+    if (!supersedes) {
+        // Mimic RebuildState::rebuildFromSwapLog() decisions for the same key:
+        // an ADD replaces an earlier ADD only if it was referenced later, and
+        // a DEL cancels an earlier ADD unless the ADD was referenced later.
+        const StoreSwapLogData &old = record(slot - 1);
+        if (old.op != SWAP_LOG_ADD)
+            supersedes = true;
+        else if (rec.op == SWAP_LOG_ADD && rec.lastref > old.lastref)
+            supersedes = true;
+        else if (rec.op == SWAP_LOG_DEL && rec.lastref >= old.lastref)
+            supersedes = true;
+    }
+
+    if (supersedes) {
+        slot = n + 1;
+        if (rec.op == SWAP_LOG_ADD)
+            fileSlots[findFile(rec)] = n + 1;
+    }
+    return true;
+}
+
+bool
+Fs::Ufs::UFSSwapLogIndex::latest(const int n) const
+{
+    return keys.slot(keys.find(record(n).key)) == static_cast<uint32_t>(n) + 1;
+}
@@ -0,0 +1,111 @@
+/*
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_FS_UFS_UFSSWAPLOGINDEX_H
+#define SQUID_FS_UFS_UFSSWAPLOGINDEX_H
+
+#include "UFSKeyTable.h"
+
+#include <stdio.h>
+
+class StoreSwapLogData;
+
+namespace Fs
+{
+namespace Ufs
+{
+
+/**
+ \ingroup UFS
+ *
+ * A temporary index of the latest swap.state record for each cache key.
+ *
+ * The index memory-maps the swap.state records so that they can be scanned
+ * in bulk, without per-record stdio calls. A first pass over the mapped
+ * records finds, for each key, the record that the old record-by-record
+ * rebuild would have ended up with. The second pass only loads those records
+ * into store_table, avoiding repeated store_table insertions and removals for
+ * frequently replaced objects.
+ *
+ * The index uses a UFSKeyTable with 32-bit slots that refer to mapped
+ * records, so the temporary memory overhead is a few bytes per record
+ * regardless of the swap.state record size. A second open addressing table
+ * maps swap file numbers to the ADD record that last claimed them, so that
+ * ADDs clashing with another key's file can be rejected the way the
+ * record-by-record rebuild rejects them.
+ */
+class UFSSwapLogIndex : private UFSKeyTable::Records
+{
+public:
+    UFSSwapLogIndex();
+    ~UFSSwapLogIndex();
+
+    /// maps native-format records located after the current fp position
+    /// \returns false if the records cannot be mapped for whatever reason
+    bool map(FILE *fp);
+
+    /// releases the mapped records and the index table
+    void unmap();
+
+    /// the number of mapped records
+    int entries() const { return count; }
+
+    /// the n-th mapped record
+    const StoreSwapLogData &record(const int n) const;
+
+    /// indexes the n-th record if it supersedes the indexed one with the same key
+    /// records must be noted in the swap.state order; the caller must not
+    /// note records that rebuildFromSwapLog() rejects regardless of order
+    /// \returns false if the record is an ADD whose swap file is claimed by
+    /// the latest ADD of another key
+    bool note(const int n);
+
+    /// whether the n-th record is the one to load for its key
+    bool latest(const int n) const;
+
+private:
+    /* UFSKeyTable::Records API */
+    virtual const cache_key *keyOf(uint32_t n) const;
+
+    uint32_t findFile(const StoreSwapLogData &rec) const;
+
+    void *mapping; ///< the result of mmap(2) or nil
+    size_t mappingSize; ///< the size of the mapping
+    const StoreSwapLogData *records; ///< the first mapped record
+    int count; ///< the number of mapped records
+
+    UFSKeyTable keys; ///< the record to load for each key
+    uint32_t *fileSlots; ///< record number plus one of the last ADD claiming a swap file
+    uint32_t fileCapacity; ///< the number of fileSlots; zero or a power of two
+};
+
+} // namespace Ufs
+} // namespace Fs
+
+#endif /* SQUID_FS_UFS_UFSSWAPLOGINDEX_H */
@@ -96,6 +96,7 @@ public:
         assert(log);
         return fread(&swapData, sizeof(StoreSwapLogData), 1, log) == 1;
     }
+    bool Mappable() const { return true; }
 };
 
 Fs::Ufs::UFSSwapLogParser *
@@ -53,6 +53,9 @@ public:
     static UFSSwapLogParser *GetUFSSwapLogParser(FILE *fp);
 
     virtual bool ReadRecord(StoreSwapLogData &swapData) = 0;
+    /// whether on-disk records use the current StoreSwapLogData layout
+    /// and, hence, may be accessed in place (e.g., via UFSSwapLogIndex)
+    virtual bool Mappable() const { return false; }
     int SwapLogEntries();
     void Close() {
         if (log) {
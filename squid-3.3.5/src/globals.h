@@ -41,6 +41,8 @@
 #include <stdio.h>
 #endif
 
+class StoreKeyTable;
+
 extern char *ConfigFile;	/* NULL */
 extern char *IcpOpcodeStr[];
 extern char tmp_error_buf[ERROR_BUF_SZ];
@@ -93,7 +95,7 @@ extern int reconfiguring;	/* 0 */
 extern time_t hit_only_mode_until;	/* 0 */
 extern double request_failure_ratio;	/* 0.0 */
 extern int store_hash_buckets;	/* 0 */
-extern hash_table *store_table;	/* NULL */
+extern StoreKeyTable *store_table;	/* NULL */
 extern int hot_obj_count;	/* 0 */
 extern int CacheDigestHashFuncCount;	/* 4 */
 extern CacheDigest *store_digest;	/* NULL */
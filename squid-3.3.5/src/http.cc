@@ -790,6 +790,7 @@ HttpStateData::processReplyHeader()
         {
             debugs(11, 3, "processReplyHeader: Non-HTTP-compliant header: '" <<  readBuf->content() << "'");
             flags.headers_parsed = true;
+            request->phases.stop(PhaseTimes::phServer);
             newrep->sline.version = HttpVersion(1,1);
             newrep->sline.status = error;
             HttpReply *vrep = setVirginReply(newrep);
@@ -835,6 +836,7 @@ HttpStateData::processReplyHeader()
 
     HttpReply *vrep = setVirginReply(newrep);
     flags.headers_parsed = true;
+    request->phases.stop(PhaseTimes::phServer);
 
     keepaliveAccounting(vrep);
 
@@ -2366,6 +2368,7 @@ HttpStateData::sendRequest()
     debugs(11, 2, "HTTP Server " << serverConnection);
     debugs(11, 2, "HTTP Server REQUEST:\n---------\n" << mb.buf << "\n----------");
 
+    request->phases.start(PhaseTimes::phServer);
     Comm::Write(serverConnection, &mb, requestSender);
     return true;
 }
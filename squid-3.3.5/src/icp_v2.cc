@@ -810,7 +810,8 @@ icpCount(void *buf, int which, size_t len, int delay)
             ++statCounter.icp.replies_sent;
             kb_incr(&statCounter.icp.r_kbytes_sent, len);
             /* this is the sent-reply service time */
-            statCounter.icp.replySvcTime.count(delay);
+            if (delay >= 0)
+                statCounter.icp.replySvcTime.count(delay);
         }
 
         if (ICP_HIT == icp->opcode)
@@ -28,7 +28,8 @@ CBDATA_NAMESPACED_CLASS_INIT(Ipc, Coordinator);
 Ipc::Coordinator* Ipc::Coordinator::TheInstance = NULL;
 
 Ipc::Coordinator::Coordinator():
-        Port(coordinatorAddr)
+        Port(coordinatorAddr),
+        lastPconnDonor(0)
 {
 }
 
@@ -60,6 +61,16 @@ void Ipc::Coordinator::registerStrand(const StrandCoord& strand)
         strands_.push_back(strand);
     }
 
+    // a (re)started kid has no idle connections to donate
+    typedef PconnRegistry::iterator PRI;
+    for (PRI i = pconnDonors.begin(); i != pconnDonors.end();) {
+        i->second.erase(strand.kidId);
+        if (i->second.empty())
+            pconnDonors.erase(i++);
+        else
+            ++i;
+    }
+
     // notify searchers waiting for this new strand, if any
     typedef Searchers::iterator SRI;
     for (SRI i = searchers.begin(); i != searchers.end();) {
@@ -93,6 +104,16 @@ void Ipc::Coordinator::receive(const TypedMsgHdr& message)
         handleSharedListenRequest(SharedListenRequest(message));
         break;
 
+    case mtPconnAvailability:
+        debugs(54, 6, HERE << "Idle connection availability");
+        handlePconnAvailability(PconnAvailability(message));
+        break;
+
+    case mtPconnRequest:
+        debugs(54, 6, HERE << "Idle connection request");
+        handlePconnRequest(PconnRequest(message));
+        break;
+
     case mtCacheMgrRequest: {
         debugs(54, 6, HERE << "Cache manager request");
         const Mgr::Request req(message);
@@ -159,6 +180,61 @@ Ipc::Coordinator::handleSharedListenRequest(const SharedListenRequest& request)
     SendMessage(MakeAddr(strandAddrPfx, request.requestorId), message);
 }
 
+void
+Ipc::Coordinator::handlePconnAvailability(const PconnAvailability& availability)
+{
+    debugs(54, 4, HERE << "kid" << availability.kidId <<
+           (availability.available ? " has" : " has no") <<
+           " idle connections for " << availability.key);
+    const std::string key(availability.key.termedBuf());
+    if (availability.available) {
+        pconnDonors[key].insert(availability.kidId);
+        return;
+    }
+
+    const PconnRegistry::iterator i = pconnDonors.find(key);
+    if (i != pconnDonors.end()) {
+        i->second.erase(availability.kidId);
+        if (i->second.empty())
+            pconnDonors.erase(i);
+    }
+}
+
+void
+Ipc::Coordinator::handlePconnRequest(const PconnRequest& request)
+{
+    const PconnRegistry::const_iterator i =
+        pconnDonors.find(std::string(request.key.termedBuf()));
+    if (i == pconnDonors.end()) {
+        debugs(54, 4, HERE << "no idle connections for " << request.key <<
+               " wanted by kid" << request.requestorId);
+        return;
+    }
+
+    // rotate among donors so that no kid is drained first
+    const PconnDonors &donors = i->second;
+    PconnDonors::const_iterator d = donors.upper_bound(lastPconnDonor);
+    for (size_t tries = 0; tries < donors.size(); ++tries) {
+        if (d == donors.end())
+            d = donors.begin();
+        if (*d != request.requestorId)
+            break;
+        ++d;
+    }
+    if (d == donors.end() || *d == request.requestorId) {
+        debugs(54, 4, HERE << "only kid" << request.requestorId <<
+               " has idle connections for " << request.key);
+        return;
+    }
+
+    lastPconnDonor = *d;
+    debugs(54, 3, HERE << "asking kid" << lastPconnDonor << " to give kid" <<
+           request.requestorId << " an idle connection for " << request.key);
+    TypedMsgHdr message;
+    request.pack(message);
+    SendMessage(MakeAddr(strandAddrPfx, lastPconnDonor), message);
+}
+
 void
 Ipc::Coordinator::handleCacheMgrRequest(const Mgr::Request& request)
 {
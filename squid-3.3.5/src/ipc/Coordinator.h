@@ -10,6 +10,7 @@
 #include "ipc/Messages.h"
 #include "ipc/Port.h"
 #include "ipc/SharedListen.h"
+#include "ipc/SharedPconn.h"
 #include "ipc/StrandCoords.h"
 #include "ipc/StrandSearch.h"
 #include "mgr/forward.h"
@@ -18,6 +19,8 @@
 #endif
 #include <list>
 #include <map>
+#include <set>
+#include <string>
 
 namespace Ipc
 {
@@ -50,6 +53,10 @@ protected:
 
     /// returns cached socket or calls openListenSocket()
     void handleSharedListenRequest(const SharedListenRequest& request);
+    /// remembers which kids have spare idle connections for the key
+    void handlePconnAvailability(const PconnAvailability& availability);
+    /// forwards the request to a kid with spare idle connections, if any
+    void handlePconnRequest(const PconnRequest& request);
     void handleCacheMgrRequest(const Mgr::Request& request);
     void handleCacheMgrResponse(const Mgr::Response& response);
 #if SQUID_SNMP
@@ -68,6 +75,11 @@ private:
     typedef std::map<OpenListenerParams, Comm::ConnectionPointer> Listeners; ///< params:connection map
     Listeners listeners; ///< cached comm_open_listener() results
 
+    typedef std::set<int> PconnDonors; ///< kidIds
+    typedef std::map<std::string, PconnDonors> PconnRegistry; ///< key:donors map
+    PconnRegistry pconnDonors; ///< kids with spare idle connections, by key
+    int lastPconnDonor; ///< the last kid asked to donate a connection
+
     static Coordinator* TheInstance; ///< the only class instance in existence
 
 private:
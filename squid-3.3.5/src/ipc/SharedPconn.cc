@@ -0,0 +1,92 @@
+/*
+ * DEBUG: section 54    Interprocess Communication
+ *
+ */
+
+#include "squid.h"
+#include "ipc/Messages.h"
+#include "ipc/SharedPconn.h"
+#include "ipc/TypedMsgHdr.h"
+
+/* PconnAvailability */
+
+Ipc::PconnAvailability::PconnAvailability(int aKidId, const char *aKey, bool isAvailable):
+        kidId(aKidId), key(aKey), available(isAvailable)
+{
+}
+
+Ipc::PconnAvailability::PconnAvailability(const TypedMsgHdr &hdrMsg):
+        kidId(-1), available(false)
+{
+    hdrMsg.checkType(mtPconnAvailability);
+    hdrMsg.getPod(kidId);
+    hdrMsg.getString(key);
+    hdrMsg.getPod(available);
+}
+
+void Ipc::PconnAvailability::pack(TypedMsgHdr &hdrMsg) const
+{
+    hdrMsg.setType(mtPconnAvailability);
+    hdrMsg.putPod(kidId);
+    hdrMsg.putString(key);
+    hdrMsg.putPod(available);
+}
+
+/* PconnRequest */
+
+Ipc::PconnRequest::PconnRequest(int aRequestorId, const char *aKey, const Ip::Address &aRemote, const char *aDomain):
+        requestorId(aRequestorId), key(aKey), remote(aRemote)
+{
+    if (aDomain)
+        domain = aDomain;
+}
+
+Ipc::PconnRequest::PconnRequest(const TypedMsgHdr &hdrMsg):
+        requestorId(-1)
+{
+    hdrMsg.checkType(mtPconnRequest);
+    hdrMsg.getPod(requestorId);
+    hdrMsg.getString(key);
+    hdrMsg.getPod(remote);
+    hdrMsg.getString(domain);
+}
+
+void Ipc::PconnRequest::pack(TypedMsgHdr &hdrMsg) const
+{
+    hdrMsg.setType(mtPconnRequest);
+    hdrMsg.putPod(requestorId);
+    hdrMsg.putString(key);
+    hdrMsg.putPod(remote);
+    hdrMsg.putString(domain);
+}
+
+/* PconnDonation */
+
+Ipc::PconnDonation::PconnDonation(): donorId(-1), fd(-1), flags(0)
+{
+}
+
+Ipc::PconnDonation::PconnDonation(const TypedMsgHdr &hdrMsg):
+        donorId(-1), fd(-1), flags(0)
+{
+    hdrMsg.checkType(mtPconnDonation);
+    hdrMsg.getPod(donorId);
+    hdrMsg.getPod(local);
+    hdrMsg.getPod(remote);
+    hdrMsg.getPod(flags);
+    hdrMsg.getString(peer);
+    hdrMsg.getString(domain);
+    fd = hdrMsg.getFd();
+}
+
+void Ipc::PconnDonation::pack(TypedMsgHdr &hdrMsg) const
+{
+    hdrMsg.setType(mtPconnDonation);
+    hdrMsg.putPod(donorId);
+    hdrMsg.putPod(local);
+    hdrMsg.putPod(remote);
+    hdrMsg.putPod(flags);
+    hdrMsg.putString(peer);
+    hdrMsg.putString(domain);
+    hdrMsg.putFd(fd);
+}
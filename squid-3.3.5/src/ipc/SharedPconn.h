@@ -0,0 +1,73 @@
+/*
+ * DEBUG: section 54    Interprocess Communication
+ *
+ */
+
+#ifndef SQUID_IPC_SHARED_PCONN_H
+#define SQUID_IPC_SHARED_PCONN_H
+
+#include "ip/Address.h"
+#include "SquidString.h"
+
+namespace Ipc
+{
+
+/// "shared pconn" is when an SMP worker hands an idle persistent server
+/// connection to another worker that wants a connection to the same server
+
+class TypedMsgHdr;
+
+/// tells Coordinator whether the kid has spare idle connections for a key
+class PconnAvailability
+{
+public:
+    PconnAvailability(int aKidId, const char *aKey, bool isAvailable);
+    explicit PconnAvailability(const TypedMsgHdr &hdrMsg); ///< from recvmsg()
+    void pack(TypedMsgHdr &hdrMsg) const; ///< prepare for sendmsg()
+
+public:
+    int kidId; ///< kidId of the sender
+    String key; ///< PconnPool key of the idle connections
+    bool available; ///< whether the sender has spare idle connections
+};
+
+/// a request for an idle connection with the given key; sent by the
+/// requestor to Coordinator and then forwarded to a potential donor kid
+class PconnRequest
+{
+public:
+    PconnRequest(int aRequestorId, const char *aKey, const Ip::Address &aRemote, const char *aDomain);
+    explicit PconnRequest(const TypedMsgHdr &hdrMsg); ///< from recvmsg()
+    void pack(TypedMsgHdr &hdrMsg) const; ///< prepare for sendmsg()
+
+public:
+    int requestorId; ///< kidId of the requestor
+    String key; ///< PconnPool key of the wanted connection
+    Ip::Address remote; ///< server address and port of the wanted connection
+    String domain; ///< PconnPool domain of the wanted connection or empty
+};
+
+/// an idle connection sent by the donor kid to the requestor
+class PconnDonation
+{
+public:
+    PconnDonation();
+    explicit PconnDonation(const TypedMsgHdr &hdrMsg); ///< from recvmsg()
+    void pack(TypedMsgHdr &hdrMsg) const; ///< prepare for sendmsg()
+
+public:
+    int donorId; ///< kidId of the donor
+    int fd; ///< the donated socket
+
+    /* bits to re-create the Comm::Connection */
+    Ip::Address local;
+    Ip::Address remote;
+    int flags;
+    String peer; ///< cache_peer name or empty for direct connections
+
+    String domain; ///< PconnPool domain the connection was pooled with
+};
+
+} // namespace Ipc;
+
+#endif /* SQUID_IPC_SHARED_PCONN_H */
@@ -39,7 +39,8 @@ void Ipc::StartListening(int sock_type, int proto,
     Must(cbd);
     cbd->conn = listenConn;
 
-    if (UsingSmp()) { // if SMP is on, share
+    // if SMP is on, share unless each kid should listen on its own socket
+    if (UsingSmp() && !(listenConn->flags & COMM_REUSEPORT)) {
         OpenListenerParams p;
         p.sock_type = sock_type; // SOCK_STREAM
         p.proto = proto;
@@ -12,6 +12,7 @@
 #include "ipc/StrandCoord.h"
 #include "ipc/Messages.h"
 #include "ipc/SharedListen.h"
+#include "ipc/SharedPconn.h"
 #include "ipc/StrandSearch.h"
 #include "ipc/Kids.h"
 #include "mgr/Request.h"
@@ -19,6 +20,7 @@
 #include "mgr/Forwarder.h"
 #include "SwapDir.h" /* XXX: scope boundary violation */
 #include "CacheManager.h"
+#include "pconn.h" /* XXX: scope boundary violation */
 #if USE_DISKIO_IPCIO
 #include "DiskIO/IpcIo/IpcIoFile.h" /* XXX: scope boundary violation */
 #endif
@@ -67,6 +69,14 @@ void Ipc::Strand::receive(const TypedMsgHdr &message)
         SharedListenJoined(SharedListenResponse(message));
         break;
 
+    case mtPconnRequest:
+        PconnPool::HandleIdleConnRequest(PconnRequest(message));
+        break;
+
+    case mtPconnDonation:
+        PconnPool::HandleIdleConnDonation(PconnDonation(message));
+        break;
+
 #if USE_DISKIO_IPCIO
     case mtStrandSearchResponse:
         IpcIoFile::HandleOpenResponse(StrandSearchResponse(message));
@@ -0,0 +1,142 @@
+/*
+ * DEBUG: section 54    Interprocess Communication
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "ipc/TokenBuckets.h"
+
+/// how many consecutive buckets to search for a key before giving up
+static const int MaxProbes = 16;
+
+/// buckets that nobody refilled for this long (msec) may be given to others
+static const int64_t IdleTimeout = 300 * 1000;
+
+Ipc::TokenBucket::TokenBucket(): key(0), level(0), refilled(0)
+{
+}
+
+void
+Ipc::TokenBucket::refill(const int64_t now, const double rate, const int limit)
+{
+    const int64_t last = refilled.get();
+    if (now <= last)
+        return;
+
+    // do not update the timestamp until we can add at least one token
+    // so that slow rates and frequent refills do not starve the bucket
+    const double gain = (now - last) * rate / 1000;
+    if (gain < 1.0 && rate > 0)
+        return;
+
+    // whoever updates the timestamp adds tokens for the entire interval
+    if (!refilled.swap_if(last, now))
+        return;
+
+    const int current = level.get();
+    if (current >= limit || gain <= 0)
+        return;
+
+    const double room = static_cast<double>(limit) - current;
+    level += static_cast<int>(gain < room ? gain : room);
+}
+
+void
+Ipc::TokenBucket::reset(const int initialLevel, const int64_t now)
+{
+    int oldLevel = level.get();
+    while (!level.swap_if(oldLevel, initialLevel))
+        oldLevel = level.get();
+
+    int64_t oldTime = refilled.get();
+    while (oldTime < now && !refilled.swap_if(oldTime, now))
+        oldTime = refilled.get();
+}
+
+Ipc::TokenBuckets::Owner *
+Ipc::TokenBuckets::Init(const char *const path, const int limit)
+{
+    assert(limit > 0); // we should not be created otherwise
+    Owner *const owner = shm_new(Shared)(path, limit);
+    debugs(54, 5, HERE << "new token buckets [" << path << "] created: " << limit);
+    return owner;
+}
+
+Ipc::TokenBuckets::TokenBuckets(const char *const path):
+        shared(shm_old(Shared)(path))
+{
+    assert(shared->limit > 0); // we should not be created otherwise
+    debugs(54, 5, HERE << "attached token buckets [" << path << "] created: " <<
+           shared->limit);
+}
+
+Ipc::TokenBucket *
+Ipc::TokenBuckets::bucket(const uint64_t key, const int initialLevel, const int64_t now)
+{
+    assert(key); // zero marks unused buckets
+    const int start = static_cast<int>(key % shared->limit);
+    const int probes = min(MaxProbes, shared->limit);
+
+    // look for an existing bucket first so that we do not claim a second one
+    for (int i = 0; i < probes; ++i) {
+        TokenBucket &b = shared->buckets[(start + i) % shared->limit];
+        if (b.key.get() == key)
+            return &b;
+    }
+
+    for (int i = 0; i < probes; ++i) {
+        TokenBucket &b = shared->buckets[(start + i) % shared->limit];
+        const uint64_t owner = b.key.get();
+        if (!owner || b.refilled.get() + IdleTimeout < now) {
+            if (TokenBucket *result = claim(b, owner, key, initialLevel, now))
+                return result;
+        }
+    }
+
+    debugs(54, 5, HERE << "no free token buckets for " << key);
+    return NULL;
+}
+
+/// gives an unused or idle bucket to key unless another kid got it first
+Ipc::TokenBucket *
+Ipc::TokenBuckets::claim(TokenBucket &b, const uint64_t owner, const uint64_t key, const int initialLevel, const int64_t now)
+{
+    if (!b.key.swap_if(owner, key))
+        return b.key.get() == key ? &b : NULL; // lost the race
+
+    // other kids may see the old level until we reset it; that is harmless
+    b.reset(initialLevel, now);
+    if (!owner)
+        ++shared->count;
+    debugs(54, 7, HERE << "claimed token bucket for " << key);
+    return &b;
+}
+
+int
+Ipc::TokenBuckets::entryCount() const
+{
+    return shared->count;
+}
+
+int
+Ipc::TokenBuckets::entryLimit() const
+{
+    return shared->limit;
+}
+
+Ipc::TokenBuckets::Shared::Shared(const int aLimit): limit(aLimit), count(0),
+        buckets(aLimit)
+{
+}
+
+size_t
+Ipc::TokenBuckets::Shared::sharedMemorySize() const
+{
+    return SharedMemorySize(limit);
+}
+
+size_t
+Ipc::TokenBuckets::Shared::SharedMemorySize(const int limit)
+{
+    return sizeof(Shared) + limit * sizeof(TokenBucket);
+}
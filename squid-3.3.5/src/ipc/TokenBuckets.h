@@ -0,0 +1,80 @@
+/*
+ */
+
+#ifndef SQUID_IPC_TOKEN_BUCKETS_H
+#define SQUID_IPC_TOKEN_BUCKETS_H
+
+#include "ipc/AtomicWord.h"
+#include "ipc/mem/FlexibleArray.h"
+#include "ipc/mem/Pointer.h"
+
+namespace Ipc
+{
+
+/// A token bucket in memory shared by kids. Each kid refills the bucket
+/// lazily, but the refill timestamp ensures that the configured rate is
+/// added only once per elapsed interval, no matter how many kids use it.
+class TokenBucket
+{
+public:
+    TokenBucket();
+
+    /// adds tokens accumulated at rate (per second) since the last refill,
+    /// without exceeding limit; now is in milliseconds
+    void refill(const int64_t now, const double rate, const int limit);
+
+    /// removes qty tokens; the level may become negative when kids overspend
+    void consume(const int qty) { level += -qty; }
+
+    /// the number of tokens available now
+    int tokens() const { return level.get(); }
+
+    /// prepares a freshly claimed bucket for its new owner
+    void reset(const int initialLevel, const int64_t now);
+
+    Atomic::WordT<uint64_t> key; ///< bucket owner ID or zero if unused
+    Atomic::WordT<int> level; ///< tokens available; may be negative
+    Atomic::WordT<int64_t> refilled; ///< last refill time in milliseconds
+};
+
+/// a fixed-size open-addressing table of shared token buckets indexed by
+/// caller-supplied 64-bit keys
+class TokenBuckets
+{
+public:
+    /// data shared across tables in different processes
+    class Shared
+    {
+    public:
+        explicit Shared(const int aLimit);
+        size_t sharedMemorySize() const;
+        static size_t SharedMemorySize(const int limit);
+
+        const int limit; ///< maximum number of buckets
+        Atomic::Word count; ///< number of buckets ever claimed
+        Ipc::Mem::FlexibleArray<TokenBucket> buckets; ///< buckets storage
+    };
+
+    typedef Mem::Owner<Shared> Owner;
+
+    /// initialize shared memory
+    static Owner *Init(const char *const path, const int limit);
+
+    explicit TokenBuckets(const char *const path);
+
+    /// finds the bucket owned by key or claims a free or idle one, filling
+    /// it with initialLevel tokens; returns nil if no bucket is available
+    TokenBucket *bucket(const uint64_t key, const int initialLevel, const int64_t now);
+
+    int entryCount() const; ///< number of claimed buckets
+    int entryLimit() const; ///< maximum number of buckets
+
+private:
+    TokenBucket *claim(TokenBucket &b, const uint64_t owner, const uint64_t key, const int initialLevel, const int64_t now);
+
+    Mem::Pointer<Shared> shared;
+};
+
+} // namespace Ipc
+
+#endif /* SQUID_IPC_TOKEN_BUCKETS_H */
@@ -604,7 +604,8 @@ ipcacheHandleReply(void *data, const rfc1035_rr * answers, int na, const char *e
     static_cast<generic_cbdata *>(data)->unwrap(&i);
     ++IpcacheStats.replies;
     const int age = i->age();
-    statCounter.dns.svcTime.count(age);
+    if (i->request_time.tv_sec)
+        statCounter.dns.svcTime.count(i->request_time, current_time);
 
 #if USE_DNSHELPER
     ipcacheParse(i, reply);
@@ -106,6 +106,8 @@
 #if ICAP_CLIENT
 #include "adaptation/icap/Config.h"
 #include "adaptation/icap/icap_log.h"
+#include "adaptation/icap/ResultCache.h"
+#include "adaptation/icap/ServiceRep.h"
 #endif
 #if USE_AUTH
 #include "auth/Gadgets.h"
@@ -124,6 +126,7 @@
 #include "ssl/certificate_db.h"
 #endif
 #if USE_SSL
+#include "ssl/CertSigner.h"
 #include "ssl/context_storage.h"
 #endif
 #if ICAP_CLIENT
@@ -1049,6 +1052,10 @@ mainInitialize(void)
     Ssl::Helper::GetInstance()->Init();
 #endif
 
+#if USE_SSL
+    Ssl::CertSignerStart();
+#endif
+
     redirectInit();
 #if USE_AUTH
     authenticateInit(&Auth::TheConfig);
@@ -1102,6 +1109,10 @@ mainInitialize(void)
         /* register the modules in the cache manager menus */
 
         cbdataRegisterWithCacheManager();
+#if ICAP_CLIENT
+        Adaptation::Icap::ResultCache::RegisterWithCacheManager();
+        Adaptation::Icap::ServiceRep::RegisterWithCacheManager();
+#endif
         /* These use separate calls so that the comm loops can eventually
          * coexist.
          */
@@ -1841,6 +1852,9 @@ SquidShutdown()
     dnsShutdown();
 #if USE_SSL_CRTD
     Ssl::Helper::GetInstance()->Shutdown();
+#endif
+#if USE_SSL
+    Ssl::CertSignerStop();
 #endif
     redirectShutdown();
     externalAclShutdown();
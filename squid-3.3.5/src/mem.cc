@@ -39,6 +39,7 @@
 #include "event.h"
 #include "md5.h"
 #include "Mem.h"
+#include "MemArena.h"
 #include "MemBuf.h"
 #include "memMeter.h"
 #include "mgr/Registration.h"
@@ -155,6 +156,10 @@ memStringStats(std::ostream &stream)
     stream << xpercentInt(StrCountMeter.level - pooled_count, StrCountMeter.level) << "\t ";
 
     stream << xpercentInt(StrVolumeMeter.level - pooled_volume, StrVolumeMeter.level) << "\n\n";
+
+    /* copy-on-write sharing of String buffers */
+    String::GetStats().dump(stream);
+    stream << "\n";
 }
 
 static void
@@ -172,6 +177,7 @@ Mem::Stats(StoreEntry * sentry)
     Report(stream);
     memStringStats(stream);
     memBufStats(stream);
+    MemArena::Stats(stream);
 #if WITH_VALGRIND
     if (RUNNING_ON_VALGRIND) {
         long int leaked = 0, dubious = 0, reachable = 0, suppressed = 0;
@@ -826,3 +832,129 @@ Mem::Report(std::ostream &stream)
     stream << "Pools ever used:     " << mp_total.tot_pools_alloc - not_used << " (shown above)\n";
     stream << "Currently in use:    " << mp_total.tot_pools_inuse << "\n";
 }
+
+/* MemArena */
+
+/// provides arena blocks
+static MemAllocator *ArenaBlockPool = NULL;
+
+/// arena usage statistics
+static struct {
+    uint64_t arenas; ///< destroyed arenas
+    uint64_t idleArenas; ///< destroyed arenas that allocated nothing
+    uint64_t inlineArenas; ///< destroyed arenas that needed no blocks
+    uint64_t allocations; ///< alloc() calls
+    uint64_t blocks; ///< pooled blocks allocated
+    uint64_t oversized; ///< xmalloc()ed blocks
+} ArenaStats;
+
+/// alignment of arena allocations and block payloads
+static const size_t ArenaAlignment = 8;
+
+static size_t
+ArenaAligned(size_t size)
+{
+    return (size + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+}
+
+MemArena::MemArena(): blocks_(NULL), free_(inline_.buf_), avail_(InlineSize)
+{
+}
+
+MemArena::~MemArena()
+{
+    ++ArenaStats.arenas;
+    if (avail_ == InlineSize && !blocks_)
+        ++ArenaStats.idleArenas;
+    else if (!blocks_)
+        ++ArenaStats.inlineArenas;
+
+    reset();
+}
+
+void
+MemArena::reset()
+{
+    while (Block *block = blocks_) {
+        blocks_ = block->next;
+        if (block->pooled)
+            ArenaBlockPool->freeOne(block);
+        else
+            xfree(block);
+    }
+
+    free_ = inline_.buf_;
+    avail_ = InlineSize;
+}
+
+void *
+MemArena::alloc(size_t size)
+{
+    const size_t headerSize = ArenaAligned(sizeof(Block));
+    size = ArenaAligned(size ? size : 1);
+    ++ArenaStats.allocations;
+
+    if (size > avail_) {
+        if (headerSize + size > BlockSize) {
+            // keep using the current buffer for smaller requests
+            Block *block = static_cast<Block *>(xmalloc(headerSize + size));
+            block->pooled = false;
+            block->next = blocks_;
+            blocks_ = block;
+            ++ArenaStats.oversized;
+            return reinterpret_cast<char *>(block) + headerSize;
+        }
+
+        if (!ArenaBlockPool) {
+            ArenaBlockPool = memPoolCreate("MemArena block", BlockSize);
+            ArenaBlockPool->zeroOnPush(false);
+        }
+
+        Block *block = static_cast<Block *>(ArenaBlockPool->alloc());
+        block->pooled = true;
+        block->next = blocks_;
+        blocks_ = block;
+        ++ArenaStats.blocks;
+        free_ = reinterpret_cast<char *>(block) + headerSize;
+        avail_ = BlockSize - headerSize;
+    }
+
+    void *result = free_;
+    free_ += size;
+    avail_ -= size;
+    return result;
+}
+
+char *
+MemArena::dup(const char *s)
+{
+    const size_t sz = strlen(s) + 1;
+    return static_cast<char *>(memcpy(alloc(sz), s, sz));
+}
+
+char *
+MemArena::ndup(const char *s, size_t n)
+{
+    size_t sz = strlen(s) + 1;
+    if (sz > n)
+        sz = n;
+    return xstrncpy(static_cast<char *>(alloc(sz)), s, sz);
+}
+
+void
+MemArena::Stats(std::ostream &stream)
+{
+    const uint64_t heapAllocations = ArenaStats.blocks + ArenaStats.oversized;
+    const uint64_t saved = ArenaStats.allocations > heapAllocations ?
+                           ArenaStats.allocations - heapAllocations : 0;
+
+    stream << "\nTransaction memory arenas:\n" <<
+    "\tdestroyed arenas: " << ArenaStats.arenas << "\n" <<
+    "\t  unused: " << ArenaStats.idleArenas << "\n" <<
+    "\t  using only the embedded " << InlineSize << " byte buffer: " << ArenaStats.inlineArenas << "\n" <<
+    "\tarena allocations: " << ArenaStats.allocations << "\n" <<
+    "\tpooled " << BlockSize << " byte blocks: " << ArenaStats.blocks << "\n" <<
+    "\toversized blocks: " << ArenaStats.oversized << "\n" <<
+    "\tallocations saved: " << saved << " (" <<
+    std::setprecision(3) << xpercent(saved, ArenaStats.allocations) << "%)\n";
+}
@@ -34,55 +34,71 @@
 #include "squid.h"
 #include "mem_node.h"
 
-static ptrdiff_t makeMemNodeDataOffset();
+/// bytes reserved in front of node data for a back pointer to the node;
+/// a multiple of the strictest alignment to keep node data aligned
+static const size_t DataPrefix = 16;
 
-static ptrdiff_t _mem_node_data_offset = makeMemNodeDataOffset();
-
-/*
- * Calculate the offset between the start of a mem_node and
- * its 'data' member
- */
-static ptrdiff_t
-makeMemNodeDataOffset()
-{
-    mem_node *p = 0L;
-    return ptrdiff_t(&p->data);
-}
+/// total capacity of all nodes, in bytes
+static size_t TheStoreMemSize = 0;
 
 /*
  * This is the callback when storeIOWrite() is done.  We need to
- * clear the write_pending flag for the mem_node.  First we have
- * to calculate the start of the mem_node based on the character
- * buffer that we wrote.  ick.
+ * clear the write_pending flag for the mem_node.  Node data is
+ * preceded by a pointer to its node; see mem_node::allocate().
  */
 void
 memNodeWriteComplete(void* d)
 {
-    mem_node* n = (mem_node*)((char*)d - _mem_node_data_offset);
+    mem_node* n = *reinterpret_cast<mem_node **>(static_cast<char *>(d) - DataPrefix);
     assert(n->write_pending);
     n->write_pending = 0;
 }
 
 mem_node::mem_node(int64_t offset) :
-        nodeBuffer(0,offset,data),
-        write_pending(0)
+        nodeBuffer(0,offset,static_cast<char *>(NULL)),
+        data(NULL),
+        write_pending(0),
+        capacity_(SM_PAGE_SIZE)
+{
+    allocate();
+}
+
+mem_node::mem_node(int64_t offset, size_t aCapacity) :
+        nodeBuffer(0,offset,static_cast<char *>(NULL)),
+        data(NULL),
+        write_pending(0),
+        capacity_(max(aCapacity, static_cast<size_t>(SM_PAGE_SIZE)))
 {
+    allocate();
+}
+
+void
+mem_node::allocate()
+{
+    char *raw = static_cast<char *>(xmalloc(DataPrefix + capacity_));
+    *reinterpret_cast<mem_node **>(raw) = this;
+    data = raw + DataPrefix;
     *data = 0;
+    nodeBuffer.data = data;
+    TheStoreMemSize += capacity_;
 }
 
 mem_node::~mem_node()
-{}
+{
+    TheStoreMemSize -= capacity_;
+    xfree(data - DataPrefix);
+}
 
 size_t
 mem_node::InUseCount()
 {
-    return Pool().inUseCount();
+    return (TheStoreMemSize + SM_PAGE_SIZE - 1) / SM_PAGE_SIZE;
 }
 
 size_t
 mem_node::StoreMemSize()
 {
-    return InUseCount() * SM_PAGE_SIZE;
+    return TheStoreMemSize;
 }
 
 int64_t
@@ -107,7 +123,7 @@ mem_node::dataRange() const
 size_t
 mem_node::space() const
 {
-    return SM_PAGE_SIZE - nodeBuffer.length;
+    return capacity_ - nodeBuffer.length;
 }
 
 bool
@@ -41,12 +41,14 @@ class mem_node
 {
 
 public:
-    static size_t InUseCount();
-    static size_t StoreMemSize();
+    static size_t InUseCount(); ///< node memory, in SM_PAGE_SIZE pages
+    static size_t StoreMemSize(); ///< node memory, in bytes
 
     MEMPROXY_CLASS(mem_node);
     mem_node(int64_t);
+    mem_node(int64_t offset, size_t capacity);
     ~mem_node();
+    size_t capacity() const { return capacity_; }
     size_t space() const;
     int64_t start() const;
     int64_t end() const;
@@ -57,8 +59,16 @@ public:
     /* public */
     StoreIOBuffer nodeBuffer;
     /* Private */
-    char data[SM_PAGE_SIZE];
+    char *data; ///< capacity() bytes; see memNodeWriteComplete()
     unsigned int write_pending:1;
+
+private:
+    mem_node(mem_node const &); // not implemented
+    mem_node &operator =(mem_node const &); // not implemented
+
+    void allocate();
+
+    size_t capacity_; ///< data size, at least SM_PAGE_SIZE
 };
 
 MEMPROXY_CLASS_INLINE(mem_node);
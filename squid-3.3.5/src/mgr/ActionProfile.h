@@ -22,7 +22,7 @@ public:
     ActionProfile(const char* aName, const char* aDesc, bool aPwReq,
                   bool anAtomic, const ActionCreatorPointer &aCreator):
             name(aName), desc(aDesc), isPwReq(aPwReq), isAtomic(anAtomic),
-            creator(aCreator) {
+            isLocal(false), creator(aCreator) {
     }
 
 public:
@@ -30,6 +30,7 @@ public:
     const char *desc; ///< action description to build an action menu list
     bool isPwReq; ///< whether password is required to perform the action
     bool isAtomic; ///< whether action dumps everything in one dump() call
+    bool isLocal; ///< whether any kid can perform the action without asking others
     ActionCreatorPointer creator; ///< creates Action objects with this profile
 };
 
@@ -0,0 +1,94 @@
+/*
+ * DEBUG: section 16    Cache Manager API
+ *
+ */
+
+#include "squid.h"
+#include "base/TextException.h"
+#include "ipc/Messages.h"
+#include "ipc/TypedMsgHdr.h"
+#include "mgr/PhaseTimesAction.h"
+#include "SquidMath.h"
+#include "StatCounters.h"
+#include "Store.h"
+#include "tools.h"
+
+Mgr::PhaseTimesActionData::PhaseTimesActionData()
+{
+    memset(this, 0, sizeof(*this));
+}
+
+Mgr::PhaseTimesActionData&
+Mgr::PhaseTimesActionData::operator += (const PhaseTimesActionData& stats)
+{
+    requests += stats.requests;
+    for (int p = 0; p < PhaseTimes::phEnd; ++p) {
+        count[p] += stats.count[p];
+        usec[p] += stats.usec[p];
+    }
+
+    return *this;
+}
+
+Mgr::PhaseTimesAction::Pointer
+Mgr::PhaseTimesAction::Create(const CommandPointer &cmd)
+{
+    return new PhaseTimesAction(cmd);
+}
+
+Mgr::PhaseTimesAction::PhaseTimesAction(const CommandPointer &cmd):
+        Action(cmd), data()
+{
+    debugs(16, 5, HERE);
+}
+
+void
+Mgr::PhaseTimesAction::add(const Action& action)
+{
+    debugs(16, 5, HERE);
+    data += dynamic_cast<const PhaseTimesAction&>(action).data;
+}
+
+void
+Mgr::PhaseTimesAction::collect()
+{
+    data.requests = statCounter.client_http.requests;
+    for (int p = 0; p < PhaseTimes::phEnd; ++p) {
+        data.count[p] = statCounter.phases.count[p];
+        data.usec[p] = statCounter.phases.usec[p];
+    }
+}
+
+void
+Mgr::PhaseTimesAction::dump(StoreEntry* entry)
+{
+    debugs(16, 5, HERE);
+    Must(entry != NULL);
+    storeAppendPrintf(entry, "Transaction Phase Times\n");
+    storeAppendPrintf(entry, "Client HTTP requests: %.0f\n\n", data.requests);
+    storeAppendPrintf(entry, "%-8s %12s %8s %14s %12s\n",
+                      "phase", "requests", "share", "total (sec)", "mean (msec)");
+    for (int p = 0; p < PhaseTimes::phEnd; ++p) {
+        const PhaseTimes::Phase phase = static_cast<PhaseTimes::Phase>(p);
+        storeAppendPrintf(entry, "%-8s %12.0f %7.2f%% %14.3f %12.3f\n",
+                          PhaseTimes::Name(phase),
+                          data.count[p],
+                          Math::doublePercent(data.count[p], data.requests),
+                          data.usec[p] / 1e6,
+                          data.count[p] > 0 ? data.usec[p] / data.count[p] / 1e3 : 0.0);
+    }
+}
+
+void
+Mgr::PhaseTimesAction::pack(Ipc::TypedMsgHdr& msg) const
+{
+    msg.setType(Ipc::mtCacheMgrResponse);
+    msg.putPod(data);
+}
+
+void
+Mgr::PhaseTimesAction::unpack(const Ipc::TypedMsgHdr& msg)
+{
+    msg.checkType(Ipc::mtCacheMgrResponse);
+    msg.getPod(data);
+}
@@ -0,0 +1,52 @@
+/*
+ * DEBUG: section 16    Cache Manager API
+ *
+ */
+
+#ifndef SQUID_MGR_PHASE_TIMES_ACTION_H
+#define SQUID_MGR_PHASE_TIMES_ACTION_H
+
+#include "mgr/Action.h"
+#include "PhaseTimes.h"
+
+namespace Mgr
+{
+
+/// transaction phase times
+class PhaseTimesActionData
+{
+public:
+    PhaseTimesActionData();
+    PhaseTimesActionData& operator += (const PhaseTimesActionData& stats);
+
+public:
+    double requests; ///< completed client HTTP requests
+    double count[PhaseTimes::phEnd]; ///< requests that completed each phase
+    double usec[PhaseTimes::phEnd]; ///< microseconds they spent in it
+};
+
+/// implement aggregated 'phase_times' action
+class PhaseTimesAction: public Action
+{
+protected:
+    PhaseTimesAction(const CommandPointer &cmd);
+
+public:
+    static Pointer Create(const CommandPointer &cmd);
+    /* Action API */
+    virtual void add(const Action& action);
+    virtual void pack(Ipc::TypedMsgHdr& msg) const;
+    virtual void unpack(const Ipc::TypedMsgHdr& msg);
+
+protected:
+    /* Action API */
+    virtual void collect();
+    virtual void dump(StoreEntry* entry);
+
+private:
+    PhaseTimesActionData data;
+};
+
+} // namespace Mgr
+
+#endif /* SQUID_MGR_PHASE_TIMES_ACTION_H */
@@ -4,7 +4,9 @@
  */
 
 #include "squid.h"
+#include "base/TextException.h"
 #include "CacheManager.h"
+#include "mgr/ActionProfile.h"
 #include "mgr/Registration.h"
 
 void
@@ -24,3 +26,25 @@ Mgr::RegisterAction(char const * action, char const * desc,
     CacheManager::GetInstance()->registerProfile(action, desc, handler,
             pw_req_flag, atomic);
 }
+
+void
+Mgr::RegisterLocalAction(char const * action, char const * desc,
+                         OBJH * handler, int pw_req_flag)
+{
+    CacheManager *mgr = CacheManager::GetInstance();
+    mgr->registerProfile(action, desc, handler, pw_req_flag, 1);
+    const Mgr::ActionProfile::Pointer profile = mgr->findAction(action);
+    Must(profile != NULL);
+    profile->isLocal = true;
+}
+
+void
+Mgr::RegisterLocalAction(char const * action, char const * desc,
+                         ClassActionCreationHandler *handler, int pw_req_flag)
+{
+    CacheManager *mgr = CacheManager::GetInstance();
+    mgr->registerProfile(action, desc, handler, pw_req_flag, 1);
+    const Mgr::ActionProfile::Pointer profile = mgr->findAction(action);
+    Must(profile != NULL);
+    profile->isLocal = true;
+}
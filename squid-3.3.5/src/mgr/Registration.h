@@ -20,6 +20,14 @@ void RegisterAction(char const * action, char const * desc,
                     ClassActionCreationHandler *handler,
                     int pw_req_flag, int atomic);
 
+/// registers an atomic action that needs no help from other kids in SMP
+/// mode, usually because it reports data kept in shared memory
+void RegisterLocalAction(char const * action, char const * desc,
+                         OBJH * handler, int pw_req_flag);
+
+void RegisterLocalAction(char const * action, char const * desc,
+                         ClassActionCreationHandler *handler, int pw_req_flag);
+
 } // namespace Mgr
 
 #endif /* SQUID_MGR_REGISTRATION_H */
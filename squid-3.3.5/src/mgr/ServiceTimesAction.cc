@@ -14,6 +14,8 @@
 void GetServiceTimesStats(Mgr::ServiceTimesActionData& stats);
 void DumpServiceTimesStats(Mgr::ServiceTimesActionData& stats, StoreEntry* sentry);
 
+const double Mgr::ServiceTimesActionData::Pctiles[pctileCount] = { 0.5, 0.9, 0.99, 0.999 };
+
 Mgr::ServiceTimesActionData::ServiceTimesActionData()
 {
     memset(this, 0, sizeof(*this));
@@ -44,6 +46,12 @@ Mgr::ServiceTimesActionData::operator += (const ServiceTimesActionData& stats)
         icp_queries5[i] += stats.icp_queries5[i];
         icp_queries60[i] += stats.icp_queries60[i];
     }
+    for (int k = 0; k < PCTILE_END; ++k) {
+        for (int j = 0; j < pctileCount; ++j) {
+            percentiles5[k][j] += stats.percentiles5[k][j];
+            percentiles60[k][j] += stats.percentiles60[k][j];
+        }
+    }
     ++count;
 
     return *this;
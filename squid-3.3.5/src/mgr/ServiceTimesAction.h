@@ -6,6 +6,7 @@
 #ifndef SQUID_MGR_SERVICE_TIMES_ACTION_H
 #define SQUID_MGR_SERVICE_TIMES_ACTION_H
 
+#include "enums.h"
 #include "mgr/Action.h"
 
 namespace Mgr
@@ -16,6 +17,10 @@ class ServiceTimesActionData
 {
 public:
     enum { seriesSize = 19 };
+    enum { pctileCount = 4 };
+
+    /// percentiles reported for every service time kind: 50, 90, 99, 99.9
+    static const double Pctiles[pctileCount];
 
 public:
     ServiceTimesActionData();
@@ -36,6 +41,8 @@ public:
     double dns_lookups60[seriesSize];
     double icp_queries5[seriesSize];
     double icp_queries60[seriesSize];
+    double percentiles5[PCTILE_END][pctileCount]; ///< Pctiles in msec, by PCTILE_ kind
+    double percentiles60[PCTILE_END][pctileCount]; ///< Pctiles in msec, by PCTILE_ kind
     unsigned int count;
 };
 
@@ -31,179 +31,326 @@
  */
 
 #include "squid.h"
+#include "CachePeer.h"
 #include "comm.h"
 #include "comm/Connection.h"
+#include "event.h"
 #include "fd.h"
 #include "fde.h"
 #include "globals.h"
+#include "ipc/Kids.h"
+#include "ipc/Port.h"
+#include "ipc/SharedPconn.h"
+#include "ipc/TypedMsgHdr.h"
 #include "mgr/Registration.h"
+#include "neighbors.h"
 #include "pconn.h"
 #include "SquidConfig.h"
+#include "SquidTime.h"
+#include "StatCounters.h"
 #include "Store.h"
+#include "tools.h"
 
-#define PCONN_FDS_SZ	8	/* pconn set size, increase for better memcache hit rate */
+#include <list>
 
 //TODO: re-attach to MemPools. WAS: static MemAllocator *pconn_fds_pool = NULL;
 PconnModule * PconnModule::instance = NULL;
 CBDATA_CLASS_INIT(IdleConnList);
+CBDATA_CLASS_INIT(IdleConn);
+
+/// the pool sharing idle connections with other SMP workers, if any
+static PconnPool *TheSharedPool = NULL;
+
+/// how long to keep our copy of a donated connection descriptor open;
+/// exceeds the time Ipc::UdsSender may spend sending the donation
+static const time_t DonationHoldTime = 15;
+
+/// donated connections we must keep open until the donation is sent
+typedef std::list<std::pair<time_t, Comm::ConnectionPointer> > HeldDonations;
+static HeldDonations TheHeldDonations;
+
+/* ========== PconnKey ================================================ */
+
+PconnKey::PconnKey(const Ip::Address &aRemote, const char *aDomain):
+        remote(aRemote), domain(aDomain), hashValue(2166136261U)
+{
+    // FNV-1a over the address, the port, and the domain
+    struct in6_addr addr;
+    remote.GetInAddr(addr);
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(&addr);
+    for (size_t i = 0; i < sizeof(addr); ++i)
+        hashValue = (hashValue ^ bytes[i]) * 16777619U;
+
+    const unsigned short port = remote.GetPort();
+    hashValue = (hashValue ^ (port & 0xFF)) * 16777619U;
+    hashValue = (hashValue ^ (port >> 8)) * 16777619U;
+
+    if (domain) {
+        for (const char *c = domain; *c; ++c)
+            hashValue = (hashValue ^ static_cast<unsigned char>(*c)) * 16777619U;
+    }
+}
+
+int
+PconnKey::Compare(const void *a, const void *b)
+{
+    const PconnKey *x = static_cast<const PconnKey *>(a);
+    const PconnKey *y = static_cast<const PconnKey *>(b);
+
+    if (x->hashValue != y->hashValue)
+        return 1;
+
+    if (x->remote.GetPort() != y->remote.GetPort() || x->remote.matchIPAddr(y->remote) != 0)
+        return 1;
+
+    if (x->domain && y->domain)
+        return strcmp(x->domain, y->domain);
+
+    return x->domain != y->domain;
+}
+
+unsigned int
+PconnKey::Hash(const void *key, unsigned int size)
+{
+    return static_cast<const PconnKey *>(key)->hashValue % size;
+}
+
+void
+PconnKey::format(char *buf, size_t size) const
+{
+    remote.ToURL(buf, size);
+    if (domain) {
+        const size_t used = strlen(buf);
+        snprintf(buf + used, size - used, "/%s", domain);
+    }
+}
+
+/* ========== IdleConn ================================================ */
+
+IdleConn::IdleConn(IdleConnList *aList, const Comm::ConnectionPointer &aConn):
+        conn(aConn),
+        list(aList),
+        older(NULL),
+        newer(NULL),
+        since(current_dtime)
+{
+}
+
+double
+IdleConn::idleTime() const
+{
+    return current_dtime - since;
+}
 
 /* ========== IdleConnList ============================================ */
 
-IdleConnList::IdleConnList(const char *key, PconnPool *thePool) :
-        capacity_(PCONN_FDS_SZ),
+IdleConnList::IdleConnList(const PconnKey &aKey, PconnPool *thePool) :
+        key_(aKey),
+        keyText_(NULL),
+        fdNote_(NULL),
+        oldest_(NULL),
+        newest_(NULL),
         size_(0),
-        parent_(thePool)
+        parent_(thePool),
+        advertised_(false)
 {
-    hash.key = xstrdup(key);
-    theList_ = new Comm::ConnectionPointer[capacity_];
-// TODO: re-attach to MemPools. WAS: theList = (?? *)pconn_fds_pool->alloc();
+    if (aKey.domain)
+        key_.domain = xstrdup(aKey.domain);
+    hash.key = &key_;
+
+    LOCAL_ARRAY(char, buf, SQUIDHOSTNAMELEN * 3 + 10);
+    key_.format(buf, SQUIDHOSTNAMELEN * 3 + 10);
+    keyText_ = xstrdup(buf);
+
+    LOCAL_ARRAY(char, desc, FD_DESC_SZ);
+    snprintf(desc, FD_DESC_SZ, "Idle server: %s", keyText_);
+    fdNote_ = xstrdup(desc);
+}
+
+IdleConnList::IdleConnList(const char *aKey, PconnPool *thePool) :
+        key_(Ip::Address(), NULL),
+        keyText_(xstrdup(aKey)),
+        fdNote_(NULL),
+        oldest_(NULL),
+        newest_(NULL),
+        size_(0),
+        parent_(thePool),
+        advertised_(false)
+{
+    hash.key = &key_;
 }
 
 IdleConnList::~IdleConnList()
 {
+    unadvertise();
+
     if (parent_)
         parent_->unlinkList(this);
 
-    delete[] theList_;
+    while (IdleConn *entry = oldest_) {
+        oldest_ = entry->newer;
+        delete entry;
+    }
 
-    xfree(hash.key);
+    xfree(const_cast<char *>(key_.domain));
+    xfree(keyText_);
+    xfree(fdNote_);
 }
 
-/** Search the list. Matches by FD socket number.
- * Performed from the end of list where newest entries are.
- *
- * \retval <0   The connection is not listed
- * \retval >=0  The connection array index
- */
-int
-IdleConnList::findIndexOf(const Comm::ConnectionPointer &conn) const
+/// The entry to consider first when looking for a connection to reuse.
+/// Pooled lists follow server_pconn_reuse_order; others reuse the newest.
+IdleConn *
+IdleConnList::first() const
 {
-    for (int index = size_ - 1; index >= 0; --index) {
-        if (conn->fd == theList_[index]->fd) {
-            debugs(48, 3, HERE << "found " << conn << " at index " << index);
-            return index;
-        }
-    }
+    if (parent_ && Config.serverPconnReuse.order == PCONN_REUSE_FIFO)
+        return oldest_;
+    return newest_;
+}
 
-    debugs(48, 2, HERE << conn << " NOT FOUND!");
-    return -1;
+/// The entry to consider after the given one, in first() order.
+IdleConn *
+IdleConnList::next(const IdleConn *entry) const
+{
+    if (parent_ && Config.serverPconnReuse.order == PCONN_REUSE_FIFO)
+        return entry->newer;
+    return entry->older;
 }
 
-/** Remove the entry at specified index.
- * May perform a shuffle of list entries to fill the gap.
- * \retval false The index is not an in-use entry.
+/** Unlinks the entry and stops monitoring its connection.
+ * Deletes this list when the last pooled connection is removed.
+ * \param how why the connection leaves the list
+ * \returns the connection of the removed entry
  */
-bool
-IdleConnList::removeAt(int index)
+Comm::ConnectionPointer
+IdleConnList::remove(IdleConn *entry, pconn_idle_end_t how)
 {
-    if (index < 0 || index >= size_)
-        return false;
+    const Comm::ConnectionPointer conn = entry->conn;
+    clearHandlers(entry);
 
-    // shuffle the remaining entries to fill the new gap.
-    for (; index < size_ - 1; ++index)
-        theList_[index] = theList_[index + 1];
-    theList_[--size_] = NULL;
+    if (entry->older)
+        entry->older->newer = entry->newer;
+    else
+        oldest_ = entry->newer;
+
+    if (entry->newer)
+        entry->newer->older = entry->older;
+    else
+        newest_ = entry->older;
+
+    --size_;
+
+    if (parent_)
+        parent_->noteIdleTime(entry->idleTime(), how);
+
+    delete entry;
 
     if (parent_) {
         parent_->noteConnectionRemoved();
         if (size_ == 0) {
-            debugs(48, 3, HERE << "deleting " << hashKeyStr(&hash));
+            debugs(48, 3, HERE << "deleting " << keyText_);
             delete this;
         }
     }
 
-    return true;
+    return conn;
 }
 
-// almost a duplicate of removeFD. But drops multiple entries.
+/// Closes the oldest N connections.
 void
 IdleConnList::closeN(size_t n)
 {
-    if (n < 1) {
+    if (n < 1 || size_ < 1) {
         debugs(48, 2, HERE << "Nothing to do.");
         return;
-    } else if (n >= (size_t)size_) {
-        debugs(48, 2, HERE << "Closing all entries.");
-        while (size_ > 0) {
-            const Comm::ConnectionPointer conn = theList_[--size_];
-            theList_[size_] = NULL;
-            clearHandlers(conn);
-            conn->close();
-            if (parent_)
-                parent_->noteConnectionRemoved();
-        }
-    } else { //if (n < size_)
-        debugs(48, 2, HERE << "Closing " << n << " of " << size_ << " entries.");
-
-        size_t index;
-        // ensure the first N entries are closed
-        for (index = 0; index < n; ++index) {
-            const Comm::ConnectionPointer conn = theList_[index];
-            theList_[index] = NULL;
-            clearHandlers(conn);
-            conn->close();
-            if (parent_)
-                parent_->noteConnectionRemoved();
-        }
-        // shuffle the list N down.
-        for (index = 0; index < (size_t)size_ - n; ++index) {
-            theList_[index] = theList_[index + n];
-        }
-        // ensure the last N entries are unset
-        while (index < ((size_t)size_)) {
-            theList_[index] = NULL;
-            ++index;
-        }
-        size_ -= n;
     }
 
-    if (parent_ && size_ == 0) {
-        debugs(48, 3, HERE << "deleting " << hashKeyStr(&hash));
-        delete this;
+    debugs(48, 2, HERE << "Closing " << n << " of " << size_ << " entries.");
+
+    for (; n > 0; --n) {
+        const bool last = size_ == 1;
+        /* may delete this */
+        const Comm::ConnectionPointer conn = remove(oldest_, PCONN_CLOSED);
+        conn->close();
+        if (last)
+            break;
+    }
+}
+
+/** Closes connections idle for longer than server_pconn_reuse_max_idle.
+ * Servers tend to close such connections just as we try to reuse them.
+ * \retval true this list was deleted
+ */
+bool
+IdleConnList::closeStale()
+{
+    const time_t maxIdle = Config.serverPconnReuse.maxIdle;
+    if (!parent_ || maxIdle <= 0)
+        return false;
+
+    while (oldest_ && oldest_->idleTime() > maxIdle) {
+        const bool last = size_ == 1;
+        debugs(48, 3, HERE << "closing stale " << oldest_->conn);
+        /* may delete this */
+        const Comm::ConnectionPointer conn = remove(oldest_, PCONN_CLOSED);
+        conn->close();
+        if (last)
+            return true;
     }
+
+    return false;
 }
 
 void
-IdleConnList::clearHandlers(const Comm::ConnectionPointer &conn)
+IdleConnList::clearHandlers(IdleConn *entry)
 {
-    debugs(48, 3, HERE << "removing close handler for " << conn);
-    comm_read_cancel(conn->fd, IdleConnList::Read, this);
-    commUnsetConnTimeout(conn);
+    debugs(48, 3, HERE << "removing close handler for " << entry->conn);
+    comm_read_cancel(entry->conn->fd, IdleConnList::Read, entry);
+    commUnsetConnTimeout(entry->conn);
 }
 
 void
 IdleConnList::push(const Comm::ConnectionPointer &conn)
 {
-    if (size_ == capacity_) {
-        debugs(48, 3, HERE << "growing idle Connection array");
-        capacity_ <<= 1;
-        const Comm::ConnectionPointer *oldList = theList_;
-        theList_ = new Comm::ConnectionPointer[capacity_];
-        for (int index = 0; index < size_; ++index)
-            theList_[index] = oldList[index];
-
-        delete[] oldList;
-    }
-
     if (parent_)
         parent_->noteConnectionAdded();
 
-    theList_[size_] = conn;
+    IdleConn *entry = new IdleConn(this, conn);
+    entry->older = newest_;
+    if (newest_)
+        newest_->newer = entry;
+    else
+        oldest_ = entry;
+    newest_ = entry;
     ++size_;
+
     AsyncCall::Pointer readCall = commCbCall(5,4, "IdleConnList::Read",
-                                  CommIoCbPtrFun(IdleConnList::Read, this));
+                                  CommIoCbPtrFun(IdleConnList::Read, entry));
     comm_read(conn, fakeReadBuf_, sizeof(fakeReadBuf_), readCall);
     AsyncCall::Pointer timeoutCall = commCbCall(5,4, "IdleConnList::Timeout",
-                                     CommTimeoutCbPtrFun(IdleConnList::Timeout, this));
+                                     CommTimeoutCbPtrFun(IdleConnList::Timeout, entry));
     commSetConnTimeout(conn, Config.Timeout.serverIdlePconn, timeoutCall);
+
+    // keep one connection for ourselves; others may be shared
+    if (!advertised_ && size_ > 1 && parent_ && parent_->sharing()) {
+        advertised_ = true;
+        parent_->advertise(keyText_, true);
+    }
+}
+
+void
+IdleConnList::unadvertise()
+{
+    if (advertised_ && parent_)
+        parent_->advertise(keyText_, false);
+    advertised_ = false;
 }
 
 /// Determine whether an entry in the idle list is available for use.
-/// Returns false if the entry is unset, closed or closing.
+/// Returns false if the connection is closed, closing, or timing out.
 bool
-IdleConnList::isAvailable(int i) const
+IdleConnList::isAvailable(const IdleConn *entry) const
 {
-    const Comm::ConnectionPointer &conn = theList_[i];
+    const Comm::ConnectionPointer &conn = entry->conn;
 
     // connection already closed. useless.
     if (!Comm::IsConnOpen(conn))
@@ -213,28 +360,58 @@ IdleConnList::isAvailable(int i) const
     if (!COMMIO_FD_READCB(conn->fd)->active())
         return false;
 
+    // our connection timeout handler is scheduled to run already. unsafe for now.
+    // TODO: cancel the pending timeout callback and allow re-use of the conn.
+    if (fd_table[conn->fd].timeoutHandler == NULL)
+        return false;
+
     return true;
 }
 
 Comm::ConnectionPointer
 IdleConnList::pop()
 {
-    for (int i=size_-1; i>=0; --i) {
+    /* may delete this */
+    if (closeStale())
+        return Comm::ConnectionPointer();
+
+    for (IdleConn *entry = first(); entry; entry = next(entry)) {
+        if (isAvailable(entry)) {
+            /* may delete this */
+            return remove(entry, PCONN_REUSED);
+        }
+    }
+
+    return Comm::ConnectionPointer();
+}
+
+Comm::ConnectionPointer
+IdleConnList::popShareable()
+{
+    /* may delete this */
+    if (closeStale())
+        return Comm::ConnectionPointer();
 
-        if (!isAvailable(i))
+    // keep one connection for ourselves
+    if (size_ <= 1)
+        return Comm::ConnectionPointer();
+
+    for (IdleConn *entry = first(); entry; entry = next(entry)) {
+
+        if (!isAvailable(entry))
             continue;
 
-        // our connection timeout handler is scheduled to run already. unsafe for now.
-        // TODO: cancel the pending timeout callback and allow re-use of the conn.
-        if (fd_table[theList_[i]->fd].timeoutHandler == NULL)
+#if USE_SSL
+        // SSL state cannot be passed to another process
+        if (fd_table[entry->conn->fd].ssl)
             continue;
+#endif
 
-        // finally, a match. pop and return it.
-        Comm::ConnectionPointer result = theList_[i];
-        /* may delete this */
-        removeAt(i);
-        clearHandlers(result);
-        return result;
+        // does not delete this: we keep at least one connection
+        const Comm::ConnectionPointer conn = remove(entry, PCONN_DONATED);
+        if (size_ <= 1)
+            unadvertise();
+        return conn;
     }
 
     return Comm::ConnectionPointer();
@@ -249,38 +426,34 @@ IdleConnList::pop()
  * quite a bit of CPU. Just keep it in mind.
  */
 Comm::ConnectionPointer
-IdleConnList::findUseable(const Comm::ConnectionPointer &key)
+IdleConnList::findUseable(const Comm::ConnectionPointer &key, bool reused)
 {
     assert(size_);
 
+    /* may delete this */
+    if (closeStale())
+        return Comm::ConnectionPointer();
+
     // small optimization: do the constant bool tests only once.
     const bool keyCheckAddr = !key->local.IsAnyAddr();
     const bool keyCheckPort = key->local.GetPort() > 0;
 
-    for (int i=size_-1; i>=0; --i) {
+    for (IdleConn *entry = first(); entry; entry = next(entry)) {
 
-        if (!isAvailable(i))
+        if (!isAvailable(entry))
             continue;
 
         // local end port is required, but dont match.
-        if (keyCheckPort && key->local.GetPort() != theList_[i]->local.GetPort())
+        if (keyCheckPort && key->local.GetPort() != entry->conn->local.GetPort())
             continue;
 
         // local address is required, but does not match.
-        if (keyCheckAddr && key->local.matchIPAddr(theList_[i]->local) != 0)
-            continue;
-
-        // our connection timeout handler is scheduled to run already. unsafe for now.
-        // TODO: cancel the pending timeout callback and allow re-use of the conn.
-        if (fd_table[theList_[i]->fd].timeoutHandler == NULL)
+        if (keyCheckAddr && key->local.matchIPAddr(entry->conn->local) != 0)
             continue;
 
         // finally, a match. pop and return it.
-        Comm::ConnectionPointer result = theList_[i];
         /* may delete this */
-        removeAt(i);
-        clearHandlers(result);
-        return result;
+        return remove(entry, reused ? PCONN_REUSED : PCONN_CLOSED);
     }
 
     return Comm::ConnectionPointer();
@@ -288,15 +461,11 @@ IdleConnList::findUseable(const Comm::ConnectionPointer &key)
 
 /* might delete list */
 void
-IdleConnList::findAndClose(const Comm::ConnectionPointer &conn)
+IdleConnList::findAndClose(IdleConn *entry)
 {
-    const int index = findIndexOf(conn);
-    if (index >= 0) {
-        /* might delete this */
-        removeAt(index);
-        clearHandlers(conn);
-        conn->close();
-    }
+    /* might delete this */
+    const Comm::ConnectionPointer conn = remove(entry, PCONN_CLOSED);
+    conn->close();
 }
 
 void
@@ -310,37 +479,22 @@ IdleConnList::Read(const Comm::ConnectionPointer &conn, char *buf, size_t len, c
         return;
     }
 
-    IdleConnList *list = (IdleConnList *) data;
+    IdleConn *entry = static_cast<IdleConn *>(data);
     /* may delete list/data */
-    list->findAndClose(conn);
+    entry->list->findAndClose(entry);
 }
 
 void
 IdleConnList::Timeout(const CommTimeoutCbParams &io)
 {
     debugs(48, 3, HERE << io.conn);
-    IdleConnList *list = static_cast<IdleConnList *>(io.data);
+    IdleConn *entry = static_cast<IdleConn *>(io.data);
     /* may delete list/data */
-    list->findAndClose(io.conn);
+    entry->list->findAndClose(entry);
 }
 
 /* ========== PconnPool PRIVATE FUNCTIONS ============================================ */
 
-const char *
-PconnPool::key(const Comm::ConnectionPointer &destLink, const char *domain)
-{
-    LOCAL_ARRAY(char, buf, SQUIDHOSTNAMELEN * 3 + 10);
-
-    destLink->remote.ToURL(buf, SQUIDHOSTNAMELEN * 3 + 10);
-    if (domain) {
-        const int used = strlen(buf);
-        snprintf(buf+used, SQUIDHOSTNAMELEN * 3 + 10-used, "/%s", domain);
-    }
-
-    debugs(48,6,"PconnPool::key(" << destLink << ", " << (domain?domain:"[no domain]") << ") is {" << buf << "}" );
-    return buf;
-}
-
 void
 PconnPool::dumpHist(StoreEntry * e) const
 {
@@ -358,6 +512,30 @@ PconnPool::dumpHist(StoreEntry * e) const
 
         storeAppendPrintf(e, "\t%4d  %9d\n", i, hist[i]);
     }
+
+    storeAppendPrintf(e,
+                      "\n"
+                      "%s idle time of reused connections:\n"
+                      "\n"
+                      "\t     msec      count\n",
+                      descr);
+    reusedIdleTimes.dump(e, statHistIntDumper);
+
+    storeAppendPrintf(e,
+                      "\n"
+                      "%s idle time of connections closed while idle:\n"
+                      "\n"
+                      "\t     msec      count\n",
+                      descr);
+    closedIdleTimes.dump(e, statHistIntDumper);
+
+    storeAppendPrintf(e,
+                      "\n"
+                      "%s idle time of connections given to other workers:\n"
+                      "\n"
+                      "\t     msec      count\n",
+                      descr);
+    donatedIdleTimes.dump(e, statHistIntDumper);
 }
 
 void
@@ -368,7 +546,7 @@ PconnPool::dumpHash(StoreEntry *e) const
 
     int i = 0;
     for (hash_link *walker = hid->next; walker; walker = hash_next(hid)) {
-        storeAppendPrintf(e, "\t item %5d: %s\n", i, (char *)(walker->key));
+        storeAppendPrintf(e, "\t item %5d: %s\n", i, reinterpret_cast<IdleConnList *>(walker)->keyText());
         ++i;
     }
 }
@@ -379,11 +557,15 @@ PconnPool::PconnPool(const char *aDescr) : table(NULL), descr(aDescr),
         theCount(0)
 {
     int i;
-    table = hash_create((HASHCMP *) strcmp, 229, hash_string);
+    table = hash_create(PconnKey::Compare, 229, PconnKey::Hash);
 
     for (i = 0; i < PCONN_HIST_SZ; ++i)
         hist[i] = 0;
 
+    reusedIdleTimes.logInit(100, 0.0, 3600000.0);
+    closedIdleTimes.logInit(100, 0.0, 3600000.0);
+    donatedIdleTimes.logInit(100, 0.0, 3600000.0);
+
     PconnModule::GetInstance()->add(this);
 }
 
@@ -406,44 +588,48 @@ PconnPool::push(const Comm::ConnectionPointer &conn, const char *domain)
         return;
     }
 
-    const char *aKey = key(conn, domain);
-    IdleConnList *list = (IdleConnList *) hash_lookup(table, aKey);
+    const PconnKey aKey(conn->remote, domain);
+    IdleConnList *list = (IdleConnList *) hash_lookup(table, &aKey);
 
     if (list == NULL) {
         list = new IdleConnList(aKey, this);
-        debugs(48, 3, HERE << "new IdleConnList for {" << hashKeyStr(&list->hash) << "}" );
+        debugs(48, 3, HERE << "new IdleConnList for {" << list->keyText() << "}" );
         hash_join(table, &list->hash);
     } else {
-        debugs(48, 3, HERE << "found IdleConnList for {" << hashKeyStr(&list->hash) << "}" );
+        debugs(48, 3, HERE << "found IdleConnList for {" << list->keyText() << "}" );
     }
 
     list->push(conn);
     assert(!comm_has_incomplete_write(conn->fd));
 
-    LOCAL_ARRAY(char, desc, FD_DESC_SZ);
-    snprintf(desc, FD_DESC_SZ, "Idle server: %s", aKey);
-    fd_note(conn->fd, desc);
-    debugs(48, 3, HERE << "pushed " << conn << " for " << aKey);
+    fd_note(conn->fd, list->fdNote());
+    debugs(48, 3, HERE << "pushed " << conn << " for " << list->keyText());
 }
 
 Comm::ConnectionPointer
 PconnPool::pop(const Comm::ConnectionPointer &destLink, const char *domain, bool isRetriable)
 {
-    const char * aKey = key(destLink, domain);
+    const PconnKey aKey(destLink->remote, domain);
 
-    IdleConnList *list = (IdleConnList *)hash_lookup(table, aKey);
+    IdleConnList *list = (IdleConnList *)hash_lookup(table, &aKey);
     if (list == NULL) {
-        debugs(48, 3, HERE << "lookup for key {" << aKey << "} failed.");
+        debugs(48, 3, HERE << "lookup for " << destLink->remote << " domain " << (domain?domain:"[none]") << " failed.");
+        if (isRetriable && sharing())
+            requestIdleConn(aKey);
         return Comm::ConnectionPointer();
     } else {
-        debugs(48, 3, HERE << "found " << hashKeyStr(&list->hash) << (isRetriable?"(to use)":"(to kill)") );
+        debugs(48, 3, HERE << "found " << list->keyText() << (isRetriable?"(to use)":"(to kill)") );
     }
 
     /* may delete list */
-    Comm::ConnectionPointer temp = list->findUseable(destLink);
+    Comm::ConnectionPointer temp = list->findUseable(destLink, isRetriable);
     if (!isRetriable && Comm::IsConnOpen(temp))
         temp->close();
 
+    // a received connection has not been used by this process yet
+    if (isRetriable && Comm::IsConnOpen(temp) && this == TheSharedPool && !fd_table[temp->fd].pconn.uses)
+        ++sharingStats.reused;
+
     return temp;
 }
 
@@ -463,6 +649,14 @@ PconnPool::unlinkList(IdleConnList *list)
     hash_remove_link(table, &list->hash);
 }
 
+void
+PconnPool::noteIdleTime(double seconds, pconn_idle_end_t how)
+{
+    StatHist &idleTimes = how == PCONN_REUSED ? reusedIdleTimes :
+                          (how == PCONN_DONATED ? donatedIdleTimes : closedIdleTimes);
+    idleTimes.count(seconds * 1000.0);
+}
+
 void
 PconnPool::noteUses(int uses)
 {
@@ -472,6 +666,188 @@ PconnPool::noteUses(int uses)
     ++hist[uses];
 }
 
+/* ========== PconnPool sharing among SMP workers ===================== */
+
+void
+PconnPool::shareIdleConnections()
+{
+    assert(!TheSharedPool || TheSharedPool == this);
+    TheSharedPool = this;
+}
+
+bool
+PconnPool::sharing() const
+{
+    return this == TheSharedPool && Config.onoff.server_pconn_sharing &&
+           Config.workers > 1 && IamWorkerProcess() && !shutting_down;
+}
+
+void
+PconnPool::advertise(const char *aKey, bool available)
+{
+    debugs(48, 3, HERE << (available ? "have" : "no more") << " spare idle connections for " << aKey);
+    Ipc::PconnAvailability availability(KidIdentifier, aKey, available);
+    Ipc::TypedMsgHdr message;
+    availability.pack(message);
+    Ipc::SendMessage(Ipc::coordinatorAddr, message);
+}
+
+void
+PconnPool::requestIdleConn(const PconnKey &key)
+{
+    LOCAL_ARRAY(char, aKey, SQUIDHOSTNAMELEN * 3 + 10);
+    key.format(aKey, SQUIDHOSTNAMELEN * 3 + 10);
+
+    // the answer, if any, comes too late for the current transaction;
+    // do not flood Coordinator with requests for the same busy server
+    if (recentRequests.size() > 10000)
+        recentRequests.clear();
+    time_t &lastRequest = recentRequests[aKey];
+    if (lastRequest == squid_curtime)
+        return;
+    lastRequest = squid_curtime;
+
+    debugs(48, 3, HERE << "asking other workers for " << aKey);
+    ++sharingStats.requested;
+    Ipc::PconnRequest request(KidIdentifier, aKey, key.remote, key.domain);
+    Ipc::TypedMsgHdr message;
+    request.pack(message);
+    Ipc::SendMessage(Ipc::coordinatorAddr, message);
+}
+
+/// closes our copies of donated connection descriptors that were surely sent
+static void
+ReleaseHeldDonations(void *)
+{
+    while (!TheHeldDonations.empty() &&
+            TheHeldDonations.front().first + DonationHoldTime <= squid_curtime) {
+        const Comm::ConnectionPointer conn = TheHeldDonations.front().second;
+        TheHeldDonations.pop_front();
+        // comm_close() would drain socket data that belongs to the recipient
+        debugs(48, 5, HERE << "releasing donated " << conn);
+        fd_close(conn->fd);
+        close(conn->fd);
+        ++ statCounter.syscalls.sock.closes;
+        conn->fd = -1;
+    }
+
+    if (!TheHeldDonations.empty())
+        eventAdd("ReleaseHeldDonations", ReleaseHeldDonations, NULL, DonationHoldTime, 0, false);
+}
+
+void
+PconnPool::HandleIdleConnRequest(const Ipc::PconnRequest &request)
+{
+    PconnPool *pool = TheSharedPool;
+    if (!pool || !pool->sharing())
+        return;
+
+    const char *aKey = request.key.termedBuf();
+    const char *domain = request.domain.size() ? request.domain.termedBuf() : NULL;
+    const PconnKey key(request.remote, domain);
+    Comm::ConnectionPointer conn;
+    if (IdleConnList *list = (IdleConnList *)hash_lookup(pool->table, &key)) {
+        /* may delete list */
+        conn = list->popShareable();
+        // a deleted list has unadvertised itself; look it up again
+        if (!Comm::IsConnOpen(conn)) {
+            if ((list = (IdleConnList *)hash_lookup(pool->table, &key)))
+                list->unadvertise();
+        }
+    } else {
+        // Coordinator has not processed our last advertisement yet
+        pool->advertise(aKey, false);
+    }
+
+    if (!Comm::IsConnOpen(conn)) {
+        debugs(48, 3, HERE << "no idle connections for " << aKey << " to give kid" << request.requestorId);
+        ++pool->sharingStats.refused;
+        return;
+    }
+
+    Ipc::PconnDonation donation;
+    donation.donorId = KidIdentifier;
+    donation.fd = conn->fd;
+    donation.local = conn->local;
+    donation.remote = conn->remote;
+    donation.flags = conn->flags;
+    if (const CachePeer *peer = conn->getPeer())
+        donation.peer = peer->name;
+    donation.domain = request.domain;
+
+    debugs(48, 3, HERE << "giving " << conn << " for " << aKey << " to kid" << request.requestorId);
+    ++pool->sharingStats.donated;
+    Ipc::TypedMsgHdr message;
+    donation.pack(message);
+    Ipc::SendMessage(Ipc::Port::MakeAddr(Ipc::strandAddrPfx, request.requestorId), message);
+
+    // the message is sent asynchronously; keep the descriptor open until then
+    fd_note(conn->fd, "Donated idle server");
+    if (TheHeldDonations.empty())
+        eventAdd("ReleaseHeldDonations", ReleaseHeldDonations, NULL, DonationHoldTime, 0, false);
+    TheHeldDonations.push_back(std::make_pair(squid_curtime, conn));
+}
+
+void
+PconnPool::HandleIdleConnDonation(const Ipc::PconnDonation &donation)
+{
+    if (donation.fd < 0)
+        return;
+
+    Comm::ConnectionPointer conn = new Comm::Connection;
+    conn->fd = donation.fd;
+    conn->local = donation.local;
+    conn->remote = donation.remote;
+    conn->flags = donation.flags;
+
+    struct addrinfo *AI = NULL;
+    conn->remote.GetAddrInfo(AI);
+    AI->ai_socktype = SOCK_STREAM;
+    AI->ai_protocol = IPPROTO_TCP;
+    comm_import_opened(conn, "Received idle server", AI);
+    conn->remote.FreeAddrInfo(AI);
+    commSetNonBlocking(conn->fd);
+
+    PconnPool *pool = TheSharedPool;
+    if (!pool || !pool->sharing()) {
+        conn->close();
+        return;
+    }
+
+    if (donation.peer.size()) {
+        CachePeer *peer = peerFindByName(donation.peer.termedBuf());
+        if (!peer) {
+            debugs(48, 3, HERE << "unknown cache_peer " << donation.peer << " for received " << conn);
+            conn->close();
+            return;
+        }
+        conn->setPeer(peer);
+    }
+
+    debugs(48, 3, HERE << "received " << conn << " from kid" << donation.donorId);
+    ++pool->sharingStats.received;
+    pool->push(conn, donation.domain.size() ? donation.domain.termedBuf() : NULL);
+}
+
+void
+PconnPool::dumpSharing(StoreEntry *e) const
+{
+    if (this != TheSharedPool)
+        return;
+
+    storeAppendPrintf(e,
+                      "%s idle connections shared with other workers (server_pconn_sharing %s):\n"
+                      "\trequested: %d\n"
+                      "\treceived:  %d\n"
+                      "\treused:    %d\n"
+                      "\tdonated:   %d\n"
+                      "\trefused:   %d\n",
+                      descr, sharing() ? "on" : "off",
+                      sharingStats.requested, sharingStats.received,
+                      sharingStats.reused, sharingStats.donated,
+                      sharingStats.refused);
+}
+
 /* ========== PconnModule ============================================ */
 
 /*
@@ -519,6 +895,7 @@ PconnModule::dump(StoreEntry *e)
     for (i = 0; i < poolCount; ++i) {
         storeAppendPrintf(e, "\n Pool %d Stats\n", i);
         (*(pools+i))->dumpHist(e);
+        (*(pools+i))->dumpSharing(e);
         storeAppendPrintf(e, "\n Pool %d Hash Table\n",i);
         (*(pools+i))->dumpHash(e);
     }
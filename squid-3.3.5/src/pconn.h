@@ -9,6 +9,7 @@
  */
 
 class PconnPool;
+class IdleConnList;
 
 /* for CBDATA_CLASS2() macros */
 #include "cbdata.h"
@@ -16,6 +17,17 @@ class PconnPool;
 #include "hash.h"
 /* for IOCB */
 #include "comm.h"
+#include "ip/Address.h"
+#include "StatHist.h"
+
+#include <map>
+#include <string>
+
+namespace Ipc
+{
+class PconnRequest;
+class PconnDonation;
+}
 
 /// \ingroup PConnAPI
 #define MAX_NUM_PCONN_POOLS 10
@@ -23,13 +35,71 @@ class PconnPool;
 /// \ingroup PConnAPI
 #define PCONN_HIST_SZ (1<<16)
 
+/** \ingroup PConnAPI
+ * Identifies the destination of pooled connections: the server address
+ * and port plus an optional domain. The hash value is computed once, when
+ * the key is created, so that PconnPool lookups do not format strings.
+ */
+class PconnKey
+{
+public:
+    PconnKey(const Ip::Address &aRemote, const char *aDomain);
+
+    /// HASHCMP for PconnPool tables
+    static int Compare(const void *a, const void *b);
+    /// HASHHASH for PconnPool tables
+    static unsigned int Hash(const void *key, unsigned int size);
+
+    /// writes the "address:port/domain" form of the key into buf
+    void format(char *buf, size_t size) const;
+
+    Ip::Address remote; ///< server address and port
+    const char *domain; ///< pooling domain or nil; not owned
+    unsigned int hashValue; ///< precomputed hash of remote and domain
+};
+
+/// why a connection left its IdleConnList, for idle time statistics
+typedef enum {
+    PCONN_REUSED, ///< taken for use by this process
+    PCONN_CLOSED, ///< closed while idle
+    PCONN_DONATED ///< given to another SMP worker
+} pconn_idle_end_t;
+
+/** \ingroup PConnAPI
+ * An idle connection waiting in an IdleConnList.
+ * Also serves as the callback data for the idle connection monitoring.
+ */
+class IdleConn
+{
+public:
+    IdleConn(IdleConnList *aList, const Comm::ConnectionPointer &aConn);
+
+    /// how long the connection has been idle, in seconds
+    double idleTime() const;
+
+    Comm::ConnectionPointer conn;
+    IdleConnList *list; ///< the list holding this entry
+    IdleConn *older; ///< the entry pushed before this one or nil
+    IdleConn *newer; ///< the entry pushed after this one or nil
+    double since; ///< when the connection became idle (current_dtime)
+
+private:
+    CBDATA_CLASS2(IdleConn);
+};
+
 /** \ingroup PConnAPI
  * A list of connections currently open to a particular destination end-point.
+ * The connections are kept in a doubly-linked list ordered by the time they
+ * became idle, so that taking the newest or the oldest available connection
+ * does not require a scan.
  */
 class IdleConnList
 {
 public:
-    IdleConnList(const char *key, PconnPool *parent);
+    /// creates a list for pooled connections to the given destination
+    IdleConnList(const PconnKey &aKey, PconnPool *parent);
+    /// creates a stand-alone list described by the given text
+    IdleConnList(const char *aKey, PconnPool *parent);
     ~IdleConnList();
 
     /// Pass control of the connection to the idle list.
@@ -43,19 +113,34 @@ public:
      * The list is created based on remote IP:port hash. This further filters
      * the choices based on specific local-end details requested.
      * If nothing usable is found the a nil pointer is returned.
+     * \param reused whether the caller will use (rather than close) it
      */
-    Comm::ConnectionPointer findUseable(const Comm::ConnectionPointer &key);
-
-    void clearHandlers(const Comm::ConnectionPointer &conn);
+    Comm::ConnectionPointer findUseable(const Comm::ConnectionPointer &key, bool reused);
 
     int count() const { return size_; }
     void closeN(size_t count);
 
+    /// pop an available connection that another process can take over;
+    /// keeps the last idle connection for ourselves
+    Comm::ConnectionPointer popShareable();
+
+    /// tell Coordinator that we no longer have spare connections to share
+    void unadvertise();
+
+    /// the textual form of the list key, for debugging and reporting
+    const char *keyText() const { return keyText_; }
+
+    /// fd_note() description of connections in this pooled list
+    const char *fdNote() const { return fdNote_; }
+
 private:
-    bool isAvailable(int i) const;
-    bool removeAt(int index);
-    int findIndexOf(const Comm::ConnectionPointer &conn) const;
-    void findAndClose(const Comm::ConnectionPointer &conn);
+    IdleConn *first() const;
+    IdleConn *next(const IdleConn *entry) const;
+    bool isAvailable(const IdleConn *entry) const;
+    bool closeStale();
+    void clearHandlers(IdleConn *entry);
+    Comm::ConnectionPointer remove(IdleConn *entry, pconn_idle_end_t how);
+    void findAndClose(IdleConn *entry);
     static IOCB Read;
     static CTCB Timeout;
 
@@ -63,16 +148,21 @@ public:
     hash_link hash;             /** must be first */
 
 private:
-    /** List of connections we are holding.
-     * Sorted as FIFO list for most efficient speeds on pop() and findUsable()
-     * The worst-case pop() and scans occur on timeout and link closure events
-     * where timing is less critical. Occasional slow additions are okay.
-     */
-    Comm::ConnectionPointer *theList_;
+    /// the pooled destination; hash.key points here
+    PconnKey key_;
+
+    /// key_ in textual form
+    char *keyText_;
 
-    /// Number of entries theList can currently hold without re-allocating (capacity).
-    int capacity_;
-    ///< Number of in-use entries in theList
+    /// "Idle server: keyText_", formatted once for all pushed connections
+    char *fdNote_;
+
+    /// the connection that has been idle the longest
+    IdleConn *oldest_;
+    /// the most recently pushed connection
+    IdleConn *newest_;
+
+    ///< Number of connections in the list
     int size_;
 
     /** The pool containing this sub-list.
@@ -82,6 +172,9 @@ private:
      */
     PconnPool *parent_;
 
+    /// whether Coordinator was told that we have spare connections to share
+    bool advertised_;
+
     char fakeReadBuf_[4096]; // TODO: kill magic number.
 
     CBDATA_CLASS2(IdleConnList);
@@ -130,15 +223,51 @@ public:
     int count() const { return theCount; }
     void noteConnectionAdded() { ++theCount; }
     void noteConnectionRemoved() { assert(theCount > 0); --theCount; }
+    /// records how long a connection stayed idle before leaving the pool
+    void noteIdleTime(double seconds, pconn_idle_end_t how);
+
+    /// Lets SMP workers hand idle connections in this pool to each other
+    /// when server_pconn_sharing is on. At most one pool may be shared.
+    void shareIdleConnections();
+    /// whether idle connections are currently shared with other workers
+    bool sharing() const;
+    /// tells Coordinator whether we have spare idle connections for the key
+    void advertise(const char *aKey, bool available);
+    void dumpSharing(StoreEntry *e) const;
+
+    /// gives one of our idle connections to the requesting worker, if possible
+    static void HandleIdleConnRequest(const Ipc::PconnRequest &request);
+    /// pools an idle connection given to us by another worker
+    static void HandleIdleConnDonation(const Ipc::PconnDonation &donation);
 
 private:
 
-    static const char *key(const Comm::ConnectionPointer &destLink, const char *domain);
+    /// asks Coordinator for an idle connection of another worker
+    void requestIdleConn(const PconnKey &key);
 
     int hist[PCONN_HIST_SZ];
+    StatHist reusedIdleTimes; ///< idle time of connections taken from the pool
+    StatHist closedIdleTimes; ///< idle time of connections closed while idle
+    StatHist donatedIdleTimes; ///< idle time of connections given to other workers
     hash_table *table;
     const char *descr;
     int theCount; ///< the number of pooled connections
+
+    /// idle connection sharing statistics
+    class SharingStats
+    {
+    public:
+        SharingStats(): requested(0), received(0), reused(0), donated(0), refused(0) {}
+
+        int requested; ///< idle connections asked from other workers
+        int received; ///< idle connections given to us by other workers
+        int reused; ///< received connections we have used
+        int donated; ///< idle connections we gave to other workers
+        int refused; ///< requests from other workers we could not satisfy
+    } sharingStats;
+
+    typedef std::map<std::string, time_t> RecentRequests;
+    RecentRequests recentRequests; ///< when we last requested each key
 };
 
 class StoreEntry;
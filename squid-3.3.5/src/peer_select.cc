@@ -167,6 +167,8 @@ peerSelect(Comm::ConnectionList * paths,
 
     psstate->callback_data = cbdataReference(callback_data);
 
+    request->phases.start(PhaseTimes::phPeerSelect);
+
 #if USE_CACHE_DIGESTS
 
     request->hier.peer_select_start = current_time;
@@ -305,6 +307,7 @@ peerSelectDnsPaths(ps_state *psstate)
 
     psstate->ping.stop = current_time;
     psstate->request->hier.ping = psstate->ping;
+    psstate->request->phases.stop(PhaseTimes::phPeerSelect);
 
     void *cbdata;
     if (cbdataReferenceValidDone(psstate->callback_data, &cbdata)) {
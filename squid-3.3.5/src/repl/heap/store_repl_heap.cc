@@ -353,6 +353,9 @@ createRemovalPolicy_heap(wordlist * args)
 
     policy->Add = heap_add;
 
+    /* heap keys come from entry metadata, not from the time of addition */
+    policy->AddCold = heap_add;
+
     policy->Remove = heap_remove;
 
     policy->Referenced = NULL;
@@ -110,6 +110,21 @@ lru_add(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
         lru->type = repl_guessType(entry, node);
 }
 
+/// adds the entry at the least recently used end, where purging starts
+static void
+lru_addCold(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    LruPolicyData *lru = (LruPolicyData *)policy->_data;
+    LruNode *lru_node;
+    assert(!node->data);
+    node->data = lru_node = (LruNode *)lru_node_pool->alloc();
+    dlinkAdd(entry, &lru_node->node, &lru->list);
+    lru->count += 1;
+
+    if (!lru->type)
+        lru->type = repl_guessType(entry, node);
+}
+
 static void
 lru_remove(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
 {
@@ -349,6 +364,8 @@ createRemovalPolicy_lru(wordlist * args)
 
     policy->Add = lru_add;
 
+    policy->AddCold = lru_addCold;
+
     policy->Remove = lru_remove;
 
     policy->Referenced = lru_referenced;
@@ -0,0 +1,171 @@
+/*
+ * DEBUG: none          Segmented LRU Removal Policy
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#ifndef SQUID_REPL_SLRU_SEGMENTS_H
+#define SQUID_REPL_SLRU_SEGMENTS_H
+
+#include "dlink.h"
+
+/**
+ * Segmented LRU bookkeeping, independent of StoreEntry so that trace
+ * replay tools can drive it directly.
+ *
+ * Segment 0 is the probationary segment: new items enter at its MRU end
+ * and victims are taken from its LRU end first. A referenced item moves
+ * to the MRU end of the next higher segment. Every segment above 0 may
+ * hold at most its share of the total bytes; an overflowing segment
+ * demotes its LRU items to the MRU end of the segment below. With four
+ * equal segments this is S4LRU; with one segment it is plain LRU.
+ *
+ * Within a segment the list head is the LRU end, like the lru policy.
+ * All operations are O(1), apart from demotions triggered by a promotion,
+ * which are bounded by the bytes moved and therefore amortized O(1).
+ */
+class SlruSegments
+{
+
+public:
+    static const int MaxSegments = 8;
+
+    /// per-item state; link must stay the first member (see lru() and next())
+    class Node
+    {
+
+    public:
+        Node() : size(0), segment(0) {}
+
+        dlink_node link; ///< link.data points to the cached item
+        int64_t size; ///< bytes charged to the segment
+        int segment;
+    };
+
+    /// creates count segments; shares, if given, are relative segment sizes
+    SlruSegments(int count, const int *shares = NULL) : segments(count), items(0), bytes(0), shareSum(0) {
+        assert(0 < segments && segments <= MaxSegments);
+        for (int i = 0; i < segments; ++i) {
+            share[i] = shares ? shares[i] : 1;
+            assert(share[i] > 0);
+            shareSum += share[i];
+            segItems[i] = 0;
+            segBytes[i] = 0;
+        }
+    }
+
+    /// starts tracking a new item in the probationary segment; a cold
+    /// item enters at the LRU end, where victims are taken from
+    void add(Node *node, void *data, int64_t size, bool cold = false) {
+        node->size = size;
+        node->segment = 0;
+        link(node, data, 0, cold);
+        ++items;
+        bytes += size;
+    }
+
+    /// stops tracking the item
+    void remove(Node *node) {
+        unlink(node);
+        --items;
+        bytes -= node->size;
+    }
+
+    /// a hit: promotes the item one segment up, demoting overflow below
+    void referenced(Node *node, int64_t size) {
+        void *data = node->link.data;
+        const int to = node->segment + 1 < segments ? node->segment + 1 : node->segment;
+        unlink(node);
+        bytes += size - node->size;
+        node->size = size;
+        node->segment = to;
+        link(node, data, to);
+        balance(to);
+    }
+
+    /// refreshes the item within its current segment without promoting it
+    void touched(Node *node) {
+        void *data = node->link.data;
+        unlink(node);
+        link(node, data, node->segment);
+    }
+
+    /// the least recently used item of the segment, if any
+    Node *lru(int segment) const { return reinterpret_cast<Node *>(list[segment].head); }
+
+    /// the next more recently used item in the same segment, if any
+    static Node *next(const Node *node) { return reinterpret_cast<Node *>(node->link.next); }
+
+    int count() const { return segments; }
+    int itemCount() const { return items; }
+    int itemCount(int segment) const { return segItems[segment]; }
+    int64_t byteCount() const { return bytes; }
+    int64_t byteCount(int segment) const { return segBytes[segment]; }
+    int shareOf(int segment) const { return share[segment]; }
+
+private:
+    void link(Node *node, void *data, int segment, bool atLruEnd = false) {
+        if (atLruEnd)
+            dlinkAdd(data, &node->link, &list[segment]);
+        else
+            dlinkAddTail(data, &node->link, &list[segment]);
+        ++segItems[segment];
+        segBytes[segment] += node->size;
+    }
+
+    void unlink(Node *node) {
+        dlinkDelete(&node->link, &list[node->segment]);
+        --segItems[node->segment];
+        segBytes[node->segment] -= node->size;
+    }
+
+    /// demotes LRU items from segment s (and then below) to fit their shares
+    void balance(int s) {
+        for (; s > 0; --s) {
+            const int64_t limit = bytes / shareSum * share[s] + bytes % shareSum * share[s] / shareSum;
+            while (segBytes[s] > limit && segItems[s] > 1) {
+                Node *victim = lru(s);
+                void *data = victim->link.data;
+                unlink(victim);
+                victim->segment = s - 1;
+                link(victim, data, s - 1);
+            }
+        }
+    }
+
+    int segments;
+    dlink_list list[MaxSegments];
+    int share[MaxSegments];
+    int segItems[MaxSegments];
+    int64_t segBytes[MaxSegments];
+    int items;
+    int64_t bytes;
+    int shareSum;
+};
+
+#endif /* SQUID_REPL_SLRU_SEGMENTS_H */
@@ -0,0 +1,462 @@
+/*
+ * DEBUG: section 81    Segmented LRU Removal Policy
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "Debug.h"
+#include "MemObject.h"
+#include "slru/SlruSegments.h"
+#include "SquidTime.h"
+#include "Store.h"
+#include "wordlist.h"
+
+REMOVALPOLICYCREATE createRemovalPolicy_slru;
+
+typedef SlruSegments::Node SlruNode;
+
+struct SlruPolicyData {
+    SlruPolicyData(int count, const int *shares) : policy(NULL), segments(count, shares), nwalkers(0), type(TYPE_UNKNOWN) {}
+
+    void setPolicyNode (StoreEntry *, void *) const;
+    RemovalPolicy *policy;
+    SlruSegments segments;
+    int nwalkers;
+    enum heap_entry_type {
+        TYPE_UNKNOWN = 0, TYPE_STORE_ENTRY, TYPE_STORE_MEM
+    } type;
+};
+
+/* Hack to avoid having to remember the RemovalPolicyNode location.
+ * Needed by the purge walker to clear the policy information
+ */
+static enum SlruPolicyData::heap_entry_type
+repl_guessType(StoreEntry * entry, RemovalPolicyNode * node)
+{
+    if (node == &entry->repl)
+        return SlruPolicyData::TYPE_STORE_ENTRY;
+
+    if (entry->mem_obj && node == &entry->mem_obj->repl)
+        return SlruPolicyData::TYPE_STORE_MEM;
+
+    fatal("SLRU Replacement: Unknown StoreEntry node type");
+
+    return SlruPolicyData::TYPE_UNKNOWN;
+}
+
+void
+SlruPolicyData::setPolicyNode (StoreEntry *entry, void *value) const
+{
+    switch (type) {
+
+    case TYPE_STORE_ENTRY:
+        entry->repl.data = value;
+        break ;
+
+    case TYPE_STORE_MEM:
+        entry->mem_obj->repl.data = value ;
+        break ;
+
+    default:
+        break;
+    }
+}
+
+/// bytes charged for the entry; segment shares are byte shares
+static int64_t
+slru_size(const StoreEntry * entry)
+{
+    int64_t size = entry->swap_file_sz;
+
+    if (!size && entry->mem_obj)
+        size = entry->mem_obj->endOffset();
+
+    /* entries of unknown size still take a slot */
+    return size > 0 ? size : 1;
+}
+
+static MemAllocator *slru_node_pool = NULL;
+
+static void
+slru_add(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node;
+    assert(!node->data);
+    node->data = slru_node = (SlruNode *)slru_node_pool->alloc();
+    slru->segments.add(slru_node, entry, slru_size(entry));
+
+    if (!slru->type)
+        slru->type = repl_guessType(entry, node);
+}
+
+static void
+slru_addCold(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node;
+    assert(!node->data);
+    node->data = slru_node = (SlruNode *)slru_node_pool->alloc();
+    slru->segments.add(slru_node, entry, slru_size(entry), true);
+
+    if (!slru->type)
+        slru->type = repl_guessType(entry, node);
+}
+
+static void
+slru_remove(RemovalPolicy * policy, StoreEntry * entry, RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    assert(slru_node->link.data == entry);
+
+    node->data = NULL;
+
+    slru->segments.remove(slru_node);
+
+    slru_node_pool->freeOne(slru_node);
+}
+
+/// a new reference promotes the entry to the next segment
+static void
+slru_referenced(RemovalPolicy * policy, const StoreEntry * entry,
+                RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    slru->segments.referenced(slru_node, slru_size(entry));
+}
+
+/// the end of a reference only refreshes the entry within its segment
+static void
+slru_dereferenced(RemovalPolicy * policy, const StoreEntry * entry,
+                  RemovalPolicyNode * node)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node = (SlruNode *)node->data;
+
+    if (!slru_node)
+        return;
+
+    slru->segments.touched(slru_node);
+}
+
+/** RemovalPolicyWalker **/
+
+typedef struct _SlruWalkData SlruWalkData;
+
+/// visits entries in eviction order: segment 0 first, LRU end first
+struct _SlruWalkData {
+    SlruNode *current;
+    int segment;
+};
+
+static const StoreEntry *
+slru_walkNext(RemovalPolicyWalker * walker)
+{
+    SlruWalkData *slru_walk = (SlruWalkData *)walker->_data;
+    SlruPolicyData *slru = (SlruPolicyData *)walker->_policy->_data;
+
+    while (!slru_walk->current) {
+        if (++slru_walk->segment >= slru->segments.count())
+            return NULL;
+
+        slru_walk->current = slru->segments.lru(slru_walk->segment);
+    }
+
+    SlruNode *slru_node = slru_walk->current;
+    slru_walk->current = SlruSegments::next(slru_node);
+    return (StoreEntry *) slru_node->link.data;
+}
+
+static void
+slru_walkDone(RemovalPolicyWalker * walker)
+{
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(slru->nwalkers > 0);
+    slru->nwalkers -= 1;
+    safe_free(walker->_data);
+    delete walker;
+}
+
+static RemovalPolicyWalker *
+slru_walkInit(RemovalPolicy * policy)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    RemovalPolicyWalker *walker;
+    SlruWalkData *slru_walk;
+    slru->nwalkers += 1;
+    walker = new RemovalPolicyWalker;
+    slru_walk = (SlruWalkData *)xcalloc(1, sizeof(*slru_walk));
+    walker->_policy = policy;
+    walker->_data = slru_walk;
+    walker->Next = slru_walkNext;
+    walker->Done = slru_walkDone;
+    slru_walk->segment = 0;
+    slru_walk->current = slru->segments.lru(0);
+    return walker;
+}
+
+/** RemovalPurgeWalker **/
+
+typedef struct _SlruPurgeData SlruPurgeData;
+
+struct _SlruPurgeData {
+    SlruNode *current;
+    SlruNode *start; ///< where the scan of the current segment began
+    int segment;
+};
+
+static StoreEntry *
+slru_purgeNext(RemovalPurgeWalker * walker)
+{
+    SlruPurgeData *slru_walker = (SlruPurgeData *)walker->_data;
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    SlruNode *slru_node;
+    StoreEntry *entry;
+
+try_again:
+
+    while (!slru_walker->current) {
+        if (++slru_walker->segment >= slru->segments.count())
+            return NULL;
+
+        slru_walker->start = slru_walker->current = slru->segments.lru(slru_walker->segment);
+    }
+
+    slru_node = slru_walker->current;
+
+    if (walker->scanned >= walker->max_scan)
+        return NULL;
+
+    walker->scanned += 1;
+
+    slru_walker->current = SlruSegments::next(slru_node);
+
+    if (slru_walker->current == slru_walker->start) {
+        /* Last node of this segment found */
+        slru_walker->current = NULL;
+    }
+
+    entry = (StoreEntry *) slru_node->link.data;
+
+    if (entry->locked()) {
+        /* locked entries stay, but move out of the way of the scan */
+        ++ walker->locked;
+        slru->segments.touched(slru_node);
+        goto try_again;
+    }
+
+    slru->segments.remove(slru_node);
+    slru_node_pool->freeOne(slru_node);
+    slru->setPolicyNode(entry, NULL);
+    return entry;
+}
+
+static void
+slru_purgeDone(RemovalPurgeWalker * walker)
+{
+    RemovalPolicy *policy = walker->_policy;
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(slru->nwalkers > 0);
+    slru->nwalkers -= 1;
+    safe_free(walker->_data);
+    delete walker;
+}
+
+static RemovalPurgeWalker *
+slru_purgeInit(RemovalPolicy * policy, int max_scan)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    RemovalPurgeWalker *walker;
+    SlruPurgeData *slru_walk;
+    slru->nwalkers += 1;
+    walker = new RemovalPurgeWalker;
+    slru_walk = (SlruPurgeData *)xcalloc(1, sizeof(*slru_walk));
+    walker->_policy = policy;
+    walker->_data = slru_walk;
+    walker->max_scan = max_scan;
+    walker->Next = slru_purgeNext;
+    walker->Done = slru_purgeDone;
+    slru_walk->segment = 0;
+    slru_walk->start = slru_walk->current = slru->segments.lru(0);
+    return walker;
+}
+
+static void
+slru_stats(RemovalPolicy * policy, StoreEntry * sentry)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    const SlruSegments &segments = slru->segments;
+
+    for (int i = 0; i < segments.count(); ++i) {
+        storeAppendPrintf(sentry, "SLRU segment %d: %d entries, %" PRId64 " KB (share %d)\n",
+                          i, segments.itemCount(i), segments.byteCount(i) >> 10, segments.shareOf(i));
+    }
+
+    for (int i = 0; i < segments.count(); ++i) {
+        for (SlruNode *slru_node = segments.lru(i); slru_node; slru_node = SlruSegments::next(slru_node)) {
+            const StoreEntry *entry = (const StoreEntry *) slru_node->link.data;
+
+            if (entry->locked())
+                continue;
+
+            storeAppendPrintf(sentry, "SLRU reference age: %.2f days\n", (double) (squid_curtime - entry->lastref) / (double) (24 * 60 * 60));
+            return;
+        }
+    }
+}
+
+static void
+slru_free(RemovalPolicy * policy)
+{
+    SlruPolicyData *slru = (SlruPolicyData *)policy->_data;
+    /* Make some verification of the policy state */
+    assert(strcmp(policy->_type, "slru") == 0);
+    assert(!slru->nwalkers);
+    assert(!slru->segments.itemCount());
+    /* Ok, time to destroy this policy */
+    delete slru;
+    memset(policy, 0, sizeof(*policy));
+    delete policy;
+}
+
+/**
+ * Accepts an optional segment layout: either a segment count
+ * ("slru 3", equal shares) or comma-separated relative shares listed
+ * from the probationary segment up ("slru 50,30,20").
+ * The default is four equal segments (S4LRU).
+ */
+RemovalPolicy *
+createRemovalPolicy_slru(wordlist * args)
+{
+    RemovalPolicy *policy;
+    SlruPolicyData *slru_data;
+    int count = 4;
+    int shares[SlruSegments::MaxSegments];
+
+    for (int i = 0; i < SlruSegments::MaxSegments; ++i)
+        shares[i] = 1;
+
+    if (args) {
+        const char *layout = args->key;
+        args = args->next;
+
+        if (!strchr(layout, ',')) {
+            count = atoi(layout);
+        } else {
+            count = 0;
+
+            for (const char *p = layout; p; p = strchr(p, ',')) {
+                if (*p == ',')
+                    ++p;
+
+                if (count >= SlruSegments::MaxSegments) {
+                    count = 0;
+                    break;
+                }
+
+                shares[count] = atoi(p);
+
+                if (shares[count] <= 0) {
+                    count = 0;
+                    break;
+                }
+
+                ++count;
+            }
+        }
+
+        if (count < 1 || count > SlruSegments::MaxSegments) {
+            debugs(81, DBG_CRITICAL, "createRemovalPolicy_slru: Invalid segment layout \"" << layout << "\". Using 4 equal segments");
+            count = 4;
+
+            for (int i = 0; i < SlruSegments::MaxSegments; ++i)
+                shares[i] = 1;
+        }
+    }
+
+    /* No additional arguments expected */
+    while (args) {
+        debugs(81, DBG_IMPORTANT, "WARNING: discarding unknown removal policy '" << args->key << "'");
+        args = args->next;
+    }
+
+    /* Initialize */
+
+    if (!slru_node_pool) {
+        /* Must be chunked */
+        slru_node_pool = memPoolCreate("SLRU policy node", sizeof(SlruNode));
+        slru_node_pool->setChunkSize(512 * 1024);
+    }
+
+    /* Allocate the needed structures */
+    slru_data = new SlruPolicyData(count, shares);
+
+    policy = new RemovalPolicy;
+
+    slru_data->policy = policy;
+
+    /* Populate the policy structure */
+    policy->_type = "slru";
+
+    policy->_data = slru_data;
+
+    policy->Free = slru_free;
+
+    policy->Add = slru_add;
+
+    policy->AddCold = slru_addCold;
+
+    policy->Remove = slru_remove;
+
+    policy->Referenced = slru_referenced;
+
+    policy->Dereferenced = slru_dereferenced;
+
+    policy->WalkInit = slru_walkInit;
+
+    policy->PurgeInit = slru_purgeInit;
+
+    policy->Stats = slru_stats;
+
+    return policy;
+}
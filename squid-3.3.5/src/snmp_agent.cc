@@ -577,35 +577,31 @@ snmp_prfProtoFn(variable_list * Var, snint * ErrP)
             break;
 
         case PERF_MEDIAN_HTTP_ALL:
-            x = statHistDeltaMedian(l->client_http.allSvcTime,
-                                    f->client_http.allSvcTime);
+            x = f->client_http.allSvcTime.deltaPctile(l->client_http.allSvcTime, 0.5) / 1000.0;
             break;
 
         case PERF_MEDIAN_HTTP_MISS:
-            x = statHistDeltaMedian(l->client_http.missSvcTime,
-                                    f->client_http.missSvcTime);
+            x = f->client_http.missSvcTime.deltaPctile(l->client_http.missSvcTime, 0.5) / 1000.0;
             break;
 
         case PERF_MEDIAN_HTTP_NM:
-            x = statHistDeltaMedian(l->client_http.nearMissSvcTime,
-                                    f->client_http.nearMissSvcTime);
+            x = f->client_http.nearMissSvcTime.deltaPctile(l->client_http.nearMissSvcTime, 0.5) / 1000.0;
             break;
 
         case PERF_MEDIAN_HTTP_HIT:
-            x = statHistDeltaMedian(l->client_http.hitSvcTime,
-                                    f->client_http.hitSvcTime);
+            x = f->client_http.hitSvcTime.deltaPctile(l->client_http.hitSvcTime, 0.5) / 1000.0;
             break;
 
         case PERF_MEDIAN_ICP_QUERY:
-            x = statHistDeltaMedian(l->icp.querySvcTime, f->icp.querySvcTime);
+            x = f->icp.querySvcTime.deltaPctile(l->icp.querySvcTime, 0.5);
             break;
 
         case PERF_MEDIAN_ICP_REPLY:
-            x = statHistDeltaMedian(l->icp.replySvcTime, f->icp.replySvcTime);
+            x = f->icp.replySvcTime.deltaPctile(l->icp.replySvcTime, 0.5);
             break;
 
         case PERF_MEDIAN_DNS:
-            x = statHistDeltaMedian(l->dns.svcTime, f->dns.svcTime);
+            x = f->dns.svcTime.deltaPctile(l->dns.svcTime, 0.5) / 1000.0;
             break;
 
         case PERF_MEDIAN_RHR:
@@ -617,8 +613,7 @@ snmp_prfProtoFn(variable_list * Var, snint * ErrP)
             break;
 
         case PERF_MEDIAN_HTTP_NH:
-            x = statHistDeltaMedian(l->client_http.nearHitSvcTime,
-                                    f->client_http.nearHitSvcTime);
+            x = f->client_http.nearHitSvcTime.deltaPctile(l->client_http.nearHitSvcTime, 0.5) / 1000.0;
             break;
 
         default:
@@ -0,0 +1,460 @@
+/*
+ * DEBUG: section 83    SSL accelerator support
+ *
+ */
+
+#include "squid.h"
+#include "base/TextException.h"
+#include "comm.h"
+#include "comm/Loops.h"
+#include "Debug.h"
+#include "fd.h"
+#include "fde.h"
+#include "ssl/certificate_index.h"
+#include "ssl/CertSigner.h"
+#include "ssl/Config.h"
+
+#if HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#if HAVE_STDEXCEPT
+#include <stdexcept>
+#endif
+
+Ssl::CertSignerCb::~CertSignerCb()
+{
+    // the call was cancelled before the results were used
+    if (cert)
+        X509_free(cert);
+    if (pkey)
+        EVP_PKEY_free(pkey);
+}
+
+// Squid links with POSIX threads only when DiskThreads are enabled.
+#if USE_DISKIO_DISKTHREADS
+#include <pthread.h>
+
+namespace Ssl
+{
+
+/// a certificate generation request and its results
+class CertSignerJob
+{
+public:
+    CertSignerJob(const CertificateProperties &aProperties, AsyncCall::Pointer &aCallback);
+
+    CertificateProperties properties; ///< what to generate
+    X509_Pointer cert; ///< generated certificate
+    EVP_PKEY_Pointer pkey; ///< generated certificate key
+    std::string error; ///< certificate database problem, if any
+    AsyncCall::Pointer callback; ///< main loop notification; never touched by threads
+    CertSignerJob *next; ///< the next job in the same queue
+};
+
+} // namespace Ssl
+
+/// a FIFO list of jobs
+class CertSignerQueue
+{
+public:
+    CertSignerQueue(): head(NULL), tail(&head) {}
+
+    void push(Ssl::CertSignerJob *job) { job->next = NULL; *tail = job; tail = &job->next; }
+    Ssl::CertSignerJob *pop();
+    /// removes and returns all queued jobs
+    Ssl::CertSignerJob *popAll() { Ssl::CertSignerJob *all = head; head = NULL; tail = &head; return all; }
+
+private:
+    Ssl::CertSignerJob *head;
+    Ssl::CertSignerJob **tail;
+};
+
+Ssl::CertSignerJob *
+CertSignerQueue::pop()
+{
+    Ssl::CertSignerJob *job = head;
+    if (job) {
+        head = job->next;
+        if (!head)
+            tail = &head;
+    }
+    return job;
+}
+
+/// protects all variables shared with signer threads
+static pthread_mutex_t TheMutex = PTHREAD_MUTEX_INITIALIZER;
+/// wakes up idle signer threads
+static pthread_cond_t TheCondition = PTHREAD_COND_INITIALIZER;
+static CertSignerQueue TheRequests; ///< jobs waiting for a signer thread
+static CertSignerQueue TheAnswers; ///< jobs waiting for the main loop
+static EVP_PKEY **KeyPool = NULL; ///< pre-generated keys
+static int KeyPoolSize = 0; ///< KeyPool capacity
+static int KeyPoolLevel = 0; ///< number of keys in KeyPool
+static int KeysInProgress = 0; ///< keys being generated for KeyPool
+static bool Stopping = false; ///< whether signer threads must quit
+static std::string DbPath; ///< certificate database directory or empty
+static size_t DbSize = 0; ///< certificate database size limit
+
+/* main loop variables */
+static pthread_t *Threads = NULL; ///< running signer threads
+static int ThreadCount = 0; ///< number of Threads
+static int NotifyReadFd = -1; ///< main loop side of the notification pipe
+static int NotifyWriteFd = -1; ///< thread side of the notification pipe
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L
+/// OpenSSL before v1.1 relies on the application for thread locking
+static pthread_mutex_t *OpenSslLocks = NULL;
+
+static void
+OpenSslLockingCallback(int mode, int n, const char *, int)
+{
+    if (mode & CRYPTO_LOCK)
+        pthread_mutex_lock(&OpenSslLocks[n]);
+    else
+        pthread_mutex_unlock(&OpenSslLocks[n]);
+}
+
+#if OPENSSL_VERSION_NUMBER < 0x10000000L
+static unsigned long
+OpenSslIdCallback()
+{
+    return static_cast<unsigned long>(pthread_self());
+}
+#endif
+
+/// makes OpenSSL thread-safe unless somebody already did that
+static void
+InstallOpenSslLocking()
+{
+    if (CRYPTO_get_locking_callback())
+        return;
+
+    const int count = CRYPTO_num_locks();
+    OpenSslLocks = new pthread_mutex_t[count];
+    for (int i = 0; i < count; ++i)
+        pthread_mutex_init(&OpenSslLocks[i], NULL);
+#if OPENSSL_VERSION_NUMBER < 0x10000000L
+    CRYPTO_set_id_callback(&OpenSslIdCallback);
+#endif
+    CRYPTO_set_locking_callback(&OpenSslLockingCallback);
+}
+#else
+static void InstallOpenSslLocking() {}
+#endif
+
+Ssl::CertSignerJob::CertSignerJob(const CertificateProperties &aProperties, AsyncCall::Pointer &aCallback):
+        callback(aCallback),
+        next(NULL)
+{
+    // CertificateProperties cannot be copied
+    properties.mimicCert.resetAndLock(aProperties.mimicCert.get());
+    properties.signWithX509.resetAndLock(aProperties.signWithX509.get());
+    properties.signWithPkey.resetAndLock(aProperties.signWithPkey.get());
+    properties.setValidAfter = aProperties.setValidAfter;
+    properties.setValidBefore = aProperties.setValidBefore;
+    properties.setCommonName = aProperties.setCommonName;
+    properties.commonName = aProperties.commonName;
+    properties.signAlgorithm = aProperties.signAlgorithm;
+}
+
+/// tells the main loop that TheAnswers has more jobs
+static void
+NotifyMainLoop()
+{
+    const char c = '!';
+    // ignore errors: a full pipe already has unread notifications
+    if (write(NotifyWriteFd, &c, 1) < 0) {}
+}
+
+/// looks the job certificate up in the certificate database, if any;
+/// called without TheMutex
+static bool
+Find(Ssl::CertSignerJob &job, Ssl::CertificateIndex *db)
+{
+    if (!db)
+        return false;
+
+    try {
+        const std::string key = job.properties.dbKey();
+        if (!db->find(key, job.cert, job.pkey))
+            return false;
+        if (Ssl::certificateMatchesProperties(job.cert.get(), job.properties))
+            return true;
+        // The certificate changed (renewed or other reason).
+        job.cert.reset(NULL);
+        job.pkey.reset(NULL);
+        db->purgeCert(key);
+    } catch (const std::runtime_error &e) {
+        job.error = e.what();
+    }
+    job.cert.reset(NULL);
+    job.pkey.reset(NULL);
+    return false;
+}
+
+/// stores the generated job certificate in the certificate database, if any;
+/// called without TheMutex
+static void
+Store(Ssl::CertSignerJob &job, Ssl::CertificateIndex *db)
+{
+    if (!db || !job.cert)
+        return;
+
+    try {
+        // may replace our certificate with the one stored by another worker
+        db->addCertAndPrivateKey(job.cert, job.pkey, job.properties.dbKey());
+    } catch (const std::runtime_error &e) {
+        job.error = e.what();
+    }
+}
+
+/// generates the job certificate; called without TheMutex
+static void
+Sign(Ssl::CertSignerJob &job, EVP_PKEY *pooledKey)
+{
+    if (!job.properties.signWithPkey.get())
+        job.properties.freshPkey.reset(pooledKey ? pooledKey : Ssl::createSslPrivateKey());
+
+    if (!Ssl::generateSslCertificate(job.cert, job.pkey, job.properties)) {
+        job.cert.reset(NULL);
+        job.pkey.reset(NULL);
+    }
+}
+
+/// signer thread main loop
+static void *
+SignerThread(void *)
+{
+    // leave signal handling to the main thread
+    sigset_t signals;
+    sigfillset(&signals);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    // each thread uses its own database lock and mapping;
+    // CertSignerStart() has already reported database errors
+    Ssl::CertificateIndex *db = NULL;
+    if (!DbPath.empty()) {
+        try {
+            db = new Ssl::CertificateIndex(DbPath, DbSize, 2048);
+        } catch (const std::runtime_error &) {
+            db = NULL;
+        }
+    }
+
+    pthread_mutex_lock(&TheMutex);
+    while (!Stopping) {
+        if (Ssl::CertSignerJob *job = TheRequests.pop()) {
+            pthread_mutex_unlock(&TheMutex);
+
+            if (!Find(*job, db)) {
+                EVP_PKEY *pooledKey = NULL;
+                pthread_mutex_lock(&TheMutex);
+                if (!job->properties.signWithPkey.get() && KeyPoolLevel > 0)
+                    pooledKey = KeyPool[--KeyPoolLevel];
+                pthread_mutex_unlock(&TheMutex);
+
+                Sign(*job, pooledKey);
+                Store(*job, db);
+            }
+
+            pthread_mutex_lock(&TheMutex);
+            TheAnswers.push(job);
+            NotifyMainLoop();
+            continue;
+        }
+
+        // use idle time to replenish the key pool
+        if (KeyPoolLevel + KeysInProgress < KeyPoolSize) {
+            ++KeysInProgress;
+            pthread_mutex_unlock(&TheMutex);
+
+            EVP_PKEY *key = Ssl::createSslPrivateKey();
+
+            pthread_mutex_lock(&TheMutex);
+            --KeysInProgress;
+            if (key)
+                KeyPool[KeyPoolLevel++] = key;
+            continue;
+        }
+
+        pthread_cond_wait(&TheCondition, &TheMutex);
+    }
+    pthread_mutex_unlock(&TheMutex);
+    delete db;
+    return NULL;
+}
+
+/// delivers generated certificates to their requestors
+static void
+HandleAnswers(int fd, void *)
+{
+    char buf[256];
+    while (read(fd, buf, sizeof(buf)) > 0) {}
+    Comm::SetSelect(fd, COMM_SELECT_READ, &HandleAnswers, NULL, 0);
+
+    pthread_mutex_lock(&TheMutex);
+    Ssl::CertSignerJob *job = TheAnswers.popAll();
+    pthread_mutex_unlock(&TheMutex);
+
+    while (job) {
+        Ssl::CertSignerJob *const next = job->next;
+        Ssl::CertSignerCb *cbd = dynamic_cast<Ssl::CertSignerCb*>(job->callback->getDialer());
+        Must(cbd);
+        cbd->cert = job->cert.release();
+        cbd->pkey = job->pkey.release();
+        if (!job->error.empty())
+            debugs(83, DBG_IMPORTANT, "WARNING: certificate database " << DbPath << ": " << job->error);
+        debugs(83, 5, HERE << (cbd->cert ? "generated" : "failed to generate") <<
+               " a certificate for " << job->properties.commonName);
+        ScheduleCallHere(job->callback);
+        delete job;
+        job = next;
+    }
+}
+
+bool
+Ssl::CertSignerEnabled()
+{
+    return ThreadCount > 0;
+}
+
+void
+Ssl::CertSignerStart()
+{
+    if (ThreadCount || Ssl::TheConfig.signerThreads <= 0)
+        return;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        debugs(83, DBG_CRITICAL, "ERROR: cannot create certificate signer pipe: " << xstrerror());
+        return;
+    }
+    NotifyReadFd = fds[0];
+    NotifyWriteFd = fds[1];
+    fd_open(NotifyReadFd, FD_PIPE, "certificate signer completion: main");
+    fd_open(NotifyWriteFd, FD_PIPE, "certificate signer completion: threads");
+    commSetNonBlocking(NotifyReadFd);
+    commSetNonBlocking(NotifyWriteFd);
+    commSetCloseOnExec(NotifyReadFd);
+    commSetCloseOnExec(NotifyWriteFd);
+    Comm::SetSelect(NotifyReadFd, COMM_SELECT_READ, &HandleAnswers, NULL, 0);
+
+    InstallOpenSslLocking();
+
+    DbPath.clear();
+    if (Ssl::TheConfig.signerDb) {
+        try {
+            // SMP kids share the database and may all get here at once
+            Ssl::CertificateIndex::Prepare(Ssl::TheConfig.signerDb, Ssl::TheConfig.signerDbSize, 2048);
+            Ssl::CertificateIndex::check(Ssl::TheConfig.signerDb, Ssl::TheConfig.signerDbSize);
+            DbPath = Ssl::TheConfig.signerDb;
+            DbSize = Ssl::TheConfig.signerDbSize;
+        } catch (const std::runtime_error &e) {
+            debugs(83, DBG_CRITICAL, "ERROR: cannot use certificate database " <<
+                   Ssl::TheConfig.signerDb << ": " << e.what());
+        }
+    }
+
+    Stopping = false;
+    KeyPoolSize = max(Ssl::TheConfig.signerKeys, 0);
+    KeyPool = new EVP_PKEY*[max(KeyPoolSize, 1)];
+
+    Threads = new pthread_t[Ssl::TheConfig.signerThreads];
+    for (int i = 0; i < Ssl::TheConfig.signerThreads; ++i) {
+        if (const int err = pthread_create(&Threads[ThreadCount], NULL, &SignerThread, NULL)) {
+            debugs(83, DBG_CRITICAL, "ERROR: cannot start a certificate signer thread: " << xstrerr(err));
+            break;
+        }
+        ++ThreadCount;
+    }
+
+    debugs(83, DBG_IMPORTANT, "Started " << ThreadCount << " certificate signer threads" <<
+           " with a pool of " << KeyPoolSize << " pre-generated keys" <<
+           (DbPath.empty() ? "" : " and certificate database ") << DbPath);
+}
+
+void
+Ssl::CertSignerStop()
+{
+    if (!Threads)
+        return;
+
+    pthread_mutex_lock(&TheMutex);
+    Stopping = true;
+    pthread_cond_broadcast(&TheCondition);
+    pthread_mutex_unlock(&TheMutex);
+
+    for (int i = 0; i < ThreadCount; ++i)
+        pthread_join(Threads[i], NULL);
+    delete[] Threads;
+    Threads = NULL;
+    ThreadCount = 0;
+
+    // the threads are gone; no locking is needed
+    CertSignerJob *job = TheRequests.popAll();
+    while (job) {
+        CertSignerJob *const next = job->next;
+        delete job;
+        job = next;
+    }
+    job = TheAnswers.popAll();
+    while (job) {
+        CertSignerJob *const next = job->next;
+        delete job;
+        job = next;
+    }
+
+    while (KeyPoolLevel > 0)
+        EVP_PKEY_free(KeyPool[--KeyPoolLevel]);
+    delete[] KeyPool;
+    KeyPool = NULL;
+    KeyPoolSize = 0;
+
+    Comm::SetSelect(NotifyReadFd, COMM_SELECT_READ, NULL, NULL, 0);
+    close(NotifyReadFd);
+    close(NotifyWriteFd);
+    fd_close(NotifyReadFd);
+    fd_close(NotifyWriteFd);
+    NotifyReadFd = NotifyWriteFd = -1;
+}
+
+void
+Ssl::GenerateCertificate(const CertificateProperties &properties, AsyncCall::Pointer &callback)
+{
+    Must(CertSignerEnabled());
+    CertSignerJob *job = new CertSignerJob(properties, callback);
+
+    pthread_mutex_lock(&TheMutex);
+    TheRequests.push(job);
+    pthread_cond_signal(&TheCondition);
+    pthread_mutex_unlock(&TheMutex);
+}
+
+#else /* !USE_DISKIO_DISKTHREADS */
+
+bool
+Ssl::CertSignerEnabled()
+{
+    return false;
+}
+
+void
+Ssl::CertSignerStart()
+{
+    if (Ssl::TheConfig.signerThreads > 0)
+        debugs(83, DBG_IMPORTANT, "WARNING: sslproxy_cert_gen_threads requires POSIX threads support; " <<
+               "generating certificates without threads");
+}
+
+void
+Ssl::CertSignerStop()
+{
+}
+
+void
+Ssl::GenerateCertificate(const CertificateProperties &, AsyncCall::Pointer &)
+{
+    Must(false); // CertSignerEnabled() is false
+}
+
+#endif /* USE_DISKIO_DISKTHREADS */
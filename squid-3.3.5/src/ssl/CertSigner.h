@@ -0,0 +1,46 @@
+/*
+ * DEBUG: section 83    SSL accelerator support
+ *
+ */
+
+#ifndef SQUID_SSL_CERT_SIGNER_H
+#define SQUID_SSL_CERT_SIGNER_H
+
+#include "base/AsyncCall.h"
+#include "ssl/gadgets.h"
+
+namespace Ssl
+{
+
+/// common API for all GenerateCertificate() callbacks
+class CertSignerCb
+{
+public:
+    CertSignerCb(): cert(NULL), pkey(NULL) {}
+    /// dialers are copied before any results are set
+    CertSignerCb(const CertSignerCb &): cert(NULL), pkey(NULL) {}
+    virtual ~CertSignerCb();
+
+    X509 *cert; ///< generated certificate or nil on failures; owned
+    EVP_PKEY *pkey; ///< generated certificate key or nil on failures; owned
+
+private:
+    CertSignerCb &operator =(const CertSignerCb &); // not implemented
+};
+
+/// whether SslBump certificates are generated by in-process threads
+bool CertSignerEnabled();
+
+/// starts certificate generation threads if they are configured
+void CertSignerStart();
+
+/// stops certificate generation threads, dropping pending requests
+void CertSignerStop();
+
+/// Generates a certificate in a signer thread and schedules the callback
+/// in the main loop. The callback dialer must be a CertSignerCb.
+void GenerateCertificate(const CertificateProperties &properties, AsyncCall::Pointer &callback);
+
+} // namespace Ssl
+
+#endif /* SQUID_SSL_CERT_SIGNER_H */
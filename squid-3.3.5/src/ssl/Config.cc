@@ -3,11 +3,14 @@
 
 Ssl::Config Ssl::TheConfig;
 
-Ssl::Config::Config()
+Ssl::Config::Config():
 #if USE_SSL_CRTD
-        :
-        ssl_crtd(NULL)
+        ssl_crtd(NULL),
 #endif
+        signerThreads(0),
+        signerKeys(0),
+        signerDb(NULL),
+        signerDbSize(0)
 {
 }
 
@@ -16,4 +19,5 @@ Ssl::Config::~Config()
 #if USE_SSL_CRTD
     xfree(ssl_crtd);
 #endif
+    xfree(signerDb);
 }
@@ -14,6 +14,10 @@ public:
     /// The number of processes spawn for ssl_crtd.
     HelperChildConfig ssl_crtdChildren;
 #endif
+    int signerThreads; ///< number of in-process certificate generation threads
+    int signerKeys; ///< number of keys pre-generated by those threads
+    char *signerDb; ///< certificate database used by those threads or nil
+    size_t signerDbSize; ///< maximum size of that database
     Config();
     ~Config();
 private:
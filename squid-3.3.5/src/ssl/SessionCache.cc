@@ -0,0 +1,391 @@
+/*
+ * DEBUG: section 83    SSL accelerator support
+ *
+ */
+
+#include "squid.h"
+#include "base/RunnersRegistry.h"
+#include "base/TextException.h"
+#include "Debug.h"
+#include "ipc/mem/Segment.h"
+#include "mgr/Registration.h"
+#include "SquidConfig.h"
+#include "SquidTime.h"
+#include "ssl/SessionCache.h"
+#include "Store.h"
+#include "tools.h"
+
+/// shared memory segment path to use for TLS sessions
+static const char *const SegmentLabel = "ssl_session_cache";
+
+/// the number of neighbouring slots a key may be stored in
+static const int ProbeLimit = 4;
+
+/// attached segment or nil if the cache is disabled
+static Ipc::Mem::Pointer<Ssl::SessionCache::Shared> TheShared;
+
+/// this kid's cache activity, indexed by SessionCache::Kind
+static struct {
+    uint64_t lookups; ///< Get() calls
+    uint64_t hits; ///< sessions found
+    uint64_t stores; ///< sessions stored
+    uint64_t tooBig; ///< sessions not stored because of their size
+    uint64_t busy; ///< stores abandoned because all slots were locked
+    uint64_t removals; ///< sessions removed at OpenSSL request
+} TheStats[Ssl::SessionCache::sesEnd];
+
+/// whether the ssl_session_cache segment should be used
+static bool
+ShareSessions()
+{
+    return Config.SSL.sessionCacheSize > 0 && Ipc::Atomic::Enabled() &&
+           Ipc::Mem::Segment::Enabled() && Ssl::SessionCache::SlotLimit() > 0;
+}
+
+/// FNV-1a hash of the key bytes
+static uint32_t
+KeyHash(const unsigned char *key, const int keySize)
+{
+    uint32_t hash = 2166136261U;
+    for (int i = 0; i < keySize; ++i) {
+        hash ^= key[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+bool
+Ssl::SessionCache::Slot::matches(const unsigned char *aKey, const int aKeySize) const
+{
+    return keySize == aKeySize && expires > squid_curtime &&
+           memcmp(key, aKey, aKeySize) == 0;
+}
+
+bool
+Ssl::SessionCache::Enabled()
+{
+    return TheShared != NULL;
+}
+
+int
+Ssl::SessionCache::SlotLimit()
+{
+    const int64_t limit = Config.SSL.sessionCacheSize / sizeof(Slot);
+    return limit < INT_MAX ? static_cast<int>(limit) : INT_MAX;
+}
+
+int
+Ssl::SessionCache::MakeKey(unsigned char *key, const unsigned char *id, const int idSize)
+{
+    if (idSize <= 0 || idSize >= MaxKeySize)
+        return 0;
+    key[0] = 'S';
+    memcpy(key + 1, id, idSize);
+    return idSize + 1;
+}
+
+int
+Ssl::SessionCache::MakeKey(unsigned char *key, const char *host, const unsigned short port)
+{
+    const int written = snprintf(reinterpret_cast<char *>(key), MaxKeySize,
+                                 "C%s:%hu", host, port);
+    return (written > 0 && written < MaxKeySize) ? written : 0;
+}
+
+SSL_SESSION *
+Ssl::SessionCache::Get(const Kind kind, const unsigned char *key, const int keySize)
+{
+    if (TheShared == NULL || keySize <= 0)
+        return NULL;
+
+    ++TheStats[kind].lookups;
+
+    static unsigned char der[MaxSessionSize]; // slot lock must not be held for long
+    int size = 0;
+    const uint32_t hash = KeyHash(key, keySize);
+    for (int probe = 0; probe < ProbeLimit && !size; ++probe) {
+        Slot &slot = TheShared->slots[(hash + probe) % TheShared->limit];
+        if (!slot.lock.lockShared())
+            continue; // a writer is busy; we will not wait for it
+        if (slot.matches(key, keySize)) {
+            size = slot.size;
+            memcpy(der, slot.data, size);
+        }
+        slot.lock.unlockShared();
+    }
+
+    if (!size)
+        return NULL;
+
+    const unsigned char *p = der;
+    SSL_SESSION *session = d2i_SSL_SESSION(NULL, &p, size);
+    if (!session) {
+        debugs(83, 2, HERE << "cannot decode a cached session of " << size << " bytes");
+        return NULL;
+    }
+
+    ++TheStats[kind].hits;
+    return session;
+}
+
+bool
+Ssl::SessionCache::Put(const Kind kind, const unsigned char *key, const int keySize, SSL_SESSION *session)
+{
+    if (TheShared == NULL || keySize <= 0 || !session)
+        return false;
+
+    const int size = i2d_SSL_SESSION(session, NULL);
+    if (size <= 0 || size > MaxSessionSize) {
+        debugs(83, 5, HERE << "not caching a session of " << size << " bytes");
+        ++TheStats[kind].tooBig;
+        return false;
+    }
+
+    // prefer the slot with our key, then an empty or stale slot, then
+    // the slot that expires first
+    Slot *victim = NULL;
+    const uint32_t hash = KeyHash(key, keySize);
+    for (int probe = 0; probe < ProbeLimit; ++probe) {
+        Slot &slot = TheShared->slots[(hash + probe) % TheShared->limit];
+        if (!slot.lock.lockExclusive())
+            continue;
+
+        if (slot.matches(key, keySize) || !slot.keySize || slot.expires <= squid_curtime) {
+            if (victim)
+                victim->lock.unlockExclusive();
+            victim = &slot;
+            break;
+        }
+
+        if (!victim || slot.expires < victim->expires) {
+            if (victim)
+                victim->lock.unlockExclusive();
+            victim = &slot;
+        } else {
+            slot.lock.unlockExclusive();
+        }
+    }
+
+    if (!victim) {
+        debugs(83, 5, HERE << "all slots are busy");
+        ++TheStats[kind].busy;
+        return false;
+    }
+
+    unsigned char *p = victim->data;
+    i2d_SSL_SESSION(session, &p);
+    victim->size = size;
+    memcpy(victim->key, key, keySize);
+    victim->keySize = keySize;
+    victim->expires = squid_curtime + Config.SSL.sessionTtl;
+    victim->lock.unlockExclusive();
+
+    ++TheStats[kind].stores;
+    return true;
+}
+
+void
+Ssl::SessionCache::Remove(const unsigned char *key, const int keySize)
+{
+    if (TheShared == NULL || keySize <= 0)
+        return;
+
+    const uint32_t hash = KeyHash(key, keySize);
+    for (int probe = 0; probe < ProbeLimit; ++probe) {
+        Slot &slot = TheShared->slots[(hash + probe) % TheShared->limit];
+        if (!slot.lock.lockExclusive())
+            continue;
+        const bool found = slot.matches(key, keySize);
+        if (found) {
+            slot.keySize = 0;
+            ++TheStats[sesClient].removals;
+        }
+        slot.lock.unlockExclusive();
+        if (found)
+            return;
+    }
+}
+
+int
+Ssl::SessionCache::NewSessionCallback(SSL *, SSL_SESSION *session)
+{
+    unsigned int idSize = 0;
+    const unsigned char *id = SSL_SESSION_get_id(session, &idSize);
+    unsigned char key[MaxKeySize];
+    Put(sesClient, key, MakeKey(key, id, idSize), session);
+    return 0; // we did not keep a reference to the session
+}
+
+SSL_SESSION *
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+Ssl::SessionCache::GetSessionCallback(SSL *, const unsigned char *id, int idSize, int *copy)
+#else
+Ssl::SessionCache::GetSessionCallback(SSL *, unsigned char *id, int idSize, int *copy)
+#endif
+{
+    *copy = 0; // OpenSSL gets the only reference to the decoded session
+    unsigned char key[MaxKeySize];
+    return Get(sesClient, key, MakeKey(key, id, idSize));
+}
+
+void
+Ssl::SessionCache::RemoveSessionCallback(SSL_CTX *, SSL_SESSION *session)
+{
+    unsigned int idSize = 0;
+    const unsigned char *id = SSL_SESSION_get_id(session, &idSize);
+    unsigned char key[MaxKeySize];
+    Remove(key, MakeKey(key, id, idSize));
+}
+
+void
+Ssl::SessionCache::ConfigureServerContext(SSL_CTX *sslContext)
+{
+    if (Config.SSL.sessionCacheSize <= 0)
+        return; // keep the OpenSSL default: a per-context internal cache
+
+    // the shared cache replaces per-context caches that are useless for
+    // generated SslBump contexts and cannot be shared among workers
+    SSL_CTX_set_session_cache_mode(sslContext, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_set_timeout(sslContext, Config.SSL.sessionTtl);
+    SSL_CTX_sess_set_new_cb(sslContext, &NewSessionCallback);
+    SSL_CTX_sess_set_get_cb(sslContext, &GetSessionCallback);
+    SSL_CTX_sess_set_remove_cb(sslContext, &RemoveSessionCallback);
+}
+
+SSL_SESSION *
+Ssl::SessionCache::GetOriginSession(const char *host, const unsigned short port)
+{
+    unsigned char key[MaxKeySize];
+    return Get(sesOrigin, key, MakeKey(key, host, port));
+}
+
+void
+Ssl::SessionCache::PutOriginSession(const char *host, const unsigned short port, SSL_SESSION *session)
+{
+    unsigned char key[MaxKeySize];
+    if (Put(sesOrigin, key, MakeKey(key, host, port), session))
+        debugs(83, 5, HERE << "cached session with " << host << ':' << port);
+}
+
+void
+Ssl::SessionCache::Stats(StoreEntry *e)
+{
+    if (TheShared == NULL) {
+        storeAppendPrintf(e, "Shared TLS session cache is disabled.\n");
+        return;
+    }
+
+    int used = 0;
+    for (int idx = 0; idx < TheShared->limit; ++idx) {
+        const Slot &slot = TheShared->slots[idx];
+        if (slot.keySize && slot.expires > squid_curtime)
+            ++used;
+    }
+
+    storeAppendPrintf(e, "Shared TLS session cache:\n");
+    storeAppendPrintf(e, "\tSlots: %d used of %d, %d bytes each\n",
+                      used, TheShared->limit, static_cast<int>(sizeof(Slot)));
+    storeAppendPrintf(e, "\tSession lifetime: %d seconds\n",
+                      static_cast<int>(Config.SSL.sessionTtl));
+
+    static const char *names[sesEnd] = { "Client sessions", "Origin server sessions" };
+    for (int k = 0; k < sesEnd; ++k) {
+        const double ratio = TheStats[k].lookups ?
+                             100.0 * TheStats[k].hits / TheStats[k].lookups : 0.0;
+        storeAppendPrintf(e, "\n%s:\n", names[k]);
+        storeAppendPrintf(e, "\tLookups: %" PRIu64 "\n", TheStats[k].lookups);
+        storeAppendPrintf(e, "\tHits: %" PRIu64 " (%.1f%%)\n", TheStats[k].hits, ratio);
+        storeAppendPrintf(e, "\tStores: %" PRIu64 "\n", TheStats[k].stores);
+        storeAppendPrintf(e, "\tToo big to store: %" PRIu64 "\n", TheStats[k].tooBig);
+        storeAppendPrintf(e, "\tStores lost to busy slots: %" PRIu64 "\n", TheStats[k].busy);
+        if (k == sesClient)
+            storeAppendPrintf(e, "\tRemovals: %" PRIu64 "\n", TheStats[k].removals);
+    }
+}
+
+void
+Ssl::SessionCache::RegisterWithCacheManager()
+{
+    Mgr::RegisterAction("ssl_session_cache", "Shared TLS Session Cache Statistics",
+                        &Stats, 0, 1);
+}
+
+Ssl::SessionCache::Owner *
+Ssl::SessionCache::Init()
+{
+    Owner *const owner = shm_new(Shared)(SegmentLabel, SlotLimit());
+    debugs(83, 5, HERE << "created " << SegmentLabel << " with " <<
+           SlotLimit() << " slots");
+    return owner;
+}
+
+void
+Ssl::SessionCache::Open()
+{
+    Must(TheShared == NULL);
+    TheShared = shm_old(Shared)(SegmentLabel);
+}
+
+void
+Ssl::SessionCache::Close()
+{
+    TheShared = Ipc::Mem::Pointer<Shared>();
+}
+
+Ssl::SessionCache::Shared::Shared(const int aLimit): limit(aLimit), slots(aLimit)
+{
+}
+
+size_t
+Ssl::SessionCache::Shared::sharedMemorySize() const
+{
+    return SharedMemorySize(limit);
+}
+
+size_t
+Ssl::SessionCache::Shared::SharedMemorySize(const int limit)
+{
+    return sizeof(Shared) + limit * sizeof(Slot);
+}
+
+/// initializes shared memory segment used by Ssl::SessionCache
+class SslSessionCacheRr: public Ipc::Mem::RegisteredRunner
+{
+public:
+    /* RegisteredRunner API */
+    SslSessionCacheRr(): owner(NULL) {}
+    virtual ~SslSessionCacheRr();
+
+protected:
+    virtual void create(const RunnerRegistry &);
+    virtual void open(const RunnerRegistry &);
+
+private:
+    Ssl::SessionCache::Owner *owner;
+};
+
+RunnerRegistrationEntry(rrAfterConfig, SslSessionCacheRr);
+
+void
+SslSessionCacheRr::create(const RunnerRegistry &)
+{
+    if (!ShareSessions())
+        return;
+
+    Must(!owner);
+    owner = Ssl::SessionCache::Init();
+}
+
+void
+SslSessionCacheRr::open(const RunnerRegistry &)
+{
+    Ssl::SessionCache::RegisterWithCacheManager();
+    if (ShareSessions())
+        Ssl::SessionCache::Open();
+}
+
+SslSessionCacheRr::~SslSessionCacheRr()
+{
+    Ssl::SessionCache::Close();
+    delete owner;
+}
@@ -0,0 +1,130 @@
+/*
+ * DEBUG: section 83    SSL accelerator support
+ *
+ */
+
+#ifndef SQUID_SSL_SESSION_CACHE_H
+#define SQUID_SSL_SESSION_CACHE_H
+
+#include "ipc/mem/FlexibleArray.h"
+#include "ipc/mem/Pointer.h"
+#include "ipc/ReadWriteLock.h"
+
+#if HAVE_OPENSSL_SSL_H
+#include <openssl/ssl.h>
+#endif
+
+class StoreEntry;
+
+namespace Ssl
+{
+
+/**
+ \ingroup ServerProtocolSSLAPI
+ * TLS sessions shared by all kids, so that a client or an origin server
+ * can resume a session negotiated by any worker instead of going through
+ * a full handshake every time.
+ *
+ * Sessions are stored in their DER form in fixed-size shared memory slots.
+ * A key hash selects a few neighbouring slots; the entry is stored in the
+ * first free, expired, or oldest of them. Slots are guarded by non-blocking
+ * locks: a busy slot is simply treated as a miss.
+ *
+ * Squid-as-server sessions (https_port and SslBump) are keyed by session
+ * ID and are managed by OpenSSL through the callbacks installed by
+ * ConfigureServerContext(). Squid-as-client sessions are keyed by the
+ * origin server host:port and are managed by FwdState.
+ */
+class SessionCache
+{
+public:
+    /// whom the session was negotiated with
+    typedef enum { sesClient, sesOrigin, sesEnd } Kind;
+
+    /// maximum key size: a type byte followed by a session ID or host:port
+    static const int MaxKeySize = 1 + 255 + 1 + 5;
+
+    /// maximum size of a DER-encoded session; larger sessions are not cached
+    static const int MaxSessionSize = 2048;
+
+    /// one cached session
+    class Slot
+    {
+    public:
+        Slot(): keySize(0), size(0), expires(0) {}
+
+        /// whether the slot holds a fresh copy of the given key
+        bool matches(const unsigned char *aKey, const int aKeySize) const;
+
+        Ipc::ReadWriteLock lock; ///< protects the fields below
+        unsigned char key[MaxKeySize]; ///< lookup key
+        uint16_t keySize; ///< key length or zero for an empty slot
+        uint16_t size; ///< DER-encoded session length
+        time_t expires; ///< when the session becomes stale
+        unsigned char data[MaxSessionSize]; ///< DER-encoded session
+    };
+
+    /// data shared across all kids
+    class Shared
+    {
+    public:
+        explicit Shared(const int aLimit);
+        size_t sharedMemorySize() const;
+        static size_t SharedMemorySize(const int limit);
+
+        const int limit; ///< number of slots
+        Ipc::Mem::FlexibleArray<Slot> slots; ///< slots storage
+    };
+
+    typedef Ipc::Mem::Owner<Shared> Owner;
+
+    /// initialize shared memory
+    static Owner *Init();
+
+    /// attach to the shared memory
+    static void Open();
+
+    /// detach from the shared memory
+    static void Close();
+
+    /// whether the cache has been configured and is usable
+    static bool Enabled();
+
+    /// the number of slots the configured cache size allows for
+    static int SlotLimit();
+
+    /// makes OpenSSL store and look up server-side sessions of the given
+    /// context in the shared cache
+    static void ConfigureServerContext(SSL_CTX *sslContext);
+
+    /// returns a cached session for the given origin server or nil;
+    /// the caller must SSL_SESSION_free() the result
+    static SSL_SESSION *GetOriginSession(const char *host, const unsigned short port);
+
+    /// caches the session negotiated with the given origin server
+    static void PutOriginSession(const char *host, const unsigned short port, SSL_SESSION *session);
+
+    static void RegisterWithCacheManager();
+
+private:
+    static int MakeKey(unsigned char *key, const unsigned char *id, const int idSize);
+    static int MakeKey(unsigned char *key, const char *host, const unsigned short port);
+
+    static SSL_SESSION *Get(const Kind kind, const unsigned char *key, const int keySize);
+    static bool Put(const Kind kind, const unsigned char *key, const int keySize, SSL_SESSION *session);
+    static void Remove(const unsigned char *key, const int keySize);
+
+    static int NewSessionCallback(SSL *ssl, SSL_SESSION *session);
+#if OPENSSL_VERSION_NUMBER >= 0x10100000L
+    static SSL_SESSION *GetSessionCallback(SSL *ssl, const unsigned char *id, int idSize, int *copy);
+#else
+    static SSL_SESSION *GetSessionCallback(SSL *ssl, unsigned char *id, int idSize, int *copy);
+#endif
+    static void RemoveSessionCallback(SSL_CTX *sslContext, SSL_SESSION *session);
+
+    static void Stats(StoreEntry *e);
+};
+
+} // namespace Ssl
+
+#endif /* SQUID_SSL_SESSION_CACHE_H */
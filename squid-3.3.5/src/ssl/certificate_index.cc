@@ -0,0 +1,426 @@
+#include "squid.h"
+#include "ssl/certificate_index.h"
+#if HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#if HAVE_STDEXCEPT
+#include <stdexcept>
+#endif
+#if HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if HAVE_OPENSSL_EVP_H
+#include <openssl/evp.h>
+#endif
+
+/// identifies index files
+static const char IndexMagic[8] = "SQCRTIX";
+/// the index format version
+static const uint32_t IndexVersion = 1;
+/// the number of slots in an index created without a size limit
+static const uint32_t DefaultSlotCount = 65536;
+/// the smallest index we create
+static const uint32_t MinSlotCount = 1024;
+/// the largest index we create
+static const uint32_t MaxSlotCount = 1 << 26;
+
+const std::string Ssl::CertificateIndex::db_file("index.db");
+const std::string Ssl::CertificateIndex::cert_dir("certs");
+
+bool Ssl::CertificateIndex::Slot::expired() const
+{
+    ASN1_TIME tm;
+    tm.length = expiresSize;
+    tm.type = expiresType;
+    tm.data = reinterpret_cast<unsigned char *>(const_cast<char *>(expires));
+    tm.flags = 0;
+    return X509_cmp_current_time(&tm) <= 0;
+}
+
+Ssl::CertificateIndex::CertificateIndex(std::string const & aDb_path, size_t aMax_db_size, size_t aFs_block_size)
+        :  db_path(aDb_path),
+        db_full(aDb_path + "/" + db_file),
+        cert_full(aDb_path + "/" + cert_dir),
+        max_db_size(aMax_db_size),
+        fs_block_size(aFs_block_size),
+        dbLock(db_full),
+        enabled_disk_store(true),
+        header(NULL),
+        slots(NULL),
+        mappedSize(0)
+{
+    if (db_path.empty() && !max_db_size)
+        enabled_disk_store = false;
+    else if ((db_path.empty() && max_db_size) || (!db_path.empty() && !max_db_size))
+        throw std::runtime_error("ssl_crtd is missing the required parameter. There should be -s and -M parameters together.");
+
+    if (enabled_disk_store)
+        open();
+}
+
+Ssl::CertificateIndex::~CertificateIndex()
+{
+    close();
+}
+
+void Ssl::CertificateIndex::open()
+{
+    const int fd = ::open(db_full.c_str(), O_RDWR);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open " + db_full);
+
+    struct stat sb;
+    if (fstat(fd, &sb) != 0 || sb.st_size < static_cast<off_t>(sizeof(Header))) {
+        ::close(fd);
+        throw std::runtime_error("Cannot use truncated " + db_full);
+    }
+
+    void *mem = mmap(NULL, sb.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping stays valid
+    if (mem == MAP_FAILED)
+        throw std::runtime_error("Cannot map " + db_full);
+
+    header = static_cast<Header *>(mem);
+    mappedSize = sb.st_size;
+    if (memcmp(header->magic, IndexMagic, sizeof(IndexMagic)) != 0 ||
+            header->version != IndexVersion ||
+            !header->slotCount ||
+            mappedSize != sizeof(Header) + header->slotCount * sizeof(Slot)) {
+        close();
+        throw std::runtime_error("Cannot use corrupted " + db_full);
+    }
+    slots = reinterpret_cast<Slot *>(header + 1);
+}
+
+void Ssl::CertificateIndex::close()
+{
+    if (header)
+        munmap(header, mappedSize);
+    header = NULL;
+    slots = NULL;
+    mappedSize = 0;
+}
+
+void Ssl::CertificateIndex::MakeKey(std::string const & name, unsigned char *key)
+{
+    unsigned int keySize = 0;
+    if (!EVP_Digest(name.data(), name.size(), key, &keySize, EVP_sha1(), NULL) || keySize != Slot::KeySize)
+        throw std::runtime_error("Cannot compute the digest of " + name);
+}
+
+uint32_t Ssl::CertificateIndex::home(const unsigned char *key) const
+{
+    uint32_t hash;
+    memcpy(&hash, key, sizeof(hash));
+    return hash % header->slotCount;
+}
+
+int Ssl::CertificateIndex::lookup(const unsigned char *key) const
+{
+    const uint32_t slotCount = header->slotCount;
+    uint32_t idx = home(key);
+    for (uint32_t probes = 0; probes < slotCount; ++probes) {
+        const Slot &slot = slots[idx];
+        if (!slot.used)
+            return -1;
+        if (memcmp(slot.key, key, Slot::KeySize) == 0)
+            return idx;
+        idx = (idx + 1) % slotCount;
+    }
+    return -1;
+}
+
+std::string Ssl::CertificateIndex::fileName(const unsigned char *key) const
+{
+    static const char hex[] = "0123456789ABCDEF";
+    std::string name(cert_full);
+    name += '/';
+    for (size_t i = 0; i < Slot::KeySize; ++i) {
+        name += hex[key[i] >> 4];
+        name += hex[key[i] & 0xF];
+    }
+    name += ".pem";
+    return name;
+}
+
+size_t Ssl::CertificateIndex::getFileSize(std::string const & filename) const
+{
+    struct stat sb;
+    if (stat(filename.c_str(), &sb) != 0)
+        return 0;
+    const size_t file_size = sb.st_size;
+    if (!fs_block_size)
+        return file_size;
+    return ((file_size + fs_block_size - 1) / fs_block_size) * fs_block_size;
+}
+
+bool Ssl::CertificateIndex::load(int slotIdx, Ssl::X509_Pointer & cert, Ssl::EVP_PKEY_Pointer & pkey)
+{
+    Slot &slot = slots[slotIdx];
+    if (!slot.expired()) {
+        readCertAndPrivateKeyFromFiles(cert, pkey, fileName(slot.key).c_str(), NULL);
+        if (cert.get() && pkey.get()) {
+            slot.referenced = 1;
+            return true;
+        }
+    }
+
+    // expired entry or corrupted certs file
+    cert.reset(NULL);
+    pkey.reset(NULL);
+    remove(slotIdx);
+    return false;
+}
+
+void Ssl::CertificateIndex::remove(int slotIdx)
+{
+    Slot &victim = slots[slotIdx];
+    unlink(fileName(victim.key).c_str());
+    header->dbSize -= min(header->dbSize, victim.diskSize);
+    --header->entries;
+    victim.used = 0;
+
+    // backward shift deletion: move up entries that can no longer be
+    // reached from their home slot because of the new hole
+    const uint32_t slotCount = header->slotCount;
+    uint32_t hole = slotIdx;
+    uint32_t idx = slotIdx;
+    for (;;) {
+        idx = (idx + 1) % slotCount;
+        if (!slots[idx].used)
+            break;
+        const uint32_t want = home(slots[idx].key);
+        const bool reachable = hole <= idx ?
+                               (hole < want && want <= idx) :
+                               (hole < want || want <= idx);
+        if (reachable)
+            continue;
+        slots[hole] = slots[idx];
+        slots[idx].used = 0;
+        hole = idx;
+    }
+}
+
+bool Ssl::CertificateIndex::evictOne()
+{
+    // two full turns: the first one may only clear reference bits
+    const uint32_t slotCount = header->slotCount;
+    for (uint32_t steps = 0; steps < 2 * slotCount; ++steps) {
+        const uint32_t idx = header->hand % slotCount;
+        header->hand = (idx + 1) % slotCount;
+        Slot &slot = slots[idx];
+        if (!slot.used)
+            continue;
+        if (slot.referenced && !slot.expired()) {
+            slot.referenced = 0;
+            continue;
+        }
+        remove(idx);
+        return true;
+    }
+    return false;
+}
+
+bool Ssl::CertificateIndex::full(size_t newSize) const
+{
+    // keep the table at most 3/4 full to keep probe sequences short
+    return header->dbSize + newSize > max_db_size ||
+           (static_cast<uint64_t>(header->entries) + 1) * 4 > static_cast<uint64_t>(header->slotCount) * 3;
+}
+
+bool Ssl::CertificateIndex::find(std::string const & key, Ssl::X509_Pointer & cert, Ssl::EVP_PKEY_Pointer & pkey)
+{
+    if (!enabled_disk_store)
+        return false;
+
+    unsigned char digest[Slot::KeySize];
+    MakeKey(key, digest);
+
+    const Locker locker(dbLock, Here);
+    const int idx = lookup(digest);
+    if (idx < 0)
+        return false;
+    return load(idx, cert, pkey);
+}
+
+bool Ssl::CertificateIndex::purgeCert(std::string const & key)
+{
+    if (!enabled_disk_store)
+        return false;
+
+    unsigned char digest[Slot::KeySize];
+    MakeKey(key, digest);
+
+    const Locker locker(dbLock, Here);
+    const int idx = lookup(digest);
+    if (idx < 0)
+        return false;
+    remove(idx);
+    return true;
+}
+
+bool Ssl::CertificateIndex::addCertAndPrivateKey(Ssl::X509_Pointer & cert, Ssl::EVP_PKEY_Pointer & pkey, std::string const & useName)
+{
+    if (!enabled_disk_store || !cert || !pkey)
+        return false;
+
+    std::string name(useName);
+    if (name.empty()) {
+        TidyPointer<char, tidyFree> subject(X509_NAME_oneline(X509_get_subject_name(cert.get()), NULL, 0));
+        name = subject.get();
+    }
+    unsigned char digest[Slot::KeySize];
+    MakeKey(name, digest);
+
+    ASN1_TIME *notAfter = X509_get_notAfter(cert.get());
+    if (!notAfter || notAfter->length <= 0 || static_cast<size_t>(notAfter->length) > sizeof(Slot().expires))
+        return false;
+
+    const Locker locker(dbLock, Here);
+
+    const int existing = lookup(digest);
+    if (existing >= 0) {
+        Ssl::X509_Pointer findCert;
+        Ssl::EVP_PKEY_Pointer findPkey;
+        if (load(existing, findCert, findPkey)) {
+            // Replace with database certificate
+            cert.reset(findCert.release());
+            pkey.reset(findPkey.release());
+            return true;
+        }
+        // load() removed the expired or corrupted entry
+    }
+
+    const std::string filename(fileName(digest));
+    if (!writeCertAndPrivateKeyToFile(cert, pkey, filename.c_str()))
+        return false;
+    const size_t diskSize = getFileSize(filename);
+
+    while (full(diskSize)) {
+        if (!evictOne()) {
+            // the certificate alone does not fit
+            unlink(filename.c_str());
+            return false;
+        }
+    }
+
+    const uint32_t slotCount = header->slotCount;
+    uint32_t idx = home(digest);
+    while (slots[idx].used)
+        idx = (idx + 1) % slotCount;
+
+    Slot &slot = slots[idx];
+    memcpy(slot.key, digest, sizeof(slot.key));
+    slot.referenced = 1;
+    slot.expiresType = notAfter->type;
+    slot.expiresSize = notAfter->length;
+    memcpy(slot.expires, notAfter->data, notAfter->length);
+    slot.diskSize = diskSize;
+    slot.used = 1;
+    header->dbSize += diskSize;
+    ++header->entries;
+    return true;
+}
+
+bool Ssl::CertificateIndex::IsEnabledDiskStore() const
+{
+    return enabled_disk_store;
+}
+
+void Ssl::CertificateIndex::create(std::string const & db_path, size_t max_db_size, size_t fs_block_size)
+{
+    if (db_path == "")
+        throw std::runtime_error("Path to db is empty");
+    std::string db_full(db_path + "/" + db_file);
+    std::string cert_full(db_path + "/" + cert_dir);
+
+    if (mkdir(db_path.c_str(), 0777))
+        throw std::runtime_error("Cannot create " + db_path);
+
+    if (mkdir(cert_full.c_str(), 0777))
+        throw std::runtime_error("Cannot create " + cert_full);
+
+    WriteIndex(db_full, O_EXCL, max_db_size, fs_block_size);
+}
+
+void Ssl::CertificateIndex::Prepare(std::string const & db_path, size_t max_db_size, size_t fs_block_size)
+{
+    if (db_path == "")
+        throw std::runtime_error("Path to db is empty");
+    std::string db_full(db_path + "/" + db_file);
+    std::string cert_full(db_path + "/" + cert_dir);
+
+    // other SMP kids may be preparing the same database right now
+    if (mkdir(db_path.c_str(), 0777) && errno != EEXIST)
+        throw std::runtime_error("Cannot create " + db_path);
+
+    if (mkdir(cert_full.c_str(), 0777) && errno != EEXIST)
+        throw std::runtime_error("Cannot create " + cert_full);
+
+    if (Exists(db_path))
+        return;
+
+    // do not mix formats in a directory created by older ssl_crtd versions
+    struct stat sb;
+    if (stat((db_path + "/index.txt").c_str(), &sb) == 0)
+        throw std::runtime_error("Cannot index the TXT_DB database in " + db_path);
+
+    // Build the index under a private name and link it into place, so that
+    // nobody opens a partially written index. Unlike rename(), link() does
+    // not replace an index that another kid has already put there.
+    char pid[32];
+    snprintf(pid, sizeof(pid), ".%d", static_cast<int>(getpid()));
+    const std::string tmp_full(db_full + pid);
+    WriteIndex(tmp_full, O_TRUNC, max_db_size, fs_block_size);
+    const bool linked = link(tmp_full.c_str(), db_full.c_str()) == 0 || errno == EEXIST;
+    unlink(tmp_full.c_str());
+    if (!linked)
+        throw std::runtime_error("Cannot create " + db_full);
+}
+
+void Ssl::CertificateIndex::WriteIndex(std::string const & fileName, int openFlags, size_t max_db_size, size_t fs_block_size)
+{
+    // a generated certificate with its key takes at least two blocks
+    uint64_t slotCount = DefaultSlotCount;
+    if (max_db_size)
+        slotCount = max_db_size / max(fs_block_size, static_cast<size_t>(512));
+    slotCount = max(static_cast<uint64_t>(MinSlotCount), min(slotCount, static_cast<uint64_t>(MaxSlotCount)));
+
+    const int fd = ::open(fileName.c_str(), O_WRONLY | O_CREAT | openFlags, 0666);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open " + fileName + " to open");
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, IndexMagic, sizeof(header.magic));
+    header.version = IndexVersion;
+    header.slotCount = slotCount;
+
+    // the table of empty slots is created by extending the file with zeros
+    const off_t fileSize = sizeof(Header) + slotCount * sizeof(Slot);
+    const bool written = write(fd, &header, sizeof(header)) == static_cast<ssize_t>(sizeof(header)) &&
+                         ftruncate(fd, fileSize) == 0;
+    ::close(fd);
+    if (!written)
+        throw std::runtime_error("Cannot write " + fileName);
+}
+
+void Ssl::CertificateIndex::check(std::string const & db_path, size_t max_db_size)
+{
+    CertificateIndex db(db_path, max_db_size, 0);
+}
+
+bool Ssl::CertificateIndex::Exists(std::string const & db_path)
+{
+    struct stat sb;
+    return !db_path.empty() && stat((db_path + "/" + db_file).c_str(), &sb) == 0;
+}
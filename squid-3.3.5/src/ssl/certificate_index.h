@@ -0,0 +1,130 @@
+#ifndef SQUID_SSL_CERTIFICATE_INDEX_H
+#define SQUID_SSL_CERTIFICATE_INDEX_H
+
+#include "ssl/certificate_db.h"
+
+#if HAVE_STRING
+#include <string>
+#endif
+
+namespace Ssl
+{
+
+/**
+ * Indexed database for storing generated SSL certificates and their keys.
+ *
+ * Unlike CertificateDb, which loads and rewrites its whole TXT_DB index on
+ * every operation, this database keeps its index in a fixed-size open
+ * addressing hash table that is mmapped by every process using it. Lookups,
+ * insertions, and removals touch a few index slots and at most one
+ * certificate file while holding the database lock. Space is reclaimed
+ * incrementally using the CLOCK algorithm: expired entries and entries not
+ * used since the last pass of the clock hand are evicted first.
+ *
+ * A database consists of:
+ *     - An index file with a header and a table of entry slots
+ *     - A directory under which the certificates and their keys are stored,
+ *       in files named after the entry key digest.
+ *
+ * The database must be initialized with CertificateIndex::create before use.
+ * Errors are reported by throwing std::runtime_error.
+ */
+class CertificateIndex
+{
+public:
+    CertificateIndex(std::string const &db_path, size_t aMax_db_size, size_t aFs_block_size);
+    ~CertificateIndex();
+
+    /// Find certificate and private key stored under the given key
+    bool find(std::string const &key, Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey);
+    /// Delete a certificate from database
+    bool purgeCert(std::string const &key);
+    /// Save certificate to disk, evicting other entries if needed.
+    /// If a valid certificate is already stored under useName, returns it.
+    bool addCertAndPrivateKey(Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey, std::string const &useName);
+    bool IsEnabledDiskStore() const; ///< Check enabled of disk store.
+
+    /// Create and initialize a database under the db_path, sizing the
+    /// index for max_db_size bytes of certificates (0 uses the default)
+    static void create(std::string const &db_path, size_t max_db_size, size_t fs_block_size);
+    /// Create the database under the db_path unless it already exists.
+    /// Several processes may race to prepare the same database.
+    static void Prepare(std::string const &db_path, size_t max_db_size, size_t fs_block_size);
+    /// Check the database stored under the db_path.
+    static void check(std::string const &db_path, size_t max_db_size);
+    /// Whether db_path contains an indexed (rather than TXT_DB) database.
+    static bool Exists(std::string const &db_path);
+
+    /// index file header
+    class Header
+    {
+    public:
+        char magic[8]; ///< identifies index files
+        uint32_t version; ///< index format version
+        uint32_t slotCount; ///< number of slots in the table
+        uint32_t entries; ///< number of used slots
+        uint32_t hand; ///< CLOCK eviction position
+        uint64_t dbSize; ///< total disk size of stored certificates
+    };
+
+    /// one index entry
+    class Slot
+    {
+    public:
+        static const size_t KeySize = 20; ///< SHA1 digest length
+
+        /// whether the certificate has expired
+        bool expired() const;
+
+        unsigned char key[KeySize]; ///< digest of the entry name
+        uint8_t used; ///< whether the slot holds an entry
+        uint8_t referenced; ///< whether the entry was used since last CLOCK visit
+        uint8_t expiresType; ///< notAfter ASN.1 time type
+        uint8_t expiresSize; ///< notAfter length
+        char expires[24]; ///< notAfter in ASN.1 UTCTime or GeneralizedTime form
+        uint64_t diskSize; ///< certificate file size on disk
+    };
+
+private:
+    void open(); ///< Map the index file.
+    void close(); ///< Unmap the index file.
+
+    /// Write an empty index file sized for max_db_size bytes of certificates.
+    static void WriteIndex(std::string const &fileName, int openFlags, size_t max_db_size, size_t fs_block_size);
+    /// Compute the slot key for the given entry name.
+    static void MakeKey(std::string const &name, unsigned char *key);
+    /// Index of the slot holding the given key or -1.
+    int lookup(const unsigned char *key) const;
+    /// The preferred slot of the given key.
+    uint32_t home(const unsigned char *key) const;
+    /// Certificate file name for the given key.
+    std::string fileName(const unsigned char *key) const;
+    /// Load certificate and key of the given slot; removes a broken entry.
+    bool load(int slotIdx, Ssl::X509_Pointer &cert, Ssl::EVP_PKEY_Pointer &pkey);
+    /// Delete the entry in the given slot and its certificate file.
+    void remove(int slotIdx);
+    /// Delete an expired or least recently used entry.
+    bool evictOne();
+    /// Whether adding an entry of the given size would overflow the db.
+    bool full(size_t newSize) const;
+    size_t getFileSize(std::string const &filename) const; ///< get file size on disk.
+
+    static const std::string db_file; ///< Base name of the database index file.
+    static const std::string cert_dir; ///< Base name of the directory to store the certs.
+
+    const std::string db_path; ///< The database directory.
+    const std::string db_full; ///< Full path of the database index file.
+    const std::string cert_full; ///< Full path of the directory to store the certs.
+    const size_t max_db_size; ///< Max size of db.
+    const size_t fs_block_size; ///< File system block size.
+    mutable Lock dbLock; ///< protects the database files
+    bool enabled_disk_store; ///< The storage on the disk is enabled.
+
+    Header *header; ///< mapped index file or nil
+    Slot *slots; ///< mapped index table or nil
+    size_t mappedSize; ///< size of the mapped index file
+};
+
+} // namespace Ssl
+
+#endif // SQUID_SSL_CERTIFICATE_INDEX_H
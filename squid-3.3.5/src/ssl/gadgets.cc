@@ -215,10 +215,9 @@ Ssl::CertificateProperties::CertificateProperties():
         signAlgorithm(Ssl::algSignEnd)
 {}
 
-std::string & Ssl::CertificateProperties::dbKey() const
+std::string Ssl::CertificateProperties::dbKey() const
 {
-    static std::string certKey;
-    certKey.clear();
+    std::string certKey;
     certKey.reserve(4096);
     if (mimicCert.get()) {
         char buf[1024];
@@ -358,6 +357,8 @@ static bool generateFakeSslCertificate(Ssl::X509_Pointer & certToStore, Ssl::EVP
     // Use signing certificates private key as generated certificate private key
     if (properties.signWithPkey.get())
         pkey.resetAndLock(properties.signWithPkey.get());
+    else if (properties.freshPkey.get())
+        pkey.resetAndLock(properties.freshPkey.get());
     else // if not exist generate one
         pkey.reset(Ssl::createSslPrivateKey());
 
@@ -582,6 +583,23 @@ static int asn1time_cmp(ASN1_TIME *asnTime1, ASN1_TIME *asnTime2)
     return strcmp(strTime1, strTime2);
 }
 
+/// stores the subject entry in the caller-supplied buffer
+static const char *getSubjectEntry(X509 *x509, int nid, char *name, size_t nameSize)
+{
+    if (!x509)
+        return NULL;
+
+    // TODO: What if the entry is a UTF8String? See X509_NAME_get_index_by_NID(3ssl).
+    const int nameLen = X509_NAME_get_text_by_NID(
+                            X509_get_subject_name(x509),
+                            nid,  name, nameSize);
+
+    if (nameLen > 0)
+        return name;
+
+    return NULL;
+}
+
 bool Ssl::certificateMatchesProperties(X509 *cert, CertificateProperties const &properties)
 {
     assert(cert);
@@ -603,8 +621,14 @@ bool Ssl::certificateMatchesProperties(X509 *cert, CertificateProperties const &
         X509_NAME *cert2_name = X509_get_subject_name(cert2);
         if (X509_NAME_cmp(cert1_name, cert2_name) != 0)
             return false;
-    } else if (properties.commonName != CommonHostName(cert))
-        return false;
+    } else {
+        // not CommonHostName(): certificate signer threads call us, and
+        // its static buffer is used by the main loop
+        char name[1024];
+        const char *commonName = getSubjectEntry(cert, NID_commonName, name, sizeof(name));
+        if (!commonName || properties.commonName != commonName)
+            return false;
+    }
 
     if (!properties.setValidBefore) {
         ASN1_TIME *aTime = X509_get_notBefore(cert);
@@ -655,31 +679,15 @@ bool Ssl::certificateMatchesProperties(X509 *cert, CertificateProperties const &
     return match;
 }
 
-static const char *getSubjectEntry(X509 *x509, int nid)
-{
-    static char name[1024] = ""; // stores common name (CN)
-
-    if (!x509)
-        return NULL;
-
-    // TODO: What if the entry is a UTF8String? See X509_NAME_get_index_by_NID(3ssl).
-    const int nameLen = X509_NAME_get_text_by_NID(
-                            X509_get_subject_name(x509),
-                            nid,  name, sizeof(name));
-
-    if (nameLen > 0)
-        return name;
-
-    return NULL;
-}
-
 const char *Ssl::CommonHostName(X509 *x509)
 {
-    return getSubjectEntry(x509, NID_commonName);
+    static char name[1024] = ""; // stores common name (CN)
+    return getSubjectEntry(x509, NID_commonName, name, sizeof(name));
 }
 
 const char *Ssl::getOrganization(X509 *x509)
 {
-    return getSubjectEntry(x509, NID_organizationName);
+    static char name[1024] = ""; // stores organization name (O)
+    return getSubjectEntry(x509, NID_organizationName, name, sizeof(name));
 }
 
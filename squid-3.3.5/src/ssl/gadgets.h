@@ -227,6 +227,7 @@ public:
     X509_Pointer mimicCert; ///< Certificate to mimic
     X509_Pointer signWithX509; ///< Certificate to sign the generated request
     EVP_PKEY_Pointer signWithPkey; ///< The key of the signing certificate
+    EVP_PKEY_Pointer freshPkey; ///< A pre-generated key to use when signWithPkey is not set
     bool setValidAfter; ///< Do not mimic "Not Valid After" field
     bool setValidBefore; ///< Do not mimic "Not Valid Before" field
     bool setCommonName; ///< Replace the CN field of the mimicing subject with the given
@@ -234,7 +235,8 @@ public:
     CertSignAlgorithm signAlgorithm; ///< The signing algorithm to use
     /// Returns certificate database primary key. New fake certificates
     /// purge old fake certificates with the same key.
-    std::string & dbKey() const;
+    /// Safe to call from certificate signer threads.
+    std::string dbKey() const;
 private:
     CertificateProperties(CertificateProperties &);
     CertificateProperties &operator =(CertificateProperties const &);
@@ -274,6 +276,7 @@ bool sslDateIsInTheFuture(char const * date);
  \ingroup SslCrtdSslAPI
  * Check if the major fields of a certificates matches the properties given by
  * a CertficateProperties object
+ * Safe to call from certificate signer threads.
  \return true if the certificates matches false otherwise.
 */
 bool certificateMatchesProperties(X509 *peer_cert, CertificateProperties const &properties);
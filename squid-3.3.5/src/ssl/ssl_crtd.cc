@@ -3,6 +3,7 @@
 #include "ssl/gadgets.h"
 #include "ssl/crtd_message.h"
 #include "ssl/certificate_db.h"
+#include "ssl/certificate_index.h"
 
 #if HAVE_CSTRING
 #include <cstring>
@@ -13,6 +14,9 @@
 #if HAVE_IOSTREAM
 #include <iostream>
 #endif
+#if HAVE_MEMORY
+#include <memory>
+#endif
 #if HAVE_STDEXCEPT
 #include <stdexcept>
 #endif
@@ -186,27 +190,27 @@ static void usage()
         "-----END RSA PRIVATE KEY-----\n"
         "\tCreate new private key and certificate request for \"host.dom\"\n"
         "\tSign new request by received certificate and private key.\n"
-        "usage: ssl_crtd -c -s ssl_store_path\n"
-        "\t-c                   Init ssl db directories and exit.\n";
+        "usage: ssl_crtd -c -s ssl_store_path [-M storage_max_size]\n"
+        "\t-c                   Init ssl db directories and exit.\n"
+        "\t                     The optional -M and -b values size the db index.\n";
     std::cerr << help_string << std::endl;
 }
 
 /**
  \ingroup ssl_crtd
- * Proccess new request message.
+ * Proccess new request message using the given certificate database.
  */
-static bool proccessNewRequest(Ssl::CrtdMessage & request_message, std::string const & db_path, size_t max_db_size, size_t fs_block_size)
+template <class Db>
+static bool proccessNewRequest(Ssl::CrtdMessage & request_message, Db & db)
 {
     Ssl::CertificateProperties certProperties;
     std::string error;
     if (!request_message.parseRequest(certProperties, error))
         throw std::runtime_error("Error while parsing the crtd request: " + error);
 
-    Ssl::CertificateDb db(db_path, max_db_size, fs_block_size);
-
     Ssl::X509_Pointer cert;
     Ssl::EVP_PKEY_Pointer pkey;
-    std::string &cert_subject = certProperties.dbKey();
+    const std::string cert_subject = certProperties.dbKey();
 
     db.find(cert_subject, cert, pkey);
 
@@ -290,13 +294,19 @@ int main(int argc, char *argv[])
 
         if (create_new_db) {
             std::cout << "Initialization SSL db..." << std::endl;
-            Ssl::CertificateDb::create(db_path);
+            Ssl::CertificateIndex::create(db_path, max_db_size, fs_block_size);
             std::cout << "Done" << std::endl;
             exit(0);
         }
 
-        {
+        // databases created by older ssl_crtd versions keep their TXT_DB format
+        std::auto_ptr<Ssl::CertificateIndex> index;
+        std::auto_ptr<Ssl::CertificateDb> legacyDb;
+        if (Ssl::CertificateIndex::Exists(db_path)) {
+            index.reset(new Ssl::CertificateIndex(db_path, max_db_size, fs_block_size));
+        } else {
             Ssl::CertificateDb::check(db_path, max_db_size);
+            legacyDb.reset(new Ssl::CertificateDb(db_path, max_db_size, fs_block_size));
         }
         // proccess request.
         for (;;) {
@@ -314,7 +324,10 @@ int main(int argc, char *argv[])
             if (parse_result == Ssl::CrtdMessage::ERROR) {
                 throw std::runtime_error("Cannot parse request message.");
             } else if (request_message.getCode() == Ssl::CrtdMessage::code_new_certificate) {
-                proccessNewRequest(request_message, db_path, max_db_size, fs_block_size);
+                if (index.get())
+                    proccessNewRequest(request_message, *index);
+                else
+                    proccessNewRequest(request_message, *legacyDb);
             } else {
                 throw std::runtime_error("Unknown request code: \"" + request_message.getCode() + "\".");
             }
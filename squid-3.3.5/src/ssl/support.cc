@@ -44,6 +44,7 @@
 #include "globals.h"
 #include "SquidConfig.h"
 #include "ssl/ErrorDetail.h"
+#include "ssl/SessionCache.h"
 #include "ssl/support.h"
 #include "ssl/gadgets.h"
 #include "URL.h"
@@ -777,6 +778,8 @@ configureSslContext(SSL_CTX *sslContext, AnyP::PortCfg &port)
 
     if (port.sslContextFlags & SSL_FLAG_NO_SESSION_REUSE) {
         SSL_CTX_set_session_cache_mode(sslContext, SSL_SESS_CACHE_OFF);
+    } else {
+        Ssl::SessionCache::ConfigureServerContext(sslContext);
     }
 
     if (Config.SSL.unclean_shutdown) {
@@ -1392,6 +1395,15 @@ Ssl::generateSslContextUsingPkeyAndCertFromMemory(const char * data, AnyP::PortC
     return createSSLContext(cert, pkey, port);
 }
 
+SSL_CTX *
+Ssl::generateSslContextUsingPkeyAndCert(Ssl::X509_Pointer & cert, Ssl::EVP_PKEY_Pointer & pkey, AnyP::PortCfg &port)
+{
+    if (!cert || !pkey)
+        return NULL;
+
+    return createSSLContext(cert, pkey, port);
+}
+
 SSL_CTX *
 Ssl::generateSslContext(CertificateProperties const &properties, AnyP::PortCfg &port)
 {
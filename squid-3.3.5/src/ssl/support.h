@@ -190,6 +190,12 @@ bool verifySslCertificate(SSL_CTX * sslContext,  CertificateProperties const &pr
  */
 SSL_CTX * generateSslContextUsingPkeyAndCertFromMemory(const char * data, AnyP::PortCfg &port);
 
+/**
+  \ingroup ServerProtocolSSLAPI
+  * Generate SSL context using the given certificate and private key.
+ */
+SSL_CTX * generateSslContextUsingPkeyAndCert(X509_Pointer & cert, EVP_PKEY_Pointer & pkey, AnyP::PortCfg &port);
+
 /**
   \ingroup ServerProtocolSSLAPI
   * Adds the certificates in certList to the certificate chain of the SSL context
@@ -43,6 +43,7 @@
 #include "globals.h"
 #include "HttpRequest.h"
 #include "IoStats.h"
+#include "KidLatencies.h"
 #include "MemObject.h"
 #include "mem_node.h"
 #include "MemBuf.h"
@@ -51,6 +52,7 @@
 #include "mgr/InfoAction.h"
 #include "mgr/IntervalAction.h"
 #include "mgr/IoAction.h"
+#include "mgr/PhaseTimesAction.h"
 #include "mgr/Registration.h"
 #include "mgr/ServiceTimesAction.h"
 #include "neighbors.h"
@@ -110,6 +112,8 @@ static void statCountersInitSpecial(StatCounters *);
 static void statCountersClean(StatCounters *);
 static void statCountersCopy(StatCounters * dest, const StatCounters * orig);
 static double statPctileSvc(double, int, int);
+static double statPctileUnits(const int which, const double usec);
+static void statLatencyWindows(KidLatencies::Windows &windows);
 static void statStoreEntry(MemBuf * mb, StoreEntry * e);
 static double statCPUUsage(int minutes);
 static OBJH stat_objects_get;
@@ -969,31 +973,54 @@ DumpMallocStatistics(StoreEntry* sentry)
 #endif
 }
 
+/// the percentile of service times in the given window, in traditional units
+static double
+statWindowPctile(const KidLatencies::Windows &windows, const int w, const int which, const double pctile)
+{
+    return statPctileUnits(which, windows[w][which].percentile(pctile));
+}
+
 void
 GetServiceTimesStats(Mgr::ServiceTimesActionData& stats)
 {
+    static KidLatencies::Windows windows; // too big for the stack
+    if (KidLatencies::Enabled())
+        KidLatencies::Merge(windows); // all kids, as of their last statAvgTick()
+    else
+        statLatencyWindows(windows);
+
+    const int w5 = KidLatencies::wnd5min;
+    const int w60 = KidLatencies::wnd60min;
     for (int i = 0; i < Mgr::ServiceTimesActionData::seriesSize; ++i) {
         double p = (i + 1) * 5 / 100.0;
-        stats.http_requests5[i] = statPctileSvc(p, 5, PCTILE_HTTP);
-        stats.http_requests60[i] = statPctileSvc(p, 60, PCTILE_HTTP);
+        stats.http_requests5[i] = statWindowPctile(windows, w5, PCTILE_HTTP, p);
+        stats.http_requests60[i] = statWindowPctile(windows, w60, PCTILE_HTTP, p);
 
-        stats.cache_misses5[i] = statPctileSvc(p, 5, PCTILE_MISS);
-        stats.cache_misses60[i] = statPctileSvc(p, 60, PCTILE_MISS);
+        stats.cache_misses5[i] = statWindowPctile(windows, w5, PCTILE_MISS, p);
+        stats.cache_misses60[i] = statWindowPctile(windows, w60, PCTILE_MISS, p);
 
-        stats.cache_hits5[i] = statPctileSvc(p, 5, PCTILE_HIT);
-        stats.cache_hits60[i] = statPctileSvc(p, 60, PCTILE_HIT);
+        stats.cache_hits5[i] = statWindowPctile(windows, w5, PCTILE_HIT, p);
+        stats.cache_hits60[i] = statWindowPctile(windows, w60, PCTILE_HIT, p);
 
-        stats.near_hits5[i] = statPctileSvc(p, 5, PCTILE_NH);
-        stats.near_hits60[i] = statPctileSvc(p, 60, PCTILE_NH);
+        stats.near_hits5[i] = statWindowPctile(windows, w5, PCTILE_NH, p);
+        stats.near_hits60[i] = statWindowPctile(windows, w60, PCTILE_NH, p);
 
-        stats.not_modified_replies5[i] = statPctileSvc(p, 5, PCTILE_NM);
-        stats.not_modified_replies60[i] = statPctileSvc(p, 60, PCTILE_NM);
+        stats.not_modified_replies5[i] = statWindowPctile(windows, w5, PCTILE_NM, p);
+        stats.not_modified_replies60[i] = statWindowPctile(windows, w60, PCTILE_NM, p);
 
-        stats.dns_lookups5[i] = statPctileSvc(p, 5, PCTILE_DNS);
-        stats.dns_lookups60[i] = statPctileSvc(p, 60, PCTILE_DNS);
+        stats.dns_lookups5[i] = statWindowPctile(windows, w5, PCTILE_DNS, p);
+        stats.dns_lookups60[i] = statWindowPctile(windows, w60, PCTILE_DNS, p);
+
+        stats.icp_queries5[i] = statWindowPctile(windows, w5, PCTILE_ICP_QUERY, p);
+        stats.icp_queries60[i] = statWindowPctile(windows, w60, PCTILE_ICP_QUERY, p);
+    }
 
-        stats.icp_queries5[i] = statPctileSvc(p, 5, PCTILE_ICP_QUERY);
-        stats.icp_queries60[i] = statPctileSvc(p, 60, PCTILE_ICP_QUERY);
+    for (int k = 0; k < PCTILE_END; ++k) {
+        for (int j = 0; j < Mgr::ServiceTimesActionData::pctileCount; ++j) {
+            const double p = Mgr::ServiceTimesActionData::Pctiles[j];
+            stats.percentiles5[k][j] = windows[w5][k].percentile(p) / 1000.0;
+            stats.percentiles60[k][j] = windows[w60][k].percentile(p) / 1000.0;
+        }
     }
 }
 
@@ -1045,6 +1072,31 @@ DumpServiceTimesStats(Mgr::ServiceTimesActionData& stats, StoreEntry* sentry)
                           stats.icp_queries5[i] / fct,
                           stats.icp_queries60[i] / fct);
     }
+
+    static const char *const kinds[PCTILE_END] = {
+        "HTTP Requests (All)",
+        "ICP Queries",
+        "DNS Lookups",
+        "Cache Hits",
+        "Cache Misses",
+        "Not-Modified Replies",
+        "Near Hits",
+        "ICP Replies",
+        "Server Responses",
+        "ICAP Transactions",
+        "Disk I/O",
+        "Accept Delay"
+    };
+    fct = stats.count > 1 ? stats.count : 1.0;
+    storeAppendPrintf(sentry, "\nService Time Percentiles (msec)      p50       p90       p99     p99.9\n");
+    for (int k = 0; k < PCTILE_END; ++k) {
+        const double *const p5 = stats.percentiles5[k];
+        const double *const p60 = stats.percentiles60[k];
+        storeAppendPrintf(sentry, "\t%-21s 5 min %9.3f %9.3f %9.3f %9.3f\n", kinds[k],
+                          p5[0] / fct, p5[1] / fct, p5[2] / fct, p5[3] / fct);
+        storeAppendPrintf(sentry, "\t%-21s60 min %9.3f %9.3f %9.3f %9.3f\n", "",
+                          p60[0] / fct, p60[1] / fct, p60[2] / fct, p60[3] / fct);
+    }
 }
 
 static void
@@ -1099,16 +1151,16 @@ GetAvgStat(Mgr::IntervalActionData& stats, int minutes, int hours)
     stats.client_http_kbytes_in = XAVG(client_http.kbytes_in.kb);
     stats.client_http_kbytes_out = XAVG(client_http.kbytes_out.kb);
 
-    stats.client_http_all_median_svc_time = statHistDeltaMedian(l->client_http.allSvcTime,
-                                            f->client_http.allSvcTime) / 1000.0;
-    stats.client_http_miss_median_svc_time = statHistDeltaMedian(l->client_http.missSvcTime,
-            f->client_http.missSvcTime) / 1000.0;
-    stats.client_http_nm_median_svc_time = statHistDeltaMedian(l->client_http.nearMissSvcTime,
-                                           f->client_http.nearMissSvcTime) / 1000.0;
-    stats.client_http_nh_median_svc_time = statHistDeltaMedian(l->client_http.nearHitSvcTime,
-                                           f->client_http.nearHitSvcTime) / 1000.0;
-    stats.client_http_hit_median_svc_time = statHistDeltaMedian(l->client_http.hitSvcTime,
-                                            f->client_http.hitSvcTime) / 1000.0;
+    stats.client_http_all_median_svc_time =
+        f->client_http.allSvcTime.deltaPctile(l->client_http.allSvcTime, 0.5) / 1000000.0;
+    stats.client_http_miss_median_svc_time =
+        f->client_http.missSvcTime.deltaPctile(l->client_http.missSvcTime, 0.5) / 1000000.0;
+    stats.client_http_nm_median_svc_time =
+        f->client_http.nearMissSvcTime.deltaPctile(l->client_http.nearMissSvcTime, 0.5) / 1000000.0;
+    stats.client_http_nh_median_svc_time =
+        f->client_http.nearHitSvcTime.deltaPctile(l->client_http.nearHitSvcTime, 0.5) / 1000000.0;
+    stats.client_http_hit_median_svc_time =
+        f->client_http.hitSvcTime.deltaPctile(l->client_http.hitSvcTime, 0.5) / 1000000.0;
 
     stats.server_all_requests = XAVG(server.all.requests);
     stats.server_all_errors = XAVG(server.all.errors);
@@ -1145,12 +1197,12 @@ GetAvgStat(Mgr::IntervalActionData& stats, int minutes, int hours)
     stats.icp_q_kbytes_recv = XAVG(icp.q_kbytes_recv.kb);
     stats.icp_r_kbytes_recv = XAVG(icp.r_kbytes_recv.kb);
 
-    stats.icp_query_median_svc_time = statHistDeltaMedian(l->icp.querySvcTime,
-                                      f->icp.querySvcTime) / 1000000.0;
-    stats.icp_reply_median_svc_time = statHistDeltaMedian(l->icp.replySvcTime,
-                                      f->icp.replySvcTime) / 1000000.0;
-    stats.dns_median_svc_time = statHistDeltaMedian(l->dns.svcTime,
-                                f->dns.svcTime) / 1000.0;
+    stats.icp_query_median_svc_time =
+        f->icp.querySvcTime.deltaPctile(l->icp.querySvcTime, 0.5) / 1000000.0;
+    stats.icp_reply_median_svc_time =
+        f->icp.replySvcTime.deltaPctile(l->icp.replySvcTime, 0.5) / 1000000.0;
+    stats.dns_median_svc_time =
+        f->dns.svcTime.deltaPctile(l->dns.svcTime, 0.5) / 1000000.0;
 
     stats.unlink_requests = XAVG(unlink.requests);
     stats.page_faults = XAVG(page_faults);
@@ -1344,8 +1396,15 @@ statRegisterWithCacheManager(void)
 {
     Mgr::RegisterAction("info", "General Runtime Information",
                         &Mgr::InfoAction::Create, 0, 1);
-    Mgr::RegisterAction("service_times", "Service Times (Percentiles)",
-                        &Mgr::ServiceTimesAction::Create, 0, 1);
+    // with shared histograms, any kid can report service times of all kids
+    if (KidLatencies::Enabled())
+        Mgr::RegisterLocalAction("service_times", "Service Times (Percentiles)",
+                                 &Mgr::ServiceTimesAction::Create, 0);
+    else
+        Mgr::RegisterAction("service_times", "Service Times (Percentiles)",
+                            &Mgr::ServiceTimesAction::Create, 0, 1);
+    Mgr::RegisterAction("phase_times", "Transaction Phase Times",
+                        &Mgr::PhaseTimesAction::Create, 0, 1);
     Mgr::RegisterAction("filedescriptors", "Process Filedescriptor Allocation",
                         fde::DumpStats, 0, 1);
     Mgr::RegisterAction("objects", "All Cache Objects", stat_objects_get, 0, 0);
@@ -1427,6 +1486,12 @@ statAvgTick(void *notused)
     statCountersCopy(t, c);
     ++NCountHist;
 
+    if (KidLatencies::Enabled()) {
+        static KidLatencies::Windows windows; // too big for the stack
+        statLatencyWindows(windows);
+        KidLatencies::Publish(windows);
+    }
+
     if ((NCountHist % COUNT_INTERVAL) == 0) {
         /* we have an hours worth of readings.  store previous hour */
         StatCounters *t2 = &CountHourHist[0];
@@ -1490,23 +1555,6 @@ statCountersInit(StatCounters * C)
 static void
 statCountersInitSpecial(StatCounters * C)
 {
-    /*
-     * HTTP svc_time hist is kept in milli-seconds; max of 3 hours.
-     */
-    C->client_http.allSvcTime.logInit(300, 0.0, 3600000.0 * 3.0);
-    C->client_http.missSvcTime.logInit(300, 0.0, 3600000.0 * 3.0);
-    C->client_http.nearMissSvcTime.logInit(300, 0.0, 3600000.0 * 3.0);
-    C->client_http.nearHitSvcTime.logInit(300, 0.0, 3600000.0 * 3.0);
-    C->client_http.hitSvcTime.logInit(300, 0.0, 3600000.0 * 3.0);
-    /*
-     * ICP svc_time hist is kept in micro-seconds; max of 1 minute.
-     */
-    C->icp.querySvcTime.logInit(300, 0.0, 1000000.0 * 60.0);
-    C->icp.replySvcTime.logInit(300, 0.0, 1000000.0 * 60.0);
-    /*
-     * DNS svc_time hist is kept in milli-seconds; max of 10 minutes.
-     */
-    C->dns.svcTime.logInit(300, 0.0, 60000.0 * 10.0);
     /*
      * Cache Digest Stuff
      */
@@ -1522,14 +1570,6 @@ static void
 statCountersClean(StatCounters * C)
 {
     assert(C);
-    C->client_http.allSvcTime.clear();
-    C->client_http.missSvcTime.clear();
-    C->client_http.nearMissSvcTime.clear();
-    C->client_http.nearHitSvcTime.clear();
-    C->client_http.hitSvcTime.clear();
-    C->icp.querySvcTime.clear();
-    C->icp.replySvcTime.clear();
-    C->dns.svcTime.clear();
     C->cd.on_xition_count.clear();
     C->comm_udp_incoming.clear();
     C->comm_dns_incoming.clear();
@@ -1548,15 +1588,7 @@ statCountersCopy(StatCounters * dest, const StatCounters * orig)
     statCountersInitSpecial(dest);
     /* now handle special cases */
     /* note: we assert that histogram capacities do not change */
-    dest->client_http.allSvcTime=orig->client_http.allSvcTime;
-    dest->client_http.missSvcTime=orig->client_http.missSvcTime;
-    dest->client_http.nearMissSvcTime=orig->client_http.nearMissSvcTime;
-    dest->client_http.nearHitSvcTime=orig->client_http.nearHitSvcTime;
-
-    dest->client_http.hitSvcTime=orig->client_http.hitSvcTime;
-    dest->icp.querySvcTime=orig->icp.querySvcTime;
-    dest->icp.replySvcTime=orig->icp.replySvcTime;
-    dest->dns.svcTime=orig->dns.svcTime;
+    /* note: LatencyHistogram service times were copied by memcpy() above */
     dest->cd.on_xition_count=orig->cd.on_xition_count;
     dest->comm_udp_incoming=orig->comm_udp_incoming;
     dest->comm_dns_incoming=orig->comm_dns_incoming;
@@ -1567,22 +1599,32 @@ statCountersCopy(StatCounters * dest, const StatCounters * orig)
 static void
 statCountersHistograms(StoreEntry * sentry)
 {
-    storeAppendPrintf(sentry, "client_http.allSvcTime histogram:\n");
-    statCounter.client_http.allSvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "client_http.missSvcTime histogram:\n");
-    statCounter.client_http.missSvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "client_http.nearMissSvcTime histogram:\n");
-    statCounter.client_http.nearMissSvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "client_http.nearHitSvcTime histogram:\n");
-    statCounter.client_http.nearHitSvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "client_http.hitSvcTime histogram:\n");
-    statCounter.client_http.hitSvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "icp.querySvcTime histogram:\n");
-    statCounter.icp.querySvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "icp.replySvcTime histogram:\n");
-    statCounter.icp.replySvcTime.dump(sentry, NULL);
-    storeAppendPrintf(sentry, "dns.svc_time histogram:\n");
-    statCounter.dns.svcTime.dump(sentry, NULL);
+    storeAppendPrintf(sentry, "client_http.allSvcTime histogram (usec):\n");
+    statCounter.client_http.allSvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "client_http.missSvcTime histogram (usec):\n");
+    statCounter.client_http.missSvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "client_http.nearMissSvcTime histogram (usec):\n");
+    statCounter.client_http.nearMissSvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "client_http.nearHitSvcTime histogram (usec):\n");
+    statCounter.client_http.nearHitSvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "client_http.hitSvcTime histogram (usec):\n");
+    statCounter.client_http.hitSvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "server.svcTime histogram (usec):\n");
+    statCounter.server.svcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "icp.querySvcTime histogram (usec):\n");
+    statCounter.icp.querySvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "icp.replySvcTime histogram (usec):\n");
+    statCounter.icp.replySvcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "dns.svc_time histogram (usec):\n");
+    statCounter.dns.svcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "icap.svcTime histogram (usec):\n");
+    statCounter.icap.svcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "disk.svcTime histogram (usec):\n");
+    statCounter.disk.svcTime.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "acceptor.delay histogram (usec):\n");
+    statCounter.acceptor.delay.dump(sentry, statHistIntDumper);
+    storeAppendPrintf(sentry, "acceptor.backlog histogram (connections):\n");
+    statCounter.acceptor.backlog.dump(sentry, statHistIntDumper);
     storeAppendPrintf(sentry, "select_fds_hist histogram:\n");
     statCounter.select_fds_hist.dump(sentry, NULL);
 }
@@ -1858,61 +1900,88 @@ statDigestBlob(StoreEntry * sentry)
     storeDigestReport(sentry);
 }
 
-static double
-statPctileSvc(double pctile, int interval, int which)
+/// the service time histogram for the given PCTILE_ kind
+static const LatencyHistogram &
+statLatencyHist(const StatCounters &c, const int which)
 {
-    StatCounters *f;
-    StatCounters *l;
-    double x;
-    assert(interval > 0);
-
-    if (interval > N_COUNT_HIST - 1)
-        interval = N_COUNT_HIST - 1;
-
-    f = &CountHist[0];
-
-    l = &CountHist[interval];
-
-    assert(f);
-
-    assert(l);
-
     switch (which) {
 
     case PCTILE_HTTP:
-        x = statHistDeltaPctile(l->client_http.allSvcTime,f->client_http.allSvcTime, pctile);
-        break;
+        return c.client_http.allSvcTime;
+
+    case PCTILE_ICP_QUERY:
+        return c.icp.querySvcTime;
+
+    case PCTILE_DNS:
+        return c.dns.svcTime;
 
     case PCTILE_HIT:
-        x = statHistDeltaPctile(l->client_http.hitSvcTime,f->client_http.hitSvcTime, pctile);
-        break;
+        return c.client_http.hitSvcTime;
 
     case PCTILE_MISS:
-        x = statHistDeltaPctile(l->client_http.missSvcTime,f->client_http.missSvcTime, pctile);
-        break;
+        return c.client_http.missSvcTime;
 
     case PCTILE_NM:
-        x = statHistDeltaPctile(l->client_http.nearMissSvcTime,f->client_http.nearMissSvcTime, pctile);
-        break;
+        return c.client_http.nearMissSvcTime;
 
     case PCTILE_NH:
-        x = statHistDeltaPctile(l->client_http.nearHitSvcTime,f->client_http.nearHitSvcTime, pctile);
-        break;
+        return c.client_http.nearHitSvcTime;
 
-    case PCTILE_ICP_QUERY:
-        x = statHistDeltaPctile(l->icp.querySvcTime,f->icp.querySvcTime, pctile);
-        break;
+    case PCTILE_ICP_REPLY:
+        return c.icp.replySvcTime;
 
-    case PCTILE_DNS:
-        x = statHistDeltaPctile(l->dns.svcTime,f->dns.svcTime, pctile);
-        break;
+    case PCTILE_SERVER:
+        return c.server.svcTime;
+
+    case PCTILE_ICAP:
+        return c.icap.svcTime;
 
-    default:
-        debugs(49, 5, "statPctileSvc: unknown type.");
-        x = 0;
+    case PCTILE_DISK:
+        return c.disk.svcTime;
+
+    case PCTILE_ACCEPT:
+        return c.acceptor.delay;
     }
 
-    return x;
+    fatalf("unknown service time kind %d", which);
+    return c.client_http.allSvcTime; // not reached
+}
+
+/// converts microseconds into the units traditionally reported for the
+/// given PCTILE_ kind: microseconds for ICP and milliseconds otherwise
+static double
+statPctileUnits(const int which, const double usec)
+{
+    if (which == PCTILE_ICP_QUERY || which == PCTILE_ICP_REPLY)
+        return usec;
+    return usec / 1000.0;
+}
+
+static double
+statPctileSvc(double pctile, int interval, int which)
+{
+    assert(interval > 0);
+
+    if (interval > N_COUNT_HIST - 1)
+        interval = N_COUNT_HIST - 1;
+
+    const LatencyHistogram &f = statLatencyHist(CountHist[0], which);
+    const LatencyHistogram &l = statLatencyHist(CountHist[interval], which);
+    return statPctileUnits(which, f.deltaPctile(l, pctile));
+}
+
+/// fills windows with service times recorded during the last 5 and 60 minutes
+static void
+statLatencyWindows(KidLatencies::Windows &windows)
+{
+    static const int minutes[KidLatencies::wndEnd] = { 5, 60 };
+    for (int w = 0; w < KidLatencies::wndEnd; ++w) {
+        const int interval = min(minutes[w], N_COUNT_HIST - 1);
+        for (int k = 0; k < PCTILE_END; ++k) {
+            windows[w][k] = statLatencyHist(CountHist[0], k);
+            windows[w][k] -= statLatencyHist(CountHist[interval], k);
+        }
+    }
 }
 
 StatCounters *
@@ -39,6 +39,15 @@
 #include "profiler/Profiler.h"
 #include "stmem.h"
 
+#include <algorithm>
+
+/// orders nodes by their start offset; see mem_hdr::nodeIndex()
+static bool
+NodeStartsAfter(int64_t location, const mem_node *aNode)
+{
+    return location < aNode->start();
+}
+
 /*
  * NodeGet() is called to get the data buffer to pass to storeIOWrite().
  * By setting the write_pending flag here we are assuming that there
@@ -57,10 +66,8 @@ mem_hdr::NodeGet(mem_node * aNode)
 int64_t
 mem_hdr::lowestOffset () const
 {
-    const SplayNode<mem_node *> *theStart = nodes.start();
-
-    if (theStart)
-        return theStart->data->nodeBuffer.offset;
+    if (!nodes.empty())
+        return nodes.front()->nodeBuffer.offset;
 
     return 0;
 }
@@ -69,10 +76,9 @@ int64_t
 mem_hdr::endOffset () const
 {
     int64_t result = 0;
-    const SplayNode<mem_node *> *theEnd = nodes.finish();
 
-    if (theEnd)
-        result = theEnd->data->dataRange().end;
+    if (!nodes.empty())
+        result = nodes.back()->dataRange().end;
 
     assert (result == inmem_hi);
 
@@ -82,7 +88,10 @@ mem_hdr::endOffset () const
 void
 mem_hdr::freeContent()
 {
-    nodes.destroy(SplayNode<mem_node *>::DefaultFree);
+    while (!nodes.empty()) {
+        delete nodes.back();
+        nodes.pop_back();
+    }
     inmem_hi = 0;
     debugs(19, 9, HERE << this << " hi: " << inmem_hi);
 }
@@ -95,7 +104,9 @@ mem_hdr::unlink(mem_node *aNode)
         return false;
     }
 
-    nodes.remove (aNode, NodeCompare);
+    const size_t i = nodeIndex(aNode->start());
+    assert(i < nodes.size() && nodes[i] == aNode);
+    nodes.erase(nodes.begin() + i);
     delete aNode;
     return true;
 }
@@ -104,16 +115,13 @@ int64_t
 mem_hdr::freeDataUpto(int64_t target_offset)
 {
     /* keep the last one to avoid change to other part of code */
-    SplayNode<mem_node*> const * theStart;
-
-    while ((theStart = nodes.start())) {
-        if (theStart == nodes.finish())
-            break;
+    while (nodes.size() > 1) {
+        mem_node *theStart = nodes.front();
 
-        if (theStart->data->end() > target_offset )
+        if (theStart->end() > target_offset )
             break;
 
-        if (!unlink(theStart->data))
+        if (!unlink(theStart))
             break;
     }
 
@@ -158,7 +166,30 @@ mem_hdr::writeAvailable(mem_node *aNode, int64_t location, size_t amount, char c
 void
 mem_hdr::appendNode (mem_node *aNode)
 {
-    nodes.insert (aNode, NodeCompare);
+    // writes usually arrive in order
+    if (nodes.empty() || nodes.back()->start() < aNode->start()) {
+        nodes.push_back(aNode);
+        return;
+    }
+
+    const Nodes::iterator pos = std::upper_bound(nodes.begin(), nodes.end(),
+                                aNode->start(), NodeStartsAfter);
+    nodes.insert(pos, aNode);
+}
+
+/// the capacity for a new node starting at offset
+size_t
+mem_hdr::nextCapacity(int64_t offset) const
+{
+    // Grow chunks with the object to keep their number small, but limit
+    // the unused tail of the last chunk to about a third of the data.
+    int64_t wanted = SM_PAGE_SIZE;
+    if (!nodes.empty() && offset > lowestOffset())
+        wanted = (offset - lowestOffset()) / 2;
+
+    wanted = ((wanted + SM_PAGE_SIZE - 1) / SM_PAGE_SIZE) * SM_PAGE_SIZE;
+    return static_cast<size_t>(max(min(wanted, static_cast<int64_t>(MaxChunkSize)),
+                                   static_cast<int64_t>(SM_PAGE_SIZE)));
 }
 
 void
@@ -169,10 +200,10 @@ mem_hdr::makeAppendSpace()
         return;
     }
 
-    if (!nodes.finish()->data->space())
-        appendNode (new mem_node (endOffset()));
+    if (!nodes.back()->space())
+        appendNode (new mem_node (endOffset(), nextCapacity(endOffset())));
 
-    assert (nodes.finish()->data->space());
+    assert (nodes.back()->space());
 }
 
 void
@@ -182,7 +213,7 @@ mem_hdr::internalAppend(const char *data, int len)
 
     while (len > 0) {
         makeAppendSpace();
-        int copied = appendToNode (nodes.finish()->data, data, len);
+        int copied = appendToNode (nodes.back(), data, len);
         assert (copied);
 
         len -= copied;
@@ -190,40 +221,52 @@ mem_hdr::internalAppend(const char *data, int len)
     }
 }
 
+/// the index of the node containing location or nodes.size()
+size_t
+mem_hdr::nodeIndex(int64_t location) const
+{
+    if (nodes.empty())
+        return 0;
+
+    // appends and readers of objects being fetched go to the last node
+    if (nodes.back()->start() <= location)
+        return nodes.back()->contains(location) ? nodes.size() - 1 : nodes.size();
+
+    // the first node starting after location follows the one we want
+    const Nodes::const_iterator pos = std::upper_bound(nodes.begin(), nodes.end(),
+                                      location, NodeStartsAfter);
+    if (pos == nodes.begin())
+        return nodes.size();
+
+    const size_t i = (pos - nodes.begin()) - 1;
+    return nodes[i]->contains(location) ? i : nodes.size();
+}
+
 /* returns a mem_node that contains location..
  * If no node contains the start, it returns NULL.
  */
 mem_node *
 mem_hdr::getBlockContainingLocation (int64_t location) const
 {
-    // Optimize: do not create a whole mem_node just to store location
-    mem_node target (location);
-    target.nodeBuffer.length = 1;
-    mem_node *const *result = nodes.find (&target, NodeCompare);
+    const size_t i = nodeIndex(location);
 
-    if (result)
-        return *result;
+    if (i < nodes.size())
+        return nodes[i];
 
     return NULL;
 }
 
-size_t
-mem_hdr::copyAvailable(mem_node *aNode, int64_t location, size_t amount, char *target) const
+StoreIOBuffer
+mem_hdr::view(int64_t location, size_t maxLength) const
 {
-    if (aNode->nodeBuffer.offset > location)
-        return 0;
-
-    assert (aNode->nodeBuffer.offset <= location);
-
-    assert (aNode->end() > location);
-
-    size_t copyOffset = location - aNode->nodeBuffer.offset;
-
-    size_t copyLen = min(amount, aNode->nodeBuffer.length - copyOffset);
+    const mem_node *aNode = getBlockContainingLocation(location);
 
-    memcpy(target, aNode->nodeBuffer.data + copyOffset, copyLen);
+    if (!aNode)
+        return StoreIOBuffer();
 
-    return copyLen;
+    const size_t skip = location - aNode->start();
+    return StoreIOBuffer(min(maxLength, aNode->nodeBuffer.length - skip), location,
+                         aNode->nodeBuffer.data + skip);
 }
 
 void
@@ -232,7 +275,7 @@ mem_hdr::debugDump() const
     debugs (19, 0, "mem_hdr::debugDump: lowest offset: " << lowestOffset() << " highest offset + 1: " << endOffset() << ".");
     std::ostringstream result;
     PointerPrinter<mem_node *> foo(result, " - ");
-    for_each (getNodes().begin(), getNodes().end(), foo);
+    std::for_each (getNodes().begin(), getNodes().end(), foo);
     debugs (19, 0, "mem_hdr::debugDump: Current available data is: " << result.str() << ".");
 }
 
@@ -263,9 +306,9 @@ mem_hdr::copy(StoreIOBuffer const &target) const
     assert(target.length > 0);
 
     /* Seek our way into store */
-    mem_node *p = getBlockContainingLocation(target.offset);
+    StoreIOBuffer source = view(target.offset, target.length);
 
-    if (!p) {
+    if (!source.length) {
         debugs(19, DBG_IMPORTANT, "memCopy: could not find start of " << target.range() <<
                " in memory.");
         debugDump();
@@ -278,24 +321,21 @@ mem_hdr::copy(StoreIOBuffer const &target) const
     int64_t location = target.offset;
 
     /* Start copying begining with this block until
-     * we're satiated */
-
-    while (p && bytes_to_go > 0) {
-        size_t bytes_to_copy = copyAvailable (p,
-                                              location, bytes_to_go, ptr_to_buf);
+     * we're satiated or hit a sparse patch */
 
-        /* hit a sparse patch */
+    while (source.length > 0) {
+        memcpy(ptr_to_buf, source.data, source.length);
 
-        if (bytes_to_copy == 0)
-            return target.length - bytes_to_go;
+        location += source.length;
 
-        location += bytes_to_copy;
+        ptr_to_buf += source.length;
 
-        ptr_to_buf += bytes_to_copy;
+        bytes_to_go -= source.length;
 
-        bytes_to_go -= bytes_to_copy;
+        if (!bytes_to_go)
+            break;
 
-        p = getBlockContainingLocation(location);
+        source = view(location, bytes_to_go);
     }
 
     return target.length - bytes_to_go;
@@ -320,9 +360,15 @@ bool
 mem_hdr::unionNotEmpty(StoreIOBuffer const &candidate)
 {
     assert (candidate.offset >= 0);
-    mem_node target(candidate.offset);
-    target.nodeBuffer.length = candidate.length;
-    return nodes.find (&target, NodeCompare);
+    const Range<int64_t> wanted(candidate.offset, candidate.offset + candidate.length);
+
+    // only the last node starting before the candidate end may overlap it
+    const Nodes::const_iterator pos = std::upper_bound(nodes.begin(), nodes.end(),
+                                      wanted.end - 1, NodeStartsAfter);
+    if (pos == nodes.begin())
+        return false;
+
+    return (*(pos - 1))->dataRange().intersection(wanted).size() > 0;
 }
 
 mem_node *
@@ -332,26 +378,20 @@ mem_hdr::nodeToRecieve(int64_t offset)
 
     if (!nodes.size()) {
         appendNode (new mem_node(offset));
-        return nodes.start()->data;
+        return nodes.front();
     }
 
     mem_node *candidate = NULL;
     /* case 2: location fits within an extant node */
 
-    if (offset > 0) {
-        mem_node search (offset - 1);
-        search.nodeBuffer.length = 1;
-        mem_node *const *leadup =  nodes.find (&search, NodeCompare);
-
-        if (leadup)
-            candidate = *leadup;
-    }
+    if (offset > 0)
+        candidate = getBlockContainingLocation(offset - 1);
 
     if (candidate && candidate->canAccept(offset))
         return candidate;
 
     /* candidate can't accept, so we need a new node */
-    candidate = new mem_node(offset);
+    candidate = new mem_node(offset, nextCapacity(offset));
 
     appendNode (candidate);
 
@@ -421,8 +461,8 @@ mem_hdr::NodeCompare(mem_node * const &left, mem_node * const &right)
 void
 mem_hdr::dump() const
 {
-    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.start() " << nodes.start());
-    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.finish() " << nodes.finish());
+    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.start() " << start());
+    debugs(20, DBG_IMPORTANT, "mem_hdr: " << (void *)this << " nodes.finish() " << (nodes.empty() ? NULL : nodes.back()));
 }
 
 size_t
@@ -434,15 +474,13 @@ mem_hdr::size() const
 mem_node const *
 mem_hdr::start() const
 {
-    const SplayNode<mem_node *> * result = nodes.start();
-
-    if (result)
-        return result->data;
+    if (!nodes.empty())
+        return nodes.front();
 
     return NULL;
 }
 
-const Splay<mem_node *> &
+const mem_hdr::Nodes &
 mem_hdr::getNodes() const
 {
     return nodes;
@@ -35,15 +35,27 @@
 
 #include "splay.h"
 #include "Range.h"
+#include "StoreIOBuffer.h"
+#include <deque>
 
 class mem_node;
 
-class StoreIOBuffer;
-
+/**
+ * In-memory object data: a sorted array of mem_node chunks. Chunks grow
+ * with the object, from SM_PAGE_SIZE up to MaxChunkSize bytes, so large
+ * objects are kept in relatively few chunks. Lookups use a binary search
+ * (after checking the last chunk, where appends and live readers go) and
+ * never modify the index.
+ */
 class mem_hdr
 {
 
 public:
+    typedef std::deque<mem_node *> Nodes;
+
+    /// the maximum size of a chunk allocated for sequential data
+    static const size_t MaxChunkSize = 64*1024;
+
     mem_hdr();
     ~mem_hdr();
     void freeContent();
@@ -51,6 +63,10 @@ public:
     int64_t endOffset () const;
     int64_t freeDataUpto (int64_t);
     ssize_t copy (StoreIOBuffer const &) const;
+    /// contiguous in-memory data starting at location, without copying;
+    /// the view is empty if location is not in memory and becomes invalid
+    /// when the data is freed
+    StoreIOBuffer view(int64_t location, size_t maxLength) const;
     bool hasContigousContentRange(Range<int64_t> const &range) const;
     /* success or fail */
     bool write (StoreIOBuffer const &);
@@ -62,7 +78,7 @@ public:
     /* access the contained nodes - easier than punning
      * as a contianer ourselves
      */
-    const Splay<mem_node *> &getNodes() const;
+    const Nodes &getNodes() const;
     char * NodeGet(mem_node * aNode);
 
     /* Only for use of MemObject */
@@ -76,12 +92,13 @@ private:
     void makeAppendSpace();
     int appendToNode(mem_node *aNode, const char *data, int maxLength);
     void appendNode (mem_node *aNode);
-    size_t copyAvailable(mem_node *aNode, int64_t location, size_t amount, char *target) const;
+    size_t nodeIndex(int64_t location) const;
+    size_t nextCapacity(int64_t offset) const;
     bool unionNotEmpty (StoreIOBuffer const &);
     mem_node *nodeToRecieve(int64_t offset);
     size_t writeAvailable(mem_node *aNode, int64_t location, size_t amount, char const *source);
     int64_t inmem_hi;
-    Splay<mem_node *> nodes;
+    Nodes nodes; ///< sorted by offset, not overlapping
 };
 
 #endif /* SQUID_STMEM_H */
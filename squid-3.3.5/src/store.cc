@@ -62,6 +62,7 @@
 #include "Store.h"
 #include "StoreClient.h"
 #include "StoreIOState.h"
+#include "StoreKeyTable.h"
 #include "StoreMeta.h"
 #include "StrList.h"
 #include "swap_log_op.h"
@@ -486,13 +487,13 @@ StoreEntry::hashInsert(const cache_key * someKey)
 {
     debugs(20, 3, "StoreEntry::hashInsert: Inserting Entry " << this << " key '" << storeKeyText(someKey) << "'");
     key = storeKeyDup(someKey);
-    hash_join(store_table, this);
+    store_table->insert(this);
 }
 
 void
 StoreEntry::hashDelete()
 {
-    hash_remove_link(store_table, this);
+    store_table->remove(this);
     storeKeyFree((const cache_key *)key);
     key = NULL;
 }
@@ -691,7 +692,7 @@ StoreEntry::setPrivateKey()
         newkey = storeKeyPrivate("JUNK", METHOD_NONE, getKeyCounter());
     }
 
-    assert(hash_lookup(store_table, newkey) == NULL);
+    assert(store_table->find(newkey) == NULL);
     EBIT_SET(flags, KEY_PRIVATE);
     hashInsert(newkey);
 }
@@ -795,7 +796,7 @@ StoreEntry::setPublicKey()
     } else
         newkey = storeKeyPublic(mem_obj->url, mem_obj->method);
 
-    if ((e2 = (StoreEntry *) hash_lookup(store_table, newkey))) {
+    if ((e2 = (StoreEntry *) store_table->find(newkey))) {
         debugs(20, 3, "StoreEntry::setPublicKey: Making old '" << mem_obj->url << "' private.");
         e2->setPrivateKey();
         e2->release();
@@ -1433,7 +1434,7 @@ storeConfigure(void)
                                (float) Config.Swap.highWaterMark) / (float) 100);
     store_swap_low = (long) (((float) Store::Root().maxSize() *
                               (float) Config.Swap.lowWaterMark) / (float) 100);
-    store_pages_max = Config.memMaxSize / sizeof(mem_node);
+    store_pages_max = Config.memMaxSize / SM_PAGE_SIZE; // see mem_node::InUseCount()
 }
 
 bool
@@ -43,6 +43,7 @@
 #include "Store.h"
 #include "store_key_md5.h"
 #include "StoreHashIndex.h"
+#include "StoreKeyTable.h"
 #include "SwapDir.h"
 #include "swap_log_op.h"
 #include "tools.h"
@@ -373,6 +374,10 @@ StoreController::stat(StoreEntry &output) const
     if (memStore)
         memStore->stat(output);
 
+    if (store_table)
+        storeAppendPrintf(&output, "Store Index Size       : %lu KB\n",
+                          (unsigned long int)(store_table->memoryUsed() >> 10));
+
     /* now the swapDir */
     swapDir->stat(output);
 }
@@ -875,8 +880,8 @@ StoreHashIndex::StoreHashIndex()
 StoreHashIndex::~StoreHashIndex()
 {
     if (store_table) {
-        hashFreeItems(store_table, destroyStoreEntry);
-        hashFreeMemory(store_table);
+        store_table->freeItems(destroyStoreEntry);
+        delete store_table;
         store_table = NULL;
     }
 }
@@ -933,7 +938,7 @@ StoreHashIndex::get(const cache_key *key)
 {
     PROF_start(storeGet);
     debugs(20, 3, "storeGet: looking up " << storeKeyText(key));
-    StoreEntry *p = static_cast<StoreEntry *>(hash_lookup(store_table, key));
+    StoreEntry *p = static_cast<StoreEntry *>(store_table->find(key));
     PROF_stop(storeGet);
     return p;
 }
@@ -969,8 +974,7 @@ StoreHashIndex::init()
            (Config.memShared ? " [shared]" : ""));
     debugs(20, DBG_IMPORTANT, "Max Swap size: " << (Store::Root().maxSize() >> 10) << " KB");
 
-    store_table = hash_create(storeKeyHashCmp,
-                              store_hash_buckets, storeKeyHashHash);
+    store_table = new StoreKeyTable(store_hash_buckets);
 
     for (int i = 0; i < Config.cacheSwap.n_configured; ++i) {
         /* this starts a search of the store dirs, loading their
@@ -1181,6 +1185,13 @@ StoreSearchHashIndex::currentItem()
     return entries.back();
 }
 
+void
+StoreSearchHashIndex::CopyEntry(hash_link *link, void *data)
+{
+    StoreSearchHashIndex *search = static_cast<StoreSearchHashIndex *>(data);
+    search->entries.push_back(static_cast<StoreEntry *>(link));
+}
+
 void
 StoreSearchHashIndex::copyBucket()
 {
@@ -1188,16 +1199,7 @@ StoreSearchHashIndex::copyBucket()
      * we copy them all to prevent races on the links. */
     debugs(47, 3, "StoreSearchHashIndex::copyBucket #" << bucket);
     assert (!entries.size());
-    hash_link *link_ptr = NULL;
-    hash_link *link_next = NULL;
-    link_next = hash_get_bucket(store_table, bucket);
-
-    while (NULL != (link_ptr = link_next)) {
-        link_next = link_ptr->next;
-        StoreEntry *e = (StoreEntry *) link_ptr;
-
-        entries.push_back(e);
-    }
+    store_table->walkBucket(bucket, &StoreSearchHashIndex::CopyEntry, this);
 
     ++bucket;
     debugs(47,3, "got entries: " << entries.size());
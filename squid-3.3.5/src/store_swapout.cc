@@ -136,6 +136,11 @@ doPages(StoreEntry *anEntry)
         if (!page)
             return; // wait for more data to become available
 
+        // nodes are written as a whole; wait for a growing node to fill up
+        if (anEntry->store_status == STORE_PENDING && page->space() > 0 &&
+                page->end() == mem->endOffset())
+            return;
+
         // memNodeWriteComplete() and absence of buffer offset math below
         // imply that we always write from the very beginning of the page
         assert(page->start() == mem->swapout.queue_offset);
@@ -14,6 +14,13 @@ Ssl::Config::Config() { printf("Ssl::Config::Config No implemented\n"); }
 Ssl::Config::~Config() { printf("Ssl::Config::Config No implemented\n"); }
 Ssl::Config Ssl::TheConfig;
 
+#include "ssl/CertSigner.h"
+Ssl::CertSignerCb::~CertSignerCb() STUB
+bool Ssl::CertSignerEnabled() STUB_RETVAL(false)
+void Ssl::CertSignerStart() STUB
+void Ssl::CertSignerStop() STUB
+void Ssl::GenerateCertificate(const CertificateProperties &, AsyncCall::Pointer &) STUB
+
 #include "ssl/context_storage.h"
 //Ssl::CertificateStorageAction::CertificateStorageAction(const Mgr::Command::Pointer &cmd) STUB
 Ssl::CertificateStorageAction::Pointer Ssl::CertificateStorageAction::Create(const Mgr::Command::Pointer &cmd) STUB_RETSTATREF(Ssl::CertificateStorageAction::Pointer)
@@ -41,6 +48,11 @@ Ssl::ErrorDetail::ErrorDetail(ssl_error_t err_no, X509 *, X509 *) STUB
 Ssl::ErrorDetail::ErrorDetail(ErrorDetail const &) STUB
 const String & Ssl::ErrorDetail::toString() const STUB_RETSTATREF(String)
 
+#include "ssl/SessionCache.h"
+void Ssl::SessionCache::ConfigureServerContext(SSL_CTX *) STUB
+SSL_SESSION *Ssl::SessionCache::GetOriginSession(const char *, const unsigned short) STUB_RETVAL(NULL)
+void Ssl::SessionCache::PutOriginSession(const char *, const unsigned short, SSL_SESSION *) STUB
+
 #include "ssl/support.h"
 SSL_CTX *sslCreateServerContext(AnyP::PortCfg &) STUB_RETVAL(NULL)
 SSL_CTX *sslCreateClientContext(const char *certfile, const char *keyfile, int version, const char *cipher, const char *options, const char *flags, const char *CAfile, const char *CApath, const char *CRLfile) STUB_RETVAL(NULL)
@@ -55,6 +67,7 @@ const char *sslGetUserCertificatePEM(SSL *ssl) STUB_RETVAL(NULL)
 const char *sslGetUserCertificateChainPEM(SSL *ssl) STUB_RETVAL(NULL)
 SSL_CTX * Ssl::generateSslContext(CertificateProperties const &properties, AnyP::PortCfg &) STUB_RETVAL(NULL)
 SSL_CTX * Ssl::generateSslContextUsingPkeyAndCertFromMemory(const char * data, AnyP::PortCfg &) STUB_RETVAL(NULL)
+SSL_CTX * Ssl::generateSslContextUsingPkeyAndCert(X509_Pointer &, EVP_PKEY_Pointer &, AnyP::PortCfg &) STUB_RETVAL(NULL)
 int Ssl::matchX509CommonNames(X509 *peer_cert, void *check_data, int (*check_func)(void *check_data,  ASN1_STRING *cn_data)) STUB_RETVAL(0)
 int Ssl::asn1timeToString(ASN1_TIME *tm, char *buf, int len) STUB_RETVAL(0)
 
@@ -4,5 +4,5 @@
 #define STUB_API "mem_node.cc"
 #include "tests/STUB.h"
 
-mem_node::mem_node(int64_t offset):nodeBuffer(0,offset,data) STUB
+mem_node::mem_node(int64_t offset):nodeBuffer(0,offset,static_cast<char *>(NULL)) STUB
         size_t mem_node::InUseCount() STUB_RETVAL(0)
@@ -8,11 +8,15 @@
 #define STUB_API "pconn.cc"
 #include "tests/STUB.h"
 
-IdleConnList::IdleConnList(const char *key, PconnPool *parent) STUB
+PconnKey::PconnKey(const Ip::Address &aRemote, const char *aDomain) : remote(aRemote), domain(aDomain), hashValue(0) STUB
+int PconnKey::Compare(const void *, const void *) STUB_RETVAL(0)
+unsigned int PconnKey::Hash(const void *, unsigned int) STUB_RETVAL(0)
+void PconnKey::format(char *, size_t) const STUB
+IdleConnList::IdleConnList(const PconnKey &aKey, PconnPool *) : key_(aKey) STUB
+IdleConnList::IdleConnList(const char *, PconnPool *) : key_(Ip::Address(), NULL) STUB
 IdleConnList::~IdleConnList() STUB
 void IdleConnList::push(const Comm::ConnectionPointer &conn) STUB
-Comm::ConnectionPointer IdleConnList::findUseable(const Comm::ConnectionPointer &key) STUB_RETVAL(Comm::ConnectionPointer())
-void IdleConnList::clearHandlers(const Comm::ConnectionPointer &conn) STUB
+Comm::ConnectionPointer IdleConnList::findUseable(const Comm::ConnectionPointer &key, bool reused) STUB_RETVAL(Comm::ConnectionPointer())
 PconnPool::PconnPool(const char *) STUB
 PconnPool::~PconnPool() STUB
 void PconnPool::moduleInit() STUB
@@ -20,9 +24,16 @@ void PconnPool::push(const Comm::ConnectionPointer &serverConn, const char *doma
 Comm::ConnectionPointer PconnPool::pop(const Comm::ConnectionPointer &destLink, const char *domain, bool retriable) STUB_RETVAL(Comm::ConnectionPointer())
 void PconnPool::count(int uses) STUB
 void PconnPool::noteUses(int) STUB
+void PconnPool::noteIdleTime(double, pconn_idle_end_t) STUB
 void PconnPool::dumpHist(StoreEntry *e) const STUB
 void PconnPool::dumpHash(StoreEntry *e) const STUB
 void PconnPool::unlinkList(IdleConnList *list) STUB
+void PconnPool::shareIdleConnections() STUB
+bool PconnPool::sharing() const STUB_RETVAL(false)
+void PconnPool::advertise(const char *, bool) STUB
+void PconnPool::dumpSharing(StoreEntry *) const STUB
+void PconnPool::HandleIdleConnRequest(const Ipc::PconnRequest &) STUB
+void PconnPool::HandleIdleConnDonation(const Ipc::PconnDonation &) STUB
 PconnModule * PconnModule::GetInstance() STUB_RETVAL(NULL)
 void PconnModule::DumpWrapper(StoreEntry *e) STUB
 PconnModule::PconnModule() STUB
@@ -17,7 +17,7 @@ void PrintRusage(void) STUB
 void death(int sig) STUB
 void BroadcastSignalIfAny(int& sig) STUB
 void sigusr2_handle(int sig) STUB
-void debug_trap(const char *message) STUB
+void debug_trap(const char *message) STUB_NOP
 void sig_child(int sig) STUB
 void sig_shutdown(int sig) STUB
 const char * getMyHostname(void) STUB_RETVAL(NULL)
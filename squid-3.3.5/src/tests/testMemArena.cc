@@ -0,0 +1,155 @@
+#define SQUID_UNIT_TEST 1
+
+#include "squid.h"
+#include "testMemArena.h"
+#include "MemArena.h"
+#include "Mem.h"
+#include "event.h"
+
+CPPUNIT_TEST_SUITE_REGISTRATION( testMemArena );
+
+/* let this test link sanely */
+void
+eventAdd(const char *name, EVH * func, void *arg, double when, int, bool cbdata)
+{}
+
+/* the number of arena blocks taken from their pool */
+static int
+ArenaBlocksInUse()
+{
+    int inUse = 0;
+    MemPoolIterator *iter = memPoolIterate();
+    while (MemImplementingAllocator *pool = memPoolIterateNext(iter)) {
+        if (strcmp(pool->objectType(), "MemArena block") == 0)
+            inUse = pool->getInUseCount();
+    }
+    memPoolIterateDone(&iter);
+    return inUse;
+}
+
+/* whether the memory is in the buffer embedded in the arena */
+static bool
+Embedded(const MemArena &arena, const void *p)
+{
+    const char *start = reinterpret_cast<const char *>(&arena);
+    const char *c = static_cast<const char *>(p);
+    return start <= c && c < start + sizeof(arena);
+}
+
+/* init memory pools */
+
+void
+testMemArena::setUp()
+{
+    Mem::Init();
+}
+
+void
+testMemArena::testAllocation()
+{
+    MemArena arena;
+
+    /* small allocations come from the embedded buffer and do not overlap */
+    char *a = static_cast<char *>(arena.alloc(10));
+    char *b = static_cast<char *>(arena.alloc(20));
+    CPPUNIT_ASSERT(Embedded(arena, a));
+    CPPUNIT_ASSERT(Embedded(arena, b));
+    CPPUNIT_ASSERT(b >= a + 10);
+    memset(a, 'a', 10);
+    memset(b, 'b', 20);
+    CPPUNIT_ASSERT_EQUAL('a', a[9]);
+
+    /* empty allocations still return distinct memory */
+    void *e1 = arena.alloc(0);
+    void *e2 = arena.alloc(0);
+    CPPUNIT_ASSERT(e1 != NULL);
+    CPPUNIT_ASSERT(e1 != e2);
+
+    /* string copies */
+    CPPUNIT_ASSERT_EQUAL(0, strcmp(arena.dup("http://example.com/"), "http://example.com/"));
+    CPPUNIT_ASSERT_EQUAL(0, strcmp(arena.ndup("http://example.com/", 5), "http"));
+    CPPUNIT_ASSERT_EQUAL(0, strcmp(arena.ndup("http", 100), "http"));
+}
+
+void
+testMemArena::testAlignment()
+{
+    MemArena arena;
+
+    /* odd sizes, enough of them to fill the embedded buffer and a block */
+    for (size_t i = 0; i < 400; ++i) {
+        void *p = arena.alloc(1 + i % 13);
+        CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(p) % sizeof(double));
+    }
+
+    /* oversized allocations */
+    void *big = arena.alloc(MemArena::BlockSize * 2 + 3);
+    CPPUNIT_ASSERT_EQUAL(static_cast<size_t>(0), reinterpret_cast<size_t>(big) % sizeof(double));
+}
+
+void
+testMemArena::testGrowth()
+{
+    const int blocksBefore = ArenaBlocksInUse();
+    {
+        MemArena arena;
+
+        char *first = static_cast<char *>(arena.alloc(MemArena::InlineSize));
+        CPPUNIT_ASSERT(Embedded(arena, first));
+        memset(first, 'x', MemArena::InlineSize);
+        CPPUNIT_ASSERT_EQUAL(blocksBefore, ArenaBlocksInUse());
+
+        /* the embedded buffer is full, so a pooled block is used */
+        char *second = static_cast<char *>(arena.alloc(100));
+        CPPUNIT_ASSERT(!Embedded(arena, second));
+        memset(second, 'y', 100);
+        CPPUNIT_ASSERT_EQUAL(blocksBefore + 1, ArenaBlocksInUse());
+
+        /* requests larger than a block do not use the block pool... */
+        char *big = static_cast<char *>(arena.alloc(MemArena::BlockSize * 3));
+        memset(big, 'z', MemArena::BlockSize * 3);
+        CPPUNIT_ASSERT_EQUAL(blocksBefore + 1, ArenaBlocksInUse());
+
+        /* ...and leave the current block in use for small ones */
+        char *third = static_cast<char *>(arena.alloc(100));
+        CPPUNIT_ASSERT(third >= second + 100);
+        CPPUNIT_ASSERT(third < second + MemArena::BlockSize);
+
+        /* growing past the first block takes another one */
+        for (size_t filled = 0; filled < MemArena::BlockSize; filled += 64)
+            memset(arena.alloc(64), 'w', 64);
+        CPPUNIT_ASSERT_EQUAL(blocksBefore + 2, ArenaBlocksInUse());
+
+        /* growth leaves earlier allocations intact */
+        CPPUNIT_ASSERT_EQUAL('x', first[MemArena::InlineSize - 1]);
+        CPPUNIT_ASSERT_EQUAL('y', second[99]);
+        CPPUNIT_ASSERT_EQUAL('z', big[MemArena::BlockSize * 3 - 1]);
+    }
+
+    /* destruction returns the blocks */
+    CPPUNIT_ASSERT_EQUAL(blocksBefore, ArenaBlocksInUse());
+}
+
+void
+testMemArena::testReset()
+{
+    const int blocksBefore = ArenaBlocksInUse();
+    MemArena arena;
+
+    void *first = arena.alloc(8);
+    for (size_t i = 0; i < 3 * MemArena::BlockSize / 64; ++i)
+        arena.alloc(64);
+    arena.alloc(MemArena::BlockSize * 2);
+    CPPUNIT_ASSERT(ArenaBlocksInUse() > blocksBefore);
+
+    /* reset returns all blocks and starts over with the embedded buffer */
+    arena.reset();
+    CPPUNIT_ASSERT_EQUAL(blocksBefore, ArenaBlocksInUse());
+    CPPUNIT_ASSERT(arena.alloc(8) == first);
+
+    /* the arena is fully usable after a reset */
+    char *s = arena.dup("reused");
+    CPPUNIT_ASSERT_EQUAL(0, strcmp(s, "reused"));
+    arena.alloc(MemArena::InlineSize);
+    CPPUNIT_ASSERT_EQUAL(blocksBefore + 1, ArenaBlocksInUse());
+}
@@ -0,0 +1,30 @@
+#ifndef SQUID_SRC_TEST_MEMARENA_H
+#define SQUID_SRC_TEST_MEMARENA_H
+
+#include <cppunit/extensions/HelperMacros.h>
+
+/*
+ * test the per-transaction memory arena
+ */
+
+class testMemArena : public CPPUNIT_NS::TestFixture
+{
+    CPPUNIT_TEST_SUITE( testMemArena );
+    CPPUNIT_TEST( testAllocation );
+    CPPUNIT_TEST( testAlignment );
+    CPPUNIT_TEST( testGrowth );
+    CPPUNIT_TEST( testReset );
+
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+
+protected:
+    void testAllocation();
+    void testAlignment();
+    void testGrowth();
+    void testReset();
+};
+
+#endif
@@ -68,3 +68,59 @@ void testString::testSubstr()
     String ref("34");
     CPPUNIT_ASSERT(check == ref);
 }
+
+void
+testString::testCopyShares()
+{
+    String s("0123456789");
+    const uint64_t shared = String::GetStats().shared;
+
+    /* copies and assignments share the original buffer */
+    String copy(s);
+    CPPUNIT_ASSERT(copy.rawBuf() == s.rawBuf());
+    String assigned;
+    assigned = s;
+    CPPUNIT_ASSERT(assigned.rawBuf() == s.rawBuf());
+    String appended;
+    appended.append(s);
+    CPPUNIT_ASSERT(appended.rawBuf() == s.rawBuf());
+    CPPUNIT_ASSERT_EQUAL(shared + 3, String::GetStats().shared);
+
+    /* copies of undefined strings stay undefined */
+    String nil;
+    String nilCopy(nil);
+    CPPUNIT_ASSERT(nilCopy.undefined());
+}
+
+void
+testString::testCopyOnWrite()
+{
+    String s("0123456789");
+    String copy(s);
+    const uint64_t unshared = String::GetStats().unshared;
+    const uint64_t allocated = String::GetStats().allocated;
+
+    /* modifying a copy leaves the original intact */
+    copy.cut(4);
+    CPPUNIT_ASSERT_EQUAL(unshared + 1, String::GetStats().unshared);
+    CPPUNIT_ASSERT_EQUAL(allocated + 1, String::GetStats().allocated);
+    CPPUNIT_ASSERT(copy.rawBuf() != s.rawBuf());
+    CPPUNIT_ASSERT(copy == String("0123"));
+    CPPUNIT_ASSERT(s == String("0123456789"));
+
+    /* so does modifying the original */
+    String other(s);
+    s.append("abc");
+    CPPUNIT_ASSERT(s == String("0123456789abc"));
+    CPPUNIT_ASSERT(other == String("0123456789"));
+
+    /* unshared buffers are modified in place */
+    const char *buf = copy.rawBuf();
+    copy.append("45", 2);
+    CPPUNIT_ASSERT(copy.rawBuf() == buf);
+    CPPUNIT_ASSERT(copy == String("012345"));
+
+    /* resetting a copy does not affect the original */
+    other = "x";
+    CPPUNIT_ASSERT(s == String("0123456789abc"));
+}
@@ -15,6 +15,8 @@ class testString : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST( testCmpEmptyString );
     CPPUNIT_TEST( testCmpNotEmptyDefault );
     CPPUNIT_TEST( testSubstr );
+    CPPUNIT_TEST( testCopyShares );
+    CPPUNIT_TEST( testCopyOnWrite );
 
     CPPUNIT_TEST_SUITE_END();
 
@@ -26,6 +28,8 @@ protected:
     void testCmpEmptyString();
     void testCmpNotEmptyDefault();
     void testSubstr();
+    void testCopyShares();
+    void testCopyOnWrite();
 };
 
 #endif
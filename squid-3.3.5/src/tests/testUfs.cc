@@ -6,11 +6,14 @@
 #include "globals.h"
 #include "HttpHeader.h"
 #include "HttpReply.h"
+#include "HttpRequestMethod.h"
 #include "Mem.h"
 #include "MemObject.h"
 #include "RequestFlags.h"
 #include "SquidConfig.h"
 #include "Store.h"
+#include "store_key_md5.h"
+#include "StoreKeyTable.h"
 #include "SwapDir.h"
 #include "testStoreSupport.h"
 #include "testUfs.h"
@@ -207,6 +210,8 @@ testUfs::testUfsSearch()
     CPPUNIT_ASSERT(search->isDone() == true);
     CPPUNIT_ASSERT(search->currentItem() == NULL);
 
+    aStore->closeLog(); // lets later test cases open their own swap logs
+
     Store::Root(NULL);
 
     free_cachedir(&Config.cacheSwap);
@@ -259,3 +264,96 @@ testUfs::testUfsDefaultEngine()
     if (0 > system ("rm -rf " TESTDIR))
         throw std::runtime_error("Failed to clean test work directory");
 }
+
+/// the store key of the n-th test object
+static const cache_key *
+compactTestKey(const int n)
+{
+    char url[64];
+    snprintf(url, sizeof(url), "http://example.com/compact/%d", n);
+    return storeKeyPublic(url, HttpRequestMethod(METHOD_GET));
+}
+
+/* With the lru policy, entries that maintain() offers from the compact index
+ * must be purged before recently requested ones, and offered entries that
+ * the policy keeps must return to the compact index.
+ */
+void
+testUfs::testUfsCompactIndexLru()
+{
+    if (0 > system ("rm -rf " TESTDIR))
+        throw std::runtime_error("Failed to clean test work directory");
+
+    CPPUNIT_ASSERT(!store_table); // or StoreHashIndex ctor will abort below
+
+    Store::Root(new StoreController);
+    SwapDirPointer aStore (new Fs::Ufs::UFSSwapDir("ufs", "Blocking"));
+    aStore->IO = new Fs::Ufs::UFSStrategy(DiskIOModule::Find("Blocking")->createStrategy());
+    addSwapDir(aStore);
+    commonInit();
+    Config.replPolicy = new RemovalPolicySettings;
+    Config.replPolicy->type = xstrdup ("lru");
+    mem_policy = createRemovalPolicy(Config.replPolicy);
+
+    char *path=xstrdup(TESTDIR);
+    char *config_line=xstrdup("foo 1 1 1 compact-index");
+    strtok(config_line, w_space);
+    aStore->parse(0, path);
+    safe_free(path);
+    safe_free(config_line);
+
+    aStore->create();
+    Store::Root().init();
+
+    StockEventLoop loop;
+    while (StoreController::store_dirs_rebuilding > 1)
+        loop.runOnce();
+
+    // storeRebuildComplete() is a stub; maintain() waits for the rebuild
+    const int rebuilding = StoreController::store_dirs_rebuilding;
+    StoreController::store_dirs_rebuilding = 0;
+
+    const int lowWaterMark = Config.Swap.lowWaterMark;
+    Config.Swap.lowWaterMark = 50;
+
+    /* fill 80% of the 1 MB cache_dir, as if loaded from swap.state */
+    const int objects = 200;
+    for (int i = 0; i < objects; ++i) {
+        CPPUNIT_ASSERT(!aStore->addDiskRestore(compactTestKey(i), i, 4096,
+                       squid_curtime + 100000, squid_curtime, squid_curtime,
+                       squid_curtime, 1, 0, 1));
+    }
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(objects), aStore->compactCount());
+
+    /* request the least recently added ones */
+    const int hot = 10;
+    for (int i = 0; i < hot; ++i)
+        CPPUNIT_ASSERT(aStore->get(compactTestKey(i)));
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint32_t>(objects - hot), aStore->compactCount());
+
+    CPPUNIT_ASSERT(aStore->currentSize() >= aStore->minSize());
+    aStore->maintain();
+    CPPUNIT_ASSERT(aStore->compactCount() < static_cast<uint32_t>(objects - hot));
+
+    for (int loops = 0; aStore->currentSize() >= aStore->minSize() && loops < 100; ++loops)
+        aStore->maintain();
+    CPPUNIT_ASSERT(aStore->currentSize() < aStore->minSize());
+    CPPUNIT_ASSERT(aStore->compactCount() > 0);
+
+    /* the requested entries survived, and no offered entry stayed a StoreEntry */
+    for (int i = 0; i < objects; ++i)
+        CPPUNIT_ASSERT_EQUAL(i < hot, store_table->find(compactTestKey(i)) != NULL);
+    CPPUNIT_ASSERT_EQUAL(static_cast<uint64_t>(aStore->compactCount() + hot), aStore->currentCount());
+
+    Config.Swap.lowWaterMark = lowWaterMark;
+    StoreController::store_dirs_rebuilding = rebuilding;
+
+    aStore->closeLog();
+    Store::Root(NULL);
+    free_cachedir(&Config.cacheSwap);
+    safe_free(Config.replPolicy->type);
+    delete Config.replPolicy;
+
+    if (0 > system ("rm -rf " TESTDIR))
+        throw std::runtime_error("Failed to clean test work directory");
+}
@@ -13,6 +13,7 @@ class testUfs : public CPPUNIT_NS::TestFixture
     CPPUNIT_TEST_SUITE( testUfs );
     CPPUNIT_TEST( testUfsSearch );
     CPPUNIT_TEST( testUfsDefaultEngine );
+    CPPUNIT_TEST( testUfsCompactIndexLru );
     CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -21,6 +22,7 @@ protected:
     void commonInit();
     void testUfsSearch();
     void testUfsDefaultEngine();
+    void testUfsCompactIndexLru();
 };
 
 #endif
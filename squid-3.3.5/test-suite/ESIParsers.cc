@@ -0,0 +1,258 @@
+/*
+ * DEBUG: section 86    ESI processing
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "esi/CustomParser.h"
+#include "esi/StreamParser.h"
+#if HAVE_LIBXML2
+#include "esi/Libxml2Parser.h"
+#endif
+#if HAVE_LIBEXPAT
+#include "esi/ExpatParser.h"
+#endif
+#include "SquidTime.h"
+#include "util.h"
+
+#include <string>
+#if HAVE_IOSTREAM
+#include <iostream>
+#endif
+#if HAVE_SSTREAM
+#include <sstream>
+#endif
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/*
+ * Checks that the stream parser reports the same elements, literals and
+ * comments as the custom parser however the template is split into
+ * buffers. With arguments, measures the throughput of all available
+ * parsers on a large generated template:
+ *
+ *   ./ESIParsers 60 [iterations]
+ *
+ * The template size is in KB; the custom parser is skipped for templates
+ * it cannot hold (64KB and larger).
+ */
+
+/// records parser callbacks as text, merging adjacent literals
+class RecordingClient : public ESIParserClient
+{
+public:
+    virtual void start(const char *el, const char **attr, size_t attrCount) {
+        flushLiteral();
+        events << "<" << el;
+        for (size_t i = 0; i < attrCount; ++i)
+            events << " " << attr[2*i] << "=" << attr[2*i + 1];
+        events << ">";
+    }
+    virtual void end(const char *el) {
+        flushLiteral();
+        events << "</" << el << ">";
+    }
+    virtual void parserDefault(const char *s, int len) {
+        literal.append(s, len);
+    }
+    virtual void parserComment(const char *s) {
+        flushLiteral();
+        events << "[" << s << "]";
+    }
+
+    std::string text() {
+        flushLiteral();
+        return events.str();
+    }
+
+private:
+    void flushLiteral() {
+        if (!literal.empty())
+            events << "{" << literal << "}";
+        literal.clear();
+    }
+
+    std::ostringstream events;
+    std::string literal;
+};
+
+/// counts parser callbacks
+class CountingClient : public ESIParserClient
+{
+public:
+    CountingClient(): elements(0), literalBytes(0) {}
+
+    virtual void start(const char *, const char **, size_t) { ++elements; }
+    virtual void end(const char *) {}
+    virtual void parserDefault(const char *, int len) { literalBytes += len; }
+    virtual void parserComment(const char *) {}
+
+    int elements;
+    int64_t literalBytes;
+};
+
+typedef ESIParser::Pointer (*ParserMaker)(ESIParserClient *);
+
+/// feeds the document to the parser in buffers of the given size
+static bool
+parseInPieces(ESIParser::Pointer parser, const std::string &document, size_t pieceSize)
+{
+    size_t offset = 0;
+    do {
+        const size_t len = min(pieceSize, document.size() - offset);
+        const bool last = offset + len == document.size();
+        if (!parser->parse(document.data() + offset, len, last))
+            return false;
+        offset += len;
+    } while (offset < document.size());
+    return true;
+}
+
+static void
+testSameEvents(const std::string &document)
+{
+    RecordingClient expected;
+    assert(parseInPieces(ESICustomParser::NewParser(&expected), document, document.size()));
+    const std::string expectedText = expected.text();
+
+    const size_t pieces[] = { 1, 2, 3, 5, 7, 13, 64, 4096, document.size() };
+    for (size_t i = 0; i < sizeof(pieces)/sizeof(pieces[0]); ++i) {
+        RecordingClient actual;
+        assert(parseInPieces(ESIStreamParser::NewParser(&actual), document, pieces[i]));
+        const std::string actualText = actual.text();
+        if (actualText != expectedText) {
+            std::cerr << "piece size " << pieces[i] << ":\n" << actualText <<
+                      "\nexpected:\n" << expectedText << std::endl;
+            assert(false);
+        }
+    }
+}
+
+static void
+testFailure(const std::string &document)
+{
+    for (size_t piece = 1; piece <= document.size(); ++piece) {
+        RecordingClient client;
+        assert(!parseInPieces(ESIStreamParser::NewParser(&client), document, piece));
+    }
+}
+
+static void
+testMarkup()
+{
+    testSameEvents("plain text without any markup");
+    testSameEvents("<html><body>a < b, <b>bold</b> &lt;esi:</body></html>");
+    testSameEvents("<p><esi:include src=\"http://example.com/a\"/></p>");
+    testSameEvents("<esi:include src='a' alt=\"b\" onerror=\"continue\" />tail");
+    testSameEvents("<ESI:try><esi:attempt>x<esi:include src=\"a\"/></esi:attempt>"
+                   "<esi:except>y</esi:except></ESI:try>");
+    testSameEvents("before<!-- a - comment -- with dashes -->after<!--esi <esi:vars>$(HTTP_HOST)</esi:vars>-->");
+    testSameEvents("<esi:remove><a href=\"x\">x</a></esi:remove><esi:comment text=\"c\"/>");
+    testSameEvents("trailing <");
+    testSameEvents("trailing <es");
+
+    testFailure("<esi:include src=\"a\"");
+    testFailure("<esi:try>never closed");
+    testFailure("stray </esi:try>");
+    testFailure("<!-- never closed");
+    testFailure("<esi:include src=noquotes/>");
+}
+
+/// an HTML page with an ESI include, some markup and a comment every 2KB
+static std::string
+makeTemplate(size_t size)
+{
+    std::string document = "<html xmlns:esi=\"http://www.edge-delivery.org/esi/1.0\"><body>\n";
+    int n = 0;
+    while (document.size() < size) {
+        std::ostringstream block;
+        block << "<div class=\"article\" id=\"a" << n << "\">\n";
+        for (int p = 0; p < 6; ++p)
+            block << "<p>Lorem ipsum dolor sit amet, <a href=\"/story/" << n << "/" << p <<
+                  "\">consectetur</a> adipiscing elit, sed do eiusmod tempor incididunt " <<
+                  "ut labore et dolore magna aliqua; a &lt; b &amp;&amp; c &gt; d.</p>\n";
+        block << "<!-- story " << n << " -->\n";
+        block << "<esi:include src=\"http://example.com/fragment/" << n << "\"/>\n";
+        block << "</div>\n";
+        document += block.str();
+        ++n;
+    }
+    document += "</body></html>\n";
+    return document;
+}
+
+static void
+benchmark(const char *name, ParserMaker maker, const std::string &document, int iterations)
+{
+    getCurrentTime();
+    const struct timeval start = current_time;
+    int elements = 0;
+    for (int i = 0; i < iterations; ++i) {
+        CountingClient client;
+        if (!parseInPieces(maker(&client), document, 4096)) {
+            std::cout << name << ": parse error" << std::endl;
+            return;
+        }
+        elements = client.elements;
+    }
+    getCurrentTime();
+    const double seconds = tvSubDsec(start, current_time);
+    const double megabytes = static_cast<double>(document.size()) * iterations / (1024 * 1024);
+    std::cout << name << ": " << (seconds > 0 ? megabytes / seconds : 0) << " MB/s, " <<
+              elements << " elements" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 1) {
+        const std::string document = makeTemplate(static_cast<size_t>(atoi(argv[1])) << 10);
+        const int iterations = argc > 2 ? atoi(argv[2]) : 10;
+        std::cout << (document.size() >> 10) << " KB template, " << iterations <<
+                  " iterations, 4KB buffers" << std::endl;
+        // the custom parser collects the template in a String, which asserts at 64KB
+        if (document.size() < 65535)
+            benchmark("custom", &ESICustomParser::NewParser, document, iterations);
+        else
+            std::cout << "custom: cannot parse templates over 64 KB" << std::endl;
+        benchmark("stream", &ESIStreamParser::NewParser, document, iterations);
+#if HAVE_LIBEXPAT
+        benchmark("expat", &ESIExpatParser::NewParser, document, iterations);
+#endif
+#if HAVE_LIBXML2
+        benchmark("libxml2", &ESILibxml2Parser::NewParser, document, iterations);
+#endif
+        return 0;
+    }
+
+    testMarkup();
+    testSameEvents(makeTemplate(60 << 10));
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * DEBUG: section 18    Cache Manager Statistics
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "LatencyHistogram.h"
+
+#if HAVE_IOSTREAM
+#include <iostream>
+#endif
+
+/*
+ * Checks LatencyHistogram bin math, percentiles, and snapshot arithmetic.
+ */
+
+/// the largest relative error a bin may introduce
+static const double MaxError = 1.0 / LatencyHistogram::SubCount;
+
+/// whether the reported value is within bin precision of the expected one
+static bool
+closeTo(const double reported, const double expected)
+{
+    const double error = reported > expected ? reported - expected : expected - reported;
+    return error <= expected * MaxError + 1;
+}
+
+static void
+testBins()
+{
+    // small values get exact bins
+    for (uint64_t v = 0; v < static_cast<uint64_t>(LatencyHistogram::SubCount); ++v) {
+        assert(LatencyHistogram::FindBin(v) == static_cast<int>(v));
+        assert(LatencyHistogram::BinWidth(v) == 1);
+    }
+
+    // bins are contiguous and every value falls into its bin range
+    uint64_t expectedMin = 0;
+    for (int bin = 0; bin < LatencyHistogram::BinCount; ++bin) {
+        const uint64_t min = LatencyHistogram::BinMin(bin);
+        const uint64_t width = LatencyHistogram::BinWidth(bin);
+        assert(min == expectedMin);
+        assert(LatencyHistogram::FindBin(min) == bin);
+        assert(LatencyHistogram::FindBin(min + width - 1) == bin);
+        expectedMin = min + width;
+    }
+    assert(expectedMin == static_cast<uint64_t>(1) << LatencyHistogram::MaxBits);
+
+    // huge values share the last bin
+    assert(LatencyHistogram::FindBin(expectedMin) == LatencyHistogram::BinCount - 1);
+    assert(LatencyHistogram::FindBin(~static_cast<uint64_t>(0)) == LatencyHistogram::BinCount - 1);
+}
+
+static void
+testPercentiles()
+{
+    LatencyHistogram h;
+    assert(h.total() == 0);
+    assert(h.percentile(0.5) == 0.0);
+
+    for (uint64_t v = 1; v <= 100000; ++v)
+        h.count(v);
+    assert(h.total() == 100000);
+    assert(closeTo(h.percentile(0.5), 50000));
+    assert(closeTo(h.percentile(0.9), 90000));
+    assert(closeTo(h.percentile(0.99), 99000));
+    assert(closeTo(h.percentile(0.999), 99900));
+    assert(closeTo(h.percentile(1.0), 100000));
+
+    struct timeval start, finish;
+    start.tv_sec = 10;
+    start.tv_usec = 900000;
+    finish.tv_sec = 12;
+    finish.tv_usec = 100000;
+    assert(LatencyHistogram::Usec(start, finish) == 1200000);
+    assert(LatencyHistogram::Usec(finish, start) == 0); // clock went back
+
+    LatencyHistogram one;
+    one.count(start, finish);
+    assert(closeTo(one.percentile(0.5), 1200000));
+}
+
+static void
+testArithmetic()
+{
+    // merging two histograms equals counting all values in one
+    LatencyHistogram low, high, all;
+    for (uint64_t v = 1; v <= 1000; ++v) {
+        low.count(v);
+        high.count(v * 1000);
+        all.count(v);
+        all.count(v * 1000);
+    }
+
+    LatencyHistogram merged = low;
+    merged += high;
+    assert(merged.total() == all.total());
+    assert(merged.percentile(0.25) == all.percentile(0.25));
+    assert(merged.percentile(0.75) == all.percentile(0.75));
+
+    // subtracting a snapshot leaves values counted after it
+    const LatencyHistogram snapshot = merged;
+    for (int i = 0; i < 10; ++i)
+        merged.count(5000000);
+    assert(closeTo(merged.deltaPctile(snapshot, 0.5), 5000000));
+
+    LatencyHistogram delta = merged;
+    delta -= snapshot;
+    assert(delta.total() == 10);
+    assert(delta.percentile(0.5) == merged.deltaPctile(snapshot, 0.5));
+
+    merged.clear();
+    assert(merged.total() == 0);
+}
+
+int
+main(int argc, char **argv)
+{
+    testBins();
+    testPercentiles();
+    testArithmetic();
+    std::cout << "LatencyHistogram tests passed" << std::endl;
+    return 0;
+}
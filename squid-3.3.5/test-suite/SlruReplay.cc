@@ -0,0 +1,301 @@
+/*
+ * DEBUG: none          Segmented LRU Removal Policy
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "repl/slru/SlruSegments.h"
+
+#include <map>
+#include <string>
+#if HAVE_FSTREAM
+#include <fstream>
+#endif
+#if HAVE_IOSTREAM
+#include <iostream>
+#endif
+#if HAVE_SSTREAM
+#include <sstream>
+#endif
+#if HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+/*
+ * Checks SlruSegments bookkeeping and scan resistance on a synthetic
+ * workload. Given a native access.log and a cache size, replays the GET
+ * requests through plain LRU, S4LRU and any extra segment layouts and
+ * reports their byte hit ratios:
+ *
+ *   ./SlruReplay access.log 1024 [2 | 50,30,20 ...]
+ *
+ * The cache size is in MB; layouts use cache_replacement_policy syntax.
+ */
+
+/// a byte-limited cache driven by SlruSegments, like the slru policy
+class ReplayCache
+{
+public:
+    ReplayCache(int64_t capacityBytes, int count, const int *shares):
+        capacity(capacityBytes), segments(count, shares), requestBytes(0), hitBytes(0), requests(0), hits(0) {}
+
+    ~ReplayCache() {
+        for (Items::iterator i = items.begin(); i != items.end(); ++i) {
+            segments.remove(i->second);
+            delete i->second;
+        }
+    }
+
+    void request(const std::string &url, int64_t size) {
+        ++requests;
+        requestBytes += size;
+
+        Items::iterator i = items.find(url);
+        if (i != items.end()) {
+            ++hits;
+            hitBytes += size;
+            segments.referenced(i->second, size);
+            return;
+        }
+
+        if (size > capacity)
+            return;
+
+        SlruSegments::Node *node = new SlruSegments::Node;
+        std::string *key = new std::string(url);
+        segments.add(node, key, size);
+        items[url] = node;
+
+        while (segments.byteCount() > capacity)
+            evict();
+    }
+
+    double byteHitRatio() const { return requestBytes ? 100.0 * hitBytes / requestBytes : 0.0; }
+    double hitRatio() const { return requests ? 100.0 * hits / requests : 0.0; }
+
+    /// checks that per-segment counters add up to the totals
+    bool consistent() const {
+        int n = 0;
+        int64_t b = 0;
+        for (int s = 0; s < segments.count(); ++s) {
+            int sn = 0;
+            int64_t sb = 0;
+            for (const SlruSegments::Node *node = segments.lru(s); node; node = SlruSegments::next(node)) {
+                if (node->segment != s)
+                    return false;
+                ++sn;
+                sb += node->size;
+            }
+            if (sn != segments.itemCount(s) || sb != segments.byteCount(s))
+                return false;
+            n += sn;
+            b += sb;
+        }
+        return n == segments.itemCount() && b == segments.byteCount() &&
+               n == static_cast<int>(items.size()) && b <= capacity;
+    }
+
+private:
+    typedef std::map<std::string, SlruSegments::Node *> Items;
+
+    void evict() {
+        for (int s = 0; s < segments.count(); ++s) {
+            if (SlruSegments::Node *victim = segments.lru(s)) {
+                std::string *key = static_cast<std::string *>(victim->link.data);
+                segments.remove(victim);
+                items.erase(*key);
+                delete key;
+                delete victim;
+                return;
+            }
+        }
+        assert(false);
+    }
+
+    int64_t capacity;
+    SlruSegments segments;
+    Items items;
+    int64_t requestBytes;
+    int64_t hitBytes;
+    int requests;
+    int hits;
+};
+
+/// parses a cache_replacement_policy slru layout; returns the segment count
+static int
+parseLayout(const char *layout, int *shares)
+{
+    int count = 0;
+    std::istringstream in(layout);
+    std::string share;
+    if (!strchr(layout, ',')) {
+        count = atoi(layout);
+        for (int i = 0; i < count && i < SlruSegments::MaxSegments; ++i)
+            shares[i] = 1;
+    } else {
+        while (std::getline(in, share, ',') && count < SlruSegments::MaxSegments)
+            shares[count++] = atoi(share.c_str());
+    }
+    assert(0 < count && count <= SlruSegments::MaxSegments);
+    return count;
+}
+
+static std::string
+objectUrl(const char *kind, int n)
+{
+    std::ostringstream url;
+    url << "http://example.com/" << kind << "/" << n;
+    return url.str();
+}
+
+/// a hot working set interleaved with a long one-time scan
+static void
+testScanResistance()
+{
+    const int shares[] = { 1, 1, 1, 1 };
+    ReplayCache lru(1000 * 1000, 1, shares);
+    ReplayCache slru(1000 * 1000, 4, shares);
+
+    for (int round = 0; round < 50; ++round) {
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int hot = 0; hot < 50; ++hot) {
+                lru.request(objectUrl("hot", hot), 10000);
+                slru.request(objectUrl("hot", hot), 10000);
+            }
+        }
+        for (int cold = 0; cold < 100; ++cold) {
+            lru.request(objectUrl("scan", round * 100 + cold), 10000);
+            slru.request(objectUrl("scan", round * 100 + cold), 10000);
+        }
+        assert(lru.consistent());
+        assert(slru.consistent());
+    }
+
+    // the scan flushes every hot object from LRU but not from S4LRU
+    assert(lru.byteHitRatio() == 25.0);
+    assert(slru.byteHitRatio() > 40.0);
+}
+
+/// a single segment behaves exactly like LRU
+static void
+testSingleSegment()
+{
+    const int shares[] = { 1 };
+    ReplayCache cache(3, 1, shares);
+    cache.request("a", 1);
+    cache.request("b", 1);
+    cache.request("c", 1);
+    cache.request("a", 1); // hit; b is now the LRU object
+    cache.request("d", 1); // evicts b
+    cache.request("a", 1); // hit
+    cache.request("b", 1); // miss
+    assert(cache.hitRatio() > 28.0 && cache.hitRatio() < 29.0);
+    assert(cache.consistent());
+}
+
+/// uneven object sizes and shares keep the counters consistent
+static void
+testMixedSizes()
+{
+    const int shares[] = { 5, 3, 2 };
+    ReplayCache cache(1 << 20, 3, shares);
+    unsigned int seed = 1;
+    for (int i = 0; i < 20000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        const int object = (seed >> 8) % 500;
+        const int64_t size = 1 + (object * 7919) % 60000;
+        cache.request(objectUrl("mixed", object), size);
+        if (i % 1000 == 0)
+            assert(cache.consistent());
+    }
+    assert(cache.consistent());
+}
+
+static int
+replay(const char *log, int64_t capacity, int layoutCount, char **layouts)
+{
+    const int defaults[] = { 1, 1, 1, 1 };
+    const int count = layoutCount + 2;
+    ReplayCache **caches = new ReplayCache *[count];
+    std::string *names = new std::string[count];
+    caches[0] = new ReplayCache(capacity, 1, defaults);
+    names[0] = "lru";
+    caches[1] = new ReplayCache(capacity, 4, defaults);
+    names[1] = "slru (S4LRU)";
+    for (int i = 0; i < layoutCount; ++i) {
+        int shares[SlruSegments::MaxSegments];
+        const int segments = parseLayout(layouts[i], shares);
+        caches[i + 2] = new ReplayCache(capacity, segments, shares);
+        names[i + 2] = std::string("slru ") + layouts[i];
+    }
+
+    std::ifstream in(log);
+    if (!in) {
+        std::cerr << "cannot open " << log << std::endl;
+        return 1;
+    }
+
+    // native format: time elapsed client code/status bytes method URL ...
+    std::string line;
+    int lines = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string time, elapsed, client, status, method, url;
+        int64_t bytes = 0;
+        if (!(fields >> time >> elapsed >> client >> status >> bytes >> method >> url))
+            continue;
+        if (method != "GET" || bytes <= 0)
+            continue;
+        ++lines;
+        for (int i = 0; i < count; ++i)
+            caches[i]->request(url, bytes);
+    }
+
+    std::cout << lines << " GET requests, cache size " << (capacity >> 20) << " MB" << std::endl;
+    for (int i = 0; i < count; ++i) {
+        std::cout << names[i] << ": byte hit ratio " << caches[i]->byteHitRatio() <<
+                  "%, hit ratio " << caches[i]->hitRatio() << "%" << std::endl;
+        delete caches[i];
+    }
+    delete[] caches;
+    delete[] names;
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (argc > 2)
+        return replay(argv[1], static_cast<int64_t>(atoi(argv[2])) << 20, argc - 3, argv + 3);
+
+    testSingleSegment();
+    testScanResistance();
+    testMixedSizes();
+    return 0;
+}
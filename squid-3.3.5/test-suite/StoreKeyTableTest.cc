@@ -0,0 +1,212 @@
+/*
+ * DEBUG: section 20    Storage Manager Key Table
+ *
+ * SQUID Web Proxy Cache          http://www.squid-cache.org/
+ * ----------------------------------------------------------
+ *
+ *  Squid is the result of efforts by numerous individuals from
+ *  the Internet community; see the CONTRIBUTORS file for full
+ *  details.   Many organizations have provided support for Squid's
+ *  development; see the SPONSORS file for full details.  Squid is
+ *  Copyrighted (C) 2001 by the Regents of the University of
+ *  California; see the COPYRIGHT file for full details.  Squid
+ *  incorporates software developed and/or copyrighted by other
+ *  sources; see the CREDITS file for full details.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111, USA.
+ *
+ */
+
+#include "squid.h"
+#include "hash.h"
+#include "HttpRequestMethod.h"
+#include "store_key_md5.h"
+#include "StoreKeyTable.h"
+#include "URL.h"
+
+#if HAVE_IOSTREAM
+#include <iostream>
+#endif
+#if HAVE_STRING_H
+#include <string.h>
+#endif
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+/*
+ * Checks StoreKeyTable against a simple model and, when given entry counts
+ * on the command line, measures lookups/s of StoreKeyTable and of the old
+ * chained hash_table store_table implementation:
+ *
+ *   ./StoreKeyTableTest 10000000 50000000
+ */
+
+/// deterministic pseudo-random MD5-like keys and their hash_links
+class KeySet
+{
+public:
+    explicit KeySet(size_t n): count(n) {
+        keys = static_cast<unsigned char *>(xmalloc(count * SQUID_MD5_DIGEST_LENGTH));
+        links = static_cast<hash_link *>(xcalloc(count, sizeof(hash_link)));
+        uint64_t state = 0x9E3779B97F4A7C15ULL;
+        for (size_t i = 0; i < count * SQUID_MD5_DIGEST_LENGTH; i += sizeof(state)) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            memcpy(keys + i, &state, sizeof(state));
+        }
+        for (size_t i = 0; i < count; ++i)
+            links[i].key = keys + i * SQUID_MD5_DIGEST_LENGTH;
+    }
+    ~KeySet() {
+        xfree(keys);
+        xfree(links);
+    }
+
+    size_t count;
+    unsigned char *keys;
+    hash_link *links;
+};
+
+/* store_key_md5.o needs these, but storeKeyHashHash() and storeKeyHashCmp() do not */
+#define STUB_API "StoreKeyTableTest.cc"
+#include "tests/STUB.h"
+const char *urlCanonical(HttpRequest *) STUB_RETVAL(NULL)
+const char *HttpRequestMethod::image() const STUB_RETVAL(NULL)
+
+static void
+CountLink(hash_link *, void *data)
+{
+    ++*static_cast<size_t *>(data);
+}
+
+static void
+MarkLink(hash_link *link, void *)
+{
+    assert(!link->next); // visited once
+    link->next = link;
+}
+
+static StoreKeyTable *TheTable = NULL;
+
+static void
+RemoveLink(void *data)
+{
+    // freeItems() callers remove links from the table; see destroyStoreEntry()
+    TheTable->remove(static_cast<hash_link *>(data));
+}
+
+static void
+testTable()
+{
+    const size_t n = 100000; // enough for several incremental resizes
+    KeySet set(n);
+    StoreKeyTable table(1024);
+    TheTable = &table;
+
+    for (size_t i = 0; i < n; ++i) {
+        assert(!table.find(set.links[i].key));
+        table.insert(&set.links[i]);
+        assert(table.find(set.links[i].key) == &set.links[i]);
+        // check earlier entries while they are being migrated
+        assert(table.find(set.links[i / 2].key) == &set.links[i / 2]);
+    }
+    assert(table.size() == n);
+
+    // every entry is walked exactly once
+    size_t walked = 0;
+    for (uint32_t b = 0; b < table.walkBuckets(); ++b)
+        table.walkBucket(b, &CountLink, &walked);
+    assert(walked == n);
+    for (uint32_t b = 0; b < table.walkBuckets(); ++b)
+        table.walkBucket(b, &MarkLink, NULL);
+    for (size_t i = 0; i < n; ++i) {
+        assert(set.links[i].next == &set.links[i]);
+        set.links[i].next = NULL;
+    }
+
+    // remove every third entry, including entries moved by earlier removals
+    for (size_t i = 0; i < n; i += 3)
+        table.remove(&set.links[i]);
+    for (size_t i = 0; i < n; ++i)
+        assert(table.find(set.links[i].key) == (i % 3 ? &set.links[i] : NULL));
+
+    walked = 0;
+    for (uint32_t b = 0; b < table.walkBuckets(); ++b)
+        table.walkBucket(b, &CountLink, &walked);
+    assert(walked == table.size());
+
+    table.freeItems(&RemoveLink);
+    assert(table.size() == 0);
+    for (size_t i = 0; i < n; ++i)
+        assert(!table.find(set.links[i].key));
+    TheTable = NULL;
+}
+
+static double
+Now()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void
+benchmark(size_t n)
+{
+    KeySet set(n);
+    const size_t lookups = 10000000;
+
+    StoreKeyTable *table = new StoreKeyTable(0x2000);
+    for (size_t i = 0; i < n; ++i)
+        table->insert(&set.links[i]);
+    double start = Now();
+    size_t found = 0;
+    for (size_t i = 0; i < lookups; ++i)
+        found += table->find(set.links[(i * 7919) % n].key) != NULL;
+    double elapsed = Now() - start;
+    assert(found == lookups);
+    std::cout << n << " entries: StoreKeyTable: " << (lookups / elapsed) << " lookups/s, " <<
+              (table->memoryUsed() >> 20) << " MB of slots" << std::endl;
+    delete table;
+
+    // the old store_table: 0x2000 or more buckets, store_objects_per_bucket 20
+    int buckets = 0x2000;
+    while (static_cast<size_t>(buckets) < n / 20)
+        buckets <<= 1;
+    hash_table *chained = hash_create(storeKeyHashCmp, buckets, storeKeyHashHash);
+    for (size_t i = 0; i < n; ++i)
+        hash_join(chained, &set.links[i]);
+    start = Now();
+    found = 0;
+    for (size_t i = 0; i < lookups; ++i)
+        found += hash_lookup(chained, set.links[(i * 7919) % n].key) != NULL;
+    elapsed = Now() - start;
+    assert(found == lookups);
+    std::cout << n << " entries: hash_table:    " << (lookups / elapsed) << " lookups/s" << std::endl;
+    hashFreeMemory(chained);
+}
+
+int
+main(int argc, char **argv)
+{
+    testTable();
+
+    for (int i = 1; i < argc; ++i)
+        benchmark(strtoul(argv[i], NULL, 10));
+
+    return 0;
+}
@@ -38,6 +38,7 @@
 #include "Generic.h"
 #include "base/TextException.h"
 
+#include <algorithm>
 #if HAVE_IOSTREAM
 #include <iostream>
 #endif
@@ -118,14 +119,51 @@ testHdrVisit()
     safe_free (sampleData);
     std::ostringstream result;
     PointerPrinter<mem_node *> foo(result, "\n");
-    for_each (aHeader.getNodes().end(), aHeader.getNodes().end(), foo);
-    for_each (aHeader.getNodes().begin(), aHeader.getNodes().begin(), foo);
-    for_each (aHeader.getNodes().begin(), aHeader.getNodes().end(), foo);
+    std::for_each (aHeader.getNodes().end(), aHeader.getNodes().end(), foo);
+    std::for_each (aHeader.getNodes().begin(), aHeader.getNodes().begin(), foo);
+    std::for_each (aHeader.getNodes().begin(), aHeader.getNodes().end(), foo);
     std::ostringstream expectedResult;
     expectedResult << "[100,101)" << std::endl << "[102,103)" << std::endl;
     assert (result.str() == expectedResult.str());
 }
 
+void
+testLargeObject()
+{
+    mem_hdr aHeader;
+    const int64_t objectSize = 1024 * 1024 + 100;
+    char page[SM_PAGE_SIZE];
+    for (int64_t offset = 0; offset < objectSize; offset += SM_PAGE_SIZE) {
+        const size_t len = min(static_cast<int64_t>(SM_PAGE_SIZE), objectSize - offset);
+        for (size_t i = 0; i < len; ++i)
+            page[i] = static_cast<char>((offset + i) % 251);
+        assert (aHeader.write (StoreIOBuffer(len, offset, page)));
+    }
+    assert (aHeader.endOffset() == objectSize);
+    /* chunks grow with the object */
+    assert (aHeader.size() < 40);
+    assert (mem_node::StoreMemSize() < objectSize * 3 / 2);
+
+    /* zero-copy views span whole chunks */
+    StoreIOBuffer view = aHeader.view(objectSize / 2, objectSize);
+    assert (view.length > SM_PAGE_SIZE);
+    assert (view.offset == objectSize / 2);
+    assert (*view.data == static_cast<char>((objectSize / 2) % 251));
+    assert (aHeader.view(objectSize, 1).length == 0);
+
+    /* copies cross chunk boundaries */
+    char *buf = static_cast<char *>(xmalloc(objectSize));
+    assert (aHeader.copy(StoreIOBuffer(objectSize - 1, 1, buf)) == objectSize - 1);
+    for (int64_t i = 0; i < objectSize - 1; ++i)
+        assert (buf[i] == static_cast<char>((i + 1) % 251));
+    xfree(buf);
+
+    /* the last chunk is kept */
+    assert (aHeader.freeDataUpto(objectSize) > objectSize / 2);
+    assert (aHeader.size() == 1);
+    assert (aHeader.hasContigousContentRange(Range<int64_t>(objectSize - 1, objectSize)));
+}
+
 int
 main(int argc, char **argv)
 {
@@ -136,5 +174,7 @@ main(int argc, char **argv)
     assert (mem_node::InUseCount() == 0);
     testHdrVisit();
     assert (mem_node::InUseCount() == 0);
+    testLargeObject();
+    assert (mem_node::InUseCount() == 0);
     return 0;
 }